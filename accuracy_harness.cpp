@@ -0,0 +1,495 @@
+// accuracy_harness.cpp
+//
+// Accuracy regression harness for the pricing kernels.
+//
+// Usage: accuracy_harness [baseline file] [update]
+// Every kernel variant prices an adversarial parameter grid (deep in and out of
+// the money, T near 0, tiny and huge sig, large r * T as in Batch 4) and is compared
+// with ReferenceOptionFunction in long double. The report lists max and RMS
+// absolute and relative error and throughput per variant. The run fails (exit
+// code 1) when a point exceeds both the absolute and the relative limit of its
+// variant, or, with a baseline file, when the max error of a variant grows past
+// twice the baseline. "update" rewrites the baseline. The book kernels run in
+// every instruction set variant the cpu supports, which must also agree with the
+// baseline variant within CpuDispatch::TOLERANCE.
+// Relative errors skip reference values below 1e-8, where only absolute error is meaningful.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "american_option_function.hpp"
+#include "chebyshev_table.hpp"
+#include "cpu_dispatch.hpp"
+#include "european_option.hpp"
+#include "european_option_function.hpp"
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "reference_option_function.hpp"
+#include "time_roll.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+// One grid point.
+struct AccuracyCase {
+	OptionData data;
+	double S;
+};
+
+enum AccuracyQuantity { CALL, PUT, CALL_DELTA, PUT_DELTA, GAMMA, AMERICAN_CALL, AMERICAN_PUT };
+
+// Kernel variant, price(grid, out) fills one value per grid point.
+struct AccuracyVariant {
+	string name;
+	AccuracyQuantity quantity;
+	double absLimit;	// Max absolute error, price units at K = 100.
+	double relLimit;	// Max relative error.
+	function<void(const vector<AccuracyCase>&, double*)> price;
+};
+
+struct AccuracyResult {
+	size_t count;
+	size_t nonFinite;	// Kernel values that are not finite where the reference is.
+	size_t violations;	// Points over both the absolute and the relative limit.
+	double maxAbs, rmsAbs, maxRel, rmsRel;
+	size_t worstAbs, worstRel;	// Grid indexes.
+	double nsPerOption;
+};
+
+static long double Reference(AccuracyQuantity quantity, const AccuracyCase& c) {
+	switch (quantity) {
+	case CALL: return ReferenceOptionFunction::CallPrice(c.data, c.S);
+	case PUT: return ReferenceOptionFunction::PutPrice(c.data, c.S);
+	case CALL_DELTA: return ReferenceOptionFunction::CallDelta(c.data, c.S);
+	case PUT_DELTA: return ReferenceOptionFunction::PutDelta(c.data, c.S);
+	case GAMMA: return ReferenceOptionFunction::Gamma(c.data, c.S);
+	case AMERICAN_CALL: return ReferenceOptionFunction::AmericanCallPrice(c.data, c.S);
+	default: return ReferenceOptionFunction::AmericanPutPrice(c.data, c.S);
+	}
+}
+
+// European grid, K = 100 and t = 0, plus the test_european_option batches.
+static vector<AccuracyCase> EuropeanGrid() {
+	const double T[] = { 1e-6, 1e-4, 0.01, 0.1, 0.25, 1.0, 5.0, 30.0, 50.0 };
+	const double sig[] = { 1e-4, 0.01, 0.1, 0.3, 1.0, 2.0 };
+	const double r[] = { 0.0, 0.02, 0.08, 0.2 };
+	const double carry[] = { 0.0, -0.05, -1.0 };	// b = r + carry, -1 means b = 0.
+	vector<AccuracyCase> tmp;
+	for (int m = -12; m <= 12; m++) {
+		for (size_t i = 0; i < sizeof(T) / sizeof(T[0]); i++) {
+			for (size_t j = 0; j < sizeof(sig) / sizeof(sig[0]); j++) {
+				for (size_t k = 0; k < sizeof(r) / sizeof(r[0]); k++) {
+					for (size_t l = 0; l < sizeof(carry) / sizeof(carry[0]); l++) {
+						double b = (carry[l] == -1.0) ? 0.0 : r[k] + carry[l];
+						AccuracyCase c = { { T[i], 100.0, sig[j], r[k], b, 0.0, 0.0 }, 100.0 * exp(0.25 * m) };
+						tmp.push_back(c);
+					}
+				}
+			}
+		}
+	}
+	AccuracyCase batch[] = {
+		{ { 0.25, 65.0, 0.30, 0.08, 0.08, 0.0, 0.0 }, 60.0 },
+		{ { 1.0, 100.0, 0.2, 0.0, 0.0, 0.0, 0.0 }, 100.0 },
+		{ { 1.0, 10.0, 0.50, 0.12, 0.12, 0.0, 0.0 }, 5.0 },
+		{ { 30.0, 100.0, 0.30, 0.08, 0.08, 0.0, 0.0 }, 100.0 },
+		{ { 0.35, 65.0, 0.30, 0.08, 0.08, 0.10, 0.0 }, 60.0 }
+	};
+	tmp.insert(tmp.end(), batch, batch + sizeof(batch) / sizeof(batch[0]));
+	return tmp;
+}
+
+// Perpetual American grid below the call (call) or above the put (put) exercise
+// boundary, every point with T = 1 and with T = 0.
+static vector<AccuracyCase> AmericanGrid(bool call) {
+	const double T[] = { 1.0, 0.0 };	// Not used by the price, AmericanOption stores T = 0.
+	const double sig[] = { 0.02, 0.1, 0.2, 0.5, 1.0 };
+	const double r[] = { 0.01, 0.05, 0.1, 0.2 };
+	const double carry[] = { -0.005, -0.02, -0.1, -0.5 };
+	vector<AccuracyCase> tmp;
+	for (size_t j = 0; j < sizeof(sig) / sizeof(sig[0]); j++) {
+		for (size_t k = 0; k < sizeof(r) / sizeof(r[0]); k++) {
+			for (size_t l = 0; l < sizeof(carry) / sizeof(carry[0]); l++) {
+				double s2 = sig[j] * sig[j];
+				double b = r[k] + carry[l];
+				double h = b / s2 - 0.5;
+				double y = -h + (call ? 1.0 : -1.0) * sqrt(h * h + 2.0 * r[k] / s2);
+				double boundary = 100.0 * y / (y - 1.0);
+				for (int m = 1; m <= 40; m++) {
+					double S = call ? boundary * m / 41.0 : boundary * (1.0 + 0.25 * m);
+					for (size_t i = 0; i < sizeof(T) / sizeof(T[0]); i++) {
+						AccuracyCase c = { { T[i], 100.0, sig[j], r[k], b, 0.0, 0.0 }, S };
+						tmp.push_back(c);
+					}
+				}
+			}
+		}
+	}
+	return tmp;
+}
+
+static AccuracyResult Measure(const AccuracyVariant& v, const vector<AccuracyCase>& grid) {
+	AccuracyResult res = { 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0.0 };
+	vector<double> value(grid.size());
+
+	// Best of three timed passes.
+	double best = 1e300;
+	for (int pass = 0; pass < 3; pass++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		v.price(grid, value.data());
+		double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		best = min(best, ns);
+	}
+	res.nsPerOption = best / grid.size();
+
+	size_t relCount = 0;
+	for (size_t i = 0; i < grid.size(); i++) {
+		long double ref = Reference(v.quantity, grid[i]);
+		if (!isfinite((double)ref))
+			continue;
+		res.count++;
+		if (!isfinite(value[i])) {
+			res.nonFinite++;
+			continue;
+		}
+		double absErr = (double)fabsl(value[i] - ref);
+		res.rmsAbs += absErr * absErr;
+		if (absErr > res.maxAbs) {
+			res.maxAbs = absErr;
+			res.worstAbs = i;
+		}
+		double relErr = (double)(absErr / fabsl(ref));
+		if (absErr > v.absLimit && (fabsl(ref) < 1e-8L || relErr > v.relLimit))
+			res.violations++;
+		if (fabsl(ref) >= 1e-8L) {
+			res.rmsRel += relErr * relErr;
+			relCount++;
+			if (relErr > res.maxRel) {
+				res.maxRel = relErr;
+				res.worstRel = i;
+			}
+		}
+	}
+	res.rmsAbs = sqrt(res.rmsAbs / max(res.count, size_t(1)));
+	res.rmsRel = sqrt(res.rmsRel / max(relCount, size_t(1)));
+	return res;
+}
+
+static void PrintCase(const char* label, const AccuracyCase& c) {
+	cout << "    " << label << ": T = " << c.data.T << ", t = " << c.data.t << ", K = " << c.data.K << ", sig = " << c.data.sig
+		<< ", r = " << c.data.r << ", b = " << c.data.b << ", S = " << c.S << endl;
+}
+
+static void BookArrays(const vector<AccuracyCase>& grid, vector<OptionData>& data, vector<double>& spot) {
+	for (size_t i = 0; i < grid.size(); i++) {
+		data.push_back(grid[i].data);
+		spot.push_back(grid[i].S);
+	}
+}
+
+// Max difference of two book kernel variants, relative to max(price, K) for
+// European (strike) or to max(price, 1e-290) for American options.
+static double IsaDifference(BookKernel reference, BookKernel kernel, const vector<OptionData>& data,
+	const vector<double>& spot, bool strike) {
+	vector<double> a(data.size()), b(data.size());
+	reference(data.data(), spot.data(), a.data(), data.size());
+	kernel(data.data(), spot.data(), b.data(), data.size());
+	double tmp = 0.0;
+	for (size_t i = 0; i < data.size(); i++) {
+		if (!isfinite(a[i]))
+			continue;
+		double scale = max(fabs(a[i]), strike ? data[i].K : 1e-290);
+		double diff = isfinite(b[i]) ? fabs(b[i] - a[i]) / scale : 1e300;
+		tmp = max(tmp, diff);
+	}
+	return tmp;
+}
+
+// Baseline file: one line per variant, name max abs max rel, names without spaces.
+static map<string, pair<double, double> > ReadBaseline(const string& fileName) {
+	map<string, pair<double, double> > tmp;
+	ifstream in(fileName.c_str());
+	string name;
+	double maxAbs, maxRel;
+	while (in >> name >> maxAbs >> maxRel)
+		tmp[name] = make_pair(maxAbs, maxRel);
+	return tmp;
+}
+
+int main(int argc, char* argv[]) {
+	string baselineFile = (argc > 1) ? argv[1] : "";
+	bool update = (argc > 2) && string(argv[2]) == "update";
+
+	vector<AccuracyCase> european = EuropeanGrid();
+	vector<AccuracyCase> americanCall = AmericanGrid(true);
+	vector<AccuracyCase> americanPut = AmericanGrid(false);
+
+	// Prebuilt structures of the table and book engines, built outside the timed passes.
+	ChebyshevTable table;
+	table.Build(ChebyshevTableSpec());
+	vector<ChainOption> callBook, putBook;
+	for (size_t i = 0; i < european.size(); i++) {
+		ChainOption o = { european[i].data, european[i].S, uint32_t(i % 7), 'C' };
+		callBook.push_back(o);
+		o.optType = 'P';
+		putBook.push_back(o);
+	}
+	OptionChainEngine callChain(callBook), putChain(putBook);
+	TimeRollEngine callRoll(callBook), putRoll(putBook);
+
+	// Book kernels take the contracts and spots as arrays.
+	vector<OptionData> data, callData, putData;
+	vector<double> spot, callSpot, putSpot;
+	BookArrays(european, data, spot);
+	BookArrays(americanCall, callData, callSpot);
+	BookArrays(americanPut, putData, putSpot);
+
+	vector<AccuracyVariant> variants;
+	AccuracyVariant v;
+
+	v.name = "european_call"; v.quantity = CALL; v.absLimit = 5e-12; v.relLimit = 1e-6;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOptionFunction::CallPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "european_put"; v.quantity = PUT;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOptionFunction::PutPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "european_option_call"; v.quantity = CALL;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOption(g[i].data, "C").Price(g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "european_option_put"; v.quantity = PUT;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOption(g[i].data, "P").Price(g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "book_call"; v.quantity = CALL;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		EuropeanOptionFunction::CallPrice(data.data(), spot.data(), out, data.size());
+	};
+	variants.push_back(v);
+
+	v.name = "book_put"; v.quantity = PUT;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		EuropeanOptionFunction::PutPrice(data.data(), spot.data(), out, data.size());
+	};
+	variants.push_back(v);
+
+	// Book kernels of every instruction set variant the cpu supports, see CpuDispatch.
+	for (int isa = 0; isa < ISA_COUNT; isa++) {
+		const BookKernels* kernels = CpuDispatch::Kernels(CpuIsa(isa));
+		if (kernels == 0)
+			continue;
+		v.name = string("book_call_") + CpuDispatch::Name(CpuIsa(isa)); v.quantity = CALL;
+		v.price = [&data, &spot, kernels](const vector<AccuracyCase>&, double* out) {
+			kernels->europeanCall(data.data(), spot.data(), out, data.size());
+		};
+		variants.push_back(v);
+
+		v.name = string("book_put_") + CpuDispatch::Name(CpuIsa(isa)); v.quantity = PUT;
+		v.price = [&data, &spot, kernels](const vector<AccuracyCase>&, double* out) {
+			kernels->europeanPut(data.data(), spot.data(), out, data.size());
+		};
+		variants.push_back(v);
+	}
+
+	v.name = "chain_call"; v.quantity = CALL;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		callChain.Price(out);
+	};
+	variants.push_back(v);
+
+	v.name = "chain_put"; v.quantity = PUT;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		putChain.Price(out);
+	};
+	variants.push_back(v);
+
+	v.name = "time_roll_call"; v.quantity = CALL;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		callRoll.Roll(0.0);
+		copy(callRoll.Price().begin(), callRoll.Price().end(), out);
+	};
+	variants.push_back(v);
+
+	v.name = "time_roll_put"; v.quantity = PUT;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		putRoll.Roll(0.0);
+		copy(putRoll.Price().begin(), putRoll.Price().end(), out);
+	};
+	variants.push_back(v);
+
+	v.name = "call_delta"; v.quantity = CALL_DELTA; v.absLimit = 5e-12; v.relLimit = 1e-6;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOptionFunction::CallDelta(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "put_delta"; v.quantity = PUT_DELTA;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOptionFunction::PutDelta(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "gamma"; v.quantity = GAMMA; v.absLimit = 1e-10; v.relLimit = 1e-6;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = EuropeanOptionFunction::CallGamma(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "time_roll_delta"; v.quantity = CALL_DELTA; v.absLimit = 5e-12; v.relLimit = 1e-6;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		callRoll.Roll(0.0);
+		copy(callRoll.Delta().begin(), callRoll.Delta().end(), out);
+	};
+	variants.push_back(v);
+
+	v.name = "chebyshev_call"; v.quantity = CALL; v.absLimit = 5e-6; v.relLimit = 1e-6;
+	v.price = [&](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = table.CallPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "chebyshev_put"; v.quantity = PUT;
+	v.price = [&](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = table.PutPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "american_call"; v.quantity = AMERICAN_CALL; v.absLimit = 5e-10; v.relLimit = 1e-11;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = AmericanOptionFunction::CallPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "american_put"; v.quantity = AMERICAN_PUT;
+	v.price = [](const vector<AccuracyCase>& g, double* out) {
+		for (size_t i = 0; i < g.size(); i++)
+			out[i] = AmericanOptionFunction::PutPrice(g[i].data, g[i].S);
+	};
+	variants.push_back(v);
+
+	v.name = "american_book_call"; v.quantity = AMERICAN_CALL;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		AmericanOptionFunction::CallPrice(callData.data(), callSpot.data(), out, callData.size());
+	};
+	variants.push_back(v);
+
+	v.name = "american_book_put"; v.quantity = AMERICAN_PUT;
+	v.price = [&](const vector<AccuracyCase>&, double* out) {
+		AmericanOptionFunction::PutPrice(putData.data(), putSpot.data(), out, putData.size());
+	};
+	variants.push_back(v);
+
+	for (int isa = 0; isa < ISA_COUNT; isa++) {
+		const BookKernels* kernels = CpuDispatch::Kernels(CpuIsa(isa));
+		if (kernels == 0)
+			continue;
+		v.name = string("american_book_call_") + CpuDispatch::Name(CpuIsa(isa)); v.quantity = AMERICAN_CALL;
+		v.price = [&callData, &callSpot, kernels](const vector<AccuracyCase>&, double* out) {
+			kernels->americanCall(callData.data(), callSpot.data(), out, callData.size());
+		};
+		variants.push_back(v);
+
+		v.name = string("american_book_put_") + CpuDispatch::Name(CpuIsa(isa)); v.quantity = AMERICAN_PUT;
+		v.price = [&putData, &putSpot, kernels](const vector<AccuracyCase>&, double* out) {
+			kernels->americanPut(putData.data(), putSpot.data(), out, putData.size());
+		};
+		variants.push_back(v);
+	}
+
+	map<string, pair<double, double> > baseline;
+	if (!baselineFile.empty() && !update)
+		baseline = ReadBaseline(baselineFile);
+
+	cout << "Grid: " << european.size() << " European, " << americanCall.size() << " American call, "
+		<< americanPut.size() << " American put points" << endl;
+	cout << "Chebyshev table: " << table.Tiles() << " tiles, max normalized error " << table.MaxError() << endl;
+	cout << "Active book kernel variant: " << CpuDispatch::Name(CpuDispatch::Active()) << endl;
+	cout << string(118, '-') << endl;
+	cout << left << setw(30) << "variant" << right << setw(8) << "points" << setw(13) << "max abs" << setw(13) << "rms abs"
+		<< setw(13) << "max rel" << setw(13) << "rms rel" << setw(12) << "ns/option" << "  status" << endl;
+
+	bool failed = false;
+	ofstream out;
+	if (update && !baselineFile.empty())
+		out.open(baselineFile.c_str());
+	for (size_t n = 0; n < variants.size(); n++) {
+		const AccuracyVariant& var = variants[n];
+		const vector<AccuracyCase>& grid = (var.quantity == AMERICAN_CALL) ? americanCall : (var.quantity == AMERICAN_PUT ? americanPut : european);
+		AccuracyResult res = Measure(var, grid);
+
+		string status = "ok";
+		if (res.nonFinite > 0)
+			status = "FAIL non-finite";
+		else if (res.violations > 0)
+			status = "FAIL limit";
+		else if (baseline.count(var.name)) {
+			const pair<double, double>& base = baseline[var.name];
+			if (res.maxAbs > 2.0 * base.first + 1e-300 || res.maxRel > 2.0 * base.second + 1e-300)
+				status = "FAIL regression";
+		}
+		if (status != "ok")
+			failed = true;
+
+		cout << left << setw(30) << var.name << right << setw(8) << res.count << scientific << setprecision(3)
+			<< setw(13) << res.maxAbs << setw(13) << res.rmsAbs << setw(13) << res.maxRel << setw(13) << res.rmsRel
+			<< fixed << setprecision(1) << setw(12) << res.nsPerOption << "  " << status << endl;
+		cout.unsetf(ios::floatfield);
+		cout << setprecision(6);
+		if (status != "ok") {
+			PrintCase("worst abs", grid[res.worstAbs]);
+			PrintCase("worst rel", grid[res.worstRel]);
+		}
+		if (out.is_open())
+			out << var.name << " " << setprecision(17) << res.maxAbs << " " << res.maxRel << endl;
+	}
+	cout << string(118, '-') << endl;
+
+	// Every instruction set variant against the baseline one, see CpuDispatch::TOLERANCE.
+	const BookKernels* reference = CpuDispatch::Kernels(ISA_BASELINE);
+	for (int isa = ISA_BASELINE + 1; isa < ISA_COUNT; isa++) {
+		const BookKernels* kernels = CpuDispatch::Kernels(CpuIsa(isa));
+		if (kernels == 0)
+			continue;
+		double diff = max(max(IsaDifference(reference->europeanCall, kernels->europeanCall, data, spot, true),
+			IsaDifference(reference->europeanPut, kernels->europeanPut, data, spot, true)),
+			max(IsaDifference(reference->americanCall, kernels->americanCall, callData, callSpot, false),
+			IsaDifference(reference->americanPut, kernels->americanPut, putData, putSpot, false)));
+		bool ok = diff <= CpuDispatch::TOLERANCE;
+		cout << left << setw(8) << CpuDispatch::Name(CpuIsa(isa)) << right << " vs baseline: max scaled difference "
+			<< scientific << setprecision(3) << diff << (ok ? "  ok" : "  FAIL tolerance") << endl;
+		cout.unsetf(ios::floatfield);
+		cout << setprecision(6);
+		if (!ok)
+			failed = true;
+	}
+	cout << (failed ? "Accuracy regression" : "All variants within limits") << endl;
+	return failed ? 1 : 0;
+}
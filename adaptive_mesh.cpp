@@ -0,0 +1,140 @@
+// adaptive_mesh.cpp
+//
+// Adaptive mesh implementation.
+//
+
+#include "adaptive_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "option_data.hpp"
+#include "option_function.hpp"
+#include "pricing_metrics.hpp"
+
+using namespace std;
+
+AdaptiveMeshSpec::AdaptiveMeshSpec() : tolerance(1e-4), relTolerance(0.0), initialPoints(9), maxPoints(4096) {
+}
+
+namespace OptionFunction {
+namespace AdaptiveMesh {
+
+// Intervals narrower than this fraction of the range are not split, so a jump stops the refinement.
+static const double MIN_WIDTH = 1e-12;
+
+vector<CurvePoint> Sample(const function<double(double)>& f, double start, double end, const AdaptiveMeshSpec& spec) {
+	return SampleBatch([&f](const double* x, double* y, size_t size) {
+		for (size_t i = 0; i < size; i++)
+			y[i] = f(x[i]);
+	}, start, end, spec);
+}
+
+vector<CurvePoint> SampleBatch(const BatchCurve& f, double start, double end, const AdaptiveMeshSpec& spec) {
+	PRICING_METRIC("AdaptiveMesh::SampleBatch(const BatchCurve&, double, double, const AdaptiveMeshSpec&)", 0);
+	vector<CurvePoint> tmp;
+	if (!(end > start)) {
+		cout << "Wrong curve range" << endl;
+		return tmp;
+	}
+
+	// Start grid from the index, with both ends exact.
+	size_t initial = max<size_t>(spec.initialPoints, 2);
+	vector<double> x(initial), y(initial);
+	for (size_t i = 0; i < initial; i++)
+		x[i] = (i + 1 == initial) ? end : start + (end - start) * double(i) / double(initial - 1);
+	f(x.data(), y.data(), initial);
+	for (size_t i = 0; i < initial; i++) {
+		CurvePoint p = { x[i], y[i] };
+		tmp.push_back(p);
+	}
+
+	// Intervals to check, as pairs of points.
+	vector<pair<CurvePoint, CurvePoint> > pending;
+	for (size_t i = 0; i + 1 < initial; i++)
+		pending.push_back(make_pair(tmp[i], tmp[i + 1]));
+	double minWidth = (end - start) * MIN_WIDTH;
+	while (!pending.empty() && tmp.size() + pending.size() <= spec.maxPoints) {
+		size_t size = pending.size();
+		x.resize(size);
+		y.resize(size);
+		for (size_t i = 0; i < size; i++)
+			x[i] = 0.5 * (pending[i].first.x + pending[i].second.x);
+		f(x.data(), y.data(), size);
+
+		vector<pair<CurvePoint, CurvePoint> > next;
+		for (size_t i = 0; i < size; i++) {
+			CurvePoint m = { x[i], y[i] };
+			tmp.push_back(m);
+			double line = 0.5 * (pending[i].first.y + pending[i].second.y);
+			bool accurate = fabs(m.y - line) <= spec.tolerance + spec.relTolerance * fabs(m.y);
+			if (!accurate && m.x - pending[i].first.x > minWidth) {
+				next.push_back(make_pair(pending[i].first, m));
+				next.push_back(make_pair(m, pending[i].second));
+			}
+		}
+		pending.swap(next);
+	}
+
+	sort(tmp.begin(), tmp.end(), [](const CurvePoint& a, const CurvePoint& b) { return a.x < b.x; });
+	return tmp;
+}
+
+// Option function selected by value, 0 for a wrong name.
+static double (EuropeanOption::*Selected(const string& value))(double) const {
+	if (value == "Price")
+		return &EuropeanOption::Price;
+	if (value == "Delta")
+		return &EuropeanOption::Delta;
+	if (value == "Gamma")
+		return &EuropeanOption::Gamma;
+	cout << "Wrong curve value" << endl;
+	return 0;
+}
+
+vector<CurvePoint> Curve(const EuropeanOption& option, const string& value, double start, double end, const AdaptiveMeshSpec& spec) {
+	double (EuropeanOption::*f)(double) const = Selected(value);
+	if (!f)
+		return vector<CurvePoint>();
+	return Sample([&option, f](double S) { return (option.*f)(S); }, start, end, spec);
+}
+
+// Every point is evaluated on a copy with the parameter set, the option is not changed.
+vector<CurvePoint> Curve(const EuropeanOption& option, const string& value, const string& paramName, double start, double end, double S, const AdaptiveMeshSpec& spec) {
+	double (EuropeanOption::*f)(double) const = Selected(value);
+	OptionData data = option.Get();
+	if (!f)
+		return vector<CurvePoint>();
+	if (!SetParam(data, paramName, start)) {
+		cout << "Wrong parameter name" << endl;
+		return vector<CurvePoint>();
+	}
+	EuropeanOption copy(option);
+	return Sample([&copy, &data, &paramName, f, S](double x) {
+		SetParam(data, paramName, x);
+		copy.Set(data);
+		return (copy.*f)(S);
+	}, start, end, spec);
+}
+
+vector<CurvePoint> Curve(const AmericanOption& option, double start, double end, const AdaptiveMeshSpec& spec) {
+	return Sample([&option](double S) { return option.Price(S); }, start, end, spec);
+}
+
+double Interpolate(const vector<CurvePoint>& curve, double x) {
+	if (curve.empty())
+		return 0.0;
+	if (x <= curve.front().x)
+		return curve.front().y;
+	if (x >= curve.back().x)
+		return curve.back().y;
+	vector<CurvePoint>::const_iterator it = upper_bound(curve.begin(), curve.end(), x, [](double v, const CurvePoint& p) { return v < p.x; });
+	const CurvePoint& b = *it;
+	const CurvePoint& a = *(it - 1);
+	return a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x);
+}
+
+}	// Namespace AdaptiveMesh.
+}	// Namespace OptionFunction.
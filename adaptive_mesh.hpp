@@ -0,0 +1,66 @@
+// adaptive_mesh.hpp
+//
+// Header file for the adaptive mesh functions.
+// Price and greek curves sampled densely only where they bend.
+//
+
+#ifndef ADAPTIVE_MESH_HPP_
+#define ADAPTIVE_MESH_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "american_option.hpp"
+#include "european_option.hpp"
+
+using namespace std;
+
+// One sample of a curve.
+struct CurvePoint {
+	double x;
+	double y;
+};
+
+// Settings of the adaptive sampler.
+struct AdaptiveMeshSpec {
+	double tolerance;		// Accepted interpolation error, tolerance + relTolerance * |y|.
+	double relTolerance;
+	size_t initialPoints;	// Uniform start grid, at least 2.
+	size_t maxPoints;		// Refinement stops when the next pass would exceed it.
+
+	AdaptiveMeshSpec();	// 1e-4, 0, 9 and 4096.
+};
+
+// The sampler starts from a uniform grid and bisects every interval whose
+// midpoint is further than the tolerance from the straight line through the
+// interval ends, pass by pass, until every interval passes or maxPoints is
+// reached. Each pass evaluates all its midpoints in one call, so a batch curve
+// can use a vector kernel, and every evaluated point is kept: the number of
+// points returned is the number of evaluations. Far from the strike, where the
+// curves are almost linear, few points are needed; near the strike, where gamma
+// peaks, the intervals shrink. Points are returned in increasing x.
+namespace OptionFunction {
+namespace AdaptiveMesh {
+// Curve evaluated at size points at once: y[i] = f(x[i]).
+typedef function<void(const double* x, double* y, size_t size)> BatchCurve;
+
+vector<CurvePoint> Sample(const function<double(double)>& f, double start, double end, const AdaptiveMeshSpec& spec = AdaptiveMeshSpec());
+vector<CurvePoint> SampleBatch(const BatchCurve& f, double start, double end, const AdaptiveMeshSpec& spec = AdaptiveMeshSpec());
+
+// European option "Price", "Delta" or "Gamma" over the spot price.
+vector<CurvePoint> Curve(const EuropeanOption& option, const string& value, double start, double end, const AdaptiveMeshSpec& spec = AdaptiveMeshSpec());
+
+// European option "Price", "Delta" or "Gamma" over one parameter (see SetParam) at spot price S.
+vector<CurvePoint> Curve(const EuropeanOption& option, const string& value, const string& paramName, double start, double end, double S, const AdaptiveMeshSpec& spec = AdaptiveMeshSpec());
+
+// American option price over the spot price.
+vector<CurvePoint> Curve(const AmericanOption& option, double start, double end, const AdaptiveMeshSpec& spec = AdaptiveMeshSpec());
+
+// Linear interpolation of a sampled curve, the end values outside it.
+double Interpolate(const vector<CurvePoint>& curve, double x);
+
+}	// Namespace AdaptiveMesh.
+}	// Namespace OptionFunction.
+
+#endif	// ADAPTIVE_MESH_HPP_
@@ -9,7 +9,11 @@
 #include <vector>
 #include <iterator>
 #include <string>
+#include "american_option_function.hpp"
+#include "market_state.hpp"
 #include "option_data.hpp"
+#include "option_function.hpp"
+#include "pricing_metrics.hpp"
 
 using namespace std;
 
@@ -63,6 +67,7 @@ void AmericanOption::toggle() {
 }
 
 double AmericanOption::Price(double S) const {
+	PRICING_METRIC("AmericanOption::Price(double) const", 1);
 	if (optType == "C") {
 		return CallPrice(S);
 	} else {
@@ -71,6 +76,7 @@ double AmericanOption::Price(double S) const {
 }
 
 vector<double> AmericanOption::Price(const vector<double>& S) const {
+	PRICING_METRIC("AmericanOption::Price(const vector<double>&) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -80,9 +86,19 @@ vector<double> AmericanOption::Price(const vector<double>& S) const {
 }
 
 vector<double> AmericanOption::Price(double start, double end, double size) const {
+	PRICING_METRIC("AmericanOption::Price(double, double, double) const", 0);
 	return Price(MeshArray(start, end, size));
 }
 
+// The option itself is not changed, other threads may price it concurrently.
+double AmericanOption::Price(const MarketSnapshot& market) const {
+	PRICING_METRIC("AmericanOption::Price(const MarketSnapshot&) const", 1);
+	if (optType == "C")
+		return OptionFunction::AmericanOptionFunction::CallPrice(market.Apply(data), market.S);
+	else
+		return OptionFunction::AmericanOptionFunction::PutPrice(market.Apply(data), market.S);
+}
+
 double AmericanOption::CallPrice(double S) const {
 	double tmp = data.b / (data.sig * data.sig);
 	double y1 = 0.5 - tmp + sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * data.r / (data.sig * data.sig));
@@ -98,9 +114,5 @@ double AmericanOption::PutPrice(double S) const {
 }
 
 vector<double> AmericanOption::MeshArray(double start, double end, double size) const {
-	vector<double> tmp;
-	for (double i = start; i <= end; i += size) {
-		tmp.push_back(i);
-	}
-	return tmp;
-}
\ No newline at end of file
+	return OptionFunction::MeshArray(start, end, size);
+}
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "option.hpp"
 #include <string>
 #include <vector>
+#include "market_state.hpp"
 #include "option_data.hpp"
 
 using namespace std;
@@ -39,6 +40,7 @@ public:
 	double Price(double S) const;
 	vector<double> Price(const vector<double>& S) const;
 	vector<double> Price(double start, double end, double size) const;
+	double Price(const MarketSnapshot& market) const;	// Spot and market inputs of the snapshot.
 
 private:
 	string optType;	 // Option type (call, put).
@@ -6,8 +6,12 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include "american_option_function.hpp"
+#include "cpu_dispatch.hpp"
+#include "market_state.hpp"
 #include "option_data.hpp"
 #include "option_function.hpp"
+#include "pricing_metrics.hpp"
 
 using namespace std;
 // using namespace OptionFunction;
@@ -16,12 +20,14 @@ namespace OptionFunction{
 namespace AmericanOptionFunction {
 
 double CallPrice(double K, double sig, double r, double b, double S) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(double, double, double, double, double)", 1);
 	double tmp = b / (sig * sig);
 	double y1 = 0.5 - tmp + sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * r / (sig * sig));
 	return K / (y1 - 1) * pow((y1 - 1) / y1 * S / K, y1);
 }
 
 double CallPrice(const OptionData& data, double S) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const OptionData&, double)", 1);
 	double tmp = data.b / (data.sig * data.sig);
 	double y1 = 0.5 - tmp + sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * data.r / (data.sig * data.sig));
 	if (1.0 == y1) return S;
@@ -29,6 +35,7 @@ double CallPrice(const OptionData& data, double S) {
 }
 
 vector<double> CallPrice(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -38,10 +45,35 @@ vector<double> CallPrice(const OptionData& option, const vector<double>& S) {
 }
 
 vector<double> CallPrice(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const OptionData&, double, double, double)", 0);
 	return CallPrice(option, MeshArray(start, end, size));
 }
 
+double CallPrice(const OptionData& option, const MarketSnapshot& market) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const OptionData&, const MarketSnapshot&)", 0);
+	return CallPrice(market.Apply(option), market.S);
+}
+
+// Book kernel, the variant for this cpu, see CpuDispatch.
+void CallPrice(const OptionData* option, const double* S, double* price, size_t size) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const OptionData*, const double*, double*, size_t)", size);
+	CpuDispatch::Kernels()->americanCall(option, S, price, size);
+}
+
+// Using CallPrice(const OptionData*, const double*, double*, size_t).
+vector<double> CallPrice(const vector<OptionData>& option, const vector<double>& S) {
+	PRICING_METRIC("AmericanOptionFunction::CallPrice(const vector<OptionData>&, const vector<double>&)", option.size());
+	if (option.size() != S.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return vector<double>();
+	}
+	vector<double> tmp(option.size());
+	CallPrice(option.data(), S.data(), tmp.data(), tmp.size());
+	return tmp;
+}
+
 double PutPrice(double K, double sig, double r, double b, double S) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(double, double, double, double, double)", 1);
 	double tmp = b / (sig * sig);
 	double y2 = 0.5 - tmp - sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * r / (sig * sig));
 	if (1.0 == y2) return S;
@@ -49,12 +81,14 @@ double PutPrice(double K, double sig, double r, double b, double S) {
 }
 
 double PutPrice(const OptionData& data, double S) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const OptionData&, double)", 1);
 	double tmp = data.b / (data.sig * data.sig);
 	double y2 = 0.5 - tmp - sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * data.r / (data.sig * data.sig));
 	return data.K / (1 - y2) * pow((y2 - 1) / y2 * S / data.K, y2);
 }
 
 vector<double> PutPrice(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -64,8 +98,32 @@ vector<double> PutPrice(const OptionData& option, const vector<double>& S) {
 }
 
 vector<double> PutPrice(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const OptionData&, double, double, double)", 0);
 	return PutPrice(option, MeshArray(start, end, size));
 }
 
+double PutPrice(const OptionData& option, const MarketSnapshot& market) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const OptionData&, const MarketSnapshot&)", 0);
+	return PutPrice(market.Apply(option), market.S);
+}
+
+// Book kernel, the variant for this cpu, see CpuDispatch.
+void PutPrice(const OptionData* option, const double* S, double* price, size_t size) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const OptionData*, const double*, double*, size_t)", size);
+	CpuDispatch::Kernels()->americanPut(option, S, price, size);
+}
+
+// Using PutPrice(const OptionData*, const double*, double*, size_t).
+vector<double> PutPrice(const vector<OptionData>& option, const vector<double>& S) {
+	PRICING_METRIC("AmericanOptionFunction::PutPrice(const vector<OptionData>&, const vector<double>&)", option.size());
+	if (option.size() != S.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return vector<double>();
+	}
+	vector<double> tmp(option.size());
+	PutPrice(option.data(), S.data(), tmp.data(), tmp.size());
+	return tmp;
+}
+
 }	// Namespace AmericanOptionFunction
-}	// Namespace OptionFunction
\ No newline at end of file
+}	// Namespace OptionFunction
\ No newline at end of file
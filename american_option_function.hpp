@@ -6,7 +6,9 @@
 #ifndef AMERICAN_OPTION_FUNCTION_HPP_
 #define AMERICAN_OPTION_FUNCTION_HPP_
 
+#include <cstddef>
 #include <vector>
+#include "market_state.hpp"
 #include "option_data.hpp"
 
 using namespace std;
@@ -18,12 +20,22 @@ double CallPrice(double K, double sig, double r, double b, double S);   // Param
 double CallPrice(const OptionData& option, double S);   // OptionData version.
 vector<double> CallPrice(const OptionData& option, const vector<double>& S);    // Spot price vector version.
 vector<double> CallPrice(const OptionData& option, double start, double end, double size);	// Spot price mesh version.
+double CallPrice(const OptionData& option, const MarketSnapshot& market);	// Market snapshot version, see MarketState.
+
+// Call option pricing function with a book of options, one spot price per option.
+void CallPrice(const OptionData* option, const double* S, double* price, size_t size);	// Book array version.
+vector<double> CallPrice(const vector<OptionData>& option, const vector<double>& S);	// Book vector version.
 
 // Put option pricing function with spot price.
 double PutPrice(double K, double sig, double r, double b, double S);    // Param version.
 double PutPrice(const OptionData& option, double S);    // OptionData version.
 vector<double> PutPrice(const OptionData& option, const vector<double>& S); // Spot price vector version.
 vector<double> PutPrice(const OptionData& option, double start, double end, double size);   // Spot price mesh version.
+double PutPrice(const OptionData& option, const MarketSnapshot& market);	// Market snapshot version, see MarketState.
+
+// Put option pricing function with a book of options, one spot price per option.
+void PutPrice(const OptionData* option, const double* S, double* price, size_t size);	// Book array version.
+vector<double> PutPrice(const vector<OptionData>& option, const vector<double>& S);	// Book vector version.
 
 } // Namespace AmericanOptionFunction.
 }	// Namespace OptionFunction.
@@ -0,0 +1,356 @@
+// arbitrage_scanner.cpp
+//
+// ArbitrageScanner implementation.
+//
+
+#include "arbitrage_scanner.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "cpu_dispatch.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_trace.hpp"
+#include "simd_math.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARBITRAGE_X86 1
+#define ARBITRAGE_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Run part(0) ... part(parts - 1) on their own threads.
+static void RunParallel(size_t parts, const function<void(size_t)>& part) {
+	vector<thread> workers;
+	for (size_t i = 1; i < parts; i++)
+		workers.push_back(thread(part, i));
+	part(0);
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+// Split sorted index into parts ranges that do not cut a group.
+static vector<size_t> SplitGroups(const vector<size_t>& index, size_t parts, const function<bool(size_t, size_t)>& sameGroup) {
+	vector<size_t> bound(1, 0);
+	for (size_t i = 1; i < parts; i++) {
+		size_t b = index.size() * i / parts;
+		if (b < bound.back())
+			b = bound.back();
+		while (b > 0 && b < index.size() && sameGroup(index[b - 1], index[b]))
+			b++;
+		bound.push_back(b);
+	}
+	bound.push_back(index.size());
+	return bound;
+}
+
+static ArbitrageViolation MakeViolation(ArbitrageKind kind, size_t a, size_t b, size_t c, double amount) {
+	ArbitrageViolation tmp;
+	tmp.kind = kind;
+	tmp.quote[0] = a;
+	tmp.quote[1] = b;
+	tmp.quote[2] = c;
+	tmp.amount = amount;
+	return tmp;
+}
+
+ArbitrageTolerance::ArbitrageTolerance() : absolute(0.00001), relative(0.0) {
+}
+
+ArbitrageScanner::ArbitrageScanner(const ArbitrageTolerance& tolerance, size_t threads)
+	: tolerance(tolerance), threads(threads) {
+	if (this->threads == 0)
+		this->threads = thread::hardware_concurrency();
+	if (this->threads == 0)
+		this->threads = 1;
+}
+
+ArbitrageScanner::~ArbitrageScanner() {
+}
+
+bool ArbitrageScanner::Fails(double amount, double reference) const {
+	return amount > tolerance.absolute + tolerance.relative * fabs(reference);
+}
+
+// C - P = S exp((b - r) T) - K exp(-r T), which is CallToPut at the carry adjusted spot.
+void ArbitrageScanner::ScanParity(const vector<MarketQuote>& book, size_t begin, size_t end, vector<ArbitrageViolation>& out) const {
+	for (size_t i = begin; i < end; i++) {
+		const MarketQuote& q = book[i];
+		double forwardSpot = q.S * exp((q.data.b - q.data.r) * (q.data.T - q.data.t));
+		double amount = fabs(q.put - OptionFunction::EuropeanOptionFunction::CallToPut(q.data, q.call, forwardSpot));
+		if (Fails(amount, max(q.call, q.put)))
+			out.push_back(MakeViolation(PUT_CALL_PARITY, i, ARBITRAGE_NO_QUOTE, ARBITRAGE_NO_QUOTE, amount));
+	}
+}
+
+// Time to expiry.
+static double Tau(const MarketQuote& q) {
+	return q.data.T - q.data.t;
+}
+
+// Same underlying and time to expiry, a group of the strike pass.
+static bool SameExpiry(const MarketQuote& a, const MarketQuote& b) {
+	return a.underlying == b.underlying && Tau(a) == Tau(b);
+}
+
+// Same underlying and strike, a group of the calendar pass.
+static bool SameStrike(const MarketQuote& a, const MarketQuote& b) {
+	return a.underlying == b.underlying && a.data.K == b.data.K;
+}
+
+// Strike pass checks per block of the vector loop, a fixed trip count so the
+// loop vectorizes at -O2; the arrays are padded to whole blocks.
+static const size_t STRIKE_BLOCK = 64;
+
+// Strike pass of a part in structure of arrays. Entry n + 2 holds quote
+// index[n] of the sorted part, two leading entries make n - 2 valid, and the
+// entries are padded to whole blocks with checks that do not apply. pair is all
+// ones when the quote has a higher strike than the previous one of its group,
+// fly when the previous one has too.
+struct StrikeArrays {
+	vector<size_t> quote;
+	vector<double> call, put;
+	vector<double> bound;	// Strike step times the discount of the previous quote.
+	vector<double> lambda;	// Butterfly weight of the lowest strike.
+	vector<uint64_t> pair, fly;
+	double absolute, relative;	// Tolerance.
+
+	StrikeArrays(size_t size, const ArbitrageTolerance& tolerance)
+		: quote(2 + (size + STRIKE_BLOCK - 1) / STRIKE_BLOCK * STRIKE_BLOCK, ARBITRAGE_NO_QUOTE),
+		call(quote.size(), 0.0), put(quote.size(), 0.0), bound(quote.size(), 0.0), lambda(quote.size(), 0.0),
+		pair(quote.size(), 0), fly(quote.size(), 0), absolute(tolerance.absolute), relative(tolerance.relative) {
+	}
+};
+
+enum StrikeCheck { CALL_UP = 1, CALL_DOWN = 2, PUT_DOWN = 4, PUT_UP = 8, CALL_FLY = 16, PUT_FLY = 32 };
+
+// Violations of entry j, flags of the failed checks.
+static void EmitStrikes(const StrikeArrays& a, size_t j, uint64_t flags, const double* amount, vector<ArbitrageViolation>& out) {
+	size_t l = a.quote[j - 2], m = a.quote[j - 1], h = a.quote[j];
+	if (flags & CALL_UP)
+		out.push_back(MakeViolation(CALL_STRIKE, m, h, ARBITRAGE_NO_QUOTE, amount[0]));
+	if (flags & CALL_DOWN)
+		out.push_back(MakeViolation(CALL_STRIKE, m, h, ARBITRAGE_NO_QUOTE, amount[1]));
+	if (flags & PUT_DOWN)
+		out.push_back(MakeViolation(PUT_STRIKE, m, h, ARBITRAGE_NO_QUOTE, amount[2]));
+	if (flags & PUT_UP)
+		out.push_back(MakeViolation(PUT_STRIKE, m, h, ARBITRAGE_NO_QUOTE, amount[3]));
+	if (flags & CALL_FLY)
+		out.push_back(MakeViolation(CALL_CONVEXITY, l, m, h, amount[4]));
+	if (flags & PUT_FLY)
+		out.push_back(MakeViolation(PUT_CONVEXITY, l, m, h, amount[5]));
+}
+
+// The checks of entry j one at a time, the ISA_BASELINE loop.
+static void StrikesBaseline(const StrikeArrays& a, vector<ArbitrageViolation>& out) {
+	for (size_t j = 2; j < a.quote.size(); j++) {
+		if (!a.pair[j])
+			continue;
+		double amount[6];
+		amount[0] = a.call[j] - a.call[j - 1];
+		amount[1] = a.call[j - 1] - a.call[j] - a.bound[j];
+		amount[2] = a.put[j - 1] - a.put[j];
+		amount[3] = a.put[j] - a.put[j - 1] - a.bound[j];
+		amount[4] = -(a.lambda[j] * a.call[j - 2] + (1.0 - a.lambda[j]) * a.call[j] - a.call[j - 1]);
+		amount[5] = -(a.lambda[j] * a.put[j - 2] + (1.0 - a.lambda[j]) * a.put[j] - a.put[j - 1]);
+		double callLimit = a.absolute + a.relative * fabs(a.call[j - 1]);
+		double putLimit = a.absolute + a.relative * fabs(a.put[j]);
+		double flyPutLimit = a.absolute + a.relative * fabs(a.put[j - 1]);
+		uint64_t flags = (amount[0] > callLimit ? CALL_UP : 0) | (amount[1] > callLimit ? CALL_DOWN : 0)
+			| (amount[2] > putLimit ? PUT_DOWN : 0) | (amount[3] > putLimit ? PUT_UP : 0);
+		if (a.fly[j])
+			flags |= (amount[4] > callLimit ? CALL_FLY : 0) | (amount[5] > flyPutLimit ? PUT_FLY : 0);
+		if (flags)
+			EmitStrikes(a, j, flags, amount, out);
+	}
+}
+
+// Same checks without branches over a block, forced inline into one wrapper per
+// CpuDispatch variant; the few entries that fail are then emitted in order.
+SIMD_MATH_INLINE void StrikesBody(const StrikeArrays& a, vector<ArbitrageViolation>& out) {
+	double amount[6][STRIKE_BLOCK];
+	uint64_t flags[STRIKE_BLOCK];
+	const double* call = a.call.data();
+	const double* put = a.put.data();
+	const double* bound = a.bound.data();
+	const double* lambda = a.lambda.data();
+	const uint64_t* pair = a.pair.data();
+	const uint64_t* fly = a.fly.data();
+	double absolute = a.absolute, relative = a.relative;
+	for (size_t start = 2; start < a.quote.size(); start += STRIKE_BLOCK) {
+		for (size_t i = 0; i < STRIKE_BLOCK; i++) {
+			size_t j = start + i;
+			amount[0][i] = call[j] - call[j - 1];
+			amount[1][i] = call[j - 1] - call[j] - bound[j];
+			amount[2][i] = put[j - 1] - put[j];
+			amount[3][i] = put[j] - put[j - 1] - bound[j];
+			amount[4][i] = -(lambda[j] * call[j - 2] + (1.0 - lambda[j]) * call[j] - call[j - 1]);
+			amount[5][i] = -(lambda[j] * put[j - 2] + (1.0 - lambda[j]) * put[j] - put[j - 1]);
+			double callLimit = absolute + relative * fabs(call[j - 1]);
+			double putLimit = absolute + relative * fabs(put[j]);
+			double flyPutLimit = absolute + relative * fabs(put[j - 1]);
+			uint64_t strike = (amount[0][i] > callLimit ? uint64_t(CALL_UP) : 0) | (amount[1][i] > callLimit ? uint64_t(CALL_DOWN) : 0)
+				| (amount[2][i] > putLimit ? uint64_t(PUT_DOWN) : 0) | (amount[3][i] > putLimit ? uint64_t(PUT_UP) : 0);
+			uint64_t convexity = (amount[4][i] > callLimit ? uint64_t(CALL_FLY) : 0) | (amount[5][i] > flyPutLimit ? uint64_t(PUT_FLY) : 0);
+			flags[i] = (strike & pair[j]) | (convexity & fly[j]);
+		}
+		size_t n = min(STRIKE_BLOCK, a.quote.size() - start);
+		for (size_t i = 0; i < n; i++) {
+			if (flags[i]) {
+				double tmp[6] = { amount[0][i], amount[1][i], amount[2][i], amount[3][i], amount[4][i], amount[5][i] };
+				EmitStrikes(a, start + i, flags[i], tmp, out);
+			}
+		}
+	}
+}
+
+static void StrikesSse2(const StrikeArrays& a, vector<ArbitrageViolation>& out) {
+	StrikesBody(a, out);
+}
+
+#ifdef ARBITRAGE_X86
+ARBITRAGE_TARGET("avx2,fma")
+static void StrikesAvx2(const StrikeArrays& a, vector<ArbitrageViolation>& out) {
+	StrikesBody(a, out);
+}
+
+ARBITRAGE_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void StrikesAvx512(const StrikeArrays& a, vector<ArbitrageViolation>& out) {
+	StrikesBody(a, out);
+}
+#endif
+
+// index holds whole groups of one underlying and time to expiry, each sorted by
+// strike. The quotes are gathered into arrays, then checked by the variant for
+// this cpu; the gather through index costs most of the pass.
+void ArbitrageScanner::ScanStrikes(const vector<MarketQuote>& book, const size_t* index, size_t size, vector<ArbitrageViolation>& out) const {
+	StrikeArrays a(size, tolerance);
+	double r = 0.0, tau = 0.0, discount = 1.0;
+	for (size_t n = 0; n < size; n++) {
+		const MarketQuote& b = book[index[n]];
+		size_t j = n + 2;
+		a.quote[j] = index[n];
+		a.call[j] = b.call;
+		a.put[j] = b.put;
+		if (n == 0)
+			continue;
+		const MarketQuote& m = book[index[n - 1]];
+		if (!SameExpiry(m, b) || b.data.K <= m.data.K)
+			continue;	// New group or duplicate strike.
+		if (m.data.r != r || Tau(m) != tau) {
+			r = m.data.r;
+			tau = Tau(m);
+			discount = exp(-r * tau);
+		}
+		a.bound[j] = (b.data.K - m.data.K) * discount;
+		a.pair[j] = ~uint64_t(0);
+		if (a.pair[j - 1]) {
+			a.lambda[j] = (b.data.K - m.data.K) / (b.data.K - book[index[n - 2]].data.K);
+			a.fly[j] = ~uint64_t(0);
+		}
+	}
+
+	switch (CpuDispatch::Active()) {
+	case ISA_BASELINE:
+		StrikesBaseline(a, out);
+		break;
+#ifdef ARBITRAGE_X86
+	case ISA_AVX512:
+		StrikesAvx512(a, out);
+		break;
+	case ISA_AVX2:
+		StrikesAvx2(a, out);
+		break;
+#endif
+	default:
+		StrikesSse2(a, out);
+		break;
+	}
+}
+
+// index holds one underlying and strike, sorted by time to expiry. These groups
+// are the few expiries of one strike, too short for a vector loop.
+void ArbitrageScanner::ScanCalendar(const vector<MarketQuote>& book, const size_t* index, size_t size, vector<ArbitrageViolation>& out) const {
+	for (size_t n = 1; n < size; n++) {
+		const MarketQuote& a = book[index[n - 1]];
+		const MarketQuote& b = book[index[n]];
+		if (Tau(b) <= Tau(a) || a.data.b < a.data.r || b.data.b < b.data.r)
+			continue;
+		if (Fails(a.call - b.call, a.call))
+			out.push_back(MakeViolation(CALENDAR, index[n - 1], index[n], ARBITRAGE_NO_QUOTE, a.call - b.call));
+	}
+}
+
+vector<ArbitrageViolation> ArbitrageScanner::Scan(const vector<MarketQuote>& book) const {
+	size_t parts = min(threads, max(book.size() / 1024, size_t(1)));
+	vector<vector<ArbitrageViolation> > found(parts);
+
+	// Parity pass.
+	RunParallel(parts, [&](size_t p) {
+		PricingTrace::Span span("parity", "arbitrage");
+		ScanParity(book, book.size() * p / parts, book.size() * (p + 1) / parts, found[p]);
+	});
+
+	// Strike pass, groups of one underlying and time to expiry.
+	vector<size_t> index(book.size());
+	for (size_t i = 0; i < index.size(); i++)
+		index[i] = i;
+	sort(index.begin(), index.end(), [&](size_t i, size_t j) {
+		const MarketQuote& a = book[i];
+		const MarketQuote& b = book[j];
+		if (a.underlying != b.underlying)
+			return a.underlying < b.underlying;
+		if (Tau(a) != Tau(b))
+			return Tau(a) < Tau(b);
+		return a.data.K < b.data.K;
+	});
+	vector<size_t> bound = SplitGroups(index, parts, [&](size_t i, size_t j) { return SameExpiry(book[i], book[j]); });
+	RunParallel(parts, [&](size_t p) {
+		PricingTrace::Span span("strikes", "arbitrage");
+		ScanStrikes(book, &index[bound[p]], bound[p + 1] - bound[p], found[p]);
+	});
+
+	// Calendar pass, groups of one underlying and strike.
+	sort(index.begin(), index.end(), [&](size_t i, size_t j) {
+		const MarketQuote& a = book[i];
+		const MarketQuote& b = book[j];
+		if (a.underlying != b.underlying)
+			return a.underlying < b.underlying;
+		if (a.data.K != b.data.K)
+			return a.data.K < b.data.K;
+		return Tau(a) < Tau(b);
+	});
+	bound = SplitGroups(index, parts, [&](size_t i, size_t j) { return SameStrike(book[i], book[j]); });
+	RunParallel(parts, [&](size_t p) {
+		PricingTrace::Span span("calendar", "arbitrage");
+		for (size_t begin = bound[p], end; begin < bound[p + 1]; begin = end) {
+			for (end = begin + 1; end < bound[p + 1] && SameStrike(book[index[begin]], book[index[end]]); end++) {
+			}
+			ScanCalendar(book, &index[begin], end - begin, found[p]);
+		}
+	});
+
+	vector<ArbitrageViolation> tmp;
+	for (size_t p = 0; p < parts; p++)
+		tmp.insert(tmp.end(), found[p].begin(), found[p].end());
+	return tmp;
+}
+
+void ArbitrageScanner::Print(const vector<ArbitrageViolation>& violations) {
+	static const char* name[] = { "parity", "call strike", "put strike", "call convexity", "put convexity", "calendar" };
+	vector<ArbitrageViolation>::const_iterator it;
+	for (it = violations.begin(); it != violations.end(); it++) {
+		cout << name[it->kind] << "  quotes:";
+		for (size_t i = 0; i < 3; i++) {
+			if (it->quote[i] != ARBITRAGE_NO_QUOTE)
+				cout << " " << it->quote[i];
+		}
+		cout << "  amount: " << it->amount << endl;
+	}
+}
@@ -0,0 +1,91 @@
+// arbitrage_scanner.hpp
+//
+// Header file for Class ArbitrageScanner.
+// Put-call parity and static no-arbitrage checks over a book of market quotes.
+//
+
+#ifndef ARBITRAGE_SCANNER_HPP_
+#define ARBITRAGE_SCANNER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Market call and put quote of one European contract.
+// Quotes of the same underlying share the underlying id.
+struct MarketQuote {
+	OptionData data;		// Contract parameters, sig is not used.
+	double S;				// Spot price.
+	double call;			// Call price.
+	double put;				// Put price.
+	uint32_t underlying;	// Underlying id.
+};
+
+// Tolerances of the checks. A check fails when the violation exceeds
+// absolute + relative * reference price.
+struct ArbitrageTolerance {
+	double absolute;	// Price units.
+	double relative;	// Fraction of the reference price.
+
+	ArbitrageTolerance();	// 1e-5 absolute, no relative part.
+};
+
+enum ArbitrageKind {
+	PUT_CALL_PARITY,	// C - P differs from S exp((b - r) tau) - K exp(-r tau), tau = T - t.
+	CALL_STRIKE,		// Call price rises with strike or falls faster than the discounted strike.
+	PUT_STRIKE,			// Put price falls with strike or rises faster than the discounted strike.
+	CALL_CONVEXITY,		// Call butterfly with negative price.
+	PUT_CONVEXITY,		// Put butterfly with negative price.
+	CALENDAR			// Call price falls with time to expiry at the same strike.
+};
+
+// Unused quote index of a violation.
+const size_t ARBITRAGE_NO_QUOTE = size_t(-1);
+
+// One failed check. Unused quote indexes are ARBITRAGE_NO_QUOTE.
+struct ArbitrageViolation {
+	ArbitrageKind kind;
+	size_t quote[3];	// Indexes of the quotes involved, in strike or expiry order.
+	double amount;		// Size of the violation in price units.
+};
+
+// Batch arbitrage scanner.
+// Scan(const vector<MarketQuote>&) runs a parity pass over all quotes, then groups
+// the quotes by underlying and time to expiry T - t for the strike monotonicity
+// and convexity checks, and by underlying and strike for the calendar check in
+// T - t order. Each pass is split over threads. The strike checks run branch free
+// over arrays of the quotes, vectorized for the CpuDispatch variant. Parity uses the carry adjusted form of EuropeanOptionFunction::CallToPut.
+// The calendar check only applies to quotes with b >= r (no dividend yield), where
+// calls cannot lose value with time.
+// Print a report with Print(const vector<ArbitrageViolation>&).
+class ArbitrageScanner {
+public:
+	// Constructors & destructor.
+	ArbitrageScanner(const ArbitrageTolerance& tolerance = ArbitrageTolerance(), size_t threads = 0);	// 0 threads means one per hardware thread.
+	virtual ~ArbitrageScanner();	// Destructor.
+
+	vector<ArbitrageViolation> Scan(const vector<MarketQuote>& book) const;
+	static void Print(const vector<ArbitrageViolation>& violations);
+
+	// Selectors.
+	const ArbitrageTolerance& Tolerance() const;
+
+private:
+	ArbitrageTolerance tolerance;
+	size_t threads;
+
+	void ScanParity(const vector<MarketQuote>& book, size_t begin, size_t end, vector<ArbitrageViolation>& out) const;
+	void ScanStrikes(const vector<MarketQuote>& book, const size_t* index, size_t size, vector<ArbitrageViolation>& out) const;
+	void ScanCalendar(const vector<MarketQuote>& book, const size_t* index, size_t size, vector<ArbitrageViolation>& out) const;
+	bool Fails(double amount, double reference) const;
+};
+
+// Implementation of the normal inline function.
+inline const ArbitrageTolerance& ArbitrageScanner::Tolerance() const {
+	return tolerance;
+}
+
+#endif	// ARBITRAGE_SCANNER_HPP_
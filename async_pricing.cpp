@@ -0,0 +1,249 @@
+// async_pricing.cpp
+//
+// Asynchronous pricing implementation.
+//
+
+#include "async_pricing.hpp"
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "option_function.hpp"
+#include "pricing_executor.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+// Elements between two cancellation checks of an element function.
+static const size_t CANCEL_CHECK = 64;
+
+PricingCancelled::PricingCancelled() : runtime_error("Pricing job cancelled") {
+}
+
+AsyncPricingOptions::AsyncPricingOptions() : chunkSize(4096), executor(0) {
+}
+
+// Shared by the handles and the chunk tasks of a job.
+struct PricingJob::State {
+	atomic<bool> cancelled;
+	atomic<size_t> done;		// Elements done.
+	atomic<size_t> chunksLeft;	// Chunks not yet finished or skipped.
+	size_t size;
+	vector<double> result;
+	promise<vector<double> > resultPromise;
+	shared_future<vector<double> > future;
+	mutex callbackLock;
+	mutex errorLock;
+	exception_ptr error;		// First exception of a kernel or callback.
+	AsyncPricingOptions options;
+
+	State() : cancelled(false), done(0), chunksLeft(0), size(0), future(resultPromise.get_future().share()) {
+	}
+};
+
+PricingJob::PricingJob() : state(new State) {
+	state->resultPromise.set_value(vector<double>());
+}
+
+PricingJob::PricingJob(const shared_ptr<State>& state) : state(state) {
+}
+
+void PricingJob::Cancel() {
+	state->cancelled = true;
+}
+
+bool PricingJob::IsCancelled() const {
+	return state->cancelled;
+}
+
+bool PricingJob::IsDone() const {
+	return state->future.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+double PricingJob::Progress() const {
+	if (state->size == 0)
+		return 1.0;
+	return double(state->done) / state->size;
+}
+
+void PricingJob::Wait() const {
+	state->future.wait();
+}
+
+vector<double> PricingJob::Get() const {
+	return state->future.get();
+}
+
+shared_future<vector<double> > PricingJob::Future() const {
+	return state->future;
+}
+
+namespace OptionFunction {
+namespace AsyncPricing {
+
+// Result, first exception or PricingCancelled, once every chunk finished or was skipped.
+static void Publish(const shared_ptr<PricingJob::State>& state) {
+	if (state->error)
+		state->resultPromise.set_exception(state->error);
+	else if (state->cancelled)
+		state->resultPromise.set_exception(make_exception_ptr(PricingCancelled()));
+	else
+		state->resultPromise.set_value(move(state->result));
+}
+
+// Keeps the first exception and cancels the job.
+static void Fail(const shared_ptr<PricingJob::State>& state, exception_ptr error) {
+	lock_guard<mutex> lock(state->errorLock);
+	if (!state->error)
+		state->error = error;
+	state->cancelled = true;
+}
+
+// One chunk task. The last chunk to finish publishes the result.
+// A throwing kernel or callback cancels the job, its exception is kept for the result.
+static void RunChunk(const shared_ptr<PricingJob::State>& state, const ChunkKernel& kernel, size_t begin, size_t end) {
+	PricingTrace::Span span("chunk", "async", end - begin);
+	try {
+		if (!state->cancelled) {
+			kernel(begin, end, &state->result[begin], state->cancelled);
+			if (!state->cancelled) {
+				if (!state->options.onChunk && !state->options.onProgress) {
+					state->done += end - begin;
+				} else {
+					lock_guard<mutex> lock(state->callbackLock);	// Counted under the lock, so progress only increases.
+					size_t done = (state->done += end - begin);
+					if (state->options.onChunk)
+						state->options.onChunk(begin, vector<double>(state->result.begin() + begin, state->result.begin() + end));
+					if (state->options.onProgress)
+						state->options.onProgress(double(done) / state->size);
+				}
+			}
+		}
+	} catch (...) {
+		Fail(state, current_exception());
+	}
+
+	if (--state->chunksLeft == 0)
+		Publish(state);
+}
+
+PricingJob Run(size_t size, const ChunkKernel& kernel, const AsyncPricingOptions& options) {
+	if (size == 0)
+		return PricingJob();
+
+	shared_ptr<PricingJob::State> state(new PricingJob::State);
+	state->options = options;
+	if (state->options.chunkSize == 0)
+		state->options.chunkSize = 1;
+	state->size = size;
+	state->result.resize(size);
+
+	size_t chunk = state->options.chunkSize;
+	state->chunksLeft = (size + chunk - 1) / chunk;
+	PricingExecutor& executor = options.executor ? *options.executor : PricingExecutor::Shared();
+	for (size_t begin = 0; begin < size; begin += chunk) {
+		size_t end = begin + chunk < size ? begin + chunk : size;
+		try {
+			executor.Submit(bind(RunChunk, state, kernel, begin, end));
+		} catch (...) {	// The chunks from begin on never run, Get() rethrows.
+			Fail(state, current_exception());
+			if ((state->chunksLeft -= (size - begin + chunk - 1) / chunk) == 0)
+				Publish(state);
+			break;
+		}
+	}
+	return PricingJob(state);
+}
+
+PricingJob Evaluate(const vector<double>& x, const function<double(double)>& f, const AsyncPricingOptions& options) {
+	shared_ptr<const vector<double> > input(new vector<double>(x));
+	return Run(x.size(), [input, f](size_t begin, size_t end, double* out, const atomic<bool>& cancelled) {
+		for (size_t i = begin; i < end; i++) {
+			if ((i - begin) % CANCEL_CHECK == 0 && cancelled)
+				return;
+			out[i - begin] = f((*input)[i]);
+		}
+	}, options);
+}
+
+PricingJob Price(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options) {
+	EuropeanOption copy(option);
+	return Evaluate(S, [copy](double x) { return copy.Price(x); }, options);
+}
+
+PricingJob Price(const EuropeanOption& option, double start, double end, double size, const AsyncPricingOptions& options) {
+	return Price(option, MeshArray(start, end, size), options);
+}
+
+PricingJob Price(const EuropeanOption& option, const vector<double>& param, const string& paramName, double S, const AsyncPricingOptions& options) {
+	OptionData data = option.Get();
+	if (!SetParam(data, paramName, 0.0)) {
+		cout << "Wrong parameter name" << endl;
+		return PricingJob();
+	}
+	bool call = option.OptType() == "C";
+	return Evaluate(param, [data, paramName, call, S](double x) {
+		OptionData tmp = data;
+		SetParam(tmp, paramName, x);
+		return call ? EuropeanOptionFunction::CallPrice(tmp, S) : EuropeanOptionFunction::PutPrice(tmp, S);
+	}, options);
+}
+
+PricingJob Delta(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options) {
+	EuropeanOption copy(option);
+	return Evaluate(S, [copy](double x) { return copy.Delta(x); }, options);
+}
+
+PricingJob Gamma(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options) {
+	EuropeanOption copy(option);
+	return Evaluate(S, [copy](double x) { return copy.Gamma(x); }, options);
+}
+
+PricingJob PriceSurface(const EuropeanOption& option, const vector<double>& S, const vector<double>& param, const string& paramName, const AsyncPricingOptions& options) {
+	OptionData data = option.Get();
+	if (!SetParam(data, paramName, 0.0)) {
+		cout << "Wrong parameter name" << endl;
+		return PricingJob();
+	}
+	bool call = option.OptType() == "C";
+	shared_ptr<const vector<double> > spot(new vector<double>(S));
+	shared_ptr<const vector<double> > grid(new vector<double>(param));
+	return Run(S.size() * param.size(), [data, paramName, call, spot, grid](size_t begin, size_t end, double* out, const atomic<bool>& cancelled) {
+		OptionData tmp = data;
+		for (size_t i = begin; i < end; i++) {
+			if ((i - begin) % CANCEL_CHECK == 0 && cancelled)
+				return;
+			SetParam(tmp, paramName, (*grid)[i / spot->size()]);
+			double x = (*spot)[i % spot->size()];
+			out[i - begin] = call ? EuropeanOptionFunction::CallPrice(tmp, x) : EuropeanOptionFunction::PutPrice(tmp, x);
+		}
+	}, options);
+}
+
+PricingJob Price(const AmericanOption& option, const vector<double>& S, const AsyncPricingOptions& options) {
+	AmericanOption copy(option);
+	return Evaluate(S, [copy](double x) { return copy.Price(x); }, options);
+}
+
+// Cancellation is checked per chunk, the book kernel runs a chunk in one call.
+PricingJob Price(const vector<OptionData>& option, const vector<double>& S, const string& optType, const AsyncPricingOptions& options) {
+	if (option.size() != S.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return PricingJob();
+	}
+	shared_ptr<const vector<OptionData> > book(new vector<OptionData>(option));
+	shared_ptr<const vector<double> > spot(new vector<double>(S));
+	bool call = optType == "C";
+	return Run(S.size(), [book, spot, call](size_t begin, size_t end, double* out, const atomic<bool>&) {
+		if (call)
+			EuropeanOptionFunction::CallPrice(&(*book)[begin], &(*spot)[begin], out, end - begin);
+		else
+			EuropeanOptionFunction::PutPrice(&(*book)[begin], &(*spot)[begin], out, end - begin);
+	}, options);
+}
+
+}	// Namespace AsyncPricing.
+}	// Namespace OptionFunction.
@@ -0,0 +1,100 @@
+// async_pricing.hpp
+//
+// Header file for asynchronous pricing functions.
+//
+
+#ifndef ASYNC_PRICING_HPP_
+#define ASYNC_PRICING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "option_data.hpp"
+#include "pricing_executor.hpp"
+
+using namespace std;
+
+// Error stored in the future of a cancelled job.
+class PricingCancelled : public runtime_error {
+public:
+	PricingCancelled();
+};
+
+// Settings of an asynchronous job.
+// The job is split into chunks of chunkSize elements, each chunk is one executor task.
+// onChunk receives the offset and the values of every finished chunk, onProgress the
+// fraction of elements done. Callbacks run on executor threads, one at a time.
+struct AsyncPricingOptions {
+	size_t chunkSize;
+	function<void(size_t, const vector<double>&)> onChunk;
+	function<void(double)> onProgress;
+	PricingExecutor* executor;	// 0 means PricingExecutor::Shared().
+
+	AsyncPricingOptions();
+};
+
+// Handle of an asynchronous job, copies share the same job.
+// Stop the job with Cancel(), queued chunks are skipped and running chunks stop
+// at their next check; Get() then throws PricingCancelled.
+// An exception thrown by the kernel, a callback or the Submit() of a chunk cancels
+// the job the same way, and Get() rethrows the first one.
+// Access the fraction of elements done with Progress().
+// Wait for the result with Wait() and take it with Get() or Future().
+class PricingJob {
+public:
+	struct State;
+
+	// Constructors & destructor.
+	PricingJob();	// Finished job with an empty result.
+	PricingJob(const shared_ptr<State>& state);	// Job on a shared state.
+
+	void Cancel();
+	bool IsCancelled() const;
+	bool IsDone() const;
+	double Progress() const;
+	void Wait() const;
+	vector<double> Get() const;
+	shared_future<vector<double> > Future() const;
+
+private:
+	shared_ptr<State> state;
+};
+
+namespace OptionFunction {
+namespace AsyncPricing {
+// Kernel of a job: fill out[0, end - begin) for elements [begin, end), checking cancelled regularly.
+typedef function<void(size_t begin, size_t end, double* out, const atomic<bool>& cancelled)> ChunkKernel;
+
+// Run a kernel over size elements on the executor.
+PricingJob Run(size_t size, const ChunkKernel& kernel, const AsyncPricingOptions& options = AsyncPricingOptions());
+
+// Apply an element function to every x.
+PricingJob Evaluate(const vector<double>& x, const function<double(double)>& f, const AsyncPricingOptions& options = AsyncPricingOptions());
+
+// European option price, delta and gamma.
+PricingJob Price(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options = AsyncPricingOptions());	// Spot price vector version.
+PricingJob Price(const EuropeanOption& option, double start, double end, double size, const AsyncPricingOptions& options = AsyncPricingOptions());	// Spot price mesh version.
+PricingJob Price(const EuropeanOption& option, const vector<double>& param, const string& paramName, double S, const AsyncPricingOptions& options = AsyncPricingOptions());	// Param vector version.
+PricingJob Delta(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options = AsyncPricingOptions());	// Spot price vector version.
+PricingJob Gamma(const EuropeanOption& option, const vector<double>& S, const AsyncPricingOptions& options = AsyncPricingOptions());	// Spot price vector version.
+
+// European price surface, row i holds the prices for param[i] over all S.
+PricingJob PriceSurface(const EuropeanOption& option, const vector<double>& S, const vector<double>& param, const string& paramName, const AsyncPricingOptions& options = AsyncPricingOptions());
+
+// American option price.
+PricingJob Price(const AmericanOption& option, const vector<double>& S, const AsyncPricingOptions& options = AsyncPricingOptions());	// Spot price vector version.
+
+// Book of European options ("C" or "P"), one spot price per option.
+PricingJob Price(const vector<OptionData>& option, const vector<double>& S, const string& optType, const AsyncPricingOptions& options = AsyncPricingOptions());
+
+}	// Namespace AsyncPricing.
+}	// Namespace OptionFunction.
+
+#endif	// ASYNC_PRICING_HPP_
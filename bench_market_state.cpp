@@ -0,0 +1,183 @@
+// bench_market_state.cpp
+//
+// Contention benchmark of the market state.
+//
+// Usage: bench_market_state [max threads] [milliseconds]
+// One feed thread publishes market inputs of 64 underlyings without pause while
+// 1, 2, 4, ... max threads (default 64) read them, through MarketState (seqlock)
+// and through a mutex guarded copy, once reading only and once pricing a European
+// option per read. The report gives million reads per second over all readers.
+// Every snapshot is checked for torn inputs; the benchmark exits with 1 on one.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "european_option.hpp"
+#include "market_state.hpp"
+
+using namespace std;
+
+static const size_t UNDERLYINGS = 64;
+static atomic<double> sink;	// Keeps the reads from being optimized away.
+
+// Publications of an underlying are numbered modulo 2^24.
+static const uint64_t PUBLICATIONS = uint64_t(1) << 24;
+
+// Inputs of publication j of an underlying. Every field is a different exact
+// function of u and j, so a mix of two publications differs in some field.
+static MarketSnapshot Inputs(size_t u, uint64_t j) {
+	double x = double(j % PUBLICATIONS) / double(PUBLICATIONS);	// [0, 1), 24 bits.
+	MarketSnapshot tmp;
+	tmp.S = 100.0 + double(u) + x;
+	tmp.sig = 0.1 + x / 16.0;
+	tmp.r = 0.01 + x / 64.0;
+	tmp.b = 0.005 + x / 256.0;
+	tmp.t = x / 64.0;
+	tmp.q = x / 1024.0;
+	tmp.version = 0;
+	return tmp;
+}
+
+// The publication is identified by t, every field is checked against it.
+static bool Consistent(size_t u, const MarketSnapshot& m) {
+	MarketSnapshot expected = Inputs(u, uint64_t(m.t * 64.0 * double(PUBLICATIONS)));
+	return m.S == expected.S && m.sig == expected.sig && m.r == expected.r && m.b == expected.b && m.t == expected.t && m.q == expected.q;
+}
+
+// Market inputs behind one mutex, the usual alternative.
+class LockedMarket {
+public:
+	LockedMarket() : market(UNDERLYINGS) {
+	}
+
+	void Publish(size_t underlying, const MarketSnapshot& m) {
+		lock_guard<mutex> guard(lock);
+		market[underlying] = m;
+	}
+
+	MarketSnapshot Snapshot(size_t underlying) {
+		lock_guard<mutex> guard(lock);
+		return market[underlying];
+	}
+
+private:
+	mutex lock;
+	vector<MarketSnapshot> market;
+};
+
+struct RunResult {
+	double readsPerSecond;
+	uint64_t torn;
+};
+
+// Run readers and one writer for the given time.
+static RunResult Run(size_t threads, int millis, const function<void(uint64_t)>& publish, const function<double(size_t, bool&)>& read) {
+	atomic<bool> stop(false);
+	atomic<uint64_t> reads(0), torn(0);
+	thread writer([&]() {
+		for (uint64_t k = 1; !stop.load(memory_order_relaxed); k++)
+			publish(k);
+	});
+	vector<thread> readers;
+	for (size_t n = 0; n < threads; n++) {
+		readers.push_back(thread([&, n]() {
+			uint64_t count = 0, bad = 0;
+			double sum = 0.0;
+			for (size_t u = n % UNDERLYINGS; !stop.load(memory_order_relaxed); u = (u + 1) % UNDERLYINGS) {
+				bool ok = true;
+				sum += read(u, ok);
+				bad += !ok;
+				count++;
+			}
+			reads += count;
+			torn += bad;
+			sink.store(sum, memory_order_relaxed);
+		}));
+	}
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	this_thread::sleep_for(chrono::milliseconds(millis));
+	stop = true;
+	for (size_t n = 0; n < readers.size(); n++)
+		readers[n].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	writer.join();
+	RunResult tmp = { double(reads) / seconds, torn };
+	return tmp;
+}
+
+int main(int argc, char* argv[]) {
+	size_t maxThreads = (argc > 1) ? strtoul(argv[1], 0, 10) : 64;
+	int millis = (argc > 2) ? atoi(argv[2]) : 200;
+	if (maxThreads == 0 || millis <= 0) {
+		cout << "Usage: bench_market_state [max threads] [milliseconds]" << endl;
+		return 1;
+	}
+
+	MarketState state(UNDERLYINGS);
+	LockedMarket locked;
+	EuropeanOption option(1.0, 100.0, 0.2, 0.05, 0.04, 0.0, 0.0, "C");
+	// Publication k is publication k / UNDERLYINGS of underlying k % UNDERLYINGS.
+	function<void(uint64_t)> publishSeqlock = [&](uint64_t k) { state.Publish(k % UNDERLYINGS, Inputs(k % UNDERLYINGS, k / UNDERLYINGS)); };
+	function<void(uint64_t)> publishLocked = [&](uint64_t k) { locked.Publish(k % UNDERLYINGS, Inputs(k % UNDERLYINGS, k / UNDERLYINGS)); };
+
+	for (size_t u = 0; u < UNDERLYINGS; u++) {
+		publishSeqlock(u);
+		publishLocked(u);
+	}
+
+	// Readers: snapshot only, or snapshot and price.
+	function<double(size_t, bool&)> readSeqlock = [&](size_t u, bool& ok) {
+		MarketSnapshot m = state.Snapshot(u);
+		ok = Consistent(u, m);
+		return m.S;
+	};
+	function<double(size_t, bool&)> readLocked = [&](size_t u, bool& ok) {
+		MarketSnapshot m = locked.Snapshot(u);
+		ok = Consistent(u, m);
+		return m.S;
+	};
+	function<double(size_t, bool&)> priceSeqlock = [&](size_t u, bool& ok) {
+		MarketSnapshot m = state.Snapshot(u);
+		ok = Consistent(u, m);
+		return option.Price(m);
+	};
+	function<double(size_t, bool&)> priceLocked = [&](size_t u, bool& ok) {
+		MarketSnapshot m = locked.Snapshot(u);
+		ok = Consistent(u, m);
+		return option.Price(m);
+	};
+
+	uint64_t torn = 0;
+	cout << "Million reads per second over all readers, " << UNDERLYINGS << " underlyings, one writer, "
+		<< thread::hardware_concurrency() << " hardware threads" << endl;
+	cout << setw(8) << "readers" << setw(12) << "seqlock" << setw(12) << "mutex"
+		<< setw(16) << "seqlock+price" << setw(14) << "mutex+price" << endl;
+	for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+		RunResult r[4] = {
+			Run(threads, millis, publishSeqlock, readSeqlock),
+			Run(threads, millis, publishLocked, readLocked),
+			Run(threads, millis, publishSeqlock, priceSeqlock),
+			Run(threads, millis, publishLocked, priceLocked)
+		};
+		cout << setw(8) << threads << fixed << setprecision(2) << setw(12) << r[0].readsPerSecond / 1e6
+			<< setw(12) << r[1].readsPerSecond / 1e6 << setw(16) << r[2].readsPerSecond / 1e6
+			<< setw(14) << r[3].readsPerSecond / 1e6 << endl;
+		for (size_t i = 0; i < 4; i++)
+			torn += r[i].torn;
+	}
+
+	if (torn) {
+		cout << torn << " torn snapshots" << endl;
+		return 1;
+	}
+	cout << "No torn snapshots" << endl;
+	return 0;
+}
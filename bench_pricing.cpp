@@ -0,0 +1,229 @@
+// bench_pricing.cpp
+//
+// Throughput benchmark of the book pricing kernels.
+//
+// Usage: bench_pricing [options] [repeats] [perf] [trace=file]
+// Every kernel prices the same book of options repeats times; the report gives
+// the best ns per option. With trace=file the book building, table building
+// and every kernel run are traced and saved to file as a Chrome trace.
+// With "perf" each kernel also runs under PerfCounters
+// and the report adds cycles, instructions, IPC, L1D and LLC misses, branch misses
+// and packed floating point instructions per option ("n/a" where the kernel or
+// cpu does not provide the counter, see perf_event_paranoid).
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "american_option_function.hpp"
+#include "chebyshev_table.hpp"
+#include "cpu_dispatch.hpp"
+#include "european_option.hpp"
+#include "european_option_function.hpp"
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "perf_counters.hpp"
+#include "pricing_protocol.hpp"
+#include "pricing_trace.hpp"
+#include "strategy.hpp"
+#include "time_roll.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+struct BenchKernel {
+	string name;
+	function<void()> run;	// Prices the whole book once.
+};
+
+// Deterministic book with a few expiries per underlying, like a listed chain.
+static vector<ChainOption> MakeBook(size_t size) {
+	vector<ChainOption> tmp;
+	uint64_t seed = 12345;
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		double u = double(seed >> 11) / 9007199254740992.0;
+		uint32_t underlying = uint32_t(i / 256);
+		double T = 0.1 + 0.25 * (i % 8);
+		OptionData data = { T, 50.0 + 100.0 * u, 0.15 + 0.3 * u, 0.05, 0.03, 0.0, 0.0 };
+		ChainOption o = { data, 100.0 + underlying % 10, underlying, (i % 2) ? 'P' : 'C' };
+		tmp.push_back(o);
+	}
+	return tmp;
+}
+
+static void PrintPerOption(const PerfCounterValues& v, PerfEvent event, double options) {
+	if (v.valid[event])
+		cout << setw(10) << fixed << setprecision(2) << v.value[event] / options;
+	else
+		cout << setw(10) << "n/a";
+}
+
+int main(int argc, char* argv[]) {
+	size_t size = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000;
+	size_t repeats = (argc > 2) ? strtoul(argv[2], 0, 10) : 5;
+	bool perf = false;
+	string traceFile;
+	for (int i = 3; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "perf")
+			perf = true;
+		else if (arg.compare(0, 6, "trace=") == 0 && arg.size() > 6)
+			traceFile = arg.substr(6);
+		else
+			size = 0;
+	}
+	if (size == 0 || repeats == 0) {
+		cout << "Usage: bench_pricing [options] [repeats] [perf] [trace=file]" << endl;
+		return 1;
+	}
+	if (!traceFile.empty()) {
+		PricingTrace::Enable(true);
+		PricingTrace::SetThreadName("bench");
+	}
+
+	// The inputs outlive the stage, so the spans are recorded by hand.
+	uint64_t stageStart = PricingTrace::Enabled() ? PricingTrace::Now() : 0;
+	vector<ChainOption> book = MakeBook(size);
+	vector<OptionData> data(size);
+	vector<double> S(size), price(size);
+	vector<EuropeanOption> objects;
+	vector<PricingRequestItem> items;
+	for (size_t i = 0; i < size; i++) {
+		data[i] = book[i].data;
+		S[i] = book[i].S;
+		objects.push_back(EuropeanOption(data[i], book[i].optType == 'C' ? "C" : "P"));
+		items.push_back(PricingProtocol::MakeItem(data[i], (i % 4 == 3) ? PRICING_AMERICAN : PRICING_EUROPEAN, book[i].optType, S[i]));
+	}
+	vector<OptionData> american(data);
+	for (size_t i = 0; i < size; i++)
+		american[i].b = 0.02;
+
+	vector<FixedStrategy<2> > straddles;	// Two legs each, ns per option is per leg.
+	vector<StrategyValue> strategyValue(size / 2);
+	for (size_t i = 0; i + 1 < size; i += 2)
+		straddles.push_back(StrategyFunction::Straddle(data[i]));
+	if (stageStart != 0)
+		PricingTrace::Record("build book", "bench", stageStart, PricingTrace::Now(), size);
+
+	stageStart = PricingTrace::Enabled() ? PricingTrace::Now() : 0;
+
+	OptionChainEngine chain(book);
+	TimeRollEngine roll(book);
+	ChebyshevTable table;
+	table.Build(ChebyshevTableSpec());
+	if (stageStart != 0)
+		PricingTrace::Record("build engines", "bench", stageStart, PricingTrace::Now(), size);
+
+	vector<BenchKernel> kernels;
+	BenchKernel k;
+	k.name = "scalar CallPrice";
+	k.run = [&]() {
+		for (size_t i = 0; i < size; i++)
+			price[i] = EuropeanOptionFunction::CallPrice(data[i], S[i]);
+	};
+	kernels.push_back(k);
+	k.name = "EuropeanOption::Price";
+	k.run = [&]() {
+		for (size_t i = 0; i < size; i++)
+			price[i] = objects[i].Price(S[i]);
+	};
+	kernels.push_back(k);
+	k.name = "book CallPrice";
+	k.run = [&]() {
+		EuropeanOptionFunction::CallPrice(data.data(), S.data(), price.data(), size);
+	};
+	kernels.push_back(k);
+	k.name = "book PutPrice";
+	k.run = [&]() {
+		EuropeanOptionFunction::PutPrice(data.data(), S.data(), price.data(), size);
+	};
+	kernels.push_back(k);
+	k.name = "chain Price";
+	k.run = [&]() {
+		chain.Price(price.data());
+	};
+	kernels.push_back(k);
+	k.name = "time roll Roll";
+	k.run = [&]() {
+		roll.Roll(0.0);
+	};
+	kernels.push_back(k);
+	k.name = "Chebyshev CallPrice";
+	k.run = [&]() {
+		table.CallPrice(data.data(), S.data(), price.data(), size);
+	};
+	kernels.push_back(k);
+	k.name = "straddle Value, greeks";
+	k.run = [&]() {
+		StrategyFunction::Value(straddles.data(), S.data(), strategyValue.data(), straddles.size());
+	};
+	kernels.push_back(k);
+	k.name = "American book CallPrice";
+	k.run = [&]() {
+		AmericanOptionFunction::CallPrice(american.data(), S.data(), price.data(), size);
+	};
+	kernels.push_back(k);
+	k.name = "PriceItems mixed";
+	k.run = [&]() {
+		PricingProtocol::PriceItems(items.data(), price.data(), size);
+	};
+	kernels.push_back(k);
+
+	PerfCounters counters;
+	if (perf && !counters.Available())
+		cout << "Performance counters unavailable (perf_event_open refused), timing only" << endl;
+	perf = perf && counters.Available();
+
+	cout << size << " options, best of " << repeats << " runs, book kernel variant "
+		<< CpuDispatch::Name(CpuDispatch::Active()) << endl;
+	cout << left << setw(24) << "kernel" << right << setw(10) << "ns/option";
+	if (perf)
+		cout << setw(10) << "cycles" << setw(10) << "instr" << setw(10) << "IPC" << setw(10) << "L1D miss"
+			<< setw(10) << "LLC miss" << setw(10) << "br miss" << setw(10) << "vector";
+	cout << endl;
+
+	for (size_t n = 0; n < kernels.size(); n++) {
+		kernels[n].run();	// Warm up caches and lazy initialization.
+		double best = 1e300;
+		for (size_t r = 0; r < repeats; r++) {
+			PricingTrace::Span span(kernels[n].name.c_str(), "bench", size);
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			kernels[n].run();
+			best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+		}
+		cout << left << setw(24) << kernels[n].name << right << setw(10) << fixed << setprecision(1) << best / size;
+
+		if (perf) {
+			counters.Start();
+			for (size_t r = 0; r < repeats; r++)
+				kernels[n].run();
+			counters.Stop();
+			PerfCounterValues v = counters.Read();
+			double options = double(size) * repeats;
+			PrintPerOption(v, PERF_CYCLES, options);
+			PrintPerOption(v, PERF_INSTRUCTIONS, options);
+			if (v.Ipc() > 0.0)
+				cout << setw(10) << fixed << setprecision(2) << v.Ipc();
+			else
+				cout << setw(10) << "n/a";
+			PrintPerOption(v, PERF_L1D_MISSES, options);
+			PrintPerOption(v, PERF_LLC_MISSES, options);
+			PrintPerOption(v, PERF_BRANCH_MISSES, options);
+			PrintPerOption(v, PERF_VECTOR_OPS, options);
+		}
+		cout << endl;
+	}
+
+	if (!traceFile.empty()) {
+		PricingTrace::Enable(false);
+		if (!PricingTrace::SaveChromeTrace(traceFile))
+			return 1;
+		cout << "Trace saved to " << traceFile << ", " << PricingTrace::Dropped() << " spans overwritten" << endl;
+	}
+	return 0;
+}
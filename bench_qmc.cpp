@@ -0,0 +1,132 @@
+// bench_qmc.cpp
+//
+// Convergence benchmark of quasi-random paths.
+//
+// Usage: bench_qmc [max log2 paths] [threads] [replications]
+// Prices a European call on 16 step GBM paths with 2^10 .. 2^max (default 18)
+// paths three ways: pseudo-random normals (mt19937_64), scrambled Sobol
+// normals taken step by step, and scrambled Sobol normals through a Brownian
+// bridge. Each estimate is repeated with independent seeds (default 16) and the
+// report gives the RMSE against EuropeanOptionFunction::CallPrice and the wall
+// time per estimate, so the error can be read against paths and against time.
+// Threads draw disjoint blocks of points (SobolSequence::Skip).
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "quasi_random.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+static const size_t STEPS = 16;
+static const size_t BLOCK = 256;	// Paths per inverse normal batch.
+
+enum Method { PSEUDO_RANDOM, SOBOL, SOBOL_BRIDGE };
+
+// Sum of call payoffs of paths [begin, end).
+static double Payoffs(Method method, const OptionData& data, double S, uint64_t seed, uint64_t begin, uint64_t end) {
+	double tau = data.T - data.t;
+	double dt = tau / double(STEPS);
+	double drift = (data.b - 0.5 * data.sig * data.sig) * dt;
+	double sqrtDt = sqrt(dt);
+	SobolSequence sobol(STEPS, seed);
+	sobol.Skip(begin);
+	mt19937_64 generator(seed * 1000003 + begin);
+	BrownianBridge bridge(STEPS, tau);
+	vector<double> u(BLOCK * STEPS), z(BLOCK * STEPS), dW(STEPS);
+	double sum = 0.0;
+	for (uint64_t first = begin; first < end; first += BLOCK) {
+		size_t paths = size_t(min<uint64_t>(BLOCK, end - first));
+		if (method == PSEUDO_RANDOM) {
+			uniform_real_distribution<double> uniform(0.0, 1.0);
+			for (size_t i = 0; i < paths * STEPS; i++) {
+				do
+					u[i] = uniform(generator);
+				while (u[i] <= 0.0);
+			}
+		} else {
+			sobol.Next(u.data(), paths);
+		}
+		QuasiRandom::InverseNormal(u.data(), z.data(), paths * STEPS);
+		for (size_t p = 0; p < paths; p++) {
+			const double* x = &z[p * STEPS];
+			double logS = log(S);
+			if (method == SOBOL_BRIDGE) {
+				bridge.Increments(x, dW.data());
+				for (size_t k = 0; k < STEPS; k++)
+					logS += drift + data.sig * dW[k];
+			} else {
+				for (size_t k = 0; k < STEPS; k++)
+					logS += drift + data.sig * sqrtDt * x[k];
+			}
+			sum += max(exp(logS) - data.K, 0.0);
+		}
+	}
+	return sum;
+}
+
+// Discounted estimate with paths split over threads.
+static double Estimate(Method method, const OptionData& data, double S, uint64_t seed, uint64_t paths, size_t threads) {
+	vector<double> sum(threads, 0.0);
+	function<void(size_t)> run = [&](size_t t) {
+		sum[t] = Payoffs(method, data, S, seed, paths * t / threads, paths * (t + 1) / threads);
+	};
+	vector<thread> workers;
+	for (size_t t = 1; t < threads; t++)
+		workers.push_back(thread(run, t));
+	run(0);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	double total = 0.0;
+	for (size_t t = 0; t < threads; t++)
+		total += sum[t];
+	return exp(-data.r * (data.T - data.t)) * total / double(paths);
+}
+
+int main(int argc, char* argv[]) {
+	size_t maxLog = (argc > 1) ? strtoul(argv[1], 0, 10) : 18;
+	size_t threads = (argc > 2) ? strtoul(argv[2], 0, 10) : thread::hardware_concurrency();
+	size_t replications = (argc > 3) ? strtoul(argv[3], 0, 10) : 16;
+	if (threads == 0)
+		threads = 1;
+	if (replications == 0)
+		replications = 1;
+
+	OptionData data = { 1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0 };
+	double S = 100.0;
+	double exact = EuropeanOptionFunction::CallPrice(data, S);
+	const char* names[] = { "pseudo-random", "Sobol", "Sobol + bridge" };
+
+	cout << "European call " << exact << ", " << STEPS << " steps, " << replications << " replications, " << threads << " threads" << endl;
+	cout << setw(10) << "paths";
+	for (size_t m = 0; m < 3; m++)
+		cout << setw(17) << names[m] << " RMSE" << setw(9) << "ms";
+	cout << endl;
+	for (size_t n = 10; n <= maxLog; n++) {
+		uint64_t paths = uint64_t(1) << n;
+		cout << setw(10) << paths;
+		for (size_t m = 0; m < 3; m++) {
+			double square = 0.0;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (size_t r = 0; r < replications; r++) {
+				double error = Estimate(Method(m), data, S, r + 1, paths, threads) - exact;
+				square += error * error;
+			}
+			double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / double(replications);
+			cout << setw(22) << setprecision(3) << sqrt(square / double(replications)) << setw(9) << setprecision(3) << ms;
+		}
+		cout << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,418 @@
+// chebyshev_table.cpp
+//
+// ChebyshevTable implementation.
+//
+
+#include "chebyshev_table.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+static const char CHEBYSHEV_MAGIC[8] = { 'C', 'H', 'E', 'B', 'T', 'A', 'B', '2' };
+static const size_t QUANTITIES = 3;	// c, N(d1), n(d1).
+
+static inline double Square(double x) {
+	return x * x;
+}
+
+// Exact normalized quantities at (x, w).
+static void Exact(double x, double w, double* value) {
+	double d1 = x / w + 0.5 * w;
+	double d2 = d1 - w;
+	double Nd1 = 0.5 * erfc(-d1 * M_SQRT1_2);
+	value[0] = exp(x) * Nd1 - 0.5 * erfc(-d2 * M_SQRT1_2);
+	value[1] = Nd1;
+	value[2] = exp(-0.5 * d1 * d1) / sqrt(2.0 * M_PI);
+}
+
+// Largest supported degree + 1, bounds the basis arrays on the stack.
+static const size_t MAX_NODES = 32;
+
+// Two dimensional Chebyshev series c[p * n + q] T_p(u) T_q(v).
+// Both bases come from the recurrence. The rows are then accumulated into n
+// independent sums, one per q, so the additions do not form one long chain.
+// N is the number of nodes when known at compile time, 0 otherwise.
+template <size_t N>
+static inline double Chebyshev2(const double* c, size_t n, double u, double v) {
+	if (N != 0)
+		n = N;
+	double tu[N ? N : MAX_NODES], tv[N ? N : MAX_NODES], acc[N ? N : MAX_NODES];
+	tu[0] = 1.0;
+	tv[0] = 1.0;
+	tu[1] = u;
+	tv[1] = v;
+	for (size_t i = 2; i < n; i++) {
+		tu[i] = 2.0 * u * tu[i - 1] - tu[i - 2];
+		tv[i] = 2.0 * v * tv[i - 1] - tv[i - 2];
+	}
+
+	for (size_t q = 0; q < n; q++)
+		acc[q] = c[q];
+	for (size_t p = 1; p < n; p++) {
+		for (size_t q = 0; q < n; q++)
+			acc[q] += c[p * n + q] * tu[p];
+	}
+	double sum = 0.0;
+	for (size_t q = 0; q < n; q++)
+		sum += acc[q] * tv[q];
+	return sum;
+}
+
+// Fixed size versions for the usual degrees, so the loops unroll into registers.
+static double Chebyshev2(const double* c, size_t n, double u, double v) {
+	switch (n) {
+	case 4: return Chebyshev2<4>(c, n, u, v);
+	case 5: return Chebyshev2<5>(c, n, u, v);
+	case 6: return Chebyshev2<6>(c, n, u, v);
+	case 7: return Chebyshev2<7>(c, n, u, v);
+	case 8: return Chebyshev2<8>(c, n, u, v);
+	case 9: return Chebyshev2<9>(c, n, u, v);
+	case 10: return Chebyshev2<10>(c, n, u, v);
+	default: return Chebyshev2<0>(c, n, u, v);
+	}
+}
+
+ChebyshevTableSpec::ChebyshevTableSpec()
+	: xMin(-2.0), xMax(2.0), wMin(0.01), wMax(2.0), degree(5), rows(64),
+		minColumns(4), maxColumns(4096), targetError(1e-8), threads(0) {
+}
+
+ChebyshevTable::ChebyshevTable() : maxError(0.0), maxDeltaError(0.0), sMin(0.0), sStep(1.0) {
+}
+
+ChebyshevTable::~ChebyshevTable() {
+}
+
+// Spec a table can be built for: a finite domain and a degree the basis arrays hold.
+static bool ValidSpec(const ChebyshevTableSpec& spec) {
+	return spec.xMin < spec.xMax && isfinite(spec.xMin) && isfinite(spec.xMax)
+		&& spec.wMin > 0.0 && spec.wMin < spec.wMax && isfinite(spec.wMax)
+		&& spec.degree > 0 && spec.degree < MAX_NODES && spec.rows > 0;
+}
+
+// Coefficients of the columns of one row, doubling the columns until the row is accurate.
+void ChebyshevTable::BuildRow(size_t row, vector<double>& rowCoeff, size_t& columns, double& priceError, double& deltaError) const {
+	size_t n = spec.degree + 1;
+	size_t tileSize = QUANTITIES * n * n;
+	double la = sMin + row * sStep;
+
+	vector<double> node(n);
+	for (size_t i = 0; i < n; i++)
+		node[i] = cos(M_PI * (i + 0.5) / n);
+
+	vector<double> sample(QUANTITIES * n * n);
+	for (columns = spec.minColumns > 0 ? spec.minColumns : 1; ; columns *= 2) {
+		rowCoeff.assign(columns * tileSize, 0.0);
+		double width = (spec.xMax - spec.xMin) / columns;
+
+		for (size_t col = 0; col < columns; col++) {
+			double xa = spec.xMin + col * width;
+			double* c = &rowCoeff[col * tileSize];
+
+			for (size_t i = 0; i < n; i++) {
+				for (size_t j = 0; j < n; j++) {
+					double value[QUANTITIES];
+					Exact(xa + 0.5 * width * (1.0 + node[i]), Square(la + 0.5 * sStep * (1.0 + node[j])), value);
+					for (size_t k = 0; k < QUANTITIES; k++)
+						sample[(k * n + i) * n + j] = value[k];
+				}
+			}
+
+			// Discrete Chebyshev transform on both axes.
+			for (size_t k = 0; k < QUANTITIES; k++) {
+				for (size_t p = 0; p < n; p++) {
+					for (size_t q = 0; q < n; q++) {
+						double sum = 0.0;
+						for (size_t i = 0; i < n; i++) {
+							double cp = cos(M_PI * p * (i + 0.5) / n);
+							for (size_t j = 0; j < n; j++)
+								sum += sample[(k * n + i) * n + j] * cp * cos(M_PI * q * (j + 0.5) / n);
+						}
+						sum *= 4.0 / (n * n);
+						if (p == 0)
+							sum *= 0.5;
+						if (q == 0)
+							sum *= 0.5;
+						c[(k * n + p) * n + q] = sum;
+					}
+				}
+			}
+		}
+
+		// Verification grid, tile edges included.
+		size_t m = 2 * spec.degree + 1;
+		priceError = 0.0;
+		deltaError = 0.0;
+		for (size_t col = 0; col < columns; col++) {
+			const double* c = &rowCoeff[col * tileSize];
+			for (size_t i = 0; i <= m; i++) {
+				double u = -1.0 + 2.0 * i / m;
+				for (size_t j = 0; j <= m; j++) {
+					double v = -1.0 + 2.0 * j / m;
+					double value[QUANTITIES];
+					Exact(spec.xMin + width * (col + 0.5 * (1.0 + u)), Square(la + 0.5 * sStep * (1.0 + v)), value);
+					priceError = fmax(priceError, fabs(Chebyshev2(c, n, u, v) - value[0]));
+					deltaError = fmax(deltaError, fabs(Chebyshev2(c + n * n, n, u, v) - value[1]));
+				}
+			}
+		}
+
+		if (priceError <= spec.targetError || columns * 2 > spec.maxColumns)
+			break;
+	}
+}
+
+bool ChebyshevTable::Build(const ChebyshevTableSpec& newSpec) {
+	if (!ValidSpec(newSpec)) {
+		cout << "Wrong table spec" << endl;
+		return false;
+	}
+	spec = newSpec;
+	sMin = sqrt(spec.wMin);
+	sStep = (sqrt(spec.wMax) - sMin) / spec.rows;
+
+	vector<vector<double> > rowCoeff(spec.rows);
+	vector<size_t> columns(spec.rows);
+	vector<double> priceError(spec.rows), deltaError(spec.rows);
+
+	// Rows are independent, threads take the next unbuilt row.
+	atomic<size_t> next(0);
+	size_t threads = spec.threads ? spec.threads : thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([&]() {
+			for (size_t row = next++; row < spec.rows; row = next++) {
+				PricingTrace::Span span("row", "chebyshev");
+				BuildRow(row, rowCoeff[row], columns[row], priceError[row], deltaError[row]);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	rows.resize(spec.rows);
+	maxError = 0.0;
+	maxDeltaError = 0.0;
+	size_t first = 0, missed = 0;
+	for (size_t row = 0; row < spec.rows; row++) {
+		rows[row].columns = columns[row];
+		rows[row].first = first;
+		first += columns[row];
+		maxError = fmax(maxError, priceError[row]);
+		maxDeltaError = fmax(maxDeltaError, deltaError[row]);
+		if (!(priceError[row] <= spec.targetError))
+			missed++;
+	}
+
+	// Quantity major, so price lookups only touch price coefficients.
+	size_t tileSize = (spec.degree + 1) * (spec.degree + 1);
+	coeff.assign(QUANTITIES * first * tileSize, 0.0);
+	for (size_t row = 0; row < spec.rows; row++) {
+		for (size_t col = 0; col < rows[row].columns; col++) {
+			for (size_t k = 0; k < QUANTITIES; k++) {
+				const double* src = &rowCoeff[row][(col * QUANTITIES + k) * tileSize];
+				copy(src, src + tileSize, &coeff[(k * first + rows[row].first + col) * tileSize]);
+			}
+		}
+	}
+
+	if (missed > 0) {
+		cout << "Table error " << maxError << " above the target " << spec.targetError << " in " << missed
+			<< " of " << spec.rows << " rows at " << spec.maxColumns << " columns" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool ChebyshevTable::Save(const string& fileName) const {
+	ofstream out(fileName.c_str(), ios::binary);
+	if (!out) {
+		cout << "Cannot open " << fileName << endl;
+		return false;
+	}
+	uint64_t rowCount = rows.size();
+	uint64_t coeffCount = coeff.size();
+	out.write(CHEBYSHEV_MAGIC, sizeof(CHEBYSHEV_MAGIC));
+	out.write(reinterpret_cast<const char*>(&spec), sizeof(spec));
+	out.write(reinterpret_cast<const char*>(&maxError), sizeof(maxError));
+	out.write(reinterpret_cast<const char*>(&maxDeltaError), sizeof(maxDeltaError));
+	out.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
+	for (size_t i = 0; i < rows.size(); i++) {
+		uint64_t columns = rows[i].columns;
+		out.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+	}
+	out.write(reinterpret_cast<const char*>(&coeffCount), sizeof(coeffCount));
+	out.write(reinterpret_cast<const char*>(coeff.data()), coeff.size() * sizeof(double));
+	return bool(out);
+}
+
+bool ChebyshevTable::Load(const string& fileName) {
+	ifstream in(fileName.c_str(), ios::binary);
+	char magic[sizeof(CHEBYSHEV_MAGIC)];
+	ChebyshevTableSpec newSpec;
+	double newMaxError, newMaxDeltaError;
+	uint64_t rowCount = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&newSpec), sizeof(newSpec));
+	in.read(reinterpret_cast<char*>(&newMaxError), sizeof(newMaxError));
+	in.read(reinterpret_cast<char*>(&newMaxDeltaError), sizeof(newMaxDeltaError));
+	in.read(reinterpret_cast<char*>(&rowCount), sizeof(rowCount));
+	if (!in || memcmp(magic, CHEBYSHEV_MAGIC, sizeof(magic)) != 0 || !ValidSpec(newSpec) || rowCount != newSpec.rows) {
+		cout << "Wrong table file " << fileName << endl;
+		return false;
+	}
+
+	// Build() makes 1 to max(minColumns, maxColumns) columns per row; the bound
+	// also keeps the coefficient count below SIZE_MAX.
+	size_t n = newSpec.degree + 1;
+	size_t maxColumns = max<size_t>(max(newSpec.minColumns, newSpec.maxColumns), 1);
+	size_t maxTiles = SIZE_MAX / (QUANTITIES * n * n * sizeof(double));
+	vector<Row> newRows;
+	size_t first = 0;
+	for (size_t i = 0; in && i < rowCount; i++) {
+		uint64_t columns = 0;
+		in.read(reinterpret_cast<char*>(&columns), sizeof(columns));
+		if (columns == 0 || columns > maxColumns || columns > maxTiles - first) {
+			cout << "Wrong table file " << fileName << endl;
+			return false;
+		}
+		Row row = { size_t(columns), first };
+		newRows.push_back(row);
+		first += columns;
+	}
+	uint64_t coeffCount = 0;
+	in.read(reinterpret_cast<char*>(&coeffCount), sizeof(coeffCount));
+	if (!in || coeffCount != first * QUANTITIES * n * n) {
+		cout << "Wrong table file " << fileName << endl;
+		return false;
+	}
+
+	// The coefficients must be in the file before they are allocated.
+	streampos position = in.tellg();
+	in.seekg(0, ios::end);
+	streamoff remaining = in.tellg() - position;
+	in.seekg(position);
+	if (!in || remaining < 0 || uint64_t(remaining) < coeffCount * sizeof(double)) {
+		cout << "Wrong table file " << fileName << endl;
+		return false;
+	}
+	vector<double> newCoeff(coeffCount);
+	in.read(reinterpret_cast<char*>(newCoeff.data()), newCoeff.size() * sizeof(double));
+	if (!in) {
+		cout << "Wrong table file " << fileName << endl;
+		return false;
+	}
+
+	spec = newSpec;
+	rows.swap(newRows);
+	coeff.swap(newCoeff);
+	maxError = newMaxError;
+	maxDeltaError = newMaxDeltaError;
+	sMin = sqrt(spec.wMin);
+	sStep = (sqrt(spec.wMax) - sMin) / spec.rows;
+	return true;
+}
+
+bool ChebyshevTable::InDomain(double x, double w) const {
+	return !rows.empty() && x >= spec.xMin && x <= spec.xMax && w >= spec.wMin && w <= spec.wMax;
+}
+
+bool ChebyshevTable::Lookup(double x, double w, size_t k, double& value) const {
+	if (!InDomain(x, w))
+		return false;
+
+	double sw = (sqrt(w) - sMin) / sStep;
+	size_t row = static_cast<size_t>(sw);
+	if (row >= rows.size())
+		row = rows.size() - 1;
+	const Row& r = rows[row];
+	double xs = (x - spec.xMin) / (spec.xMax - spec.xMin) * r.columns;
+	size_t col = static_cast<size_t>(xs);
+	if (col >= r.columns)
+		col = r.columns - 1;
+
+	size_t n = spec.degree + 1;
+	const double* c = &coeff[(k * Tiles() + r.first + col) * n * n];
+	value = Chebyshev2(c, n, 2.0 * (xs - col) - 1.0, 2.0 * (sw - row) - 1.0);
+	return true;
+}
+
+double ChebyshevTable::Normalized(double x, double w) const {
+	double value[QUANTITIES];
+	if (Lookup(x, w, 0, value[0]))
+		return value[0];
+	Exact(x, w, value);
+	return value[0];
+}
+
+double ChebyshevTable::CallPrice(const OptionData& option, double S) const {
+	double tau = option.T - option.t;	// Time to expiry.
+	double x = log(S / option.K) + option.b * tau;
+	double w = option.sig * sqrt(tau);
+	double c;
+	if (!Lookup(x, w, 0, c))
+		return OptionFunction::EuropeanOptionFunction::CallPrice(option, S);
+	return option.K * exp(-option.r * tau) * c;
+}
+
+// Put-call parity with carry: P = C - S exp((b - r) T) + K exp(-r T).
+double ChebyshevTable::PutPrice(const OptionData& option, double S) const {
+	double tau = option.T - option.t;	// Time to expiry.
+	double x = log(S / option.K) + option.b * tau;
+	double w = option.sig * sqrt(tau);
+	double c;
+	if (!Lookup(x, w, 0, c))
+		return OptionFunction::EuropeanOptionFunction::PutPrice(option, S);
+	double discount = exp(-option.r * tau);
+	return option.K * discount * (c + 1.0) - S * exp((option.b - option.r) * tau);
+}
+
+double ChebyshevTable::CallDelta(const OptionData& option, double S) const {
+	double tau = option.T - option.t;	// Time to expiry.
+	double x = log(S / option.K) + option.b * tau;
+	double w = option.sig * sqrt(tau);
+	double g;
+	if (!Lookup(x, w, 1, g))
+		return OptionFunction::EuropeanOptionFunction::CallDelta(option, S);
+	return exp((option.b - option.r) * tau) * g;
+}
+
+double ChebyshevTable::PutDelta(const OptionData& option, double S) const {
+	double tau = option.T - option.t;	// Time to expiry.
+	double x = log(S / option.K) + option.b * tau;
+	double w = option.sig * sqrt(tau);
+	double g;
+	if (!Lookup(x, w, 1, g))
+		return OptionFunction::EuropeanOptionFunction::PutDelta(option, S);
+	return exp((option.b - option.r) * tau) * (g - 1.0);
+}
+
+double ChebyshevTable::Gamma(const OptionData& option, double S) const {
+	double tau = option.T - option.t;	// Time to expiry.
+	double x = log(S / option.K) + option.b * tau;
+	double w = option.sig * sqrt(tau);
+	double h;
+	if (!Lookup(x, w, 2, h))
+		return OptionFunction::EuropeanOptionFunction::CallGamma(option, S);
+	return exp((option.b - option.r) * tau) * h / (S * w);
+}
+
+void ChebyshevTable::CallPrice(const OptionData* option, const double* S, double* price, size_t size) const {
+	PRICING_METRIC("ChebyshevTable::CallPrice(const OptionData*, const double*, double*, size_t) const", size);
+	for (size_t i = 0; i < size; i++)
+		price[i] = CallPrice(option[i], S[i]);
+}
@@ -0,0 +1,121 @@
+// chebyshev_table.hpp
+//
+// Header file for Class ChebyshevTable.
+// Interpolated European prices for low latency approximate pricing.
+//
+
+#ifndef CHEBYSHEV_TABLE_HPP_
+#define CHEBYSHEV_TABLE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Domain and accuracy of a ChebyshevTable.
+// The table is built in normalized coordinates x = log(S * exp(b * T) / K)
+// (log-moneyness of the forward) and w = sig * sqrt(T) (square root of the total
+// variance). Rows are uniform in sqrt(w); each row is split in columns uniform in
+// x, doubled from minColumns up to maxColumns until the row meets targetError.
+// Every tile holds tensor Chebyshev polynomials of the given degree.
+struct ChebyshevTableSpec {
+	double xMin;
+	double xMax;
+	double wMin;
+	double wMax;
+	size_t degree;
+	size_t rows;
+	size_t minColumns;
+	size_t maxColumns;
+	double targetError;	// Price error per unit of discounted strike.
+	size_t threads;		// Build threads, 0 means one per hardware thread.
+
+	ChebyshevTableSpec();	// x in [-2, 2], w in [0.01, 2], degree 5, 64 rows, error 1e-8.
+};
+
+// European call, put, delta and gamma by table lookup.
+// With D = exp(-r * T) and c(x, w) = exp(x) N(x / w + w / 2) - N(x / w - w / 2)
+// the call price is D * K * c(x, w); the table interpolates c, N(d1) and n(d1),
+// so discounting and carry are applied outside the table. Puts follow from parity.
+// Build a table with Build(const ChebyshevTableSpec&), store it with Save(const string&)
+// and read it back with Load(const string&).
+// MaxError() is the largest normalized price error measured against the exact
+// formula on a verification grid of 2 * degree + 1 points per tile and axis,
+// so about MaxError() * K * exp(-r * T) in price. It is measured, not a bound:
+// between the grid points the error can be somewhat larger.
+// Build() returns false when a row still measured above targetError with
+// maxColumns columns; the table is then built and usable, at MaxError().
+// Options outside the domain are priced with EuropeanOptionFunction.
+class ChebyshevTable {
+public:
+	// Constructors & destructor.
+	ChebyshevTable();	// Empty table, everything priced exactly.
+	virtual ~ChebyshevTable();	// Destructor.
+
+	bool Build(const ChebyshevTableSpec& spec);
+	bool Save(const string& fileName) const;
+	bool Load(const string& fileName);
+
+	// Approximate pricing functions.
+	double CallPrice(const OptionData& option, double S) const;
+	double PutPrice(const OptionData& option, double S) const;
+	double CallDelta(const OptionData& option, double S) const;
+	double PutDelta(const OptionData& option, double S) const;
+	double Gamma(const OptionData& option, double S) const;
+	void CallPrice(const OptionData* option, const double* S, double* price, size_t size) const;	// Book array version.
+
+	// Normalized call price c(x, w), exact outside the domain.
+	double Normalized(double x, double w) const;
+
+	// Selectors.
+	const ChebyshevTableSpec& Spec() const;
+	bool Empty() const;
+	bool InDomain(double x, double w) const;
+	double MaxError() const;		// Normalized price error.
+	double MaxDeltaError() const;	// Error of N(d1).
+	size_t Tiles() const;
+
+private:
+	// Tile row: columns tiles starting at tile index first.
+	struct Row {
+		size_t columns;
+		size_t first;
+	};
+
+	ChebyshevTableSpec spec;
+	vector<Row> rows;
+	vector<double> coeff;	// (degree + 1)^2 per tile and quantity, all c tiles, then N(d1), then n(d1).
+	double maxError;
+	double maxDeltaError;
+	double sMin;			// sqrt(wMin).
+	double sStep;			// Row height in sqrt(w).
+
+	// Evaluate quantity k (0: c, 1: N(d1), 2: n(d1)), false outside the domain.
+	bool Lookup(double x, double w, size_t k, double& value) const;
+	void BuildRow(size_t row, vector<double>& rowCoeff, size_t& columns, double& priceError, double& deltaError) const;
+};
+
+// Implementation of the normal inline function.
+inline const ChebyshevTableSpec& ChebyshevTable::Spec() const {
+	return spec;
+}
+
+inline bool ChebyshevTable::Empty() const {
+	return rows.empty();
+}
+
+inline double ChebyshevTable::MaxError() const {
+	return maxError;
+}
+
+inline double ChebyshevTable::MaxDeltaError() const {
+	return maxDeltaError;
+}
+
+inline size_t ChebyshevTable::Tiles() const {
+	return rows.empty() ? 0 : rows.back().first + rows.back().columns;
+}
+
+#endif	// CHEBYSHEV_TABLE_HPP_
@@ -0,0 +1,354 @@
+// cpu_dispatch.cpp
+//
+// CpuDispatch implementation.
+//
+
+#include "cpu_dispatch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "simd_math.hpp"
+
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_DISPATCH_X86 1
+#define CPU_DISPATCH_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace OptionFunction {
+namespace CpuDispatch {
+
+// Baseline variant, the original book loops. Cdf written with erfc so the loop
+// has no function object setup.
+static void EuropeanCallBaseline(const OptionData* option, const double* S, double* price, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		double tau = option[i].T - option[i].t;	// Time to expiry.
+		double tmp = option[i].sig * sqrt(tau);
+		double d1 = (log(S[i] / option[i].K) + (option[i].b + (option[i].sig * option[i].sig) * 0.5) * tau) / tmp;
+		double d2 = d1 - tmp;
+		price[i] = (S[i] * exp((option[i].b - option[i].r) * tau) * 0.5 * erfc(-d1 * M_SQRT1_2))
+			- (option[i].K * exp(-option[i].r * tau) * 0.5 * erfc(-d2 * M_SQRT1_2));
+	}
+}
+
+static void EuropeanPutBaseline(const OptionData* option, const double* S, double* price, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		double tau = option[i].T - option[i].t;	// Time to expiry.
+		double tmp = option[i].sig * sqrt(tau);
+		double d1 = (log(S[i] / option[i].K) + (option[i].b + (option[i].sig * option[i].sig) * 0.5) * tau) / tmp;
+		double d2 = d1 - tmp;
+		price[i] = (option[i].K * exp(-option[i].r * tau) * 0.5 * erfc(d2 * M_SQRT1_2))
+			- (S[i] * exp((option[i].b - option[i].r) * tau) * 0.5 * erfc(d1 * M_SQRT1_2));
+	}
+}
+
+// Same branch as AmericanOptionFunction::CallPrice(const OptionData&, double).
+static void AmericanCallBaseline(const OptionData* option, const double* S, double* price, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		double tmp = option[i].b / (option[i].sig * option[i].sig);
+		double y1 = 0.5 - tmp + sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * option[i].r / (option[i].sig * option[i].sig));
+		price[i] = (1.0 == y1) ? S[i] : option[i].K / (y1 - 1) * pow((y1 - 1) / y1 * S[i] / option[i].K, y1);
+	}
+}
+
+static void AmericanPutBaseline(const OptionData* option, const double* S, double* price, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		double tmp = option[i].b / (option[i].sig * option[i].sig);
+		double y2 = 0.5 - tmp - sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * option[i].r / (option[i].sig * option[i].sig));
+		price[i] = option[i].K / (1 - y2) * pow((y2 - 1) / y2 * S[i] / option[i].K, y2);
+	}
+}
+
+// OptionData fields, spot and price of up to BLOCK options, one array per field.
+// The vectorizer cannot load a field out of an array of 7 double structs, and
+// at -O2 it does not check at run time that spot and price arrays do not
+// overlap or peel a remainder, so each kernel copies a block in, runs the math
+// over all BLOCK entries of the local arrays and copies the prices out.
+const size_t BLOCK = 64;
+
+struct BookBlock {
+	double tau[BLOCK];	// Time to expiry.
+	double K[BLOCK];
+	double sig[BLOCK];
+	double r[BLOCK];
+	double b[BLOCK];
+	double S[BLOCK];
+	double price[BLOCK];
+	bool degenerate[BLOCK];	// Priced by the baseline kernel.
+};
+
+// Options with no time value left or no volatility give infinite d1 and d2, or
+// divide by zero, which the SimdMath functions do not handle. They are priced
+// with the baseline kernel after the block, and replaced by harmless values in it.
+// A perpetual American price does not depend on the expiry (AmericanOption
+// stores T = 0), so for perpetual only the volatility, spot and strike count.
+SIMD_MATH_INLINE bool Load(const OptionData* option, const double* S, size_t size, BookBlock& block, bool perpetual) {
+	bool degenerate = false;
+	for (size_t i = 0; i < size; i++) {
+		block.tau[i] = option[i].T - option[i].t;
+		block.K[i] = option[i].K;
+		block.sig[i] = option[i].sig;
+		block.r[i] = option[i].r;
+		block.b[i] = option[i].b;
+		block.S[i] = S[i];
+		block.degenerate[i] = perpetual ? !(block.sig[i] > 1e-100 && block.S[i] > 0.0 && block.K[i] > 0.0)
+			: !(block.tau[i] > 1e-100 && block.sig[i] > 1e-100);
+		if (block.degenerate[i]) {
+			degenerate = true;
+			block.tau[i] = 1.0;
+			block.sig[i] = 0.2;
+		}
+	}
+	for (size_t i = size; i < BLOCK; i++) {	// Harmless padding of a short last block.
+		block.tau[i] = 1.0;
+		block.K[i] = 1.0;
+		block.sig[i] = 0.2;
+		block.r[i] = 0.05;
+		block.b[i] = 0.0;
+		block.S[i] = 1.0;
+	}
+	return degenerate;
+}
+
+SIMD_MATH_INLINE void Store(const BookBlock& block, bool degenerate, BookKernel baseline,
+	const OptionData* option, const double* S, double* price, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		price[i] = block.price[i];
+	if (!degenerate)
+		return;
+	for (size_t i = 0; i < size; i++) {
+		if (block.degenerate[i])
+			baseline(option + i, S + i, price + i, 1);
+	}
+}
+
+// Kernel bodies, forced inline into one wrapper per variant so each copy is
+// compiled, and vectorized (-O2 and up), for the wrapper's target.
+SIMD_MATH_INLINE void EuropeanCallBody(const OptionData* option, const double* S, double* price, size_t size) {
+	BookBlock x;
+	for (size_t start = 0; start < size; start += BLOCK) {
+		size_t n = min(BLOCK, size - start);
+		bool degenerate = Load(option + start, S + start, n, x, false);
+		for (size_t i = 0; i < BLOCK; i++) {
+			double tmp = x.sig[i] * SimdMath::Sqrt(x.tau[i]);
+			double d1 = (SimdMath::Log(x.S[i] / x.K[i]) + (x.b[i] + (x.sig[i] * x.sig[i]) * 0.5) * x.tau[i]) / tmp;
+			double d2 = d1 - tmp;
+			x.price[i] = (x.S[i] * SimdMath::Exp((x.b[i] - x.r[i]) * x.tau[i]) * SimdMath::NormalCdf(d1))
+				- (x.K[i] * SimdMath::Exp(-x.r[i] * x.tau[i]) * SimdMath::NormalCdf(d2));
+		}
+		Store(x, degenerate, EuropeanCallBaseline, option + start, S + start, price + start, n);
+	}
+}
+
+SIMD_MATH_INLINE void EuropeanPutBody(const OptionData* option, const double* S, double* price, size_t size) {
+	BookBlock x;
+	for (size_t start = 0; start < size; start += BLOCK) {
+		size_t n = min(BLOCK, size - start);
+		bool degenerate = Load(option + start, S + start, n, x, false);
+		for (size_t i = 0; i < BLOCK; i++) {
+			double tmp = x.sig[i] * SimdMath::Sqrt(x.tau[i]);
+			double d1 = (SimdMath::Log(x.S[i] / x.K[i]) + (x.b[i] + (x.sig[i] * x.sig[i]) * 0.5) * x.tau[i]) / tmp;
+			double d2 = d1 - tmp;
+			x.price[i] = (x.K[i] * SimdMath::Exp(-x.r[i] * x.tau[i]) * SimdMath::NormalCdf(-d2))
+				- (x.S[i] * SimdMath::Exp((x.b[i] - x.r[i]) * x.tau[i]) * SimdMath::NormalCdf(-d1));
+		}
+		Store(x, degenerate, EuropeanPutBaseline, option + start, S + start, price + start, n);
+	}
+}
+
+// pow(x, y) = exp(y log(x)), x > 0. For y1 = 1 (no dividend) the price is S, the
+// limit of the formula as y1 - 1 goes to 0; a tiny y1 - 1 in place of 0 gives it
+// within 1e-13 without a select the vectorizer cannot if-convert.
+SIMD_MATH_INLINE void AmericanCallBody(const OptionData* option, const double* S, double* price, size_t size) {
+	BookBlock x;
+	for (size_t start = 0; start < size; start += BLOCK) {
+		size_t n = min(BLOCK, size - start);
+		bool degenerate = Load(option + start, S + start, n, x, true);
+		for (size_t i = 0; i < BLOCK; i++) {
+			double tmp = x.b[i] / (x.sig[i] * x.sig[i]);
+			double y1 = 0.5 - tmp + SimdMath::Sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * x.r[i] / (x.sig[i] * x.sig[i]));
+			double e = y1 - 1;
+			e = e + (e == 0.0 ? 1e-200 : 0.0);
+			x.price[i] = x.K[i] / e * SimdMath::Exp(y1 * SimdMath::Log(e / y1 * x.S[i] / x.K[i]));
+		}
+		Store(x, degenerate, AmericanCallBaseline, option + start, S + start, price + start, n);
+	}
+}
+
+SIMD_MATH_INLINE void AmericanPutBody(const OptionData* option, const double* S, double* price, size_t size) {
+	BookBlock x;
+	for (size_t start = 0; start < size; start += BLOCK) {
+		size_t n = min(BLOCK, size - start);
+		bool degenerate = Load(option + start, S + start, n, x, true);
+		for (size_t i = 0; i < BLOCK; i++) {
+			double tmp = x.b[i] / (x.sig[i] * x.sig[i]);
+			double y2 = 0.5 - tmp - SimdMath::Sqrt((tmp - 0.5) * (tmp - 0.5) + 2 * x.r[i] / (x.sig[i] * x.sig[i]));
+			x.price[i] = x.K[i] / (1 - y2) * SimdMath::Exp(y2 * SimdMath::Log((y2 - 1) / y2 * x.S[i] / x.K[i]));
+		}
+		Store(x, degenerate, AmericanPutBaseline, option + start, S + start, price + start, n);
+	}
+}
+
+// SSE2 variant, the default target.
+static void EuropeanCallSse2(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanCallBody(option, S, price, size);
+}
+
+static void EuropeanPutSse2(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanPutBody(option, S, price, size);
+}
+
+static void AmericanCallSse2(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanCallBody(option, S, price, size);
+}
+
+static void AmericanPutSse2(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanPutBody(option, S, price, size);
+}
+
+#ifdef CPU_DISPATCH_X86
+CPU_DISPATCH_TARGET("avx2,fma")
+static void EuropeanCallAvx2(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanCallBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx2,fma")
+static void EuropeanPutAvx2(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanPutBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx2,fma")
+static void AmericanCallAvx2(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanCallBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx2,fma")
+static void AmericanPutAvx2(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanPutBody(option, S, price, size);
+}
+
+// 512 bit vectors even where the tuning would prefer 256 bit ones.
+CPU_DISPATCH_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void EuropeanCallAvx512(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanCallBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void EuropeanPutAvx512(const OptionData* option, const double* S, double* price, size_t size) {
+	EuropeanPutBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void AmericanCallAvx512(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanCallBody(option, S, price, size);
+}
+
+CPU_DISPATCH_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void AmericanPutAvx512(const OptionData* option, const double* S, double* price, size_t size) {
+	AmericanPutBody(option, S, price, size);
+}
+#endif
+
+static const BookKernels baselineKernels = { EuropeanCallBaseline, EuropeanPutBaseline, AmericanCallBaseline, AmericanPutBaseline };
+static const BookKernels sse2Kernels = { EuropeanCallSse2, EuropeanPutSse2, AmericanCallSse2, AmericanPutSse2 };
+#ifdef CPU_DISPATCH_X86
+static const BookKernels avx2Kernels = { EuropeanCallAvx2, EuropeanPutAvx2, AmericanCallAvx2, AmericanPutAvx2 };
+static const BookKernels avx512Kernels = { EuropeanCallAvx512, EuropeanPutAvx512, AmericanCallAvx512, AmericanPutAvx512 };
+#endif
+
+// -1 until the first use.
+static atomic<int> active(-1);
+
+const char* Name(CpuIsa isa) {
+	static const char* name[] = { "baseline", "sse2", "avx2", "avx512" };
+	return (isa < ISA_COUNT) ? name[isa] : "unknown";
+}
+
+bool Supported(CpuIsa isa) {
+	switch (isa) {
+	case ISA_BASELINE:
+	case ISA_SSE2:
+		return true;
+#ifdef CPU_DISPATCH_X86
+	case ISA_AVX2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case ISA_AVX512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+			&& __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	default:
+		return false;
+	}
+}
+
+CpuIsa Best() {
+	for (int isa = ISA_COUNT - 1; isa > ISA_SSE2; isa--) {
+		if (Supported(CpuIsa(isa)))
+			return CpuIsa(isa);
+	}
+	return ISA_SSE2;
+}
+
+// Best(), or the variant named by OPTION_PRICING_ISA.
+static CpuIsa Initial() {
+	const char* env = getenv("OPTION_PRICING_ISA");
+	if (env == 0 || *env == 0)
+		return Best();
+	for (int isa = 0; isa < ISA_COUNT; isa++) {
+		if (strcmp(env, Name(CpuIsa(isa))) == 0) {
+			if (Supported(CpuIsa(isa)))
+				return CpuIsa(isa);
+			cout << "OPTION_PRICING_ISA=" << env << " is not supported by this cpu, using " << Name(Best()) << endl;
+			return Best();
+		}
+	}
+	cout << "Unknown OPTION_PRICING_ISA=" << env << ", using " << Name(Best()) << endl;
+	return Best();
+}
+
+// Concurrent first calls compute the same value, so the race is harmless.
+CpuIsa Active() {
+	int tmp = active.load(memory_order_acquire);
+	if (tmp < 0) {
+		tmp = Initial();
+		active.store(tmp, memory_order_release);
+	}
+	return CpuIsa(tmp);
+}
+
+bool Select(CpuIsa isa) {
+	if (!Supported(isa))
+		return false;
+	active.store(isa, memory_order_release);
+	return true;
+}
+
+const BookKernels* Kernels() {
+	return Kernels(Active());
+}
+
+const BookKernels* Kernels(CpuIsa isa) {
+	if (!Supported(isa))
+		return 0;
+	switch (isa) {
+	case ISA_BASELINE:
+		return &baselineKernels;
+	case ISA_SSE2:
+		return &sse2Kernels;
+#ifdef CPU_DISPATCH_X86
+	case ISA_AVX2:
+		return &avx2Kernels;
+	case ISA_AVX512:
+		return &avx512Kernels;
+#endif
+	default:
+		return 0;
+	}
+}
+
+}	// Namespace CpuDispatch.
+}	// Namespace OptionFunction.
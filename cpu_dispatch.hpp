@@ -0,0 +1,62 @@
+// cpu_dispatch.hpp
+//
+// Header file for the run time selection of the book kernel ISA variants.
+//
+
+#ifndef CPU_DISPATCH_HPP_
+#define CPU_DISPATCH_HPP_
+
+#include <cstddef>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Instruction set variants of the European and American book kernels.
+// ISA_BASELINE is the original scalar loop calling the C library exp, log, pow
+// and erfc. The other variants run one loop over the branch free SimdMath
+// functions, compiled for SSE2 (the x86-64 baseline, or the default target on
+// other architectures), AVX2 with FMA and AVX-512, so one binary uses the vector
+// width of whatever cpu it runs on.
+enum CpuIsa {
+	ISA_BASELINE,
+	ISA_SSE2,
+	ISA_AVX2,		// AVX2 and FMA.
+	ISA_AVX512,	// AVX-512 F and DQ.
+	ISA_COUNT
+};
+
+// Book kernel, see EuropeanOptionFunction::CallPrice(const OptionData*, const double*, double*, size_t).
+typedef void (*BookKernel)(const OptionData* option, const double* S, double* price, size_t size);
+
+struct BookKernels {
+	BookKernel europeanCall;
+	BookKernel europeanPut;
+	BookKernel americanCall;
+	BookKernel americanPut;
+};
+
+namespace OptionFunction {
+namespace CpuDispatch {
+// All variants agree with ISA_BASELINE within TOLERANCE * max(price, K) for the
+// European kernels and TOLERANCE * price for the American ones. Prices that
+// would be subnormal (below about 1e-300) may come out as 0.
+const double TOLERANCE = 1e-12;
+
+// The variant is selected once, on first use, as the widest one the cpu supports
+// (cpuid), unless the environment variable OPTION_PRICING_ISA names another one:
+// baseline, sse2, avx2 or avx512. An unknown or unsupported name is reported and ignored.
+CpuIsa Active();
+const char* Name(CpuIsa isa);
+bool Supported(CpuIsa isa);	// Compiled in and supported by the cpu.
+CpuIsa Best();	// Widest supported variant.
+bool Select(CpuIsa isa);	// Switch the active variant, false when not supported.
+
+// Kernel table of the active variant or of a given one, 0 for a variant that is
+// not supported.
+const BookKernels* Kernels();
+const BookKernels* Kernels(CpuIsa isa);
+
+}	// Namespace CpuDispatch.
+}	// Namespace OptionFunction.
+
+#endif	// CPU_DISPATCH_HPP_
@@ -11,7 +11,11 @@
 #include <string>
 #include <boost/math/distributions/normal.hpp>
 #include <boost/math/distributions.hpp>	 // For non-member functions of distributions.
+#include "european_option_function.hpp"
+#include "market_state.hpp"
 #include "option_data.hpp"
+#include "option_function.hpp"
+#include "pricing_metrics.hpp"
 
 using namespace std;
 using namespace boost::math;
@@ -66,6 +70,7 @@ void EuropeanOption::toggle() {
 }
 
 double EuropeanOption::Price(double S) const {
+	PRICING_METRIC("EuropeanOption::Price(double) const", 1);
 	if (optType == "C") {
 		return CallPrice(S);
 	} else {
@@ -74,6 +79,7 @@ double EuropeanOption::Price(double S) const {
 }
 
 vector<double> EuropeanOption::Price(const vector<double>& S) const {
+	PRICING_METRIC("EuropeanOption::Price(const vector<double>&) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -83,47 +89,37 @@ vector<double> EuropeanOption::Price(const vector<double>& S) const {
 }
 
 vector<double> EuropeanOption::Price(double start, double end, double size) const {
+	PRICING_METRIC("EuropeanOption::Price(double, double, double) const", 0);
 	return Price(MeshArray(start, end, size));
 }
 
-// Using paraName to decide which parameter to change while other parameters hold constant.
-vector<double> EuropeanOption::Price(const vector<double>& param, const string& paramName, double S) {
-	vector<double> tmp;
-	vector<double>::const_iterator it;
-	double hold;
-
-	if (paramName == "T") {
-		hold = data.T;
-		for (it = param.begin(); it != param.end(); it++) {
-			Option::T(*it);
-			tmp.push_back(Price(S));
-		}
-		Option::T(hold);
-	} else if (paramName == "K") {
-		hold = data.K;
-		for (it = param.begin(); it != param.end(); it++) {
-			Option::K(*it);
-			tmp.push_back(Price(S));
-		}
-		Option::K(hold);
-	} else if (paramName == "sig") {
-		hold = data.sig;
-		for (it = param.begin(); it != param.end(); it++) {
-			Option::sig(*it);
-			tmp.push_back(Price(S));
-		}
-		Option::sig(hold);
-	} else {
-		cout << "Wrong parameter name" << endl;
-	}
-	return tmp;
+// Using paramName to decide which parameter (any OptionData field) to change while other
+// parameters hold constant. The sweep works on a copy of the parameters, the option is
+// not changed and may be shared between threads; large sweeps run on several threads.
+vector<double> EuropeanOption::Price(const vector<double>& param, const string& paramName, double S) const {
+	PRICING_METRIC("EuropeanOption::Price(const vector<double>&, const string&, double) const", param.size());
+	if (optType == "C")
+		return OptionFunction::EuropeanOptionFunction::CallPrice(data, param, paramName, S);
+	else
+		return OptionFunction::EuropeanOptionFunction::PutPrice(data, param, paramName, S);
 }
 
-vector<double> EuropeanOption::Price(double start, double end, double size, const string& paramName, double S) {
+vector<double> EuropeanOption::Price(double start, double end, double size, const string& paramName, double S) const {
+	PRICING_METRIC("EuropeanOption::Price(double, double, double, const string&, double) const", 0);
 	return Price(MeshArray(start, end, size), paramName, S);
 }
 
+// The option itself is not changed, other threads may price it concurrently.
+double EuropeanOption::Price(const MarketSnapshot& market) const {
+	PRICING_METRIC("EuropeanOption::Price(const MarketSnapshot&) const", 1);
+	if (optType == "C")
+		return OptionFunction::EuropeanOptionFunction::CallPrice(market.Apply(data), market.S);
+	else
+		return OptionFunction::EuropeanOptionFunction::PutPrice(market.Apply(data), market.S);
+}
+
 double EuropeanOption::PutCallParity(double S) const {
+	PRICING_METRIC("EuropeanOption::PutCallParity(double) const", 1);
 	if (optType == "C")
 		return CallToPut(S);
 	else
@@ -131,6 +127,7 @@ double EuropeanOption::PutCallParity(double S) const {
 }
 
 vector<double> EuropeanOption::PutCallParity(const vector<double>& S) const {
+	PRICING_METRIC("EuropeanOption::PutCallParity(const vector<double>&) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	if (optType == "C") {
@@ -146,10 +143,12 @@ vector<double> EuropeanOption::PutCallParity(const vector<double>& S) const {
 }
 
 vector<double> EuropeanOption::PutCallParity(double start, double end, double size) const {
+	PRICING_METRIC("EuropeanOption::PutCallParity(double, double, double) const", 0);
 	return PutCallParity(MeshArray(start, end, size));
 }
 
 double EuropeanOption::Delta(double S) const {
+	PRICING_METRIC("EuropeanOption::Delta(double) const", 1);
 	if (optType == "C")
 		return CallDelta(S);
 	else
@@ -157,6 +156,7 @@ double EuropeanOption::Delta(double S) const {
 }
 
 vector<double> EuropeanOption::Delta(const vector<double>& S) const {
+	PRICING_METRIC("EuropeanOption::Delta(const vector<double>&) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	if (optType == "C") {
@@ -172,14 +172,17 @@ vector<double> EuropeanOption::Delta(const vector<double>& S) const {
 }
 
 vector<double> EuropeanOption::Delta(double start, double end, double size) const {
+	PRICING_METRIC("EuropeanOption::Delta(double, double, double) const", 0);
 	return Delta(MeshArray(start, end, size));
 }
 
 double EuropeanOption::Delta(double S, double h) const {
+	PRICING_METRIC("EuropeanOption::Delta(double, double) const", 1);
 	return (Price(S + h) - Price(S - h)) / (2 * h);
 }
 
 vector<double> EuropeanOption::Delta(const vector<double>& S, double h) const {
+	PRICING_METRIC("EuropeanOption::Delta(const vector<double>&, double) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -189,16 +192,20 @@ vector<double> EuropeanOption::Delta(const vector<double>& S, double h) const {
 }
 
 vector<double> EuropeanOption::Delta(double start, double end, double size, double h) const {
+	PRICING_METRIC("EuropeanOption::Delta(double, double, double, double) const", 0);
 	return Delta(MeshArray(start, end, size), h);
 }
 
 double EuropeanOption::Gamma(double S) const {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * n(d1) / (S * tmp);
+	PRICING_METRIC("EuropeanOption::Gamma(double) const", 1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * n(d1) / (S * tmp);
 }
 
 vector<double> EuropeanOption::Gamma(const vector<double>& S) const {
+	PRICING_METRIC("EuropeanOption::Gamma(const vector<double>&) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -208,14 +215,17 @@ vector<double> EuropeanOption::Gamma(const vector<double>& S) const {
 }
 
 vector<double> EuropeanOption::Gamma(double start, double end, double size) const {
+	PRICING_METRIC("EuropeanOption::Gamma(double, double, double) const", 0);
 	return Gamma(MeshArray(start, end, size));
 }
 
 double EuropeanOption::Gamma(double S, double h) const {
+	PRICING_METRIC("EuropeanOption::Gamma(double, double) const", 1);
 	return (Price(S + h) - 2 * Price(S) + Price(S - h)) / (h * h);
 }
 
 vector<double> EuropeanOption::Gamma(const vector<double>& S, double h) const {
+	PRICING_METRIC("EuropeanOption::Gamma(const vector<double>&, double) const", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -225,11 +235,15 @@ vector<double> EuropeanOption::Gamma(const vector<double>& S, double h) const {
 }
 
 vector<double> EuropeanOption::Gamma(double start, double end, double size, double h) const {
+	PRICING_METRIC("EuropeanOption::Gamma(double, double, double, double) const", 0);
 	return Gamma(MeshArray(start, end, size), h);
 }
 
 bool EuropeanOption::IsParity(double S, double price) const {
-	double epsilon = 0.00001;
+	return IsParity(S, price, 0.00001);
+}
+
+bool EuropeanOption::IsParity(double S, double price, double epsilon) const {
 	if (abs(PutCallParity(S) - price) < epsilon)
 		return true;
 	else
@@ -239,37 +253,43 @@ bool EuropeanOption::IsParity(double S, double price) const {
 // Private function.
 
 double EuropeanOption::CallPrice(double S) const {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
 	double d2 = d1 - tmp;
-	return (S * exp((data.b - data.r) * data.T) * N(d1)) - (data.K * exp(-data.r * data.T) * N(d2));
+	return (S * exp((data.b - data.r) * tau) * N(d1)) - (data.K * exp(-data.r * tau) * N(d2));
 }
 
 double EuropeanOption::PutPrice(double S) const {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
 	double d2 = d1 - tmp;
-	return (data.K * exp(-data.r * data.T) * N(-d2)) - (S * exp((data.b - data.r) * data.T) * N(-d1));
+	return (data.K * exp(-data.r * tau) * N(-d2)) - (S * exp((data.b - data.r) * tau) * N(-d1));
 }
 
 double EuropeanOption::CallToPut(double S) const {
-	return (Price(S) + data.K * exp(-data.r * data.T) - S);
+	double tau = data.T - data.t;	// Time to expiry.
+	return (Price(S) + data.K * exp(-data.r * tau) - S);
 }
 
 double EuropeanOption::PutToCall(double S) const {
-	return (Price(S) + S - data.K * exp(-data.r * data.T));
+	double tau = data.T - data.t;	// Time to expiry.
+	return (Price(S) + S - data.K * exp(-data.r * tau));
 }
 
 double EuropeanOption::CallDelta(double S) const {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * N(d1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * N(d1);
 }
 
 double EuropeanOption::PutDelta(double S) const {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * (N(d1) - 1.0);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * (N(d1) - 1.0);
 }
 
 // Using boost library normal_distribution. 
@@ -285,9 +305,5 @@ double EuropeanOption::N(double x) const {
 }
 
 vector<double> EuropeanOption::MeshArray(double start, double end, double size) const {
-	vector<double> tmp;
-	for (double i = start; i <= end; i += size) {
-		tmp.push_back(i);
-	}
-	return tmp;
-}
\ No newline at end of file
+	return OptionFunction::MeshArray(start, end, size);
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "option.hpp"
 #include <string>
 #include <vector>
+#include "market_state.hpp"
 #include "option_data.hpp"
 
 using namespace std;
@@ -20,6 +21,7 @@ using namespace std;
 // Calculate option price vector with Price(double, double, double), spot price mesh version.
 // Calculate option price vector with Price(const vector<double>&, const string&, double S), param vector version.
 // Calculate option price vector with Price(double, double, double, const string&, double), param mesh version.
+// Calculate option price with Price(const MarketSnapshot&), market snapshot version (spot and market inputs of the snapshot).
 // Calculate opposite type option price with PutCallParity(double), spot price version.
 // Calculate opposite type option price with PutCallParity(const vector<double>&), spot price vector version.
 // Calculate opposite type option price with PutCallParity(double, double, double), spot price price mesh version.
@@ -36,6 +38,7 @@ using namespace std;
 // Calculate approximated gamma with Gamma(const vector<double>&, double), spot price vector version.
 // Calculate approximated gamma with Gamma(double, double, double, double), spot price mesh version.
 // Evaluates whether the put-call parity holds with IsParity(double, double).
+// Evaluates whether the put-call parity holds within a tolerance with IsParity(double, double, double).
 // Assign value to the same type of object with binary operator =.
 class EuropeanOption : public Option {
  public:
@@ -63,8 +66,9 @@ class EuropeanOption : public Option {
 	double Price(double S) const;
 	vector<double> Price(const vector<double>& S) const;
 	vector<double> Price(double start, double end, double size) const;
-	vector<double> Price(const vector<double>& param, const string& paramName, double S);
-	vector<double> Price(double start, double end, double size, const string& paramName, double S);
+	vector<double> Price(const vector<double>& param, const string& paramName, double S) const;	// Any OptionData field, see SetParam().
+	vector<double> Price(double start, double end, double size, const string& paramName, double S) const;
+	double Price(const MarketSnapshot& market) const;
 	double PutCallParity(double S) const;
 	vector<double> PutCallParity(const vector<double>& S) const;
 	vector<double> PutCallParity(double start, double end, double size) const;
@@ -85,6 +89,7 @@ class EuropeanOption : public Option {
 
 	// Evaluation whether the put-call parity holds.
 	bool IsParity(double S, double price) const;
+	bool IsParity(double S, double price, double epsilon) const;
 
  private:
 	string optType;	 // Option type (call, put).
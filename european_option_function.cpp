@@ -5,17 +5,59 @@
 
 #include <boost/math/distributions/normal.hpp>
 #include <boost/math/distributions.hpp>	 // For non-member functions of distributions.
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <cmath>
+#include <thread>
 #include <vector>
+#include "cpu_dispatch.hpp"
+#include "european_option_function.hpp"
+#include "market_state.hpp"
 #include "option_data.hpp"
 #include "option_function.hpp"
+#include "pricing_metrics.hpp"
 
 using namespace std;
 using namespace boost::math;
 
 namespace OptionFunction {
 namespace EuropeanOptionFunction {
+
+// Sweeps of at least two chunks run on several threads.
+static const size_t SWEEP_CHUNK = 4096;
+
+// Prices with one parameter (any OptionData field, see SetParam) changed over
+// param. Every thread works on its own copy of the parameters, nothing shared
+// is written, so sweeps are reentrant and give the same prices on any number of threads.
+static vector<double> Sweep(const OptionData& option, const vector<double>& param, const string& paramName, double S, bool call) {
+	OptionData data = option;
+	if (!SetParam(data, paramName, 0.0)) {
+		cout << "Wrong parameter name" << endl;
+		return vector<double>();
+	}
+	vector<double> tmp(param.size());
+	function<void(size_t, size_t)> run = [&](size_t begin, size_t end) {
+		OptionData local = option;
+		for (size_t i = begin; i < end; i++) {
+			SetParam(local, paramName, param[i]);
+			tmp[i] = call ? CallPrice(local, S) : PutPrice(local, S);
+		}
+	};
+
+	size_t threads = min<size_t>(thread::hardware_concurrency(), param.size() / SWEEP_CHUNK);
+	if (threads <= 1) {
+		run(0, param.size());
+		return tmp;
+	}
+	vector<thread> workers;
+	for (size_t t = 1; t < threads; t++)
+		workers.push_back(thread(run, t * param.size() / threads, (t + 1) * param.size() / threads));
+	run(0, param.size() / threads);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	return tmp;
+}
 // Using boost library normal_distribution. 
 double n(double x) {
 	normal_distribution<> myNormal(0.0, 1.0);
@@ -30,6 +72,7 @@ double N(double x) {
 
 // Using n(x) and N(x).
 double CallPrice(double T, double K, double sig, double r, double b, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(double, double, double, double, double, double)", 1);
 	double tmp = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig * sig) * 0.5) * T) / tmp;
 	double d2 = d1 - tmp;
@@ -38,14 +81,17 @@ double CallPrice(double T, double K, double sig, double r, double b, double S) {
 
 // Using n(x) and N(x).
 double CallPrice(const OptionData& option, double S) {
-	double tmp = option.sig * sqrt(option.T);
-	double d1 = (log(S / option.K) + (option.b + (option.sig * option.sig) * 0.5) * option.T) / tmp;
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, double)", 1);
+	double tau = option.T - option.t;	// Time to expiry.
+	double tmp = option.sig * sqrt(tau);
+	double d1 = (log(S / option.K) + (option.b + (option.sig * option.sig) * 0.5) * tau) / tmp;
 	double d2 = d1 - tmp;
-	return (S * exp((option.b - option.r) * option.T) * N(d1)) - (option.K * exp(-option.r * option.T) * N(d2));
+	return (S * exp((option.b - option.r) * tau) * N(d1)) - (option.K * exp(-option.r * tau) * N(d2));
 }
 
 // Using n(x), N(x) and CallPrice(const OptionData&, double).
 vector<double> CallPrice(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -56,43 +102,48 @@ vector<double> CallPrice(const OptionData& option, const vector<double>& S) {
 
 // Using CallPrice(const OptionData&, const vector<double>&) and MeshArray(double, double, double).
 vector<double> CallPrice(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, double, double, double)", 0);
 	return CallPrice(option, MeshArray(start, end, size));
 }
 
-// Using paraName to decide which parameter to change while other parameters hold constant. 
-vector<double> CallPrice (const OptionData& option, const vector<double>& param, const string& paramName, double S) {
-	OptionData data = option;
-	vector<double> tmp;
-	vector<double>::const_iterator it;
+double CallPrice(const OptionData& option, const MarketSnapshot& market) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, const MarketSnapshot&)", 0);
+	return CallPrice(market.Apply(option), market.S);
+}
 
-	if (paramName == "T") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.T = *it;
-			tmp.push_back(CallPrice(data, S));
-		}
-	} else if (paramName == "K") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.K = *it;
-			tmp.push_back(CallPrice(data, S));
-		}
-	} else if (paramName == "sig") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.sig = *it;
-			tmp.push_back(CallPrice(data, S));
-		}
-	} else {
-		cout << "Wrong parameter name" << endl;
+// Book kernel, the variant for this cpu, see CpuDispatch.
+void CallPrice(const OptionData* option, const double* S, double* price, size_t size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData*, const double*, double*, size_t)", size);
+	CpuDispatch::Kernels()->europeanCall(option, S, price, size);
+}
+
+// Using CallPrice(const OptionData*, const double*, double*, size_t).
+vector<double> CallPrice(const vector<OptionData>& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const vector<OptionData>&, const vector<double>&)", option.size());
+	if (option.size() != S.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return vector<double>();
 	}
+	vector<double> tmp(option.size());
+	CallPrice(option.data(), S.data(), tmp.data(), tmp.size());
 	return tmp;
 }
 
+// Using paramName to decide which parameter to change while other parameters hold constant, see Sweep().
+vector<double> CallPrice(const OptionData& option, const vector<double>& param, const string& paramName, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, const vector<double>&, const string&, double)", param.size());
+	return Sweep(option, param, paramName, S, true);
+}
+
 // Using paraName to decide which parameter to change while other parameters hold constant. 
 vector<double> CallPrice(const OptionData& option, double start, double end, double size, const string& paramName, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallPrice(const OptionData&, double, double, double, const string&, double)", 0);
 	return CallPrice(option, MeshArray(start, end, size), paramName, S);
 }
 
 // Using n(x) and N(x).
 double PutPrice(double T, double K, double sig, double r, double b, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(double, double, double, double, double, double)", 1);
 	double tmp = sig * sqrt(T);
 	double d1 = (log(S / K) + (b + (sig * sig) * 0.5) * T) / tmp;
 	double d2 = d1 - tmp;
@@ -101,14 +152,17 @@ double PutPrice(double T, double K, double sig, double r, double b, double S) {
 
 // Using n(x) and N(x).
 double PutPrice(const OptionData& option, double S) {
-	double tmp = option.sig * sqrt(option.T);
-	double d1 = (log(S / option.K) + (option.b + (option.sig * option.sig) * 0.5) * option.T) / tmp;
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, double)", 1);
+	double tau = option.T - option.t;	// Time to expiry.
+	double tmp = option.sig * sqrt(tau);
+	double d1 = (log(S / option.K) + (option.b + (option.sig * option.sig) * 0.5) * tau) / tmp;
 	double d2 = d1 - tmp;
-	return (option.K * exp(-option.r * option.T) * N(-d2)) - (S * exp((option.b - option.r) * option.T) * N(-d1));
+	return (option.K * exp(-option.r * tau) * N(-d2)) - (S * exp((option.b - option.r) * tau) * N(-d1));
 }
 
 // Using n(x), N(x) and PutPrice(const OptionData&, double).
 vector<double> PutPrice(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -119,38 +173,42 @@ vector<double> PutPrice(const OptionData& option, const vector<double>& S) {
 
 // Using PutPrice(const OptionData&, const vector<double>&) and MeshArray(double, double, double).
 vector<double> PutPrice(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, double, double, double)", 0);
 	return PutPrice(option, MeshArray(start, end, size));
 }
 
-// Using paraName to decide which parameter to change while others hold constant. 
-vector<double> PutPrice(const OptionData& option, const vector<double>& param, const string& paramName, double S) {
-	OptionData data = option;
-	vector<double> tmp;
-	vector<double>::const_iterator it;
+double PutPrice(const OptionData& option, const MarketSnapshot& market) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, const MarketSnapshot&)", 0);
+	return PutPrice(market.Apply(option), market.S);
+}
 
-	if (paramName == "T") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.T = *it;
-			tmp.push_back(PutPrice(data, S));
-		}
-	} else if (paramName == "K") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.K = *it;
-			tmp.push_back(PutPrice(data, S));
-		}
-	} else if (paramName == "sig") {
-		for (it = param.begin(); it != param.end(); it++) {
-			data.sig = *it;
-			tmp.push_back(PutPrice(data, S));
-		}
-	} else {
-		cout << "Wrong parameter name" << endl;
+// Book kernel, see CallPrice(const OptionData*, const double*, double*, size_t).
+void PutPrice(const OptionData* option, const double* S, double* price, size_t size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData*, const double*, double*, size_t)", size);
+	CpuDispatch::Kernels()->europeanPut(option, S, price, size);
+}
+
+// Using PutPrice(const OptionData*, const double*, double*, size_t).
+vector<double> PutPrice(const vector<OptionData>& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const vector<OptionData>&, const vector<double>&)", option.size());
+	if (option.size() != S.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return vector<double>();
 	}
+	vector<double> tmp(option.size());
+	PutPrice(option.data(), S.data(), tmp.data(), tmp.size());
 	return tmp;
 }
 
+// Using paramName to decide which parameter to change while others hold constant, see Sweep().
+vector<double> PutPrice(const OptionData& option, const vector<double>& param, const string& paramName, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, const vector<double>&, const string&, double)", param.size());
+	return Sweep(option, param, paramName, S, false);
+}
+
 // Using paraName to decide which parameter to change while others hold constant.
 vector<double> PutPrice(const OptionData& option, double start, double end, double size, const string& paramName, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutPrice(const OptionData&, double, double, double, const string&, double)", 0);
 	return PutPrice(option, MeshArray(start, end, size), paramName, S);
 }
 
@@ -158,10 +216,13 @@ vector<double> PutPrice(const OptionData& option, double start, double end, doub
 // Put-call parity pricing function (call to put).
 
 double CallToPut(const OptionData& option, double C, double S) {
-	return (C + option.K * exp(-option.r * option.T) - S);
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, double, double)", 1);
+	double tau = option.T - option.t;	// Time to expiry.
+	return (C + option.K * exp(-option.r * tau) - S);
 }
 
 vector<double> CallToPut(const OptionData& option, double C, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, double, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -171,14 +232,17 @@ vector<double> CallToPut(const OptionData& option, double C, const vector<double
 }
 
 vector<double> CallToPut(const OptionData& option, double C, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, double, double, double, double)", 0);
 	return CallToPut(option, C, MeshArray(start, end, size));
 }
 
 double CallToPut(const OptionData& option, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, double)", 1);
 	return CallToPut(option, CallPrice(option, S), S);
 }
 
 vector<double> CallToPut(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -188,16 +252,20 @@ vector<double> CallToPut(const OptionData& option, const vector<double>& S) {
 }
 
 vector<double> CallToPut(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallToPut(const OptionData&, double, double, double)", 0);
 	return CallToPut(option, MeshArray(start, end, size));
 }
 
 // Put-call parity pricing function (put to call).
 
 double PutToCall(const OptionData& option, double P, double S) {
-	return (P + S - option.K * exp(-option.r * option.T));
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, double, double)", 1);
+	double tau = option.T - option.t;	// Time to expiry.
+	return (P + S - option.K * exp(-option.r * tau));
 }
 
 vector<double> PutToCall(const OptionData& option, double P, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, double, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -207,14 +275,17 @@ vector<double> PutToCall(const OptionData& option, double P, const vector<double
 }
 
 vector<double> PutToCall(const OptionData& option, double P, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, double, double, double, double)", 0);
 	return PutToCall(option, P, MeshArray(start, end, size));
 }
 
 double PutToCall(const OptionData& option, double S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, double)", 1);
 	return PutToCall(option, PutPrice(option, S), S);
 }
 
 vector<double> PutToCall(const OptionData& option, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -224,18 +295,22 @@ vector<double> PutToCall(const OptionData& option, const vector<double>& S) {
 }
 
 vector<double> PutToCall(const OptionData& option, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutToCall(const OptionData&, double, double, double)", 0);
 	return PutToCall(option, MeshArray(start, end, size));
 }
 
 // Call option delta function.
 
 double CallDelta(const OptionData& data, double S) {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * N(d1);
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, double)", 1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * N(d1);
 }
 
 vector<double> CallDelta(const OptionData& data, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -245,16 +320,19 @@ vector<double> CallDelta(const OptionData& data, const vector<double>& S) {
 }
 
 vector<double> CallDelta(const OptionData& data, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, double, double, double)", 0);
 	return CallDelta(data, MeshArray(start, end, size));
 }
 
 // Call option delta approximation function.
 
 double CallDelta(const OptionData& data, double S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, double, double)", 1);
 	return (CallPrice(data, S + h) - CallPrice(data, S - h)) / (2 * h);
 }
 
 vector<double> CallDelta(const OptionData& data, const vector<double>& S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, const vector<double>&, double)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -264,18 +342,22 @@ vector<double> CallDelta(const OptionData& data, const vector<double>& S, double
 }
 
 vector<double> CallDelta(const OptionData& data, double start, double end, double size, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::CallDelta(const OptionData&, double, double, double, double)", 0);
 	return CallDelta(data, MeshArray(start, end, size), h);
 }
 
 // Put option delta function.
 
 double PutDelta(const OptionData& data, double S) {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * (N(d1) - 1.0);
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, double)", 1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * (N(d1) - 1.0);
 }
 
 vector<double> PutDelta(const OptionData& data, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -285,16 +367,19 @@ vector<double> PutDelta(const OptionData& data, const vector<double>& S) {
 }
 
 vector<double> PutDelta(const OptionData& data, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, double, double, double)", 0);
 	return PutDelta(data, MeshArray(start, end, size));
 }
 
 // Put option delta approximation function.
 
 double PutDelta(const OptionData& data, double S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, double, double)", 1);
 	return (PutPrice(data, S + h) - PutPrice(data, S - h)) / (2 * h);
 }
 
 vector<double> PutDelta(const OptionData& data, const vector<double>& S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, const vector<double>&, double)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -304,18 +389,22 @@ vector<double> PutDelta(const OptionData& data, const vector<double>& S, double
 }
 
 vector<double> PutDelta(const OptionData& data, double start, double end, double size, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutDelta(const OptionData&, double, double, double, double)", 0);
 	return PutDelta(data, MeshArray(start, end, size), h);
 }
 
 // Call option gamma function.
 
 double CallGamma(const OptionData& data, double S){
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * n(d1) / (S * tmp);
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, double)", 1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * n(d1) / (S * tmp);
 }
 
 vector<double> CallGamma(const OptionData& data, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -325,16 +414,19 @@ vector<double> CallGamma(const OptionData& data, const vector<double>& S) {
 }
 
 vector<double> CallGamma(const OptionData& data, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, double, double, double)", 0);
 	return CallGamma(data, MeshArray(start, end, size));
 }
 
 // Call option gamma approximation function.
 
 double CallGamma(const OptionData& data, double S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, double, double)", 1);
 	return (CallPrice(data, S + h) - 2 * CallPrice(data, S) + CallPrice(data, S - h)) / (h * h);
 }
 
 vector<double> CallGamma(const OptionData& data, const vector<double>& S, double h){
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, const vector<double>&, double)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -344,18 +436,22 @@ vector<double> CallGamma(const OptionData& data, const vector<double>& S, double
 }
 
 vector<double> CallGamma(const OptionData& data, double start, double end, double size, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::CallGamma(const OptionData&, double, double, double, double)", 0);
 	return CallGamma(data, MeshArray(start, end ,size), h);
 }
 
 // Put option gamma function.
 
 double PutGamma(const OptionData& data, double S) {
-	double tmp = data.sig * sqrt(data.T);
-	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * data.T) / tmp;
-	return exp((data.b - data.r) * data.T) * n(d1) / (S * tmp);
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, double)", 1);
+	double tau = data.T - data.t;	// Time to expiry.
+	double tmp = data.sig * sqrt(tau);
+	double d1 = (log(S / data.K) + (data.b + (data.sig * data.sig) * 0.5) * tau) / tmp;
+	return exp((data.b - data.r) * tau) * n(d1) / (S * tmp);
 }
 
 vector<double> PutGamma(const OptionData& data, const vector<double>& S) {
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, const vector<double>&)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -365,16 +461,19 @@ vector<double> PutGamma(const OptionData& data, const vector<double>& S) {
 }
 
 vector<double> PutGamma(const OptionData& data, double start, double end, double size) {
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, double, double, double)", 0);
 	return PutGamma(data, MeshArray(start, end, size));
 }
 
 // Put option gamma approximation function.
 
 double PutGamma(const OptionData& data, double S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, double, double)", 1);
 	return (PutPrice(data, S + h) - 2 * PutPrice(data, S) + PutPrice(data, S - h)) / (h * h);
 }
 
 vector<double> PutGamma(const OptionData& data, const vector<double>& S, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, const vector<double>&, double)", S.size());
 	vector<double> tmp;
 	vector<double>::const_iterator it;
 	for (it = S.begin(); it != S.end(); it++) {
@@ -384,8 +483,9 @@ vector<double> PutGamma(const OptionData& data, const vector<double>& S, double
 }
 
 vector<double> PutGamma(const OptionData& data, double start, double end, double size, double h) {
+	PRICING_METRIC("EuropeanOptionFunction::PutGamma(const OptionData&, double, double, double, double)", 0);
 	return PutGamma(data, MeshArray(start, end, size), h);
 }
 
 }	// Namespace EuropeanOptionFunction.
-}	// Namespace OptionFunction.
\ No newline at end of file
+}	// Namespace OptionFunction.
\ No newline at end of file
@@ -6,7 +6,10 @@
 #ifndef EUROPEAN_OPTION_FUNCTION_HPP_
 #define EUROPEAN_OPTION_FUNCTION_HPP_
 
+#include <cstddef>
+#include <string>
 #include <vector>
+#include "market_state.hpp"
 #include "option_data.hpp"
 
 using namespace std;
@@ -22,7 +25,12 @@ double CallPrice(double T, double K, double sig, double r, double b, double S);
 double CallPrice(const OptionData& option, double S);   // OptionData version.
 vector<double> CallPrice(const OptionData& option, const vector<double>& S);    // Spot price vector version.
 vector<double> CallPrice(const OptionData& option, double start, double end, double size);  // Spot price mesh version.
+double CallPrice(const OptionData& option, const MarketSnapshot& market);	// Market snapshot version, see MarketState.
 	
+// Call option pricing function with a book of options, one spot price per option.
+void CallPrice(const OptionData* option, const double* S, double* price, size_t size);	// Book array version.
+vector<double> CallPrice(const vector<OptionData>& option, const vector<double>& S);	// Book vector version.
+
 // Call option pricing function with one changing parameter.
 vector<double> CallPrice(const OptionData& option, const vector<double>& param, const string& paramName, double S); // Param vector version.
 vector<double> CallPrice(const OptionData& option, double start, double end, double size, const string& paramName, double S);   // Param mesh version.
@@ -32,6 +40,11 @@ double PutPrice(double T, double K, double sig, double r, double b, double S);	/
 double PutPrice(const OptionData& option, double S);    // OptionData version.
 vector<double> PutPrice(const OptionData& option, const vector<double>& S); // Spot price vector version.
 vector<double> PutPrice(const OptionData& option, double start, double end, double size);   // Spot price mesh version.
+double PutPrice(const OptionData& option, const MarketSnapshot& market);	// Market snapshot version, see MarketState.
+
+// Put option pricing function with a book of options, one spot price per option.
+void PutPrice(const OptionData* option, const double* S, double* price, size_t size);	// Book array version.
+vector<double> PutPrice(const vector<OptionData>& option, const vector<double>& S);	// Book vector version.
 
 // Put option pricing function with one changing parameter.
 vector<double> PutPrice(const OptionData& option, const vector<double>& param, const string& paramName, double S);  // Param vector version.
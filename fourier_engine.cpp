@@ -0,0 +1,235 @@
+// fourier_engine.cpp
+//
+// FourierEngine implementation.
+//
+
+#include "fourier_engine.hpp"
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+// Grids kept before the cache is emptied.
+static const size_t MAX_CACHE = 256;
+
+// Lewis integral: frequency step and upper limit.
+static const double INTEGRAL_STEP = 0.01;
+static const double INTEGRAL_END = 200.0;
+
+FourierGrid::FourierGrid() : size(4096), eta(0.25), alpha(1.5) {
+}
+
+namespace OptionFunction {
+namespace FourierFunction {
+
+// Albrecher, Mayer, Schoutens and Tistaert ("The little Heston trap"): the
+// exp(-d tau) form stays on the principal branch of the logarithm.
+CharacteristicFunction Heston(const HestonParams& params) {
+	HestonParams p = params;
+	return [p](const complex<double>& u, double tau) {
+		const complex<double> I(0.0, 1.0);
+		complex<double> iu = I * u;
+		complex<double> beta = p.kappa - p.rho * p.xi * iu;
+		complex<double> d = sqrt(beta * beta + p.xi * p.xi * (iu + u * u));
+		complex<double> g = (beta - d) / (beta + d);
+		complex<double> e = exp(-d * tau);
+		double xi2 = p.xi * p.xi;
+		complex<double> C = p.kappa * p.theta / xi2 * ((beta - d) * tau - 2.0 * log((1.0 - g * e) / (1.0 - g)));
+		complex<double> D = (beta - d) / xi2 * (1.0 - e) / (1.0 - g * e);
+		return exp(C + D * p.v0);
+	};
+}
+
+CharacteristicFunction BlackScholes(double sig) {
+	return [sig](const complex<double>& u, double tau) {
+		const complex<double> I(0.0, 1.0);
+		return exp(-0.5 * sig * sig * tau * (I * u + u * u));
+	};
+}
+
+void Fft(complex<double>* x, size_t size) {
+	// Bit reversal permutation.
+	for (size_t i = 1, j = 0; i < size; i++) {
+		size_t bit = size >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			swap(x[i], x[j]);
+	}
+
+	// Twiddles of the last stage, the earlier stages use every (size / len)th.
+	vector<complex<double> > w(size / 2);
+	for (size_t k = 0; k < size / 2; k++)
+		w[k] = polar(1.0, -2.0 * M_PI * double(k) / double(size));
+	for (size_t len = 2; len <= size; len <<= 1) {
+		size_t half = len / 2, stride = size / len;
+		for (size_t i = 0; i < size; i += len) {
+			for (size_t k = 0; k < half; k++) {
+				complex<double> t = w[k * stride] * x[i + k + half];
+				x[i + k + half] = x[i + k] - t;
+				x[i + k] += t;
+			}
+		}
+	}
+}
+
+}	// Namespace FourierFunction.
+}	// Namespace OptionFunction.
+
+FourierEngine::FourierEngine(const CharacteristicFunction& cf, const FourierGrid& newGrid) : cf(cf), grid(newGrid), hits(0), misses(0) {
+	if (grid.size < 4 || (grid.size & (grid.size - 1)) != 0 || !(grid.eta > 0.0) || !(grid.alpha > 0.0)) {
+		cout << "Wrong FFT grid, using the default grid" << endl;
+		grid = FourierGrid();
+	}
+}
+
+FourierEngine::FourierEngine(const HestonParams& params, const FourierGrid& newGrid)
+	: FourierEngine(OptionFunction::FourierFunction::Heston(params), newGrid) {
+}
+
+FourierEngine::~FourierEngine() {
+}
+
+// Carr-Madan with Simpson weights. Log strikes k = log(F) + kappa, kappa from
+// -pi / eta in steps of lambda = 2 pi / (N eta). Returns C / F at each kappa.
+vector<double> FourierEngine::Build(double tau, double r) const {
+	PricingTrace::Span span("characteristic grid", "fourier", grid.size);
+	const complex<double> I(0.0, 1.0);
+	size_t N = grid.size;
+	double eta = grid.eta, alpha = grid.alpha;
+	double lambda = 2.0 * M_PI / (double(N) * eta);
+	double half = 0.5 * double(N) * lambda;
+	double discount = exp(-r * tau);
+
+	vector<complex<double> > x(N);
+	for (size_t j = 0; j < N; j++) {
+		double v = double(j) * eta;
+		complex<double> psi = discount * cf(complex<double>(v, -(alpha + 1.0)), tau)
+			/ complex<double>(alpha * alpha + alpha - v * v, (2.0 * alpha + 1.0) * v);
+		double simpson = eta / 3.0 * (3.0 + ((j & 1) ? 1.0 : -1.0) - (j == 0 ? 1.0 : 0.0));
+		x[j] = exp(I * (v * half)) * psi * simpson;
+	}
+	OptionFunction::FourierFunction::Fft(x.data(), N);
+
+	vector<double> tmp(N);
+	for (size_t u = 0; u < N; u++) {
+		double kappa = -half + lambda * double(u);
+		tmp[u] = exp(-alpha * kappa) / M_PI * x[u].real();
+	}
+	return tmp;
+}
+
+shared_ptr<const vector<double> > FourierEngine::Normalized(double tau, double r) const {
+	Key key(tau, r);
+	{
+		lock_guard<mutex> guard(lock);
+		map<Key, shared_ptr<const vector<double> > >::const_iterator it = cache.find(key);
+		if (it != cache.end()) {
+			hits++;
+			return it->second;
+		}
+	}
+	misses++;
+	shared_ptr<const vector<double> > tmp(new vector<double>(Build(tau, r)));	// Outside the lock, other expiries go on.
+	lock_guard<mutex> guard(lock);
+	if (cache.size() >= MAX_CACHE)
+		cache.clear();
+	cache[key] = tmp;
+	return tmp;
+}
+
+// Cubic (four point Lagrange) interpolation of C / F in log strike.
+vector<double> FourierEngine::Price(const OptionData& data, const vector<double>& K, char optType, double S) const {
+	PRICING_METRIC("FourierEngine::Price(const OptionData&, const vector<double>&, char, double) const", K.size());
+	bool call = !(optType == 'P' || optType == 'p');
+	if (optType != 'C' && optType != 'c' && call)
+		cout << "Wrong option type" << endl;
+	double tau = data.T - data.t;	// Time to expiry.
+	vector<double> tmp(K.size());
+	if (tau <= 0.0) {
+		for (size_t i = 0; i < K.size(); i++)
+			tmp[i] = call ? max(S - K[i], 0.0) : max(K[i] - S, 0.0);
+		return tmp;
+	}
+
+	shared_ptr<const vector<double> > normalized = Normalized(tau, data.r);
+	const vector<double>& y = *normalized;
+	double F = S * exp(data.b * tau);
+	double discount = exp(-data.r * tau);
+	double lambda = 2.0 * M_PI / (double(grid.size) * grid.eta);
+	double half = 0.5 * double(grid.size) * lambda;
+	for (size_t i = 0; i < K.size(); i++) {
+		double p = (log(K[i] / F) + half) / lambda;
+		double j = floor(p);
+		if (!(j >= 1.0 && j + 2.0 <= double(grid.size - 1))) {
+			tmp[i] = numeric_limits<double>::quiet_NaN();
+			continue;
+		}
+		size_t n = size_t(j);
+		double t = p - j;
+		double c = y[n - 1] * (-t * (t - 1.0) * (t - 2.0) / 6.0) + y[n] * ((t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0)
+			+ y[n + 1] * (-(t + 1.0) * t * (t - 2.0) / 2.0) + y[n + 2] * ((t + 1.0) * t * (t - 1.0) / 6.0);
+		double C = F * c;
+		tmp[i] = call ? C : C - discount * (F - K[i]);
+	}
+	return tmp;
+}
+
+// Expiries are independent, threads take the next unpriced one.
+vector<vector<double> > FourierEngine::Price(const vector<FourierExpiry>& expiries, size_t threads) const {
+	PRICING_METRIC("FourierEngine::Price(const vector<FourierExpiry>&, size_t) const", expiries.size());
+	vector<vector<double> > tmp(expiries.size());
+	if (threads == 0)
+		threads = thread::hardware_concurrency();
+	threads = max<size_t>(1, min(threads, expiries.size()));
+	atomic<size_t> next(0);
+	function<void()> run = [&]() {
+		for (size_t i = next++; i < expiries.size(); i = next++) {
+			PricingTrace::Span span("expiry", "fourier", expiries[i].K.size());
+			tmp[i] = Price(expiries[i].data, expiries[i].K, expiries[i].optType, expiries[i].S);
+		}
+	};
+	vector<thread> workers;
+	for (size_t t = 1; t < threads; t++)
+		workers.push_back(thread(run));
+	run();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	return tmp;
+}
+
+// C = exp(-r tau) (F - sqrt(F K) / pi int_0^inf Re(exp(i u k) phi(u - i / 2)) / (u^2 + 1 / 4) du), k = log(F / K).
+double FourierEngine::IntegralPrice(const OptionData& data, double K, char optType, double S) const {
+	PRICING_METRIC("FourierEngine::IntegralPrice(const OptionData&, double, char, double) const", 1);
+	bool call = !(optType == 'P' || optType == 'p');
+	double tau = data.T - data.t;	// Time to expiry.
+	if (tau <= 0.0)
+		return call ? max(S - K, 0.0) : max(K - S, 0.0);
+	const complex<double> I(0.0, 1.0);
+	double F = S * exp(data.b * tau);
+	double k = log(F / K);
+	double integral = 0.0;
+	size_t steps = size_t(INTEGRAL_END / INTEGRAL_STEP);
+	for (size_t j = 0; j <= steps; j++) {
+		double u = double(j) * INTEGRAL_STEP;
+		double f = (exp(I * (u * k)) * cf(complex<double>(u, -0.5), tau)).real() / (u * u + 0.25);
+		integral += (j == 0 || j == steps) ? 0.5 * f : f;
+	}
+	integral *= INTEGRAL_STEP;
+	double discount = exp(-data.r * tau);
+	double C = discount * (F - sqrt(F * K) / M_PI * integral);
+	return call ? C : C - discount * (F - K);
+}
+
+void FourierEngine::Clear() {
+	lock_guard<mutex> guard(lock);
+	cache.clear();
+}
@@ -0,0 +1,132 @@
+// fourier_engine.hpp
+//
+// Header file for Class FourierEngine.
+// Carr-Madan FFT pricing of European strike chains under Heston or any
+// model with a known characteristic function.
+//
+
+#ifndef FOURIER_ENGINE_HPP_
+#define FOURIER_ENGINE_HPP_
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Heston stochastic volatility: dv = kappa (theta - v) dt + xi sqrt(v) dW2, d<W1, W2> = rho dt.
+struct HestonParams {
+	double v0;		// Initial variance.
+	double kappa;	// Mean reversion speed.
+	double theta;	// Long run variance.
+	double xi;		// Volatility of variance.
+	double rho;		// Spot and variance correlation.
+};
+
+// Characteristic function E[exp(i u X)] of X = log(S(T) / F) at time to expiry
+// tau, F the forward S exp(b tau), for complex u.
+typedef function<complex<double>(const complex<double>& u, double tau)> CharacteristicFunction;
+
+// FFT grid: size points (a power of 2) at spacing eta in frequency, log strike
+// spacing 2 pi / (size eta) around the forward, damping alpha.
+struct FourierGrid {
+	size_t size;
+	double eta;
+	double alpha;
+
+	FourierGrid();	// 4096 points, eta 0.25, alpha 1.5.
+};
+
+// One expiry of a chain: r, b, T and t from data, strikes K, spot price S.
+struct FourierExpiry {
+	OptionData data;
+	char optType;	// 'C' or 'P'.
+	double S;
+	vector<double> K;
+};
+
+namespace OptionFunction {
+namespace FourierFunction {
+CharacteristicFunction Heston(const HestonParams& params);	// Albrecher et al. form, no branch cut jumps.
+CharacteristicFunction BlackScholes(double sig);			// Lognormal, for checks.
+
+// In place radix 2 FFT, x[k] = sum_j x[j] exp(-2 pi i j k / size), size a power of 2.
+void Fft(complex<double>* x, size_t size);
+
+}	// Namespace FourierFunction.
+}	// Namespace OptionFunction.
+
+// Fourier engine.
+// Carr and Madan write the damped call price exp(alpha k) C(k), k the log
+// strike, as a Fourier integral of the characteristic function, so one FFT of
+// size N gives calls at N log strikes in O(N log N). The grid is centered at
+// the forward, where C / F only depends on the model, time to expiry and r, not
+// on the spot price, carry or strikes: the engine caches that normalized grid
+// per (tau, r) and prices a chain by cubic interpolation in log strike, so
+// repricing the same expiry with other strikes or another spot price costs no
+// characteristic function evaluation and no FFT. Puts come from put-call parity
+// with carry. Strikes beyond the grid (|log(K / F)| near pi / eta, 12.5 for the
+// default grid) get NaN.
+// The engine belongs to one model, build a new one (or call Clear()) when the
+// model parameters change. Price() is thread safe; the chain version prices
+// expiries on several threads.
+class FourierEngine {
+public:
+	// Constructors & destructor.
+	FourierEngine(const CharacteristicFunction& cf, const FourierGrid& grid = FourierGrid());
+	FourierEngine(const HestonParams& params, const FourierGrid& grid = FourierGrid());
+	virtual ~FourierEngine();	// Destructor.
+
+	vector<double> Price(const OptionData& data, const vector<double>& K, char optType, double S) const;	// One expiry.
+	vector<vector<double> > Price(const vector<FourierExpiry>& expiries, size_t threads = 0) const;	// Chain, 0 threads means one per hardware thread.
+
+	// Strike by strike reference (Lewis integral, trapezoid rule), much slower.
+	double IntegralPrice(const OptionData& data, double K, char optType, double S) const;
+
+	void Clear();	// Drop the cached grids.
+
+	// Selectors.
+	const FourierGrid& Grid() const;
+	uint64_t CacheHits() const;
+	uint64_t CacheMisses() const;
+
+private:
+	typedef pair<double, double> Key;	// tau, r.
+
+	CharacteristicFunction cf;
+	FourierGrid grid;
+	mutable mutex lock;	// Guards cache.
+	mutable map<Key, shared_ptr<const vector<double> > > cache;
+	mutable atomic<uint64_t> hits;
+	mutable atomic<uint64_t> misses;
+
+	shared_ptr<const vector<double> > Normalized(double tau, double r) const;	// C / F on the log strike grid.
+	vector<double> Build(double tau, double r) const;
+
+	// No copy.
+	FourierEngine(const FourierEngine&);
+	FourierEngine& operator = (const FourierEngine&);
+};
+
+// Implementation of the normal inline function.
+inline const FourierGrid& FourierEngine::Grid() const {
+	return grid;
+}
+
+inline uint64_t FourierEngine::CacheHits() const {
+	return hits.load();
+}
+
+inline uint64_t FourierEngine::CacheMisses() const {
+	return misses.load();
+}
+
+#endif	// FOURIER_ENGINE_HPP_
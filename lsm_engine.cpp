@@ -0,0 +1,276 @@
+// lsm_engine.cpp
+//
+// LsmEngine implementation.
+//
+
+#include "lsm_engine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+#include "simd_math.hpp"
+
+using namespace std;
+
+// Paths per chunk, the unit of work of a thread and of the partial sums.
+static const size_t CHUNK = 16384;
+
+// Stream of the lower bound paths.
+static const uint64_t LOWER_STREAM = 0x9e3779b97f4a7c15ULL;
+
+LsmSpec::LsmSpec() : paths(100000), dates(50), basis(LSM_LAGUERRE), degree(3), lowerPaths(100000), seed(1), threads(0) {
+}
+
+namespace OptionFunction {
+namespace LsmFunction {
+
+static uint64_t Mix(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+double Normal(uint64_t seed, uint64_t path, uint64_t date) {
+	uint64_t h = Mix(Mix(Mix(seed) ^ path) ^ date);
+	double u = (double(h >> 11) + 0.5) * (1.0 / 9007199254740992.0);	// (0, 1), 53 bits.
+	return SimdMath::InverseNormal(u);
+}
+
+bool CholeskySolve(double* A, double* y, size_t n) {
+	// A = L L^T, L in the lower triangle.
+	for (size_t j = 0; j < n; j++) {
+		double d = A[j * n + j];
+		for (size_t k = 0; k < j; k++)
+			d -= A[j * n + k] * A[j * n + k];
+		if (!(d > 0.0))
+			return false;
+		d = sqrt(d);
+		A[j * n + j] = d;
+		for (size_t i = j + 1; i < n; i++) {
+			double s = A[i * n + j];
+			for (size_t k = 0; k < j; k++)
+				s -= A[i * n + k] * A[j * n + k];
+			A[i * n + j] = s / d;
+		}
+	}
+	for (size_t i = 0; i < n; i++) {	// L z = y.
+		for (size_t k = 0; k < i; k++)
+			y[i] -= A[i * n + k] * y[k];
+		y[i] /= A[i * n + i];
+	}
+	for (size_t i = n; i-- > 0;) {	// L^T x = z.
+		for (size_t k = i + 1; k < n; k++)
+			y[i] -= A[k * n + i] * y[k];
+		y[i] /= A[i * n + i];
+	}
+	return true;
+}
+
+}	// Namespace LsmFunction.
+}	// Namespace OptionFunction.
+
+LsmEngine::LsmEngine(const OptionData& data, char optType, const LsmSpec& newSpec) : data(data), optType(optType), spec(newSpec) {
+	if (optType != 'C' && optType != 'c' && optType != 'P' && optType != 'p')
+		cout << "Wrong option type" << endl;
+	if (spec.dates == 0) {
+		cout << "Wrong number of exercise dates, using 1" << endl;
+		spec.dates = 1;
+	}
+	functions = spec.degree + 1;
+}
+
+LsmEngine::~LsmEngine() {
+}
+
+double LsmEngine::Payoff(double S) const {
+	return (optType == 'P' || optType == 'p') ? max(data.K - S, 0.0) : max(S - data.K, 0.0);
+}
+
+void LsmEngine::Basis(double x, double* phi) const {
+	phi[0] = 1.0;
+	if (functions == 1)
+		return;
+	phi[1] = spec.basis == LSM_LAGUERRE ? 1.0 - x : x;
+	for (size_t n = 1; n + 1 < functions; n++) {
+		if (spec.basis == LSM_LAGUERRE)
+			phi[n + 1] = ((2.0 * double(n) + 1.0 - x) * phi[n] - double(n) * phi[n - 1]) / double(n + 1);
+		else
+			phi[n + 1] = phi[n] * x;
+	}
+}
+
+void LsmEngine::Chunks(size_t paths, const function<void(size_t, size_t, size_t)>& run) const {
+	size_t chunks = (paths + CHUNK - 1) / CHUNK;
+	size_t threads = spec.threads ? spec.threads : thread::hardware_concurrency();
+	threads = max<size_t>(1, min(threads, chunks));
+	atomic<size_t> next(0);
+	function<void()> work = [&]() {
+		for (size_t c = next++; c < chunks; c = next++)
+			run(c, c * CHUNK, min(paths, (c + 1) * CHUNK));
+	};
+	vector<thread> workers;
+	for (size_t t = 1; t < threads; t++)
+		workers.push_back(thread(work));
+	work();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+LsmResult LsmEngine::Price(double S) const {
+	PRICING_METRIC("LsmEngine::Price(double) const", spec.paths * spec.dates);
+	LsmResult tmp = { Payoff(S), 0.0, Payoff(S), 0.0 };
+	double tau = data.T - data.t;	// Time to expiry.
+	size_t N = spec.paths, M = spec.dates, F = functions;
+	if (tau <= 0.0 || N == 0)
+		return tmp;
+	double dt = tau / double(M);
+	double drift = data.b - 0.5 * data.sig * data.sig;
+	double stepDiscount = exp(-data.r * dt);
+	size_t chunks = (N + CHUNK - 1) / CHUNK;
+
+	// Structure of arrays state: Brownian motion at the current date and discounted value to it.
+	vector<double> W(N), V(N);
+	Chunks(N, [&](size_t, size_t begin, size_t end) {
+		double sqrtTau = sqrt(tau);
+		for (size_t p = begin; p < end; p++) {
+			W[p] = sqrtTau * OptionFunction::LsmFunction::Normal(spec.seed, p, M);
+			V[p] = Payoff(S * exp(drift * tau + data.sig * W[p]));
+		}
+	});
+
+	// Fitted continuation coefficients per date, for the lower bound.
+	vector<double> coeff(M * F, 0.0);
+	vector<bool> fitted(M, false);
+	vector<double> partial(chunks * (F * F + F));
+	for (size_t k = M - 1; k >= 1; k--) {
+		PricingTrace::Span span("regression date", "lsm", N);
+		double t = dt * double(k), tNext = dt * double(k + 1);
+		double shrink = t / tNext, sd = sqrt(t * (tNext - t) / tNext);
+
+		// Bridge back to t, discount, normal equations of the in the money paths.
+		Chunks(N, [&](size_t chunk, size_t begin, size_t end) {
+			double* A = &partial[chunk * (F * F + F)];
+			double* y = A + F * F;
+			fill(A, A + F * F + F, 0.0);
+			vector<double> f(F);
+			for (size_t p = begin; p < end; p++) {
+				W[p] = shrink * W[p] + sd * OptionFunction::LsmFunction::Normal(spec.seed, p, k);
+				V[p] *= stepDiscount;
+				double St = S * exp(drift * t + data.sig * W[p]);
+				if (Payoff(St) <= 0.0)
+					continue;
+				Basis(St / data.K, f.data());
+				for (size_t i = 0; i < F; i++) {
+					for (size_t j = 0; j <= i; j++)
+						A[i * F + j] += f[i] * f[j];
+					y[i] += f[i] * V[p];
+				}
+			}
+		});
+		vector<double> A(F * F, 0.0), y(F, 0.0);
+		for (size_t c = 0; c < chunks; c++) {
+			const double* a = &partial[c * (F * F + F)];
+			for (size_t i = 0; i < F; i++) {
+				for (size_t j = 0; j <= i; j++)
+					A[i * F + j] += a[i * F + j];
+				y[i] += a[F * F + i];
+			}
+		}
+		for (size_t i = 0; i < F; i++)
+			for (size_t j = 0; j < i; j++)
+				A[j * F + i] = A[i * F + j];
+		if (A[0] < double(F) || !OptionFunction::LsmFunction::CholeskySolve(A.data(), y.data(), F))
+			continue;	// Too few in the money paths to fit.
+		copy(y.begin(), y.end(), coeff.begin() + k * F);
+		fitted[k] = true;
+
+		// Exercise where the payoff is at least the continuation value.
+		const double* c = &coeff[k * F];
+		Chunks(N, [&](size_t, size_t begin, size_t end) {
+			vector<double> f(F);
+			for (size_t p = begin; p < end; p++) {
+				double St = S * exp(drift * t + data.sig * W[p]);
+				double payoff = Payoff(St);
+				if (payoff <= 0.0)
+					continue;
+				Basis(St / data.K, f.data());
+				double continuation = 0.0;
+				for (size_t i = 0; i < F; i++)
+					continuation += c[i] * f[i];
+				if (payoff >= continuation)
+					V[p] = payoff;
+			}
+		});
+	}
+
+	// In sample price, sums per chunk in chunk order.
+	vector<double> sum(chunks, 0.0), square(chunks, 0.0);
+	Chunks(N, [&](size_t chunk, size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p++) {
+			double v = V[p] * stepDiscount;
+			sum[chunk] += v;
+			square[chunk] += v * v;
+		}
+	});
+	double s = 0.0, q = 0.0;
+	for (size_t c = 0; c < chunks; c++) {
+		s += sum[c];
+		q += square[c];
+	}
+	double mean = s / double(N);
+	tmp.price = max(Payoff(S), mean);
+	tmp.stdError = N > 1 ? sqrt(max(q / double(N) - mean * mean, 0.0) / double(N - 1)) : 0.0;
+
+	// Lower bound, forward paths with the fitted rule.
+	size_t L = spec.lowerPaths;
+	if (L == 0)
+		return tmp;
+	size_t lowerChunks = (L + CHUNK - 1) / CHUNK;
+	sum.assign(lowerChunks, 0.0);
+	square.assign(lowerChunks, 0.0);
+	Chunks(L, [&](size_t chunk, size_t begin, size_t end) {
+		PricingTrace::Span span("lower bound chunk", "lsm", end - begin);
+		vector<double> f(F);
+		double sqrtDt = sqrt(dt);
+		for (size_t p = begin; p < end; p++) {
+			double w = 0.0, v = 0.0;
+			for (size_t k = 1; k <= M; k++) {
+				w += sqrtDt * OptionFunction::LsmFunction::Normal(spec.seed ^ LOWER_STREAM, p, k);
+				double St = S * exp(drift * dt * double(k) + data.sig * w);
+				double payoff = Payoff(St);
+				if (k == M) {
+					v = payoff * exp(-data.r * tau);
+					break;
+				}
+				if (payoff <= 0.0 || !fitted[k])
+					continue;
+				Basis(St / data.K, f.data());
+				double continuation = 0.0;
+				for (size_t i = 0; i < F; i++)
+					continuation += coeff[k * F + i] * f[i];
+				if (payoff >= continuation) {
+					v = payoff * exp(-data.r * dt * double(k));
+					break;
+				}
+			}
+			sum[chunk] += v;
+			square[chunk] += v * v;
+		}
+	});
+	s = 0.0;
+	q = 0.0;
+	for (size_t c = 0; c < lowerChunks; c++) {
+		s += sum[c];
+		q += square[c];
+	}
+	mean = s / double(L);
+	tmp.lowerBound = max(Payoff(S), mean);
+	tmp.lowerStdError = L > 1 ? sqrt(max(q / double(L) - mean * mean, 0.0) / double(L - 1)) : 0.0;
+	return tmp;
+}
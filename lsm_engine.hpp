@@ -0,0 +1,107 @@
+// lsm_engine.hpp
+//
+// Header file for Class LsmEngine.
+// Longstaff-Schwartz least squares Monte Carlo for Bermudan and finite
+// American options.
+//
+
+#ifndef LSM_ENGINE_HPP_
+#define LSM_ENGINE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Regression basis in x = S / K: 1, x, x^2, ... or the Laguerre polynomials L0, L1, L2, ...
+enum LsmBasis { LSM_MONOMIAL, LSM_LAGUERRE };
+
+// Settings of the engine.
+struct LsmSpec {
+	size_t paths;			// Regression (in sample) paths.
+	size_t dates;			// Exercise dates, equally spaced up to expiry, the last one at expiry.
+	LsmBasis basis;
+	size_t degree;			// Highest basis function, degree + 1 functions.
+	size_t lowerPaths;		// Out of sample paths of the lower bound, 0 for none.
+	uint64_t seed;
+	size_t threads;			// 0 means one per hardware thread.
+
+	LsmSpec();	// 100000 paths, 50 dates, Laguerre degree 3, 100000 lower bound paths, seed 1.
+};
+
+// Prices and standard errors.
+struct LsmResult {
+	double price;		// In sample estimate, with the regression fitted on the same paths.
+	double stdError;
+	double lowerBound;	// Out of sample estimate with the fitted exercise rule, biased low only.
+	double lowerStdError;
+};
+
+// Least squares Monte Carlo engine.
+// Prices an option exercisable at spec.dates dates (a Bermudan option, the
+// American option in the limit) on geometric Brownian motion with the sig,
+// r, b, K, T and t of OptionData. At every date from the last but one back to
+// the first, the discounted values of the in the money paths are regressed on
+// the basis, and a path is exercised where the payoff is at least the fitted
+// continuation value.
+// Memory is O(paths), independent of the dates: the paths are built backward
+// in time with a Brownian bridge, W(t_k) given W(t_k+1), from normals that a
+// counter based generator computes from (seed, path, date) on demand, so no
+// path is ever stored. The state is two arrays in structure of arrays layout
+// (W and the value of every path, 16 MB for a million paths) streamed once
+// per date to accumulate the normal equations, and once more to apply the
+// exercise rule. Paths are processed in fixed chunks taken by the threads;
+// every chunk keeps its own normal equations, added in chunk order, so the
+// result does not depend on the number of threads. The small normal equations
+// are solved by Cholesky decomposition; a date with too few in the money
+// paths is not exercised.
+// The lower bound applies the fitted rule to new paths (forward in time, other
+// seed): no exercise decision sees its own future, so its mean is biased low
+// only, and with the in sample price it brackets the true value.
+class LsmEngine {
+public:
+	// Constructors & destructor.
+	LsmEngine(const OptionData& data, char optType, const LsmSpec& spec = LsmSpec());
+	virtual ~LsmEngine();	// Destructor.
+
+	LsmResult Price(double S) const;
+
+	// Selectors.
+	const LsmSpec& Spec() const;
+
+private:
+	OptionData data;
+	char optType;
+	LsmSpec spec;
+	size_t functions;	// degree + 1.
+
+	double Payoff(double S) const;
+	void Basis(double x, double* phi) const;
+	void Chunks(size_t paths, const function<void(size_t chunk, size_t begin, size_t end)>& run) const;	// Parallel over fixed chunks.
+
+	// No copy.
+	LsmEngine(const LsmEngine&);
+	LsmEngine& operator = (const LsmEngine&);
+};
+
+namespace OptionFunction {
+namespace LsmFunction {
+// Counter based standard normal of (seed, path, date), SplitMix64 mixing and SimdMath::InverseNormal.
+double Normal(uint64_t seed, uint64_t path, uint64_t date);
+
+// Solves A x = y in place (x in y) for symmetric positive definite A of size
+// n x n (row major, overwritten), returns false when A is not.
+bool CholeskySolve(double* A, double* y, size_t n);
+
+}	// Namespace LsmFunction.
+}	// Namespace OptionFunction.
+
+// Implementation of the normal inline function.
+inline const LsmSpec& LsmEngine::Spec() const {
+	return spec;
+}
+
+#endif	// LSM_ENGINE_HPP_
@@ -0,0 +1,131 @@
+// market_state.cpp
+//
+// MarketState implementation.
+//
+
+#include "market_state.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Inputs in the order of MarketSnapshot.
+enum MarketField { FIELD_S, FIELD_SIG, FIELD_R, FIELD_B, FIELD_T, FIELD_Q, FIELDS };
+
+// Cache line size the slots are aligned to.
+static const size_t CACHE_LINE = 64;
+
+// One underlying on its own cache line.
+struct alignas(CACHE_LINE) MarketState::Slot {
+	atomic<uint64_t> sequence;	// Twice the version, odd while a publication is in progress.
+	atomic<uint64_t> field[FIELDS];	// Bits of the inputs.
+};
+
+static uint64_t Bits(double x) {
+	uint64_t tmp;
+	memcpy(&tmp, &x, sizeof(tmp));
+	return tmp;
+}
+
+static double FromBits(uint64_t bits) {
+	double tmp;
+	memcpy(&tmp, &bits, sizeof(tmp));
+	return tmp;
+}
+
+// Make the sequence odd, waiting for a publication of another writer to end.
+// The fence keeps the field stores after the odd sequence number.
+static uint64_t BeginWrite(atomic<uint64_t>& sequence) {
+	uint64_t s = sequence.load(memory_order_relaxed);
+	while ((s & 1) || !sequence.compare_exchange_weak(s, s + 1, memory_order_acquire, memory_order_relaxed)) {
+		if (s & 1) {
+			this_thread::yield();
+			s = sequence.load(memory_order_relaxed);
+		}
+	}
+	atomic_thread_fence(memory_order_release);
+	return s;
+}
+
+static void EndWrite(atomic<uint64_t>& sequence, uint64_t s) {
+	sequence.store(s + 2, memory_order_release);
+}
+
+OptionData MarketSnapshot::Apply(const OptionData& contract) const {
+	OptionData tmp = contract;
+	tmp.sig = sig;
+	tmp.r = r;
+	tmp.b = b;
+	tmp.t = t;
+	tmp.q = q;
+	return tmp;
+}
+
+// new only aligns to alignof(max_align_t) before C++17, so the slots are placed
+// at the first cache line boundary of a buffer one line longer.
+MarketState::MarketState(size_t underlyings) : size(underlyings), storage(new char[(underlyings + 1) * sizeof(Slot)]), slot(0) {
+	static_assert(sizeof(Slot) == CACHE_LINE, "A slot must fill one cache line");
+	uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+	slot = reinterpret_cast<Slot*>((address + CACHE_LINE - 1) & ~uintptr_t(CACHE_LINE - 1));
+	for (size_t i = 0; i < size; i++) {
+		new (&slot[i]) Slot;
+		slot[i].sequence = 0;
+		for (size_t f = 0; f < FIELDS; f++)
+			slot[i].field[f] = Bits(0.0);
+	}
+}
+
+MarketState::~MarketState() {
+}
+
+void MarketState::Publish(size_t underlying, const MarketSnapshot& market) {
+	Slot& s = slot[underlying];
+	uint64_t sequence = BeginWrite(s.sequence);
+	s.field[FIELD_S].store(Bits(market.S), memory_order_relaxed);
+	s.field[FIELD_SIG].store(Bits(market.sig), memory_order_relaxed);
+	s.field[FIELD_R].store(Bits(market.r), memory_order_relaxed);
+	s.field[FIELD_B].store(Bits(market.b), memory_order_relaxed);
+	s.field[FIELD_T].store(Bits(market.t), memory_order_relaxed);
+	s.field[FIELD_Q].store(Bits(market.q), memory_order_relaxed);
+	EndWrite(s.sequence, sequence);
+}
+
+void MarketState::PublishSpot(size_t underlying, double S) {
+	Slot& s = slot[underlying];
+	uint64_t sequence = BeginWrite(s.sequence);
+	s.field[FIELD_S].store(Bits(S), memory_order_relaxed);
+	EndWrite(s.sequence, sequence);
+}
+
+// The acquire fence keeps the field loads before the second sequence load: when
+// a load saw a store of a publication, the second load sees its odd sequence or later.
+MarketSnapshot MarketState::Snapshot(size_t underlying) const {
+	const Slot& s = slot[underlying];
+	MarketSnapshot tmp;
+	while (true) {
+		uint64_t before = s.sequence.load(memory_order_acquire);
+		if (before & 1) {
+			this_thread::yield();
+			continue;
+		}
+		tmp.S = FromBits(s.field[FIELD_S].load(memory_order_relaxed));
+		tmp.sig = FromBits(s.field[FIELD_SIG].load(memory_order_relaxed));
+		tmp.r = FromBits(s.field[FIELD_R].load(memory_order_relaxed));
+		tmp.b = FromBits(s.field[FIELD_B].load(memory_order_relaxed));
+		tmp.t = FromBits(s.field[FIELD_T].load(memory_order_relaxed));
+		tmp.q = FromBits(s.field[FIELD_Q].load(memory_order_relaxed));
+		atomic_thread_fence(memory_order_acquire);
+		if (s.sequence.load(memory_order_relaxed) == before) {
+			tmp.version = before / 2;
+			return tmp;
+		}
+	}
+}
+
+uint64_t MarketState::Version(size_t underlying) const {
+	return slot[underlying].sequence.load(memory_order_acquire) / 2;
+}
@@ -0,0 +1,75 @@
+// market_state.hpp
+//
+// Header file for Class MarketState.
+// Market inputs shared between a feed thread and pricing threads.
+//
+
+#ifndef MARKET_STATE_HPP_
+#define MARKET_STATE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Consistent market inputs of one underlying, taken from a MarketState.
+// Apply() puts them into the parameters of a contract on the underlying;
+// expiry and strike stay those of the contract.
+struct MarketSnapshot {
+	double S;		// Spot price.
+	double sig;		// Volatility.
+	double r;		// Interest rate.
+	double b;		// Cost of carry.
+	double t;		// Current date.
+	double q;		// Dividend yield.
+	uint64_t version;	// Publications of the underlying so far, 0 before the first.
+
+	OptionData Apply(const OptionData& contract) const;
+};
+
+// Market inputs of a fixed number of underlyings, written by feed threads and
+// read by any number of pricing threads without locks.
+// Every underlying is a seqlock: Publish() makes its sequence number odd,
+// stores the fields and makes it even again, O(1) with no allocation. Snapshot()
+// reads the sequence, the fields and the sequence again, and retries while a
+// publication was in progress, so a reader never sees a mix of old and new
+// inputs and never blocks a writer. Fields are relaxed atomics ordered by fences,
+// which keeps the scheme free of data races. Concurrent writers of the same
+// underlying are serialized by the odd sequence number; different underlyings
+// sit on different cache lines and do not interfere.
+// Access the number of underlyings with Size().
+class MarketState {
+public:
+	// Constructors & destructor.
+	MarketState(size_t underlyings);	// All inputs 0, version 0.
+	virtual ~MarketState();	// Destructor.
+
+	void Publish(size_t underlying, const MarketSnapshot& market);	// Version is ignored, the new one is returned by Snapshot().
+	void PublishSpot(size_t underlying, double S);	// Spot price only, the other inputs unchanged.
+	MarketSnapshot Snapshot(size_t underlying) const;
+	uint64_t Version(size_t underlying) const;	// Without reading the inputs, to skip unchanged underlyings.
+
+	// Selectors.
+	size_t Size() const;
+
+private:
+	struct Slot;
+
+	size_t size;
+	unique_ptr<char[]> storage;	// Slots and room to align them.
+	Slot* slot;			// Cache line aligned, in storage.
+
+	// No copy.
+	MarketState(const MarketState&);
+	MarketState& operator = (const MarketState&);
+};
+
+// Implementation of the normal inline function.
+inline size_t MarketState::Size() const {
+	return size;
+}
+
+#endif	// MARKET_STATE_HPP_
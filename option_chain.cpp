@@ -0,0 +1,204 @@
+// option_chain.cpp
+//
+// OptionChainEngine implementation.
+//
+
+#include "option_chain.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "cpu_dispatch.hpp"
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+#include "simd_math.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OPTION_CHAIN_X86 1
+#define OPTION_CHAIN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+OptionChainEngine::OptionChainEngine(const vector<ChainOption>& book) {
+	PricingTrace::Span span("chain grouping", "chain", book.size());
+	vector<size_t> index(book.size());
+	for (size_t i = 0; i < index.size(); i++)
+		index[i] = i;
+
+	// Lexicographic on the chain key, then strike so each chain is a sorted smile.
+	sort(index.begin(), index.end(), [&](size_t i, size_t j) {
+		const ChainOption& a = book[i];
+		const ChainOption& c = book[j];
+		if (a.underlying != c.underlying)
+			return a.underlying < c.underlying;
+		if (a.S != c.S)
+			return a.S < c.S;
+		if (a.data.T - a.data.t != c.data.T - c.data.t)
+			return a.data.T - a.data.t < c.data.T - c.data.t;
+		if (a.data.r != c.data.r)
+			return a.data.r < c.data.r;
+		if (a.data.b != c.data.b)
+			return a.data.b < c.data.b;
+		return a.data.K < c.data.K;
+	});
+
+	for (size_t n = 0; n < index.size(); n++) {
+		const ChainOption& o = book[index[n]];
+		double tau = o.data.T - o.data.t;	// Time to expiry.
+		if (chains.empty() || chains.back().underlying != o.underlying || chains.back().S != o.S
+			|| chains.back().T != tau || chains.back().r != o.data.r || chains.back().b != o.data.b) {
+			Chain c = { o.underlying, o.S, tau, o.data.r, o.data.b, n, n };
+			chains.push_back(c);
+		}
+		chains.back().end = n + 1;
+		K.push_back(o.data.K);
+		logK.push_back(log(o.data.K));
+		sig.push_back(o.data.sig);
+		sign.push_back((o.optType == 'P' || o.optType == 'p') ? -1.0 : 1.0);
+		slot.push_back(index[n]);
+	}
+}
+
+OptionChainEngine::~OptionChainEngine() {
+}
+
+vector<double> OptionChainEngine::Price() const {
+	vector<double> tmp(slot.size());
+	Price(tmp.data());
+	return tmp;
+}
+
+// Strike entries per block of the vector loop. The entries are copied into
+// local arrays with a fixed trip count, so the loop vectorizes at -O2 without
+// run time alias checks or a remainder loop; a short last block is padded.
+static const size_t CHAIN_BLOCK = 64;
+
+// Call: DF (F N(d1) - K N(d2)), put: DF (K N(-d2) - F N(-d1)), both as
+// s DF (F N(s d1) - K N(s d2)) with s the sign, so calls and puts share the loop.
+// Scalar loop with erfc, run for ISA_BASELINE and for entries with no time value
+// or volatility, whose infinite d1 and d2 SimdMath does not handle.
+static void ChainBaseline(double forward, double logF, double discount, double sqrtT,
+	const double* k, const double* lk, const double* v, const double* s, double* out, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		double w = v[i] * sqrtT;
+		double d1 = (logF - lk[i]) / w + 0.5 * w;
+		double d2 = d1 - w;
+		out[i] = s[i] * discount * (forward * 0.5 * erfc(-s[i] * d1 * M_SQRT1_2) - k[i] * 0.5 * erfc(-s[i] * d2 * M_SQRT1_2));
+	}
+}
+
+// Same loop over SimdMath, forced inline into one wrapper per CpuDispatch variant.
+SIMD_MATH_INLINE void ChainBody(double forward, double logF, double discount, double sqrtT,
+	const double* k, const double* lk, const double* v, const double* s, double* out, size_t size) {
+	double K[CHAIN_BLOCK], logK[CHAIN_BLOCK], w[CHAIN_BLOCK], sign[CHAIN_BLOCK], price[CHAIN_BLOCK];
+	for (size_t start = 0; start < size; start += CHAIN_BLOCK) {
+		size_t n = min(CHAIN_BLOCK, size - start);
+		bool degenerate = false;
+		for (size_t i = 0; i < CHAIN_BLOCK; i++) {
+			bool used = i < n;
+			K[i] = used ? k[start + i] : 1.0;
+			logK[i] = used ? lk[start + i] : 0.0;
+			w[i] = used ? v[start + i] * sqrtT : 0.2;
+			sign[i] = used ? s[start + i] : 1.0;
+			if (!(w[i] > 1e-100)) {
+				degenerate = true;
+				w[i] = 0.2;
+			}
+		}
+		for (size_t i = 0; i < CHAIN_BLOCK; i++) {
+			double d1 = (logF - logK[i]) / w[i] + 0.5 * w[i];
+			double d2 = d1 - w[i];
+			price[i] = sign[i] * discount * (forward * SimdMath::NormalCdf(sign[i] * d1) - K[i] * SimdMath::NormalCdf(sign[i] * d2));
+		}
+		copy(price, price + n, out + start);
+		if (!degenerate)
+			continue;
+		for (size_t i = start; i < start + n; i++) {
+			if (!(v[i] * sqrtT > 1e-100))
+				ChainBaseline(forward, logF, discount, sqrtT, k + i, lk + i, v + i, s + i, out + i, 1);
+		}
+	}
+}
+
+static void ChainSse2(double forward, double logF, double discount, double sqrtT,
+	const double* k, const double* lk, const double* v, const double* s, double* out, size_t size) {
+	ChainBody(forward, logF, discount, sqrtT, k, lk, v, s, out, size);
+}
+
+#ifdef OPTION_CHAIN_X86
+OPTION_CHAIN_TARGET("avx2,fma")
+static void ChainAvx2(double forward, double logF, double discount, double sqrtT,
+	const double* k, const double* lk, const double* v, const double* s, double* out, size_t size) {
+	ChainBody(forward, logF, discount, sqrtT, k, lk, v, s, out, size);
+}
+
+OPTION_CHAIN_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void ChainAvx512(double forward, double logF, double discount, double sqrtT,
+	const double* k, const double* lk, const double* v, const double* s, double* out, size_t size) {
+	ChainBody(forward, logF, discount, sqrtT, k, lk, v, s, out, size);
+}
+#endif
+
+void OptionChainEngine::Price(double* price) const {
+	PRICING_METRIC("OptionChainEngine::Price(double*) const", slot.size());
+	PricingTrace::Span span("chain price", "chain", slot.size());
+	void (*kernel)(double, double, double, double, const double*, const double*, const double*, const double*, double*, size_t);
+	switch (CpuDispatch::Active()) {
+	case ISA_BASELINE:
+		kernel = ChainBaseline;
+		break;
+#ifdef OPTION_CHAIN_X86
+	case ISA_AVX512:
+		kernel = ChainAvx512;
+		break;
+	case ISA_AVX2:
+		kernel = ChainAvx2;
+		break;
+#endif
+	default:
+		kernel = ChainSse2;
+		break;
+	}
+
+	vector<double> chainPrice;
+	for (size_t c = 0; c < chains.size(); c++) {
+		const Chain& chain = chains[c];
+		double sqrtT = sqrt(chain.T);
+		double discount = exp(-chain.r * chain.T);
+		double forward = chain.S * exp(chain.b * chain.T);
+		double logF = log(forward);
+
+		size_t size = chain.end - chain.begin;
+		chainPrice.resize(size);
+		kernel(forward, logF, discount, sqrtT, &K[chain.begin], &logK[chain.begin], &sig[chain.begin], &sign[chain.begin], chainPrice.data(), size);
+		for (size_t i = 0; i < size; i++)
+			price[slot[chain.begin + i]] = chainPrice[i];
+	}
+}
+
+ChainGroupingStats OptionChainEngine::Stats() const {
+	ChainGroupingStats tmp;
+	tmp.options = slot.size();
+	tmp.chains = chains.size();
+	tmp.largest = 0;
+	tmp.singletons = 0;
+	for (size_t c = 0; c < chains.size(); c++) {
+		size_t size = chains[c].end - chains[c].begin;
+		tmp.largest = max(tmp.largest, size);
+		if (size == 1)
+			tmp.singletons++;
+	}
+	tmp.meanSize = chains.empty() ? 0.0 : double(tmp.options) / tmp.chains;
+	tmp.termsSaved = 4 * (tmp.options - tmp.chains);
+	return tmp;
+}
+
+void OptionChainEngine::Print() const {
+	ChainGroupingStats stats = Stats();
+	cout << "options: " << stats.options << "  chains: " << stats.chains
+		<< "  mean size: " << stats.meanSize << "  largest: " << stats.largest
+		<< "  singletons: " << stats.singletons << "  terms saved: " << stats.termsSaved << endl;
+}
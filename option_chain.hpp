@@ -0,0 +1,77 @@
+// option_chain.hpp
+//
+// Header file for Class OptionChainEngine.
+// European book pricing grouped by underlying and expiry.
+//
+
+#ifndef OPTION_CHAIN_HPP_
+#define OPTION_CHAIN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// One European option of a book.
+struct ChainOption {
+	OptionData data;		// Contract parameters, sig per smile point.
+	double S;				// Spot price.
+	uint32_t underlying;	// Underlying id.
+	char optType;			// 'C' or 'P'.
+};
+
+// How well a book grouped into chains.
+struct ChainGroupingStats {
+	size_t options;
+	size_t chains;
+	size_t largest;			// Options in the largest chain.
+	size_t singletons;		// Chains of one option, no sharing.
+	double meanSize;		// Options per chain.
+	size_t termsSaved;		// Expiry level evaluations (sqrt, exp, exp, log) not repeated per option.
+};
+
+// Chain engine.
+// The book is grouped by (underlying, S, T - t, r, b). Every chain computes sqrt(T),
+// exp(-r T), the forward S exp(b T) and its log once; the per strike loop only
+// evaluates d1, d2 and the two normal cdfs over contiguous strike, log strike,
+// volatility and sign arrays, with SimdMath in the variant CpuDispatch selected
+// (the erfc loop for ISA_BASELINE). Prices are returned in book order and agree
+// with EuropeanOptionFunction within CpuDispatch::TOLERANCE * max(price, K).
+// Price the book with Price(), report the grouping with Stats() and Print().
+class OptionChainEngine {
+public:
+	// Constructors & destructor.
+	OptionChainEngine(const vector<ChainOption>& book);	// Group the book.
+	virtual ~OptionChainEngine();	// Destructor.
+
+	vector<double> Price() const;
+	void Price(double* price) const;	// price holds Size() values, in book order.
+
+	// Selectors.
+	size_t Size() const;
+	ChainGroupingStats Stats() const;
+	void Print() const;	// Print the grouping stats.
+
+private:
+	struct Chain {
+		uint32_t underlying;
+		double S, T, r, b;	// T is the time to expiry.
+		size_t begin, end;	// Range in the strike arrays.
+	};
+
+	vector<Chain> chains;
+	vector<double> K;		// Strike arrays, chain by chain.
+	vector<double> logK;
+	vector<double> sig;
+	vector<double> sign;	// 1 for calls, -1 for puts.
+	vector<size_t> slot;	// Book index of each strike entry.
+};
+
+// Implementation of the normal inline function.
+inline size_t OptionChainEngine::Size() const {
+	return slot.size();
+}
+
+#endif	// OPTION_CHAIN_HPP_
@@ -4,7 +4,9 @@
 //
 
 #include "option_function.hpp"
+#include <cmath>
 #include <iostream>
+#include <string>
 #include <vector>
 #include "option_data.hpp"
 
@@ -12,11 +14,39 @@ using namespace std;
 
 namespace OptionFunction {
 
+bool SetParam(OptionData& data, const string& paramName, double value) {
+	if (paramName == "T")
+		data.T = value;
+	else if (paramName == "K")
+		data.K = value;
+	else if (paramName == "sig")
+		data.sig = value;
+	else if (paramName == "r")
+		data.r = value;
+	else if (paramName == "b")
+		data.b = value;
+	else if (paramName == "t")
+		data.t = value;
+	else if (paramName == "q")
+		data.q = value;
+	else
+		return false;
+	return true;
+}
+
+// Points start + i * size computed from the index, so rounding does not accumulate
+// and drop the endpoint: end is included when it is a whole number of steps
+// from start within 1e-9 of a step, and then returned exactly.
 vector<double> MeshArray(double start, double end, double size) {
 	vector<double> tmp;
-	for (double i = start; i <= end; i += size) {
-		tmp.push_back(i);
-	}
+	if (!(size > 0.0) || !(end >= start))
+		return tmp;
+	double steps = (end - start) / size;
+	size_t last = size_t(floor(steps + 1e-9));
+	for (size_t i = 0; i <= last; i++)
+		tmp.push_back(start + double(i) * size);
+	if (fabs(steps - double(last)) <= 1e-9)
+		tmp.back() = end;
 	return tmp;
 }
 
@@ -6,11 +6,16 @@
 #ifndef OPTION_FUNCTION_HPP_
 #define OPTION_FUNCTION_HPP_
 
+#include <string>
 #include <vector>
+#include "option_data.hpp"
 
 using namespace std;
 
 namespace OptionFunction {
+// This function sets the parameter named paramName (T, K, sig, r, b, t, q), returns false for a wrong name.
+bool SetParam(OptionData& data, const string& paramName, double value);
+
 // This function returns a mesh array with mesh size h.
 vector<double> MeshArray(double start, double end, double size);
 
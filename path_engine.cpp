@@ -0,0 +1,201 @@
+// path_engine.cpp
+//
+// PathEngine implementation.
+//
+
+#include "path_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+// Doubles of one block of paths, 256 KB.
+static const size_t BLOCK_DOUBLES = 32768;
+
+PathEngine::PathEngine(const OptionData& data, double S, size_t steps) : data(data), S(S), steps(steps) {
+	if (this->steps == 0) {
+		cout << "Wrong number of steps, using 1" << endl;
+		this->steps = 1;
+	}
+	blockPaths = max<size_t>(16, BLOCK_DOUBLES / (this->steps + 1));
+}
+
+PathEngine::~PathEngine() {
+}
+
+size_t PathEngine::Add(const PathPayoff& payoff) {
+	if (payoff.optType != 'C' && payoff.optType != 'c' && payoff.optType != 'P' && payoff.optType != 'p')
+		cout << "Wrong option type" << endl;
+	Entry tmp = { payoff, PathFunction() };
+	entry.push_back(tmp);
+	return entry.size() - 1;
+}
+
+size_t PathEngine::Add(const PathFunction& payoff) {
+	Entry tmp;
+	tmp.payoff.kind = PATH_EUROPEAN;
+	tmp.payoff.optType = 'C';
+	tmp.payoff.K = 0.0;
+	tmp.payoff.barrier = 0.0;
+	tmp.function = payoff;
+	entry.push_back(tmp);
+	return entry.size() - 1;
+}
+
+// Simulates paths [block * blockPaths, + paths) into path and sets the mean of
+// every payoff over the block and the sum of its squared deviations (Welford).
+void PathEngine::Block(size_t block, size_t paths, uint64_t seed, vector<double>& path, double* mean, double* m2) const {
+	PricingTrace::Span span("path block", "monte carlo", paths);
+	seed_seq seq = { uint32_t(seed), uint32_t(seed >> 32), uint32_t(block), uint32_t(uint64_t(block) >> 32) };
+	mt19937_64 generator(seq);
+	normal_distribution<double> normal(0.0, 1.0);
+
+	double dt = (data.T - data.t) / double(steps);
+	double drift = (data.b - 0.5 * data.sig * data.sig) * dt;
+	double vol = data.sig * sqrt(dt);
+	double logS = log(S);
+	size_t points = steps + 1;
+	for (size_t p = 0; p < paths; p++) {
+		double* x = &path[p * points];
+		double y = logS;
+		x[0] = S;
+		for (size_t k = 1; k < points; k++) {
+			y += drift + vol * normal(generator);
+			x[k] = exp(y);
+		}
+	}
+
+	// Statistics shared by the payoffs, then every payoff on the block.
+	fill(mean, mean + entry.size(), 0.0);
+	fill(m2, m2 + entry.size(), 0.0);
+	for (size_t p = 0; p < paths; p++) {
+		const double* x = &path[p * points];
+		double last = x[steps], average = 0.0, high = x[0], low = x[0];
+		for (size_t k = 1; k < points; k++) {
+			average += x[k];
+			high = max(high, x[k]);
+			low = min(low, x[k]);
+		}
+		average /= double(steps);
+		for (size_t i = 0; i < entry.size(); i++) {
+			const PathPayoff& o = entry[i].payoff;
+			double s = (o.optType == 'P' || o.optType == 'p') ? -1.0 : 1.0;
+			double value = 0.0;
+			if (entry[i].function) {
+				value = entry[i].function(x, points);
+			} else {
+				switch (o.kind) {
+				case PATH_EUROPEAN:
+					value = max(s * (last - o.K), 0.0);
+					break;
+				case PATH_ASIAN:
+					value = max(s * (average - o.K), 0.0);
+					break;
+				case PATH_UP_AND_OUT:
+					value = high >= o.barrier ? 0.0 : max(s * (last - o.K), 0.0);
+					break;
+				case PATH_UP_AND_IN:
+					value = high >= o.barrier ? max(s * (last - o.K), 0.0) : 0.0;
+					break;
+				case PATH_DOWN_AND_OUT:
+					value = low <= o.barrier ? 0.0 : max(s * (last - o.K), 0.0);
+					break;
+				case PATH_DOWN_AND_IN:
+					value = low <= o.barrier ? max(s * (last - o.K), 0.0) : 0.0;
+					break;
+				case PATH_LOOKBACK_FIXED:
+					value = max(s * ((s > 0.0 ? high : low) - o.K), 0.0);
+					break;
+				case PATH_LOOKBACK_FLOATING:
+					value = s * (last - (s > 0.0 ? low : high));
+					break;
+				}
+			}
+			double delta = value - mean[i];
+			mean[i] += delta / double(p + 1);
+			m2[i] += delta * (value - mean[i]);
+		}
+	}
+}
+
+vector<PathResult> PathEngine::Price(size_t paths, uint64_t seed, size_t threads) const {
+	PRICING_METRIC("PathEngine::Price(size_t, uint64_t, size_t) const", paths * entry.size());
+	vector<PathResult> tmp(entry.size());
+	if (paths == 0 || entry.empty())
+		return tmp;
+	size_t blocks = (paths + blockPaths - 1) / blockPaths;
+	if (threads == 0)
+		threads = thread::hardware_concurrency();
+	threads = max<size_t>(1, min(threads, blocks));
+
+	// Block statistics wait in a window of slots and are combined in block
+	// order, so memory does not grow with the paths; a thread only takes a
+	// block within the window of the first block not combined yet.
+	size_t count = entry.size();
+	size_t window = 4 * threads;
+	vector<double> slotMean(window * count), slotM2(window * count);
+	vector<bool> ready(window, false);
+	vector<double> mean(count, 0.0), m2(count, 0.0);	// Of the blocks combined so far.
+	size_t next = 0, combined = 0;
+	double n = 0.0;	// Paths combined so far.
+	mutex lock;
+	condition_variable free;
+	function<void()> run = [&]() {
+		vector<double> path(blockPaths * (steps + 1));
+		vector<double> blockMean(count), blockM2(count);
+		for (;;) {
+			size_t block;
+			{
+				unique_lock<mutex> guard(lock);
+				block = next++;
+				if (block >= blocks)
+					return;
+				free.wait(guard, [&]() { return block < combined + window; });
+			}
+			size_t size = min(blockPaths, paths - block * blockPaths);
+			Block(block, size, seed, path, blockMean.data(), blockM2.data());
+
+			lock_guard<mutex> guard(lock);
+			size_t slot = block % window;
+			copy(blockMean.begin(), blockMean.end(), slotMean.begin() + slot * count);
+			copy(blockM2.begin(), blockM2.end(), slotM2.begin() + slot * count);
+			ready[slot] = true;
+			while (combined < blocks && ready[combined % window]) {	// Chan et al. pairwise combine.
+				slot = combined % window;
+				double m = double(min(blockPaths, paths - combined * blockPaths));
+				for (size_t i = 0; i < count; i++) {
+					double delta = slotMean[slot * count + i] - mean[i];
+					mean[i] += delta * m / (n + m);
+					m2[i] += slotM2[slot * count + i] + delta * delta * n * m / (n + m);
+				}
+				n += m;
+				ready[slot] = false;
+				combined++;
+			}
+			free.notify_all();
+		}
+	};
+	vector<thread> workers;
+	for (size_t t = 1; t < threads; t++)
+		workers.push_back(thread(run));
+	run();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	double discount = exp(-data.r * (data.T - data.t));
+	for (size_t i = 0; i < count; i++) {
+		double variance = paths > 1 ? m2[i] / (n - 1.0) : 0.0;
+		tmp[i].price = discount * mean[i];
+		tmp[i].stdError = discount * sqrt(variance / n);
+	}
+	return tmp;
+}
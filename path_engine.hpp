@@ -0,0 +1,110 @@
+// path_engine.hpp
+//
+// Header file for Class PathEngine.
+// Monte Carlo pricing of many path dependent payoffs on one set of paths.
+//
+
+#ifndef PATH_ENGINE_HPP_
+#define PATH_ENGINE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// Payoffs priced from the path statistics, monitored at the engine dates.
+enum PathPayoffKind {
+	PATH_EUROPEAN,			// Final spot price.
+	PATH_ASIAN,				// Arithmetic average over the monitoring dates after the start.
+	PATH_UP_AND_OUT,		// European, worthless once the spot price reaches barrier from below.
+	PATH_UP_AND_IN,			// European, worthless unless the spot price reaches barrier from below.
+	PATH_DOWN_AND_OUT,
+	PATH_DOWN_AND_IN,
+	PATH_LOOKBACK_FIXED,	// Maximum (call) or minimum (put) against K.
+	PATH_LOOKBACK_FLOATING	// Final spot price against the minimum (call) or maximum (put), K unused.
+};
+
+struct PathPayoff {
+	PathPayoffKind kind;
+	char optType;	// 'C' or 'P'.
+	double K;
+	double barrier;	// Barrier kinds only.
+};
+
+// Discounted mean and its standard error.
+struct PathResult {
+	double price;
+	double stdError;
+};
+
+// Undiscounted payoff of one path of size spot prices, from the start to expiry.
+typedef function<double(const double* path, size_t size)> PathFunction;
+
+// Path engine.
+// Simulates geometric Brownian motion paths of one underlying (spot price S,
+// sig, r, b, T and t from OptionData, steps equal monitoring dates) and prices
+// every registered payoff on the same paths. Paths are generated in blocks of
+// BlockPaths() paths, sized so a block (BlockPaths() x (steps + 1) doubles)
+// stays in the L2 cache; each block is reduced to the statistics the payoffs
+// share (final, average, maximum and minimum) once, every payoff is evaluated
+// against it, and the block is overwritten by the next one, so memory does not
+// grow with the number of paths. Threads take the next block from a counter.
+// Block k always draws from the generator seeded with (seed, k); its mean and
+// squared deviations (Welford) are combined pairwise in block order through a
+// window of 4 slots per thread, so memory stays constant in the number of
+// paths and the prices do not depend on the thread count or on which thread
+// took which block, bit for bit.
+// Path functions (Add(const PathFunction&)) are called from several threads.
+class PathEngine {
+public:
+	// Constructors & destructor.
+	PathEngine(const OptionData& data, double S, size_t steps);	// Dynamics of the paths.
+	virtual ~PathEngine();	// Destructor.
+
+	size_t Add(const PathPayoff& payoff);		// Returns the payoff index in Price().
+	size_t Add(const PathFunction& payoff);		// Any payoff on the whole path.
+
+	vector<PathResult> Price(size_t paths, uint64_t seed = 1, size_t threads = 0) const;	// 0 threads means one per hardware thread.
+
+	// Selectors.
+	size_t Size() const;	// Registered payoffs.
+	size_t Steps() const;
+	size_t BlockPaths() const;
+
+private:
+	// Registered payoff, a built in kind or a path function.
+	struct Entry {
+		PathPayoff payoff;
+		PathFunction function;
+	};
+
+	OptionData data;
+	double S;
+	size_t steps;
+	size_t blockPaths;
+	vector<Entry> entry;
+
+	void Block(size_t block, size_t paths, uint64_t seed, vector<double>& path, double* mean, double* m2) const;	// Statistics of every payoff.
+
+	// No copy.
+	PathEngine(const PathEngine&);
+	PathEngine& operator = (const PathEngine&);
+};
+
+// Implementation of the normal inline function.
+inline size_t PathEngine::Size() const {
+	return entry.size();
+}
+
+inline size_t PathEngine::Steps() const {
+	return steps;
+}
+
+inline size_t PathEngine::BlockPaths() const {
+	return blockPaths;
+}
+
+#endif	// PATH_ENGINE_HPP_
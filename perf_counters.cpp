@@ -0,0 +1,156 @@
+// perf_counters.cpp
+//
+// PerfCounters implementation.
+//
+
+#include "perf_counters.hpp"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+double PerfCounterValues::Ipc() const {
+	if (!valid[PERF_CYCLES] || !valid[PERF_INSTRUCTIONS] || value[PERF_CYCLES] <= 0.0)
+		return 0.0;
+	return value[PERF_INSTRUCTIONS] / value[PERF_CYCLES];
+}
+
+// Intel family 6 cores with FP_ARITH_INST_RETIRED (event 0xc7) and its packed
+// umasks: Broadwell, Skylake and the cores after it. Hybrid parts are left out,
+// their efficiency cores do not count the event the same way.
+static bool HasFpArithEvent() {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+		return false;
+	char vendor[13];
+	memcpy(vendor, &ebx, 4);
+	memcpy(vendor + 4, &edx, 4);
+	memcpy(vendor + 8, &ecx, 4);
+	vendor[12] = 0;
+	if (strcmp(vendor, "GenuineIntel") != 0 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	unsigned int family = (eax >> 8) & 0xf;
+	unsigned int model = ((eax >> 4) & 0xf) | (((eax >> 16) & 0xf) << 4);
+	if (family != 6)
+		return false;
+	static const unsigned int models[] = {
+		0x3d, 0x47, 0x4f, 0x56,						// Broadwell.
+		0x4e, 0x5e, 0x55, 0x8e, 0x9e, 0xa5, 0xa6,	// Skylake, Cascade Lake, Kaby, Coffee and Comet Lake.
+		0x66, 0x6a, 0x6c, 0x7d, 0x7e,				// Cannon Lake, Ice Lake.
+		0x8c, 0x8d, 0xa7,							// Tiger Lake, Rocket Lake.
+		0x8f, 0xcf, 0xad, 0xae						// Sapphire, Emerald and Granite Rapids.
+	};
+	for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+		if (model == models[i])
+			return true;
+	}
+	return false;
+#else
+	return false;
+#endif
+}
+
+// Opens an event of the group of leader, or a new group leader when leader is -1.
+// Members follow the leader's enable state. The kernel refuses a member the
+// group cannot be scheduled with, so the open group always counts as a whole.
+static int OpenEvent(uint32_t type, uint64_t config, int leader) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = leader < 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+// The first event that opens leads the group, the others join it.
+PerfCounters::PerfCounters() : leader(-1), members(0) {
+	const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	const uint32_t type[PERF_EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_RAW };
+	// FP_ARITH_INST_RETIRED (0xc7), umask 0xfc: 128, 256 and 512 bit packed single and double.
+	const uint64_t config[PERF_EVENTS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, l1dReadMiss,
+		PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, 0xfcc7 };
+	bool fpArith = HasFpArithEvent();
+	for (size_t i = 0; i < PERF_EVENTS; i++) {
+		fd[i] = -1;
+		slot[i] = -1;
+		if (i == PERF_VECTOR_OPS && !fpArith)
+			continue;
+		fd[i] = OpenEvent(type[i], config[i], leader);
+		if (fd[i] < 0)
+			continue;
+		if (leader < 0)
+			leader = fd[i];
+		slot[i] = int(members++);
+	}
+}
+
+PerfCounters::~PerfCounters() {
+	for (size_t i = 0; i < PERF_EVENTS; i++) {
+		if (fd[i] >= 0 && fd[i] != leader)
+			close(fd[i]);
+	}
+	if (leader >= 0)
+		close(leader);
+}
+
+// One reset and enable of the whole group, so all events cover the same instructions.
+void PerfCounters::Start() {
+	if (leader < 0)
+		return;
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::Stop() {
+	if (leader >= 0)
+		ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Group read format: number of events, time enabled, time running, then one
+// value per event in the order they were opened. The group is scheduled as a
+// whole, so one scaling applies to every value.
+PerfCounterValues PerfCounters::Read() const {
+	PerfCounterValues tmp;
+	for (size_t i = 0; i < PERF_EVENTS; i++) {
+		tmp.valid[i] = false;
+		tmp.value[i] = 0.0;
+	}
+	uint64_t data[3 + PERF_EVENTS];
+	ssize_t bytes = (3 + members) * sizeof(uint64_t);
+	if (leader < 0 || read(leader, data, bytes) != bytes || data[0] != members || data[2] == 0)
+		return tmp;
+	double scale = double(data[1]) / double(data[2]);
+	for (size_t i = 0; i < PERF_EVENTS; i++) {
+		if (slot[i] < 0)
+			continue;
+		tmp.valid[i] = true;
+		tmp.value[i] = double(data[3 + slot[i]]) * scale;
+	}
+	return tmp;
+}
+
+bool PerfCounters::Available() const {
+	for (size_t i = 0; i < PERF_EVENTS; i++) {
+		if (fd[i] >= 0)
+			return true;
+	}
+	return false;
+}
+
+const char* PerfCounters::Name(PerfEvent event) {
+	static const char* name[] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "vector ops" };
+	return name[event];
+}
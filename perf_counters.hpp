@@ -0,0 +1,74 @@
+// perf_counters.hpp
+//
+// Header file for Class PerfCounters.
+// Linux hardware performance counters around a block of code.
+//
+
+#ifndef PERF_COUNTERS_HPP_
+#define PERF_COUNTERS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+enum PerfEvent {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,		// L1 data cache read misses.
+	PERF_LLC_MISSES,		// Last level cache misses.
+	PERF_BRANCH_MISSES,
+	PERF_VECTOR_OPS,		// Packed floating point instructions, Intel only.
+	PERF_EVENTS
+};
+
+// Counter values of one measurement, scaled up when the kernel multiplexed counters.
+struct PerfCounterValues {
+	bool valid[PERF_EVENTS];
+	double value[PERF_EVENTS];
+
+	double Ipc() const;	// Instructions per cycle, 0 when not counted.
+};
+
+// Counters of the calling thread, opened with perf_event_open for user space only.
+// The events form one group, reset, enabled, read and scaled together, so they
+// count the same instructions even when the kernel multiplexes counters.
+// Events the kernel or cpu refuses (perf_event_paranoid, virtual machines, other
+// vendors, a group too large for the cpu) are left out; Available() is false
+// when none could be opened.
+// The packed floating point count uses the FP_ARITH_INST_RETIRED raw event,
+// only opened on the Intel models known to have it (Broadwell and later
+// non-hybrid cores).
+// Measure with Start() and Stop() and read the totals with Read().
+class PerfCounters {
+public:
+	// Constructors & destructor.
+	PerfCounters();	// Open the counters.
+	virtual ~PerfCounters();	// Destructor, closes the counters.
+
+	void Start();	// Reset and enable.
+	void Stop();	// Disable.
+	PerfCounterValues Read() const;
+
+	// Selectors.
+	bool Available() const;
+	bool Available(PerfEvent event) const;
+	static const char* Name(PerfEvent event);
+
+private:
+	int fd[PERF_EVENTS];	// -1 when the event is not counted.
+	int slot[PERF_EVENTS];	// Position in the group read, -1 when not counted.
+	int leader;				// Group leader fd, -1 when nothing is counted.
+	size_t members;			// Events in the group.
+
+	// No copy.
+	PerfCounters(const PerfCounters&);
+	PerfCounters& operator = (const PerfCounters&);
+};
+
+// Implementation of the normal inline function.
+inline bool PerfCounters::Available(PerfEvent event) const {
+	return fd[event] >= 0;
+}
+
+#endif	// PERF_COUNTERS_HPP_
@@ -0,0 +1,92 @@
+// pricing_client.cpp
+//
+// PricingClient implementation.
+//
+
+#include "pricing_client.hpp"
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "pricing_protocol.hpp"
+
+using namespace std;
+
+PricingClient::PricingClient() : fd(-1), nextId(0) {
+}
+
+PricingClient::~PricingClient() {
+	Close();
+}
+
+bool PricingClient::Connect(const string& socketPath) {
+	Close();
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(addr.sun_path)) {
+		cout << "Socket path too long" << endl;
+		return false;
+	}
+	strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void PricingClient::Close() {
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+}
+
+bool PricingClient::Send(uint32_t id, const vector<PricingRequestItem>& items) {
+	if (fd < 0 || items.size() > PRICING_MAX_ITEMS)
+		return false;
+
+	PricingRequestHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PRICING_MAGIC;
+	header.id = id;
+	header.count = static_cast<uint32_t>(items.size());
+	return PricingProtocol::WriteFull(fd, &header, sizeof(header))
+		&& PricingProtocol::WriteFull(fd, items.data(), items.size() * sizeof(PricingRequestItem));
+}
+
+bool PricingClient::Receive(uint32_t& id, vector<double>& prices) {
+	if (fd < 0)
+		return false;
+
+	PricingReplyHeader header;
+	if (!PricingProtocol::ReadFull(fd, &header, sizeof(header)) || header.magic != PRICING_MAGIC) {
+		Close();
+		return false;
+	}
+	id = header.id;
+	prices.resize(header.count);
+	if (!PricingProtocol::ReadFull(fd, prices.data(), prices.size() * sizeof(double))) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// Only valid when no other request is in flight on this connection.
+vector<double> PricingClient::Price(const vector<PricingRequestItem>& items) {
+	vector<double> tmp;
+	uint32_t id = nextId++;
+	uint32_t replyId;
+	if (!Send(id, items) || !Receive(replyId, tmp) || replyId != id) {
+		cout << "Pricing request failed" << endl;
+		tmp.clear();
+	}
+	return tmp;
+}
@@ -0,0 +1,50 @@
+// pricing_client.hpp
+//
+// Header file for Class PricingClient.
+// Client of the local pricing service.
+//
+
+#ifndef PRICING_CLIENT_HPP_
+#define PRICING_CLIENT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pricing_protocol.hpp"
+
+using namespace std;
+
+// Connection to a PricingServer.
+// Open the connection with Connect(const string&) and close it with Close().
+// Send a request with Send(uint32_t, const vector<PricingRequestItem>&) and collect
+// replies with Receive(uint32_t&, vector<double>&); several requests may be in flight.
+// Price a request synchronously with Price(const vector<PricingRequestItem>&).
+class PricingClient {
+public:
+	// Constructors & destructor.
+	PricingClient();	// Unconnected client.
+	virtual ~PricingClient();	// Destructor, closes the connection.
+
+	bool Connect(const string& socketPath);
+	void Close();
+	bool IsConnected() const;
+
+	bool Send(uint32_t id, const vector<PricingRequestItem>& items);
+	bool Receive(uint32_t& id, vector<double>& prices);
+	vector<double> Price(const vector<PricingRequestItem>& items);
+
+private:
+	int fd;
+	uint32_t nextId;
+
+	// No copy.
+	PricingClient(const PricingClient&);
+	PricingClient& operator = (const PricingClient&);
+};
+
+// Implementation of the normal inline function.
+inline bool PricingClient::IsConnected() const {
+	return fd >= 0;
+}
+
+#endif	// PRICING_CLIENT_HPP_
@@ -0,0 +1,73 @@
+// pricing_daemon.cpp
+//
+// Local pricing service.
+//
+// Usage: pricing_daemon [socket path] [max batch] [max wait us] [stats interval s] [trace file]
+// Serves PricingRequestItem batches on a Unix domain socket until SIGINT or SIGTERM,
+// printing throughput and latency counters every stats interval.
+// With a trace file the stages of every request (read, gather, group items,
+// kernel, queue replies, write) are traced and saved there as a Chrome trace
+// on exit, the last PricingTrace::DEFAULT_EVENTS_PER_THREAD spans per thread.
+//
+
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "pricing_server.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+static void PrintStats(const PricingServerStats& stats) {
+	double seconds = stats.seconds > 0.0 ? stats.seconds : 1.0;
+	cout << "requests: " << stats.requests
+		<< "  options: " << stats.items
+		<< "  batches: " << stats.batches
+		<< "  options/batch: " << (stats.batches ? double(stats.items) / stats.batches : 0.0)
+		<< "  options/s: " << stats.items / seconds
+		<< "  p50/p99 us: " << stats.Percentile(0.50) << "/" << stats.Percentile(0.99)
+		<< "  rejected: " << stats.rejected
+		<< "  invalid: " << stats.invalid
+		<< "  slow: " << stats.slow << endl;
+}
+
+int main(int argc, char* argv[]) {
+	string path = argc > 1 ? argv[1] : "/tmp/option_pricing.sock";
+	size_t maxBatch = argc > 2 ? strtoul(argv[2], 0, 10) : 4096;
+	long maxWait = argc > 3 ? strtol(argv[3], 0, 10) : 50;
+	long interval = argc > 4 ? strtol(argv[4], 0, 10) : 5;
+	string traceFile = argc > 5 ? argv[5] : "";
+
+	// Block the signals before any thread starts, main waits for them below.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, 0);
+
+	if (!traceFile.empty())
+		PricingTrace::Enable(true);
+
+	PricingServer server(path, maxBatch, maxWait);
+	if (!server.Start())
+		return 1;
+	cout << "Serving on " << path << ", max batch " << maxBatch << ", max wait " << maxWait << " us" << endl;
+
+	timespec timeout = { interval > 0 ? interval : 5, 0 };
+	for (;;) {
+		int sig = sigtimedwait(&signals, 0, &timeout);
+		PrintStats(server.Stats());
+		if (sig == SIGINT || sig == SIGTERM)
+			break;
+	}
+	server.Stop();
+	if (!traceFile.empty()) {
+		PricingTrace::Enable(false);
+		if (!PricingTrace::SaveChromeTrace(traceFile))
+			return 1;
+		cout << "Trace saved to " << traceFile << ", " << PricingTrace::Dropped() << " spans overwritten" << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+// pricing_executor.cpp
+//
+// PricingExecutor implementation.
+//
+
+#include "pricing_executor.hpp"
+#include <utility>
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+PricingExecutor::PricingExecutor(size_t threads) : stopping(false) {
+	if (threads == 0)
+		threads = thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+	for (size_t i = 0; i < threads; i++)
+		workers.push_back(thread(&PricingExecutor::WorkLoop, this));
+}
+
+PricingExecutor::~PricingExecutor() {
+	{
+		lock_guard<mutex> lock(queueLock);
+		stopping = true;
+	}
+	queueReady.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+// Function local static, created on first use.
+PricingExecutor& PricingExecutor::Shared() {
+	static PricingExecutor executor(0);
+	return executor;
+}
+
+void PricingExecutor::Submit(const function<void()>& task) {
+	{
+		lock_guard<mutex> lock(queueLock);
+		queue.push_back(task);
+	}
+	queueReady.notify_one();
+}
+
+void PricingExecutor::WorkLoop() {
+	PricingTrace::SetThreadName("pricing executor");
+	for (;;) {
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(queueLock);
+			while (queue.empty() && !stopping)
+				queueReady.wait(lock);
+			if (queue.empty())
+				return;
+			task = move(queue.front());	// No copy, so taking a task cannot throw.
+			queue.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,55 @@
+// pricing_executor.hpp
+//
+// Header file for Class PricingExecutor.
+//
+
+#ifndef PRICING_EXECUTOR_HPP_
+#define PRICING_EXECUTOR_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed pool of worker threads running tasks in submission order.
+// Access the process wide pool with Shared().
+// Queue a task with Submit(function<void()>).
+// Access the number of workers with Size().
+class PricingExecutor {
+public:
+	// Constructors & destructor.
+	PricingExecutor(size_t threads);	// Create pool, 0 means one thread per hardware thread.
+	virtual ~PricingExecutor();	// Destructor, runs the queued tasks and joins the workers.
+
+	static PricingExecutor& Shared();	// Pool shared by the asynchronous pricing functions.
+
+	void Submit(const function<void()>& task);
+
+	// Selectors.
+	size_t Size() const;
+
+private:
+	vector<thread> workers;
+	mutex queueLock;
+	condition_variable queueReady;
+	deque<function<void()> > queue;
+	bool stopping;
+
+	// No copy.
+	PricingExecutor(const PricingExecutor&);
+	PricingExecutor& operator = (const PricingExecutor&);
+
+	void WorkLoop();
+};
+
+// Implementation of the normal inline function.
+inline size_t PricingExecutor::Size() const {
+	return workers.size();
+}
+
+#endif	// PRICING_EXECUTOR_HPP_
@@ -0,0 +1,330 @@
+// pricing_graph.cpp
+//
+// PricingGraph implementation.
+//
+
+#include "pricing_graph.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "american_option_function.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_executor.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+// Relative spot bump of the central difference delta.
+static const double DELTA_BUMP = 1e-4;
+
+// Counts a Recompute() task finished when it goes out of scope.
+struct TaskDone {
+	mutex& lock;
+	condition_variable& finished;
+	size_t& left;
+
+	TaskDone(mutex& lock, condition_variable& finished, size_t& left) : lock(lock), finished(finished), left(left) {
+	}
+
+	~TaskDone() {
+		lock_guard<mutex> guard(lock);
+		if (--left == 0)
+			finished.notify_one();
+	}
+};
+
+PricingGraph::PricingGraph() {
+	stats.contracts = stats.aggregates = stats.kernelCalls = stats.tasks = 0;
+}
+
+PricingGraph::~PricingGraph() {
+}
+
+size_t PricingGraph::AddNode(PricingNodeKind kind, size_t index, const vector<size_t>& from) {
+	size_t id = nodes.size();
+	Node tmp;
+	tmp.kind = kind;
+	tmp.index = index;
+	tmp.dirty = kind != NODE_INPUT;	// Computed by the next Recompute().
+	tmp.value = 0.0;
+	tmp.delta = 0.0;
+	nodes.push_back(tmp);
+	parent.push_back(id);
+	if (tmp.dirty)
+		dirty.push_back(id);
+	for (size_t i = 0; i < from.size(); i++) {
+		nodes[from[i]].dependents.push_back(id);
+		parent[Root(from[i])] = Root(id);
+	}
+	return id;
+}
+
+size_t PricingGraph::Root(size_t node) {
+	while (parent[node] != node) {
+		parent[node] = parent[parent[node]];
+		node = parent[node];
+	}
+	return node;
+}
+
+size_t PricingGraph::AddInput(double value) {
+	size_t id = AddNode(NODE_INPUT, 0, vector<size_t>());
+	nodes[id].value = value;
+	return id;
+}
+
+size_t PricingGraph::AddContract(const GraphContract& contract) {
+	size_t link[] = { contract.spot, contract.vol, contract.rate, contract.carry };
+	vector<size_t> from;
+	for (size_t i = 0; i < 4; i++) {
+		if (link[i] == NO_NODE && i > 0)
+			continue;
+		if (link[i] >= nodes.size() || nodes[link[i]].kind != NODE_INPUT) {
+			cout << "Wrong input node" << endl;
+			return NO_NODE;
+		}
+		from.push_back(link[i]);
+	}
+	contracts.push_back(contract);
+	return AddNode(NODE_CONTRACT, contracts.size() - 1, from);
+}
+
+size_t PricingGraph::AddAggregate(const vector<size_t>& node, const vector<double>& weights) {
+	if (node.size() != weights.size()) {
+		cout << "Node and weight sizes differ" << endl;
+		return NO_NODE;
+	}
+	for (size_t i = 0; i < node.size(); i++) {
+		if (node[i] >= nodes.size() || (nodes[node[i]].kind != NODE_CONTRACT && nodes[node[i]].kind != NODE_AGGREGATE)) {
+			cout << "Wrong aggregate member node" << endl;
+			return NO_NODE;
+		}
+	}
+	Aggregate tmp = { node, weights };
+	aggregates.push_back(tmp);
+	return AddNode(NODE_AGGREGATE, aggregates.size() - 1, node);
+}
+
+size_t PricingGraph::AddHedge(size_t aggregate, size_t instrument) {
+	if (aggregate >= nodes.size() || nodes[aggregate].kind != NODE_AGGREGATE
+		|| (instrument != NO_NODE && (instrument >= nodes.size() || nodes[instrument].kind != NODE_CONTRACT))) {
+		cout << "Wrong hedge node" << endl;
+		return NO_NODE;
+	}
+	Hedge tmp = { aggregate, instrument };
+	hedges.push_back(tmp);
+	vector<size_t> from(1, aggregate);
+	if (instrument != NO_NODE)
+		from.push_back(instrument);
+	return AddNode(NODE_HEDGE, hedges.size() - 1, from);
+}
+
+// An unchanged value marks nothing.
+bool PricingGraph::Set(size_t input, double value) {
+	if (input >= nodes.size() || nodes[input].kind != NODE_INPUT) {
+		cout << "Wrong input node" << endl;
+		return false;
+	}
+	if (nodes[input].value == value)
+		return true;
+	nodes[input].value = value;
+
+	vector<size_t> stack(nodes[input].dependents);
+	while (!stack.empty()) {
+		size_t n = stack.back();
+		stack.pop_back();
+		if (nodes[n].dirty)
+			continue;
+		nodes[n].dirty = true;
+		dirty.push_back(n);
+		stack.insert(stack.end(), nodes[n].dependents.begin(), nodes[n].dependents.end());
+	}
+	return true;
+}
+
+void PricingGraph::Evaluate(const vector<size_t>& work, size_t& kernelCalls) {
+	PricingTrace::Span span("graph evaluate", "graph", work.size());
+
+	// Contracts by kernel: European call, put, American call, put. Every contract
+	// is priced at S, S (1 + h) and S (1 - h) in the same call.
+	vector<size_t> group[4];
+	for (size_t i = 0; i < work.size(); i++) {
+		const Node& node = nodes[work[i]];
+		if (node.kind == NODE_CONTRACT) {
+			const GraphContract& c = contracts[node.index];
+			group[(c.american ? 2 : 0) + ((c.optType == 'P' || c.optType == 'p') ? 1 : 0)].push_back(work[i]);
+		}
+	}
+	vector<OptionData> data;
+	vector<double> S, price;
+	for (size_t g = 0; g < 4; g++) {
+		if (group[g].empty())
+			continue;
+		size_t size = group[g].size();
+		data.resize(3 * size);
+		S.resize(3 * size);
+		price.resize(3 * size);
+		for (size_t i = 0; i < size; i++) {
+			const GraphContract& c = contracts[nodes[group[g][i]].index];
+			OptionData d = c.data;
+			if (c.vol != NO_NODE)
+				d.sig = nodes[c.vol].value;
+			if (c.rate != NO_NODE)
+				d.r = nodes[c.rate].value;
+			if (c.carry != NO_NODE)
+				d.b = nodes[c.carry].value;
+			double spot = nodes[c.spot].value;
+			data[3 * i] = data[3 * i + 1] = data[3 * i + 2] = d;
+			S[3 * i] = spot;
+			S[3 * i + 1] = spot * (1.0 + DELTA_BUMP);
+			S[3 * i + 2] = spot * (1.0 - DELTA_BUMP);
+		}
+		switch (g) {
+		case 0: EuropeanOptionFunction::CallPrice(data.data(), S.data(), price.data(), 3 * size); break;
+		case 1: EuropeanOptionFunction::PutPrice(data.data(), S.data(), price.data(), 3 * size); break;
+		case 2: AmericanOptionFunction::CallPrice(data.data(), S.data(), price.data(), 3 * size); break;
+		default: AmericanOptionFunction::PutPrice(data.data(), S.data(), price.data(), 3 * size); break;
+		}
+		kernelCalls++;
+		for (size_t i = 0; i < size; i++) {
+			Node& node = nodes[group[g][i]];
+			node.value = price[3 * i];
+			node.delta = (price[3 * i + 1] - price[3 * i + 2]) / (S[3 * i + 1] - S[3 * i + 2]);
+		}
+	}
+
+	// Aggregates and hedges, their members come earlier in node order.
+	for (size_t i = 0; i < work.size(); i++) {
+		Node& node = nodes[work[i]];
+		if (node.kind == NODE_AGGREGATE) {
+			const Aggregate& a = aggregates[node.index];
+			double value = 0.0, delta = 0.0;
+			for (size_t m = 0; m < a.nodes.size(); m++) {
+				value += a.weights[m] * nodes[a.nodes[m]].value;
+				delta += a.weights[m] * nodes[a.nodes[m]].delta;
+			}
+			node.value = value;
+			node.delta = delta;
+		} else if (node.kind == NODE_HEDGE) {
+			const Hedge& h = hedges[node.index];
+			double unit = h.instrument == NO_NODE ? 1.0 : nodes[h.instrument].delta;
+			node.value = -nodes[h.aggregate].delta / unit;
+			node.delta = 0.0;
+		}
+		node.dirty = false;
+	}
+}
+
+void PricingGraph::Recompute(PricingExecutor* executor) {
+	PRICING_METRIC("PricingGraph::Recompute(PricingExecutor*)", dirty.size());
+	PricingTrace::Span span("graph recompute", "graph", dirty.size());
+	stats.contracts = stats.aggregates = stats.kernelCalls = stats.tasks = 0;
+	if (dirty.empty())
+		return;
+	for (size_t i = 0; i < dirty.size(); i++) {
+		if (nodes[dirty[i]].kind == NODE_CONTRACT)
+			stats.contracts++;
+		else
+			stats.aggregates++;
+	}
+
+	if (!executor || executor->Size() <= 1) {
+		sort(dirty.begin(), dirty.end());
+		stats.tasks = 1;
+		try {
+			Evaluate(dirty, stats.kernelCalls);
+		} catch (...) {
+			Redirty();
+			throw;
+		}
+		dirty.clear();
+		return;
+	}
+
+	// Dirty nodes by subgraph, then the subgraphs largest first onto the least loaded task.
+	vector<pair<size_t, size_t> > keyed(dirty.size());
+	for (size_t i = 0; i < dirty.size(); i++)
+		keyed[i] = make_pair(Root(dirty[i]), dirty[i]);
+	sort(keyed.begin(), keyed.end());
+	vector<pair<size_t, size_t> > subgraph;	// Size and first entry in keyed.
+	for (size_t i = 0; i < keyed.size(); i++) {
+		if (i == 0 || keyed[i].first != keyed[i - 1].first)
+			subgraph.push_back(make_pair(0, i));
+		subgraph.back().first++;
+	}
+	sort(subgraph.rbegin(), subgraph.rend());
+	size_t tasks = min(executor->Size(), subgraph.size());
+	vector<vector<size_t> > work(tasks);
+	for (size_t s = 0; s < subgraph.size(); s++) {
+		size_t least = 0;
+		for (size_t t = 1; t < tasks; t++) {
+			if (work[t].size() < work[least].size())
+				least = t;
+		}
+		for (size_t i = 0; i < subgraph[s].first; i++)
+			work[least].push_back(keyed[subgraph[s].second + i].second);
+	}
+
+	// Tasks write only the nodes of their own subgraphs. Every task counts itself
+	// finished however it ends, and the first exception of a task or of Submit()
+	// is rethrown here once the submitted tasks are done, the nodes left dirty.
+	vector<size_t> calls(tasks, 0);
+	mutex lock;
+	condition_variable finished;
+	size_t left = tasks;
+	exception_ptr error;
+	for (size_t t = 0; t < tasks; t++) {
+		sort(work[t].begin(), work[t].end());
+		try {
+			executor->Submit([this, &work, &calls, &lock, &finished, &left, &error, t]() {
+				TaskDone done(lock, finished, left);
+				try {
+					Evaluate(work[t], calls[t]);
+				} catch (...) {
+					lock_guard<mutex> guard(lock);
+					if (!error)
+						error = current_exception();
+				}
+			});
+		} catch (...) {
+			lock_guard<mutex> guard(lock);
+			left -= tasks - t;	// Never submitted.
+			if (!error)
+				error = current_exception();
+			break;
+		}
+	}
+	unique_lock<mutex> guard(lock);
+	finished.wait(guard, [&left]() { return left == 0; });
+	if (error) {
+		Redirty();
+		rethrow_exception(error);
+	}
+
+	stats.tasks = tasks;
+	for (size_t t = 0; t < tasks; t++)
+		stats.kernelCalls += calls[t];
+	dirty.clear();
+}
+
+// Evaluated or not, every node of a failed Recompute() is recomputed by the next one.
+void PricingGraph::Redirty() {
+	for (size_t i = 0; i < dirty.size(); i++)
+		nodes[dirty[i]].dirty = true;
+}
+
+size_t PricingGraph::Subgraphs() {
+	size_t tmp = 0;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (Root(i) == i)
+			tmp++;
+	}
+	return tmp;
+}
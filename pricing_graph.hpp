@@ -0,0 +1,155 @@
+// pricing_graph.hpp
+//
+// Header file for Class PricingGraph.
+// Incremental recomputation of contract prices, aggregates and hedges.
+//
+
+#ifndef PRICING_GRAPH_HPP_
+#define PRICING_GRAPH_HPP_
+
+#include <cstddef>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_executor.hpp"
+
+using namespace std;
+
+const size_t NO_NODE = size_t(-1);
+
+enum PricingNodeKind {
+	NODE_INPUT,		// Market input: spot, vol surface point, curve pillar, carry.
+	NODE_CONTRACT,	// Option priced by the book kernels.
+	NODE_AGGREGATE,	// Weighted sum of contracts and aggregates.
+	NODE_HEDGE		// Hedge ratio of an aggregate.
+};
+
+// Contract node: the parameters of data with spot and optionally sig, r and b
+// taken from input nodes.
+struct GraphContract {
+	OptionData data;	// T, K, t and q, and sig, r, b where not linked to an input.
+	char optType;		// 'C' or 'P'.
+	bool american;		// Perpetual American, otherwise European.
+	size_t spot;		// Input node of the spot price.
+	size_t vol;			// Input node of the volatility or NO_NODE.
+	size_t rate;		// Input node of the interest rate or NO_NODE.
+	size_t carry;		// Input node of the cost of carry or NO_NODE.
+};
+
+// Work done by the last Recompute().
+struct PricingGraphStats {
+	size_t contracts;	// Contracts repriced.
+	size_t aggregates;	// Aggregates and hedges recomputed.
+	size_t kernelCalls;	// Book kernel calls, one per option type and style and task.
+	size_t tasks;		// Parallel tasks.
+};
+
+// Dataflow graph of a book.
+// Nodes only refer to nodes added before them, so node order is a topological
+// order. Set() changes an input and marks everything that depends on it dirty,
+// stopping at nodes already dirty; Recompute() then brings only the dirty nodes up
+// to date: the dirty contracts are gathered into one book kernel call per option
+// type and style (price and a central difference delta in the same call), then the
+// dirty aggregates and hedges are evaluated in node order.
+// Nodes connected through shared inputs form a subgraph; with an executor the
+// dirty subgraphs are spread over its workers, each task batching its own
+// contracts. Results do not depend on the executor or the number of tasks.
+// Every node has a value and a delta (dV/dS): inputs have delta 0, aggregates sum
+// both with their weights (delta is meaningful for one underlying), hedges give
+// the units of an instrument that make an aggregate delta neutral.
+// Set() and Recompute() must be called from one thread, and Recompute() not from a
+// worker of the executor it is given. An exception of a task is rethrown by
+// Recompute() on the calling thread after the other tasks finished, and the
+// dirty nodes stay dirty for the next Recompute().
+class PricingGraph {
+public:
+	// Constructors & destructor.
+	PricingGraph();	// Empty graph.
+	virtual ~PricingGraph();	// Destructor.
+
+	// Building, every function returns the new node or NO_NODE for a wrong argument.
+	size_t AddInput(double value);
+	size_t AddContract(const GraphContract& contract);
+	size_t AddAggregate(const vector<size_t>& nodes, const vector<double>& weights);	// Contracts or aggregates.
+	size_t AddHedge(size_t aggregate, size_t instrument = NO_NODE);	// Units of a contract, NO_NODE for the underlying.
+
+	bool Set(size_t input, double value);	// False when not an input node.
+	void Recompute(PricingExecutor* executor = 0);	// 0 runs on the calling thread.
+
+	// Selectors.
+	size_t Size() const;
+	PricingNodeKind Kind(size_t node) const;
+	double Value(size_t node) const;	// As of the last Recompute().
+	double Delta(size_t node) const;
+	bool IsDirty(size_t node) const;
+	size_t Dirty() const;	// Nodes waiting for Recompute().
+	size_t Subgraphs();	// Independent subgraphs.
+	const PricingGraphStats& LastRecompute() const;
+
+private:
+	struct Node {
+		PricingNodeKind kind;
+		size_t index;	// In contracts, aggregates or hedges.
+		bool dirty;
+		double value;
+		double delta;
+		vector<size_t> dependents;
+	};
+
+	struct Aggregate {
+		vector<size_t> nodes;
+		vector<double> weights;
+	};
+
+	struct Hedge {
+		size_t aggregate;
+		size_t instrument;
+	};
+
+	vector<Node> nodes;
+	vector<GraphContract> contracts;
+	vector<Aggregate> aggregates;
+	vector<Hedge> hedges;
+	vector<size_t> parent;		// Union-find of the subgraphs.
+	vector<size_t> dirty;		// Dirty nodes, unordered.
+	PricingGraphStats stats;
+
+	size_t AddNode(PricingNodeKind kind, size_t index, const vector<size_t>& from);
+	size_t Root(size_t node);
+	void Evaluate(const vector<size_t>& work, size_t& kernelCalls);	// Dirty nodes in node order.
+	void Redirty();	// Marks the dirty list dirty again after an exception.
+
+	// No copy.
+	PricingGraph(const PricingGraph&);
+	PricingGraph& operator = (const PricingGraph&);
+};
+
+// Implementation of the normal inline function.
+inline size_t PricingGraph::Size() const {
+	return nodes.size();
+}
+
+inline PricingNodeKind PricingGraph::Kind(size_t node) const {
+	return nodes[node].kind;
+}
+
+inline double PricingGraph::Value(size_t node) const {
+	return nodes[node].value;
+}
+
+inline double PricingGraph::Delta(size_t node) const {
+	return nodes[node].delta;
+}
+
+inline bool PricingGraph::IsDirty(size_t node) const {
+	return nodes[node].dirty;
+}
+
+inline size_t PricingGraph::Dirty() const {
+	return dirty.size();
+}
+
+inline const PricingGraphStats& PricingGraph::LastRecompute() const {
+	return stats;
+}
+
+#endif	// PRICING_GRAPH_HPP_
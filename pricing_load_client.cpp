@@ -0,0 +1,133 @@
+// pricing_load_client.cpp
+//
+// Load generator for the local pricing service.
+//
+// Usage: pricing_load_client [socket path] [threads] [requests per thread] [options per request] [in flight]
+// Every thread plays one quoting process: it keeps a number of requests in flight
+// on its own connection and checks the replies against the in-process kernels.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "american_option_function.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_client.hpp"
+#include "pricing_protocol.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+// Deterministic mix of European and American calls and puts.
+static vector<PricingRequestItem> MakeRequest(size_t size, size_t seed) {
+	vector<PricingRequestItem> tmp;
+	for (size_t i = 0; i < size; i++) {
+		size_t k = seed * 31 + i;
+		OptionData data = { 0.25 + 0.05 * (k % 10), 60.0 + (k % 40), 0.2 + 0.01 * (k % 20), 0.08, 0.08, 0.0, 0.0 };
+		char style = (k % 4 == 3) ? PRICING_AMERICAN : PRICING_EUROPEAN;
+		char optType = (k % 2 == 0) ? 'C' : 'P';
+		if (style == PRICING_AMERICAN)
+			data.b = 0.02;
+		tmp.push_back(PricingProtocol::MakeItem(data, style, optType, 50.0 + (k % 60)));
+	}
+	return tmp;
+}
+
+static double LocalPrice(const PricingRequestItem& item) {
+	if (item.style == PRICING_AMERICAN)
+		return item.optType == 'C' ? AmericanOptionFunction::CallPrice(item.data, item.S) : AmericanOptionFunction::PutPrice(item.data, item.S);
+	return item.optType == 'C' ? EuropeanOptionFunction::CallPrice(item.data, item.S) : EuropeanOptionFunction::PutPrice(item.data, item.S);
+}
+
+struct LoadResult {
+	vector<double> latency;	// Microseconds per request.
+	size_t errors;
+};
+
+static void Run(const string& path, size_t requests, size_t size, size_t inFlight, size_t seed, LoadResult& result) {
+	result.errors = 0;
+	PricingClient client;
+	if (!client.Connect(path)) {
+		cout << "Cannot connect to " << path << endl;
+		result.errors = requests;
+		return;
+	}
+
+	vector<PricingRequestItem> request = MakeRequest(size, seed);
+	map<uint32_t, chrono::steady_clock::time_point> sent;
+	vector<double> prices;
+	size_t next = 0, done = 0;
+	while (done < requests) {
+		while (next < requests && sent.size() < inFlight) {
+			sent[uint32_t(next)] = chrono::steady_clock::now();
+			if (!client.Send(uint32_t(next), request)) {
+				result.errors += requests - done;
+				return;
+			}
+			next++;
+		}
+
+		uint32_t id;
+		if (!client.Receive(id, prices)) {
+			result.errors += requests - done;
+			return;
+		}
+		result.latency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent[id]).count());
+		sent.erase(id);
+		done++;
+
+		if (id == 0) {
+			for (size_t i = 0; i < request.size(); i++) {
+				double expected = LocalPrice(request[i]);
+				if (i >= prices.size() || fabs(prices[i] - expected) > 1e-9 * (1.0 + fabs(expected)))
+					result.errors++;
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	string path = argc > 1 ? argv[1] : "/tmp/option_pricing.sock";
+	size_t threads = argc > 2 ? strtoul(argv[2], 0, 10) : 8;
+	size_t requests = argc > 3 ? strtoul(argv[3], 0, 10) : 10000;
+	size_t size = argc > 4 ? strtoul(argv[4], 0, 10) : 16;
+	size_t inFlight = argc > 5 ? strtoul(argv[5], 0, 10) : 4;
+	if (threads == 0 || size == 0 || inFlight == 0) {
+		cout << "Threads, options per request and in flight must be positive" << endl;
+		return 1;
+	}
+
+	vector<LoadResult> results(threads);
+	vector<thread> workers;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = 0; i < threads; i++)
+		workers.push_back(thread(Run, path, requests, size, inFlight, i, ref(results[i])));
+	for (size_t i = 0; i < threads; i++)
+		workers[i].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<double> latency;
+	size_t errors = 0;
+	for (size_t i = 0; i < threads; i++) {
+		latency.insert(latency.end(), results[i].latency.begin(), results[i].latency.end());
+		errors += results[i].errors;
+	}
+	sort(latency.begin(), latency.end());
+
+	cout << "requests: " << latency.size() << "  options/s: " << latency.size() * size / seconds
+		<< "  requests/s: " << latency.size() / seconds << endl;
+	if (!latency.empty()) {
+		cout << "latency us  p50: " << latency[latency.size() / 2]
+			<< "  p99: " << latency[latency.size() * 99 / 100]
+			<< "  max: " << latency.back() << endl;
+	}
+	cout << "errors: " << errors << endl;
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// pricing_metrics.cpp
+//
+// Pricing metrics implementation.
+//
+
+#include "pricing_metrics.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+double PricingMetricSnapshot::Percentile(double p) const {
+	uint64_t total = 0;
+	for (size_t i = 0; i < bucket.size(); i++)
+		total += bucket[i];
+	if (total == 0)
+		return 0.0;
+	uint64_t target = (uint64_t)ceil(p * total);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucket.size(); i++) {
+		seen += bucket[i];
+		if (seen >= target && bucket[i] > 0)
+			return (double)BucketHigh(i);
+	}
+	return (double)BucketHigh(bucket.size() - 1);
+}
+
+// Buckets 0 to 7 hold 0 to 7 ns; bucket 8 (e - 2) + s holds [(8 + s) 2^(e - 3), (9 + s) 2^(e - 3)).
+uint64_t PricingMetricSnapshot::BucketLow(size_t i) {
+	if (i < 8)
+		return i;
+	return (uint64_t)(8 + i % 8) << (i / 8 - 1);
+}
+
+uint64_t PricingMetricSnapshot::BucketHigh(size_t i) {
+	if (i < 8)
+		return i + 1;
+	return (uint64_t)(9 + i % 8) << (i / 8 - 1);
+}
+
+namespace PricingMetrics {
+
+// Counters of one entry point in one thread, written by that thread only.
+struct SiteCounters {
+	atomic<uint64_t> calls;
+	atomic<uint64_t> elements;
+	atomic<uint64_t> nanos;
+	atomic<uint64_t> bucket[PricingMetricSnapshot::BUCKETS];
+};
+
+struct ThreadBlock {
+	atomic<SiteCounters*> site[MAX_SITES];
+
+	~ThreadBlock() {
+		for (size_t i = 0; i < MAX_SITES; i++)
+			delete site[i].load();
+	}
+};
+
+// Plain totals per entry point.
+struct Totals {
+	uint64_t calls;
+	uint64_t elements;
+	uint64_t nanos;
+	uint64_t bucket[PricingMetricSnapshot::BUCKETS];
+};
+
+struct Registry {
+	mutex lock;
+	vector<string> names;
+	vector<ThreadBlock*> threads;
+	vector<Totals> retired;		// Counters of exited threads.
+	vector<Totals> baseline;	// Totals at the last Reset().
+};
+
+// Never destroyed, threads may exit after static destruction started.
+static Registry& GetRegistry() {
+	static Registry* registry = new Registry;
+	return *registry;
+}
+
+static void Add(Totals& to, const SiteCounters& from) {
+	to.calls += from.calls.load(memory_order_relaxed);
+	to.elements += from.elements.load(memory_order_relaxed);
+	to.nanos += from.nanos.load(memory_order_relaxed);
+	for (size_t i = 0; i < PricingMetricSnapshot::BUCKETS; i++)
+		to.bucket[i] += from.bucket[i].load(memory_order_relaxed);
+}
+
+// Single writer, so a relaxed load and store replaces the locked increment.
+static inline void Bump(atomic<uint64_t>& counter, uint64_t value) {
+	counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+// Owner of the block of the current thread, folds it into the retired totals on thread exit.
+struct ThreadHolder {
+	ThreadBlock* block;
+
+	ThreadHolder() : block(0) {
+	}
+
+	~ThreadHolder() {
+		if (!block)
+			return;
+		Registry& registry = GetRegistry();
+		lock_guard<mutex> guard(registry.lock);
+		for (size_t i = 0; i < MAX_SITES; i++) {
+			SiteCounters* counters = block->site[i].load(memory_order_acquire);
+			if (counters)
+				Add(registry.retired[i], *counters);
+		}
+		for (size_t i = 0; i < registry.threads.size(); i++) {
+			if (registry.threads[i] == block) {
+				registry.threads.erase(registry.threads.begin() + i);
+				break;
+			}
+		}
+		delete block;
+	}
+};
+
+static thread_local ThreadHolder holder;
+
+Site::Site(const char* name) {
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	if (registry.retired.empty()) {
+		registry.retired.resize(MAX_SITES, Totals());
+		registry.baseline.resize(MAX_SITES, Totals());
+	}
+	if (registry.names.size() < MAX_SITES) {
+		id = registry.names.size();
+		registry.names.push_back(name);
+	} else {
+		cout << "Too many pricing metric sites, " << name << " shares the last one" << endl;
+		id = MAX_SITES - 1;
+	}
+}
+
+Site::~Site() {
+}
+
+bool Enabled() {
+#ifdef OPTION_PRICING_METRICS
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t BucketIndex(uint64_t nanos) {
+	if (nanos < 8)
+		return nanos;
+	size_t e = 63 - __builtin_clzll(nanos);
+	size_t i = 8 * (e - 2) + ((nanos >> (e - 3)) & 7);
+	return (i < PricingMetricSnapshot::BUCKETS) ? i : PricingMetricSnapshot::BUCKETS - 1;
+}
+
+void Record(size_t id, size_t elements, uint64_t nanos) {
+	ThreadBlock* block = holder.block;
+	if (!block) {
+		block = new ThreadBlock();
+		Registry& registry = GetRegistry();
+		lock_guard<mutex> guard(registry.lock);
+		registry.threads.push_back(block);
+		holder.block = block;
+	}
+	SiteCounters* counters = block->site[id].load(memory_order_relaxed);
+	if (!counters) {
+		counters = new SiteCounters();
+		block->site[id].store(counters, memory_order_release);
+	}
+	Bump(counters->calls, 1);
+	Bump(counters->elements, elements);
+	Bump(counters->nanos, nanos);
+	Bump(counters->bucket[BucketIndex(nanos)], 1);
+}
+
+// Totals since start, registry lock held.
+static vector<Totals> RawTotals(Registry& registry) {
+	vector<Totals> tmp(registry.retired);
+	for (size_t t = 0; t < registry.threads.size(); t++) {
+		for (size_t i = 0; i < registry.names.size(); i++) {
+			SiteCounters* counters = registry.threads[t]->site[i].load(memory_order_acquire);
+			if (counters)
+				Add(tmp[i], *counters);
+		}
+	}
+	return tmp;
+}
+
+vector<PricingMetricSnapshot> Collect() {
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	vector<PricingMetricSnapshot> tmp;
+	if (registry.names.empty())
+		return tmp;
+	vector<Totals> totals = RawTotals(registry);
+	for (size_t i = 0; i < registry.names.size(); i++) {
+		const Totals& base = registry.baseline[i];
+		PricingMetricSnapshot s;
+		s.name = registry.names[i];
+		s.calls = totals[i].calls - base.calls;
+		s.elements = totals[i].elements - base.elements;
+		s.nanos = totals[i].nanos - base.nanos;
+		if (s.calls == 0)
+			continue;
+		s.bucket.resize(PricingMetricSnapshot::BUCKETS);
+		for (size_t k = 0; k < PricingMetricSnapshot::BUCKETS; k++)
+			s.bucket[k] = totals[i].bucket[k] - base.bucket[k];
+		tmp.push_back(s);
+	}
+	return tmp;
+}
+
+// Writers never see a reset, the current totals become the new zero.
+void Reset() {
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	if (!registry.names.empty())
+		registry.baseline = RawTotals(registry);
+}
+
+// Escape backslash, double quote and newline, valid for both label values and JSON strings.
+static string Escape(const string& text) {
+	string tmp;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '\\' || text[i] == '"')
+			tmp += '\\';
+		if (text[i] == '\n')
+			tmp += "\\n";
+		else
+			tmp += text[i];
+	}
+	return tmp;
+}
+
+void DumpPrometheus(ostream& out) {
+	vector<PricingMetricSnapshot> metrics = Collect();
+	out << "# HELP option_pricing_calls_total Calls per pricing entry point.\n";
+	out << "# TYPE option_pricing_calls_total counter\n";
+	for (size_t i = 0; i < metrics.size(); i++)
+		out << "option_pricing_calls_total{entry=\"" << Escape(metrics[i].name) << "\"} " << metrics[i].calls << "\n";
+	out << "# HELP option_pricing_elements_total Options evaluated per pricing entry point.\n";
+	out << "# TYPE option_pricing_elements_total counter\n";
+	for (size_t i = 0; i < metrics.size(); i++)
+		out << "option_pricing_elements_total{entry=\"" << Escape(metrics[i].name) << "\"} " << metrics[i].elements << "\n";
+	out << "# HELP option_pricing_latency_seconds Latency per pricing entry point call.\n";
+	out << "# TYPE option_pricing_latency_seconds histogram\n";
+	for (size_t i = 0; i < metrics.size(); i++) {
+		const PricingMetricSnapshot& m = metrics[i];
+		string label = "entry=\"" + Escape(m.name) + "\"";
+		uint64_t seen = 0;
+		for (size_t k = 0; k < m.bucket.size(); k++) {
+			if (m.bucket[k] == 0)
+				continue;
+			seen += m.bucket[k];
+			out << "option_pricing_latency_seconds_bucket{" << label << ",le=\"" << PricingMetricSnapshot::BucketHigh(k) * 1e-9 << "\"} " << seen << "\n";
+		}
+		out << "option_pricing_latency_seconds_bucket{" << label << ",le=\"+Inf\"} " << m.calls << "\n";
+		out << "option_pricing_latency_seconds_sum{" << label << "} " << m.nanos * 1e-9 << "\n";
+		out << "option_pricing_latency_seconds_count{" << label << "} " << m.calls << "\n";
+	}
+}
+
+void DumpJson(ostream& out) {
+	vector<PricingMetricSnapshot> metrics = Collect();
+	out << "[";
+	for (size_t i = 0; i < metrics.size(); i++) {
+		const PricingMetricSnapshot& m = metrics[i];
+		out << (i ? ",\n " : "\n ") << "{\"entry\": \"" << Escape(m.name) << "\", \"calls\": " << m.calls
+			<< ", \"elements\": " << m.elements << ", \"total_ns\": " << m.nanos
+			<< ", \"mean_ns\": " << (double)m.nanos / m.calls
+			<< ", \"p50_ns\": " << m.Percentile(0.5) << ", \"p90_ns\": " << m.Percentile(0.9)
+			<< ", \"p99_ns\": " << m.Percentile(0.99) << ", \"p999_ns\": " << m.Percentile(0.999)
+			<< ", \"max_ns\": " << m.Percentile(1.0) << "}";
+	}
+	out << "\n]\n";
+}
+
+}	// Namespace PricingMetrics.
@@ -0,0 +1,119 @@
+// pricing_metrics.hpp
+//
+// Header file for the pricing metrics.
+// Opt-in call counters and latency histograms of the pricing entry points.
+//
+
+#ifndef PRICING_METRICS_HPP_
+#define PRICING_METRICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Instrumented entry points start with PRICING_METRIC(name, elements), name an
+// entry point label and elements the number of options the call evaluates itself
+// (0 for mesh versions, which forward to the vector version).
+// Compile with -DOPTION_PRICING_METRICS to record metrics; otherwise the macro
+// expands to nothing, the elements expression is not evaluated and the only cost
+// is an empty registry.
+// Nested entry points are recorded by each level, so a spot price vector call
+// also counts one scalar call per spot.
+#ifdef OPTION_PRICING_METRICS
+#define PRICING_METRIC_CONCAT2(a, b) a##b
+#define PRICING_METRIC_CONCAT(a, b) PRICING_METRIC_CONCAT2(a, b)
+#define PRICING_METRIC(name, elements) \
+	static PricingMetrics::Site PRICING_METRIC_CONCAT(pricingMetricSite, __LINE__)(name); \
+	PricingMetrics::Timer PRICING_METRIC_CONCAT(pricingMetricTimer, __LINE__)(PRICING_METRIC_CONCAT(pricingMetricSite, __LINE__), (elements))
+#else
+#define PRICING_METRIC(name, elements) ((void)0)
+#endif
+
+// Merged counters of one entry point.
+// bucket[i] counts calls with a latency in [BucketLow(i), BucketHigh(i)) nanoseconds;
+// buckets are log-linear, 8 per power of two (HDR style, 12.5% resolution).
+struct PricingMetricSnapshot {
+	static const size_t BUCKETS = 304;
+
+	string name;
+	uint64_t calls;
+	uint64_t elements;
+	uint64_t nanos;		// Total latency.
+	vector<uint64_t> bucket;
+
+	double Percentile(double p) const;	// Latency percentile in nanoseconds, upper bucket bound.
+	static uint64_t BucketLow(size_t i);
+	static uint64_t BucketHigh(size_t i);
+};
+
+namespace PricingMetrics {
+// Entry point registration, one static Site per instrumented function.
+class Site {
+public:
+	// Constructors & destructor.
+	Site(const char* name);	// Register the entry point.
+	virtual ~Site();	// Destructor.
+
+	// Selectors.
+	size_t Id() const;
+
+private:
+	size_t id;
+
+	// No copy.
+	Site(const Site&);
+	Site& operator = (const Site&);
+};
+
+// Scoped latency measurement of one call.
+// Counters live in per-thread blocks that only their thread writes, so recording
+// needs no lock and no atomic read-modify-write.
+class Timer {
+public:
+	// Constructors & destructor.
+	Timer(const Site& site, size_t elements);	// Start the clock.
+	virtual ~Timer();	// Destructor, records the call.
+
+private:
+	size_t id;
+	size_t elements;
+	chrono::steady_clock::time_point start;
+
+	// No copy.
+	Timer(const Timer&);
+	Timer& operator = (const Timer&);
+};
+
+const size_t MAX_SITES = 512;
+
+bool Enabled();	// Compiled with OPTION_PRICING_METRICS.
+size_t BucketIndex(uint64_t nanos);
+void Record(size_t id, size_t elements, uint64_t nanos);
+
+vector<PricingMetricSnapshot> Collect();	// Merge all threads, entry points without calls are skipped.
+void Reset();	// Zero all counters.
+void DumpPrometheus(ostream& out);	// Prometheus text exposition format.
+void DumpJson(ostream& out);
+
+}	// Namespace PricingMetrics.
+
+// Implementation of the normal inline function.
+inline size_t PricingMetrics::Site::Id() const {
+	return id;
+}
+
+inline PricingMetrics::Timer::Timer(const Site& site, size_t elements)
+	: id(site.Id()), elements(elements), start(chrono::steady_clock::now()) {
+}
+
+inline PricingMetrics::Timer::~Timer() {
+	Record(id, elements, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+#endif	// PRICING_METRICS_HPP_
@@ -0,0 +1,106 @@
+// pricing_protocol.cpp
+//
+// Wire format helpers implementation.
+//
+
+#include "pricing_protocol.hpp"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "american_option_function.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+namespace PricingProtocol {
+
+PricingRequestItem MakeItem(const OptionData& data, char style, char optType, double S) {
+	PricingRequestItem item;
+	memset(&item, 0, sizeof(item));
+	item.data = data;
+	item.S = S;
+	item.style = style;
+	item.optType = optType;
+	return item;
+}
+
+bool ValidItem(const PricingRequestItem& item) {
+	return (item.style == PRICING_EUROPEAN || item.style == PRICING_AMERICAN)
+		&& (item.optType == 'C' || item.optType == 'c' || item.optType == 'P' || item.optType == 'p');
+}
+
+void PriceItems(const PricingRequestItem* items, double* prices, size_t size) {
+	PRICING_METRIC("PricingProtocol::PriceItems(const PricingRequestItem*, double*, size_t)", size);
+	// Bucket 0/1: European call/put, bucket 2/3: American call/put.
+	vector<OptionData> data[4];
+	vector<double> spot[4];
+	vector<size_t> slot[4];
+	{
+		PricingTrace::Span span("group items", "protocol", size);
+		for (size_t i = 0; i < size; i++) {
+			if (!ValidItem(items[i])) {
+				prices[i] = numeric_limits<double>::quiet_NaN();
+				continue;
+			}
+			size_t k = (items[i].style == PRICING_AMERICAN ? 2 : 0) + ((items[i].optType == 'P' || items[i].optType == 'p') ? 1 : 0);
+			data[k].push_back(items[i].data);
+			spot[k].push_back(items[i].S);
+			slot[k].push_back(i);
+		}
+	}
+
+	vector<double> price;
+	for (size_t k = 0; k < 4; k++) {
+		if (data[k].empty())
+			continue;
+		PricingTrace::Span span("kernel", "protocol", data[k].size());
+		price.resize(data[k].size());
+		if (k == 0)
+			OptionFunction::EuropeanOptionFunction::CallPrice(data[k].data(), spot[k].data(), price.data(), price.size());
+		else if (k == 1)
+			OptionFunction::EuropeanOptionFunction::PutPrice(data[k].data(), spot[k].data(), price.data(), price.size());
+		else if (k == 2)
+			OptionFunction::AmericanOptionFunction::CallPrice(data[k].data(), spot[k].data(), price.data(), price.size());
+		else
+			OptionFunction::AmericanOptionFunction::PutPrice(data[k].data(), spot[k].data(), price.data(), price.size());
+		for (size_t j = 0; j < price.size(); j++)
+			prices[slot[k][j]] = price[j];
+	}
+}
+
+bool ReadFull(int fd, void* buf, size_t size) {
+	char* p = static_cast<char*>(buf);
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+// MSG_NOSIGNAL so a client that went away does not kill the writer with SIGPIPE.
+bool WriteFull(int fd, const void* buf, size_t size) {
+	const char* p = static_cast<const char*>(buf);
+	while (size > 0) {
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+}	// Namespace PricingProtocol.
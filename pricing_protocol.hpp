@@ -0,0 +1,62 @@
+// pricing_protocol.hpp
+//
+// Binary wire format of the local pricing service.
+// A request is a PricingRequestHeader followed by count PricingRequestItem.
+// A reply is a PricingReplyHeader followed by count doubles, in request order.
+// Both ends run on the same host, so the structs are sent as they are in memory.
+//
+
+#ifndef PRICING_PROTOCOL_HPP_
+#define PRICING_PROTOCOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include "option_data.hpp"
+
+const uint32_t PRICING_MAGIC = 0x4F505231;	// "OPR1".
+const uint32_t PRICING_MAX_ITEMS = 65536;	// Largest batch accepted in one request.
+
+// Option style of a request item.
+const char PRICING_EUROPEAN = 'E';
+const char PRICING_AMERICAN = 'A';
+
+struct PricingRequestHeader {
+	uint32_t magic;		// PRICING_MAGIC.
+	uint32_t id;		// Client chosen request id, echoed in the reply.
+	uint32_t count;		// Number of items following the header.
+	uint32_t reserved;
+};
+
+struct PricingRequestItem {
+	OptionData data;	// Option parameters.
+	double S;			// Spot price.
+	char style;			// PRICING_EUROPEAN or PRICING_AMERICAN.
+	char optType;		// 'C' or 'P'.
+	char reserved[6];
+};
+
+struct PricingReplyHeader {
+	uint32_t magic;		// PRICING_MAGIC.
+	uint32_t id;		// Id of the request.
+	uint32_t count;		// Number of prices following the header, 0 if the request was rejected.
+	uint32_t reserved;
+};
+
+namespace PricingProtocol {
+// This function fills a request item.
+PricingRequestItem MakeItem(const OptionData& data, char style, char optType, double S);
+
+// This function tells whether an item has a known style and type.
+bool ValidItem(const PricingRequestItem& item);
+
+// This function prices items with the book kernels, grouping them by style and type.
+// An item failing ValidItem gets a NaN price.
+void PriceItems(const PricingRequestItem* items, double* prices, size_t size);
+
+// These functions read or write exactly size bytes, returning false on error or end of stream.
+bool ReadFull(int fd, void* buf, size_t size);
+bool WriteFull(int fd, const void* buf, size_t size);
+
+}	// Namespace PricingProtocol.
+
+#endif	// PRICING_PROTOCOL_HPP_
@@ -0,0 +1,333 @@
+// pricing_server.cpp
+//
+// PricingServer implementation.
+//
+
+#include "pricing_server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "pricing_protocol.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+double PricingServerStats::Percentile(double p) const {
+	uint64_t total = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+		total += latency[i];
+	if (total == 0)
+		return 0.0;
+
+	double target = p * total;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += latency[i];
+		if (seen >= target)
+			return static_cast<double>(uint64_t(1) << (i + 1));
+	}
+	return static_cast<double>(uint64_t(1) << LATENCY_BUCKETS);
+}
+
+PricingServer::Connection::Connection(int fd) : fd(fd), closing(false), done(false) {
+}
+
+PricingServer::Connection::~Connection() {
+	close(fd);
+}
+
+PricingServer::PricingServer(const string& socketPath, size_t maxBatch, long maxWaitMicros)
+	: path(socketPath), maxBatch(maxBatch > 0 ? maxBatch : 1), maxWaitMicros(maxWaitMicros),
+		listenFd(-1), running(false), queuedItems(0), requests(0), items(0), batches(0), rejected(0), invalid(0), slow(0) {
+	for (size_t i = 0; i < PricingServerStats::LATENCY_BUCKETS; i++)
+		latency[i] = 0;
+}
+
+PricingServer::~PricingServer() {
+	Stop();
+}
+
+bool PricingServer::Start() {
+	if (running)
+		return true;
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		cout << "Socket path too long" << endl;
+		return false;
+	}
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		cout << "Cannot create socket" << endl;
+		return false;
+	}
+	unlink(path.c_str());	// Stale socket of a previous run.
+	if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 64) < 0) {
+		cout << "Cannot listen on " << path << endl;
+		close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+
+	running = true;
+	started = chrono::steady_clock::now();
+	batchThread = thread(&PricingServer::BatchLoop, this);
+	acceptThread = thread(&PricingServer::AcceptLoop, this);
+	return true;
+}
+
+void PricingServer::Stop() {
+	if (!running.exchange(false))
+		return;
+
+	// Wake up accept() and every blocked read().
+	shutdown(listenFd, SHUT_RDWR);
+	acceptThread.join();
+	close(listenFd);
+	listenFd = -1;
+	unlink(path.c_str());
+
+	{
+		lock_guard<mutex> lock(connLock);
+		for (size_t i = 0; i < connections.size(); i++) {
+			shutdown(connections[i]->fd, SHUT_RDWR);
+			connections[i]->reader.join();
+			connections[i]->writer.join();
+		}
+		connections.clear();
+	}
+
+	queueReady.notify_all();
+	batchThread.join();
+}
+
+PricingServerStats PricingServer::Stats() const {
+	PricingServerStats tmp;
+	tmp.requests = requests;
+	tmp.items = items;
+	tmp.batches = batches;
+	tmp.rejected = rejected;
+	tmp.invalid = invalid;
+	tmp.slow = slow;
+	for (size_t i = 0; i < PricingServerStats::LATENCY_BUCKETS; i++)
+		tmp.latency[i] = latency[i];
+	tmp.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	return tmp;
+}
+
+// Out of descriptors or memory, accept() fails again at once until a client
+// goes away: the loop backs off from 1 ms up to 100 ms between attempts.
+void PricingServer::AcceptLoop() {
+	PricingTrace::SetThreadName("accept");
+	long backoffMillis = 0;
+	while (running) {
+		int fd = accept(listenFd, 0, 0);
+		if (fd < 0) {
+			int error = errno;
+			if (!running)
+				break;	// Shut down by Stop().
+			if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+				{
+					lock_guard<mutex> lock(connLock);
+					RemoveDone();
+				}
+				backoffMillis = backoffMillis ? min(2 * backoffMillis, 100L) : 1;
+				this_thread::sleep_for(chrono::milliseconds(backoffMillis));
+				continue;
+			}
+			if (error == EINTR || error == ECONNABORTED || error == EAGAIN || error == EWOULDBLOCK || error == EPROTO)
+				continue;	// Interrupted, or the client went away first.
+			cout << "Cannot accept connections on " << path << ": " << strerror(error) << endl;
+			break;
+		}
+		backoffMillis = 0;
+
+		shared_ptr<Connection> conn(new Connection(fd));
+		lock_guard<mutex> lock(connLock);
+		if (!running)
+			break;
+		RemoveDone();
+		connections.push_back(conn);
+		conn->reader = thread(&PricingServer::ReadLoop, this, conn);
+		conn->writer = thread(&PricingServer::WriteLoop, this, conn);
+	}
+}
+
+// Forget the clients that went away, connLock held.
+void PricingServer::RemoveDone() {
+	for (size_t i = 0; i < connections.size(); ) {
+		if (connections[i]->done) {
+			connections[i]->reader.join();
+			connections[i]->writer.join();
+			connections[i] = connections.back();
+			connections.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+void PricingServer::ReadLoop(shared_ptr<Connection> conn) {
+	PricingTrace::SetThreadName("connection reader");
+	while (running) {
+		Pending req;
+		if (!PricingProtocol::ReadFull(conn->fd, &req.header, sizeof(req.header)))
+			break;
+		if (req.header.magic != PRICING_MAGIC || req.header.count > PRICING_MAX_ITEMS) {
+			rejected++;
+			break;
+		}
+		bool valid = true;
+		{
+			PricingTrace::Span span("read request", "server", req.header.count);
+			req.items.resize(req.header.count);
+			if (!PricingProtocol::ReadFull(conn->fd, req.items.data(), req.items.size() * sizeof(PricingRequestItem)))
+				break;
+			for (size_t i = 0; i < req.items.size(); i++)
+				valid = valid && PricingProtocol::ValidItem(req.items[i]);
+		}
+		if (!valid) {
+			PricingReplyHeader header;
+			memset(&header, 0, sizeof(header));
+			header.magic = PRICING_MAGIC;
+			header.id = req.header.id;
+			Reply(*conn, header, 0);
+			invalid++;
+			continue;
+		}
+		req.conn = conn;
+		req.received = chrono::steady_clock::now();
+
+		lock_guard<mutex> lock(queueLock);
+		queuedItems += req.items.size();
+		queue.push_back(req);
+		queueReady.notify_one();
+	}
+	shutdown(conn->fd, SHUT_RDWR);	// Replies still queued fail quietly.
+	{
+		lock_guard<mutex> lock(conn->writeLock);
+		conn->closing = true;
+		conn->output.clear();
+	}
+	conn->writeReady.notify_one();
+	conn->done = true;
+}
+
+// Sends the queued replies with blocking writes, only this thread waits on a
+// client that does not read.
+void PricingServer::WriteLoop(shared_ptr<Connection> conn) {
+	PricingTrace::SetThreadName("connection writer");
+	string pending;
+	for (;;) {
+		{
+			unique_lock<mutex> lock(conn->writeLock);
+			while (conn->output.empty() && !conn->closing)
+				conn->writeReady.wait(lock);
+			if (conn->closing)
+				return;
+			pending.swap(conn->output);
+		}
+		PricingTrace::Span span("write replies", "server", pending.size());
+		if (!PricingProtocol::WriteFull(conn->fd, pending.data(), pending.size())) {
+			shutdown(conn->fd, SHUT_RDWR);	// The reader sees the end and sets closing.
+			lock_guard<mutex> lock(conn->writeLock);
+			conn->output.clear();
+		}
+		pending.clear();
+	}
+}
+
+// Queues a reply on the connection, dropping it when the client is too far behind.
+void PricingServer::Reply(Connection& conn, const PricingReplyHeader& header, const double* prices) {
+	size_t bytes = sizeof(header) + header.count * sizeof(double);
+	{
+		lock_guard<mutex> lock(conn.writeLock);
+		if (conn.closing)
+			return;
+		if (conn.output.size() + bytes > PRICING_MAX_QUEUED_BYTES) {
+			shutdown(conn.fd, SHUT_RDWR);	// Slow consumer, the reader sees the end.
+			conn.closing = true;
+			conn.output.clear();
+			slow++;
+		} else {
+			conn.output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+			conn.output.append(reinterpret_cast<const char*>(prices), header.count * sizeof(double));
+		}
+	}
+	conn.writeReady.notify_one();
+}
+
+void PricingServer::BatchLoop() {
+	PricingTrace::SetThreadName("pricing batcher");
+	for (;;) {
+		vector<Pending> batch;
+		{
+			unique_lock<mutex> lock(queueLock);
+			while (queue.empty() && running)
+				queueReady.wait(lock);
+			if (queue.empty())
+				return;
+
+			// Give other clients a chance to fill the batch.
+			chrono::steady_clock::time_point deadline = queue.front().received + chrono::microseconds(maxWaitMicros);
+			while (queuedItems < maxBatch && running) {
+				if (queueReady.wait_until(lock, deadline) == cv_status::timeout)
+					break;
+			}
+
+			size_t count = 0;
+			while (!queue.empty() && (batch.empty() || count + queue.front().items.size() <= maxBatch)) {
+				count += queue.front().items.size();
+				queuedItems -= queue.front().items.size();
+				batch.push_back(queue.front());
+				queue.pop_front();
+			}
+		}
+		PriceBatch(batch);
+	}
+}
+
+void PricingServer::PriceBatch(vector<Pending>& batch) {
+	PricingTrace::Span span("batch", "server", batch.size());
+	vector<PricingRequestItem> flat;
+	{
+		PricingTrace::Span gatherSpan("gather", "server", batch.size());
+		for (size_t i = 0; i < batch.size(); i++)
+			flat.insert(flat.end(), batch[i].items.begin(), batch[i].items.end());
+	}
+	vector<double> result(flat.size());
+	{
+		PricingTrace::Span priceSpan("price", "server", flat.size());
+		PricingProtocol::PriceItems(flat.data(), result.data(), flat.size());
+	}
+
+	PricingTrace::Span replySpan("queue replies", "server", batch.size());
+	size_t offset = 0;
+	for (size_t i = 0; i < batch.size(); i++) {
+		PricingReplyHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = PRICING_MAGIC;
+		header.id = batch[i].header.id;
+		header.count = batch[i].header.count;
+		Reply(*batch[i].conn, header, result.data() + offset);
+		offset += header.count;
+
+		long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - batch[i].received).count();
+		size_t bucket = 0;
+		while (bucket + 1 < PricingServerStats::LATENCY_BUCKETS && (micros >> (bucket + 1)) > 0)
+			bucket++;
+		latency[bucket]++;
+	}
+
+	requests += batch.size();
+	items += flat.size();
+	batches++;
+}
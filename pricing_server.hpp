@@ -0,0 +1,135 @@
+// pricing_server.hpp
+//
+// Header file for Class PricingServer.
+// Local pricing service over a Unix domain socket.
+//
+
+#ifndef PRICING_SERVER_HPP_
+#define PRICING_SERVER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pricing_protocol.hpp"
+
+using namespace std;
+
+const size_t PRICING_MAX_QUEUED_BYTES = 16 << 20;	// Replies queued on a connection before it is dropped.
+
+// Counters of a running PricingServer.
+// latency[i] counts requests answered in [2^i, 2^(i+1)) microseconds after they were read.
+struct PricingServerStats {
+	static const size_t LATENCY_BUCKETS = 32;
+
+	uint64_t requests;	// Requests answered.
+	uint64_t items;		// Options priced.
+	uint64_t batches;	// Micro-batches run.
+	uint64_t rejected;	// Connections dropped on a malformed request.
+	uint64_t invalid;	// Requests answered with a rejection for an unknown style or type.
+	uint64_t slow;		// Connections dropped with too many replies not read.
+	uint64_t latency[LATENCY_BUCKETS];
+	double seconds;		// Time since Start().
+
+	double Percentile(double p) const;	// Latency percentile in microseconds, upper bucket bound.
+};
+
+// Pricing daemon.
+// Every connection gets a reader thread that queues its requests. One batcher
+// thread drains the queue, coalescing requests of all clients into a micro-batch
+// of at most maxBatch options, waiting at most maxWaitMicros for the batch to fill.
+// The batch is split by style and type into contiguous arrays for the book kernels
+// and each reply is queued on its connection as soon as its batch is priced, so
+// clients may pipeline. A writer thread per connection sends the queue, the
+// batcher never blocks on a client; a client that lets more than
+// PRICING_MAX_QUEUED_BYTES of replies pile up is dropped.
+// A request with an item of unknown style or type is answered with count 0.
+// Start the service with Start() and stop it with Stop().
+// Read the counters with Stats().
+class PricingServer {
+public:
+	// Constructors & destructor.
+	PricingServer(const string& socketPath, size_t maxBatch, long maxWaitMicros);	// Create server on socket path.
+	virtual ~PricingServer();	// Destructor, stops the server.
+
+	bool Start();	// Bind the socket and start the threads.
+	void Stop();	// Close all connections and join the threads.
+
+	// Selectors.
+	PricingServerStats Stats() const;
+	const string& SocketPath() const;
+
+private:
+	// The socket is closed with the last reference, so a batch still holding
+	// a connection never writes to a reused descriptor.
+	struct Connection {
+		int fd;
+		mutex writeLock;	// Guards output and closing.
+		condition_variable writeReady;
+		string output;		// Replies not handed to the writer yet.
+		bool closing;		// Reader finished or client dropped, writer leaves.
+		thread reader;
+		thread writer;
+		atomic<bool> done;	// Reader finished, ready to be joined.
+		Connection(int fd);
+		~Connection();
+	};
+
+	struct Pending {
+		shared_ptr<Connection> conn;
+		PricingRequestHeader header;
+		vector<PricingRequestItem> items;
+		chrono::steady_clock::time_point received;
+	};
+
+	string path;
+	size_t maxBatch;
+	long maxWaitMicros;
+	int listenFd;
+	atomic<bool> running;
+	chrono::steady_clock::time_point started;
+
+	thread acceptThread;
+	thread batchThread;
+	mutex connLock;
+	vector<shared_ptr<Connection> > connections;
+
+	mutex queueLock;
+	condition_variable queueReady;
+	deque<Pending> queue;
+	size_t queuedItems;
+
+	atomic<uint64_t> requests;
+	atomic<uint64_t> items;
+	atomic<uint64_t> batches;
+	atomic<uint64_t> rejected;
+	atomic<uint64_t> invalid;
+	atomic<uint64_t> slow;
+	atomic<uint64_t> latency[PricingServerStats::LATENCY_BUCKETS];
+
+	// No copy.
+	PricingServer(const PricingServer&);
+	PricingServer& operator = (const PricingServer&);
+
+	void AcceptLoop();
+	void RemoveDone();
+	void ReadLoop(shared_ptr<Connection> conn);
+	void WriteLoop(shared_ptr<Connection> conn);
+	void Reply(Connection& conn, const PricingReplyHeader& header, const double* prices);
+	void BatchLoop();
+	void PriceBatch(vector<Pending>& batch);
+};
+
+// Implementation of the normal inline function.
+inline const string& PricingServer::SocketPath() const {
+	return path;
+}
+
+#endif	// PRICING_SERVER_HPP_
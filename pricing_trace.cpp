@@ -0,0 +1,243 @@
+// pricing_trace.cpp
+//
+// Pricing trace implementation.
+//
+
+#include "pricing_trace.hpp"
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace PricingTrace {
+
+atomic<bool> tracing(false);
+
+// One ring buffer slot. seq is 2 n + 1 while span n is written and 2 n + 2 once
+// it is complete, so a reader can tell a torn slot from a finished one.
+struct TraceSlot {
+	atomic<uint64_t> seq;
+	atomic<const char*> name;
+	atomic<const char*> category;
+	atomic<uint64_t> start;
+	atomic<uint64_t> end;
+	atomic<uint64_t> items;
+};
+
+// Ring buffer of one thread, written by that thread only.
+struct TraceBuffer {
+	vector<TraceSlot> slot;
+	atomic<uint64_t> head;			// Spans written.
+	atomic<uint64_t> clearedBefore;	// Spans before this one were cleared.
+	atomic<bool> retired;			// Thread exited.
+	size_t tid;
+	string threadName;				// Guarded by the registry lock.
+
+	TraceBuffer(size_t size, size_t tid) : slot(size), head(0), clearedBefore(0), retired(false), tid(tid) {
+		for (size_t i = 0; i < size; i++)
+			slot[i].seq.store(0, memory_order_relaxed);
+	}
+};
+
+struct TraceRegistry {
+	mutex lock;
+	vector<TraceBuffer*> buffers;
+	size_t eventsPerThread;
+	size_t nextTid;
+	uint64_t epoch;		// Time zero of the export.
+
+	TraceRegistry() : eventsPerThread(DEFAULT_EVENTS_PER_THREAD), nextTid(1), epoch(0) {
+	}
+};
+
+// Never destroyed, threads may exit after static destruction started.
+static TraceRegistry& GetRegistry() {
+	static TraceRegistry* registry = new TraceRegistry;
+	return *registry;
+}
+
+// Buffer of the current thread. A plain pointer, so it stays usable while
+// the thread_local objects are destroyed at thread exit.
+static thread_local TraceBuffer* current = 0;
+static thread_local bool exited = false;	// The holder below is destroyed.
+
+// Retires the buffer of the current thread when the thread exits, the buffer
+// is kept for export until the next Clear(). current is reset first, so a
+// span recorded later in the exit (by the destructor of another thread_local)
+// goes to a new buffer instead of one that Clear() may free.
+struct TraceHolder {
+	string threadName;	// Name set before the first span.
+
+	TraceHolder() {
+	}
+
+	~TraceHolder() {
+		TraceBuffer* buffer = current;
+		current = 0;
+		exited = true;
+		if (buffer)
+			buffer->retired.store(true, memory_order_release);
+	}
+};
+
+static thread_local TraceHolder holder;
+
+static TraceBuffer* ThreadBuffer() {
+	if (!current) {
+		TraceRegistry& registry = GetRegistry();
+		lock_guard<mutex> guard(registry.lock);
+		current = new TraceBuffer(registry.eventsPerThread, registry.nextTid++);
+		if (!exited)
+			current->threadName = holder.threadName;
+		registry.buffers.push_back(current);
+	}
+	return current;
+}
+
+void Enable(bool on, size_t eventsPerThread) {
+	TraceRegistry& registry = GetRegistry();
+	{
+		lock_guard<mutex> guard(registry.lock);
+		registry.eventsPerThread = eventsPerThread ? eventsPerThread : 1;
+		if (on && registry.epoch == 0)
+			registry.epoch = Now();
+	}
+	tracing.store(on, memory_order_relaxed);
+}
+
+// Threads that never record a span do not get a buffer.
+void SetThreadName(const string& name) {
+	lock_guard<mutex> guard(GetRegistry().lock);
+	holder.threadName = name;
+	if (current)
+		current->threadName = name;
+}
+
+uint64_t Now() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Record(const char* name, const char* category, uint64_t start, uint64_t end, uint64_t items) {
+	TraceBuffer* buffer = ThreadBuffer();
+	uint64_t n = buffer->head.load(memory_order_relaxed);
+	TraceSlot& slot = buffer->slot[n % buffer->slot.size()];
+	slot.seq.store(2 * n + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot.name.store(name, memory_order_relaxed);
+	slot.category.store(category, memory_order_relaxed);
+	slot.start.store(start, memory_order_relaxed);
+	slot.end.store(end, memory_order_relaxed);
+	slot.items.store(items, memory_order_relaxed);
+	slot.seq.store(2 * n + 2, memory_order_release);
+	buffer->head.store(n + 1, memory_order_release);
+}
+
+void Clear() {
+	TraceRegistry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	vector<TraceBuffer*> live;
+	for (size_t i = 0; i < registry.buffers.size(); i++) {
+		TraceBuffer* buffer = registry.buffers[i];
+		if (buffer->retired.load(memory_order_acquire)) {
+			delete buffer;	// Its thread no longer points to it, see TraceHolder.
+		} else {
+			buffer->clearedBefore.store(buffer->head.load(memory_order_acquire), memory_order_relaxed);
+			live.push_back(buffer);
+		}
+	}
+	registry.buffers.swap(live);
+	registry.epoch = Now();
+}
+
+size_t Dropped() {
+	TraceRegistry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	size_t tmp = 0;
+	for (size_t i = 0; i < registry.buffers.size(); i++) {
+		const TraceBuffer* buffer = registry.buffers[i];
+		uint64_t written = buffer->head.load(memory_order_acquire) - buffer->clearedBefore.load(memory_order_relaxed);
+		if (written > buffer->slot.size())
+			tmp += written - buffer->slot.size();
+	}
+	return tmp;
+}
+
+// Escape backslash and double quote for JSON strings.
+static string Escape(const char* text) {
+	string tmp;
+	for (; *text; text++) {
+		if (*text == '\\' || *text == '"')
+			tmp += '\\';
+		tmp += *text;
+	}
+	return tmp;
+}
+
+void WriteChromeTrace(ostream& out) {
+	TraceRegistry& registry = GetRegistry();
+	lock_guard<mutex> guard(registry.lock);
+	int pid = getpid();
+	bool first = true;
+	out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+	streamsize precision = out.precision(3);
+	out << fixed;
+	for (size_t b = 0; b < registry.buffers.size(); b++) {
+		const TraceBuffer* buffer = registry.buffers[b];
+		if (!buffer->threadName.empty()) {
+			out << (first ? "\n" : ",\n") << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << pid << ", \"tid\": " << buffer->tid
+				<< ", \"args\": {\"name\": \"" << Escape(buffer->threadName.c_str()) << "\"}}";
+			first = false;
+		}
+
+		uint64_t head = buffer->head.load(memory_order_acquire);
+		uint64_t from = buffer->clearedBefore.load(memory_order_relaxed);
+		if (head - from > buffer->slot.size())
+			from = head - buffer->slot.size();
+		for (uint64_t n = from; n < head; n++) {
+			const TraceSlot& slot = buffer->slot[n % buffer->slot.size()];
+			uint64_t seq = slot.seq.load(memory_order_acquire);
+			const char* name = slot.name.load(memory_order_relaxed);
+			const char* category = slot.category.load(memory_order_relaxed);
+			uint64_t start = slot.start.load(memory_order_relaxed);
+			uint64_t end = slot.end.load(memory_order_relaxed);
+			uint64_t items = slot.items.load(memory_order_relaxed);
+			atomic_thread_fence(memory_order_acquire);
+			if (seq != 2 * n + 2 || slot.seq.load(memory_order_relaxed) != seq)
+				continue;	// Overwritten while reading.
+			if (start < registry.epoch)
+				continue;
+
+			out << (first ? "\n" : ",\n") << "{\"ph\": \"X\", \"name\": \"" << Escape(name) << "\", \"cat\": \"" << Escape(category)
+				<< "\", \"pid\": " << pid << ", \"tid\": " << buffer->tid << ", \"ts\": " << (start - registry.epoch) * 1e-3
+				<< ", \"dur\": " << (end - start) * 1e-3;
+			if (items)
+				out << ", \"args\": {\"items\": " << items << "}";
+			out << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	out.unsetf(ios::floatfield);
+	out.precision(precision);
+}
+
+bool SaveChromeTrace(const string& fileName) {
+	ofstream out(fileName.c_str());
+	if (!out) {
+		cout << "Cannot open trace file " << fileName << endl;
+		return false;
+	}
+	WriteChromeTrace(out);
+	return bool(out);
+}
+
+}	// Namespace PricingTrace.
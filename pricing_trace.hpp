@@ -0,0 +1,75 @@
+// pricing_trace.hpp
+//
+// Header file for the pricing trace.
+// Scoped spans of batch pricing stages, exported as Chrome trace events.
+//
+
+#ifndef PRICING_TRACE_HPP_
+#define PRICING_TRACE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+// Spans are recorded into per-thread ring buffers of fixed size, the oldest
+// spans are overwritten. Recording is off until Enable(true); a disabled span
+// costs one relaxed load. Names and categories must be string literals or
+// otherwise outlive the export.
+// Export with WriteChromeTrace(ostream&) or SaveChromeTrace(const string&) and
+// open the file in a Chrome trace viewer (chrome://tracing or Perfetto).
+namespace PricingTrace {
+const size_t DEFAULT_EVENTS_PER_THREAD = 16384;
+
+// Scoped span, recorded as one complete event when it goes out of scope.
+// items is shown as an argument of the event when not 0.
+class Span {
+public:
+	// Constructors & destructor.
+	Span(const char* name, const char* category = "pricing", uint64_t items = 0);	// Start the span.
+	virtual ~Span();	// Destructor, records the span.
+
+private:
+	const char* name;
+	const char* category;
+	uint64_t items;
+	uint64_t start;		// 0 when tracing was off at the start.
+
+	// No copy.
+	Span(const Span&);
+	Span& operator = (const Span&);
+};
+
+extern atomic<bool> tracing;	// Use Enabled().
+
+void Enable(bool on, size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);	// Buffer size of threads that record their first span afterwards.
+bool Enabled();
+void SetThreadName(const string& name);	// Name of the current thread in the viewer.
+uint64_t Now();	// Trace clock in nanoseconds.
+void Record(const char* name, const char* category, uint64_t start, uint64_t end, uint64_t items);
+
+void Clear();	// Drop the recorded spans, buffers of exited threads are freed.
+size_t Dropped();	// Spans overwritten before an export since the last Clear().
+void WriteChromeTrace(ostream& out);
+bool SaveChromeTrace(const string& fileName);
+
+}	// Namespace PricingTrace.
+
+// Implementation of the normal inline function.
+inline bool PricingTrace::Enabled() {
+	return tracing.load(memory_order_relaxed);
+}
+
+inline PricingTrace::Span::Span(const char* name, const char* category, uint64_t items)
+	: name(name), category(category), items(items), start(Enabled() ? Now() : 0) {
+}
+
+inline PricingTrace::Span::~Span() {
+	if (start != 0)
+		Record(name, category, start, Now(), items);
+}
+
+#endif	// PRICING_TRACE_HPP_
@@ -0,0 +1,96 @@
+// quasi_random.hpp
+//
+// Header file for Class SobolSequence and Class BrownianBridge.
+// Quasi-random paths: scrambled Sobol points, inverse normal transform and
+// Brownian bridge construction.
+//
+
+#ifndef QUASI_RANDOM_HPP_
+#define QUASI_RANDOM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Sobol sequence.
+// Points of up to MAX_DIMENSIONS dimensions from the Joe-Kuo direction numbers
+// (new-joe-kuo-6.21201, dimensions 2 to 1024), 32 bits, at most 2^32 points.
+// With a nonzero scramble seed every dimension gets a random lower triangular
+// linear scramble (Matousek) and a random digital shift, so independent seeds
+// give independent randomized point sets with the same low discrepancy, and
+// the spread of estimates over seeds measures the error. Points are returned
+// as (x + 1/2) 2^-32, strictly inside (0, 1).
+// Next() walks the sequence in Gray code order, one XOR per dimension;
+// Skip(index) jumps to any index in O(32 dimensions), so threads draw disjoint
+// blocks from copies of one sequence.
+class SobolSequence {
+public:
+	static const size_t MAX_DIMENSIONS = 1024;
+
+	// Constructors & destructor.
+	SobolSequence(size_t dimensions, uint64_t scramble = 0);	// No scrambling for 0.
+	virtual ~SobolSequence();	// Destructor.
+
+	void Skip(uint64_t index);	// The next point is point index.
+	void Next(double* point);	// Dimensions() values.
+	void Next(double* points, size_t count);	// count points, one after the other.
+
+	// Selectors.
+	size_t Dimensions() const;
+	uint64_t Index() const;	// Index of the next point.
+
+private:
+	size_t dimensions;
+	uint64_t index;
+	vector<uint32_t> direction;	// 32 per dimension.
+	vector<uint32_t> shift;
+	vector<uint32_t> state;		// Point index, scrambled.
+};
+
+// Brownian bridge.
+// Builds a Brownian path on steps equal steps up to time T from steps normals,
+// the first normal fixing the end point, the next ones the midpoints of the
+// widest gaps (Jaeckel's construction). With quasi-random normals the first
+// dimensions, the best distributed ones, then carry most of the path variance.
+class BrownianBridge {
+public:
+	// Constructors & destructor.
+	BrownianBridge(size_t steps, double T);
+	virtual ~BrownianBridge();	// Destructor.
+
+	void Path(const double* z, double* W) const;			// W(T k / steps), k = 1 .. steps.
+	void Increments(const double* z, double* dW) const;	// W(T (k + 1) / steps) - W(T k / steps).
+
+	// Selectors.
+	size_t Steps() const;
+
+private:
+	size_t steps;
+	vector<size_t> bridge, left, right;	// Point built by step i and its neighbours (left 0 means the start).
+	vector<double> leftWeight, rightWeight, sd;
+};
+
+namespace OptionFunction {
+namespace QuasiRandom {
+// Inverse normal cdf of size values in (0, 1), see SimdMath::InverseNormal.
+void InverseNormal(const double* u, double* z, size_t size);
+
+}	// Namespace QuasiRandom.
+}	// Namespace OptionFunction.
+
+// Implementation of the normal inline function.
+inline size_t SobolSequence::Dimensions() const {
+	return dimensions;
+}
+
+inline uint64_t SobolSequence::Index() const {
+	return index;
+}
+
+inline size_t BrownianBridge::Steps() const {
+	return steps;
+}
+
+#endif	// QUASI_RANDOM_HPP_
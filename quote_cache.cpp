@@ -0,0 +1,178 @@
+// quote_cache.cpp
+//
+// QuoteCache implementation.
+//
+
+#include "quote_cache.hpp"
+#include <cmath>
+#include <cstring>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "option_data.hpp"
+
+using namespace std;
+
+QuoteTolerance::QuoteTolerance() : spotAbsolute(0.0), spotRelative(0.0), paramStep(0.0) {
+}
+
+bool QuoteCache::Key::operator == (const Key& other) const {
+	return memcmp(field, other.field, sizeof(field)) == 0 && exact == other.exact && style == other.style && optType == other.optType;
+}
+
+// Multiply-xorshift mix of the fields, then the MurmurHash3 finalizer: the
+// shard is the hash modulo the shard count, so the low bits must depend on
+// every bit of the fields.
+size_t QuoteCache::KeyHash::operator () (const Key& key) const {
+	uint64_t h = (uint64_t(key.exact) << 16) | (uint64_t(uint8_t(key.style)) << 8) | uint8_t(key.optType);
+	for (size_t i = 0; i < 8; i++) {
+		h ^= uint64_t(key.field[i]) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+		h *= 0xBF58476D1CE4E5B9ULL;
+		h ^= h >> 31;
+	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return static_cast<size_t>(h);
+}
+
+QuoteCache::QuoteCache(size_t capacity, size_t shardCount, const QuoteTolerance& tolerance)
+	: tolerance(tolerance), capacity(capacity), hits(0), misses(0), evictions(0) {
+	if (shardCount == 0)
+		shardCount = 1;
+	shardCapacity = (capacity + shardCount - 1) / shardCount;
+	if (shardCapacity == 0)
+		shardCapacity = 1;
+	for (size_t i = 0; i < shardCount; i++)
+		shards.push_back(new Shard);
+}
+
+QuoteCache::~QuoteCache() {
+	for (size_t i = 0; i < shards.size(); i++)
+		delete shards[i];
+}
+
+double QuoteCache::Price(const EuropeanOption& option, double S) {
+	Key key = MakeKey(option.Get(), 'E', option.OptType(), S);
+	double price;
+	if (Find(key, price))
+		return price;
+	price = option.Price(S);
+	Insert(key, price);
+	return price;
+}
+
+vector<double> QuoteCache::Price(const EuropeanOption& option, const vector<double>& S) {
+	vector<double> tmp;
+	vector<double>::const_iterator it;
+	for (it = S.begin(); it != S.end(); it++) {
+		tmp.push_back(Price(option, *it));
+	}
+	return tmp;
+}
+
+double QuoteCache::Price(const AmericanOption& option, double S) {
+	Key key = MakeKey(option.Get(), 'A', option.OptType(), S);
+	double price;
+	if (Find(key, price))
+		return price;
+	price = option.Price(S);
+	Insert(key, price);
+	return price;
+}
+
+vector<double> QuoteCache::Price(const AmericanOption& option, const vector<double>& S) {
+	vector<double> tmp;
+	vector<double>::const_iterator it;
+	for (it = S.begin(); it != S.end(); it++) {
+		tmp.push_back(Price(option, *it));
+	}
+	return tmp;
+}
+
+QuoteCacheStats QuoteCache::Stats() const {
+	QuoteCacheStats tmp;
+	tmp.hits = hits;
+	tmp.misses = misses;
+	tmp.evictions = evictions;
+	tmp.size = 0;
+	for (size_t i = 0; i < shards.size(); i++) {
+		lock_guard<mutex> lock(shards[i]->lock);
+		tmp.size += shards[i]->lru.size();
+	}
+	return tmp;
+}
+
+void QuoteCache::Clear() {
+	for (size_t i = 0; i < shards.size(); i++) {
+		lock_guard<mutex> lock(shards[i]->lock);
+		shards[i]->index.clear();
+		shards[i]->lru.clear();
+	}
+}
+
+// Bucket index q as a key field when it is finite and well inside the int64
+// range, else the bit pattern of x with exact set, so only identical values match.
+static int64_t Bucket(double q, double x, bool& exact) {
+	exact = !(fabs(q) < 4611686018427387904.0);	// 2^62, false for NaN.
+	if (!exact)
+		return static_cast<int64_t>(q);
+	int64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return bits;
+}
+
+// Without a step the bit pattern is the key.
+int64_t QuoteCache::Quantize(double x, bool& exact) const {
+	return Bucket(tolerance.paramStep > 0.0 ? floor(x / tolerance.paramStep + 0.5) : HUGE_VAL, x, exact);
+}
+
+QuoteCache::Key QuoteCache::MakeKey(const OptionData& data, char style, const string& optType, double S) const {
+	Key key;
+	const double value[7] = { data.T, data.K, data.sig, data.r, data.b, data.t, data.q };
+	bool exact[8];
+	for (size_t i = 0; i < 7; i++)
+		key.field[i] = Quantize(value[i], exact[i]);
+	double bucket = HUGE_VAL;
+	if (tolerance.spotRelative > 0.0 && S > 0.0)
+		bucket = floor(log(S) / log1p(tolerance.spotRelative));
+	else if (tolerance.spotAbsolute > 0.0)
+		bucket = floor(S / tolerance.spotAbsolute);
+	key.field[7] = Bucket(bucket, S, exact[7]);
+	key.exact = 0;
+	for (size_t i = 0; i < 8; i++)
+		key.exact |= uint8_t(exact[i]) << i;
+	key.style = style;
+	key.optType = optType.empty() ? 'C' : optType[0];
+	return key;
+}
+
+bool QuoteCache::Find(const Key& key, double& price) {
+	Shard& shard = *shards[KeyHash()(key) % shards.size()];
+	lock_guard<mutex> lock(shard.lock);
+	unordered_map<Key, LruList::iterator, KeyHash>::iterator it = shard.index.find(key);
+	if (it == shard.index.end()) {
+		misses++;
+		return false;
+	}
+	shard.lru.splice(shard.lru.begin(), shard.lru, it->second);	// Move to front.
+	price = it->second->second;
+	hits++;
+	return true;
+}
+
+// Another thread may have priced the same key meanwhile, the first quote stays.
+void QuoteCache::Insert(const Key& key, double price) {
+	Shard& shard = *shards[KeyHash()(key) % shards.size()];
+	lock_guard<mutex> lock(shard.lock);
+	if (shard.index.find(key) != shard.index.end())
+		return;
+	shard.lru.push_front(make_pair(key, price));
+	shard.index[key] = shard.lru.begin();
+	if (shard.lru.size() > shardCapacity) {
+		shard.index.erase(shard.lru.back().first);
+		shard.lru.pop_back();
+		evictions++;
+	}
+}
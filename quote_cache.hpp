@@ -0,0 +1,117 @@
+// quote_cache.hpp
+//
+// Header file for Class QuoteCache.
+// Memoization of option prices keyed by contract parameters and spot.
+//
+
+#ifndef QUOTE_CACHE_HPP_
+#define QUOTE_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "option_data.hpp"
+
+using namespace std;
+
+// What counts as the same quote.
+// Spot prices are grouped in buckets: of relative width spotRelative (log spaced)
+// when it is positive, else of absolute width spotAbsolute when it is positive,
+// else only identical spot prices match. OptionData fields are compared after
+// rounding to paramStep when it is positive, else exactly.
+// A hit returns the price computed for the first spot seen in the bucket, so the
+// pricing error of a hit is bounded by delta times the bucket width.
+struct QuoteTolerance {
+	double spotAbsolute;
+	double spotRelative;
+	double paramStep;
+
+	QuoteTolerance();	// Exact matching.
+};
+
+// Counters of a QuoteCache.
+struct QuoteCacheStats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t size;	// Quotes held.
+};
+
+// Concurrent memoization layer in front of EuropeanOption::Price and AmericanOption::Price.
+// Quotes are spread over shards by key hash, each shard being an LRU list with
+// its own lock and capacity / shards entries. Pricing runs outside the lock.
+// Access a price with Price(const EuropeanOption&, double) or Price(const AmericanOption&, double).
+// Read the counters with Stats() and drop all quotes with Clear().
+class QuoteCache {
+public:
+	// Constructors & destructor.
+	QuoteCache(size_t capacity, size_t shards = 16, const QuoteTolerance& tolerance = QuoteTolerance());	// Create cache.
+	virtual ~QuoteCache();	// Destructor.
+
+	double Price(const EuropeanOption& option, double S);
+	vector<double> Price(const EuropeanOption& option, const vector<double>& S);
+	double Price(const AmericanOption& option, double S);
+	vector<double> Price(const AmericanOption& option, const vector<double>& S);
+
+	QuoteCacheStats Stats() const;
+	void Clear();
+
+	// Selectors.
+	const QuoteTolerance& Tolerance() const;
+	size_t Capacity() const;
+
+private:
+	struct Key {
+		int64_t field[8];	// Quantized T, K, sig, r, b, t, q and spot bucket.
+		uint8_t exact;		// Bit i set when field[i] is the bit pattern of the value.
+		char style;
+		char optType;
+		bool operator == (const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator () (const Key& key) const;
+	};
+
+	typedef list<pair<Key, double> > LruList;
+
+	struct Shard {
+		mutex lock;
+		LruList lru;	// Most recently used first.
+		unordered_map<Key, LruList::iterator, KeyHash> index;
+	};
+
+	QuoteTolerance tolerance;
+	size_t capacity;
+	size_t shardCapacity;
+	vector<Shard*> shards;
+	atomic<uint64_t> hits;
+	atomic<uint64_t> misses;
+	atomic<uint64_t> evictions;
+
+	// No copy.
+	QuoteCache(const QuoteCache&);
+	QuoteCache& operator = (const QuoteCache&);
+
+	Key MakeKey(const OptionData& data, char style, const string& optType, double S) const;
+	int64_t Quantize(double x, bool& exact) const;
+	bool Find(const Key& key, double& price);
+	void Insert(const Key& key, double price);
+};
+
+// Implementation of the normal inline function.
+inline const QuoteTolerance& QuoteCache::Tolerance() const {
+	return tolerance;
+}
+
+inline size_t QuoteCache::Capacity() const {
+	return capacity;
+}
+
+#endif	// QUOTE_CACHE_HPP_
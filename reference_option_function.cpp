@@ -0,0 +1,78 @@
+// reference_option_function.cpp
+//
+// Functions implementation.
+//
+
+#include <cmath>
+#include "option_data.hpp"
+#include "reference_option_function.hpp"
+
+using namespace std;
+
+namespace OptionFunction {
+namespace ReferenceOptionFunction {
+
+long double n(long double x) {
+	return expl(-0.5L * x * x) * 0.398942280401432677939946059934381868L;
+}
+
+// N(x) = erfc(-x / sqrt(2)) / 2, no cancellation in the lower tail.
+long double N(long double x) {
+	return 0.5L * erfcl(-x * 0.707106781186547524400844362104849039L);
+}
+
+long double CallPrice(const OptionData& option, long double S) {
+	long double tau = (long double)option.T - option.t;
+	long double tmp = option.sig * sqrtl(tau);
+	long double d1 = (logl(S / option.K) + (option.b + 0.5L * option.sig * option.sig) * tau) / tmp;
+	long double d2 = d1 - tmp;
+	return S * expl((option.b - (long double)option.r) * tau) * N(d1) - option.K * expl(-option.r * tau) * N(d2);
+}
+
+long double PutPrice(const OptionData& option, long double S) {
+	long double tau = (long double)option.T - option.t;
+	long double tmp = option.sig * sqrtl(tau);
+	long double d1 = (logl(S / option.K) + (option.b + 0.5L * option.sig * option.sig) * tau) / tmp;
+	long double d2 = d1 - tmp;
+	return option.K * expl(-option.r * tau) * N(-d2) - S * expl((option.b - (long double)option.r) * tau) * N(-d1);
+}
+
+long double CallDelta(const OptionData& option, long double S) {
+	long double tau = (long double)option.T - option.t;
+	long double tmp = option.sig * sqrtl(tau);
+	long double d1 = (logl(S / option.K) + (option.b + 0.5L * option.sig * option.sig) * tau) / tmp;
+	return expl((option.b - (long double)option.r) * tau) * N(d1);
+}
+
+long double PutDelta(const OptionData& option, long double S) {
+	long double tau = (long double)option.T - option.t;
+	long double tmp = option.sig * sqrtl(tau);
+	long double d1 = (logl(S / option.K) + (option.b + 0.5L * option.sig * option.sig) * tau) / tmp;
+	return -expl((option.b - (long double)option.r) * tau) * N(-d1);
+}
+
+long double Gamma(const OptionData& option, long double S) {
+	long double tau = (long double)option.T - option.t;
+	long double tmp = option.sig * sqrtl(tau);
+	long double d1 = (logl(S / option.K) + (option.b + 0.5L * option.sig * option.sig) * tau) / tmp;
+	return expl((option.b - (long double)option.r) * tau) * n(d1) / (S * tmp);
+}
+
+long double AmericanCallPrice(const OptionData& option, long double S) {
+	long double sig2 = (long double)option.sig * option.sig;
+	long double tmp = option.b / sig2;
+	long double y1 = 0.5L - tmp + sqrtl((tmp - 0.5L) * (tmp - 0.5L) + 2.0L * option.r / sig2);
+	if (1.0L == y1)
+		return S;
+	return option.K / (y1 - 1.0L) * powl((y1 - 1.0L) / y1 * S / option.K, y1);
+}
+
+long double AmericanPutPrice(const OptionData& option, long double S) {
+	long double sig2 = (long double)option.sig * option.sig;
+	long double tmp = option.b / sig2;
+	long double y2 = 0.5L - tmp - sqrtl((tmp - 0.5L) * (tmp - 0.5L) + 2.0L * option.r / sig2);
+	return option.K / (1.0L - y2) * powl((y2 - 1.0L) / y2 * S / option.K, y2);
+}
+
+}	// Namespace ReferenceOptionFunction.
+}	// Namespace OptionFunction.
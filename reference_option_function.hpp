@@ -0,0 +1,38 @@
+// reference_option_function.hpp
+//
+// Header file for reference option functions.
+// Extended precision prices and greeks used to measure the accuracy of the fast kernels.
+//
+
+#ifndef REFERENCE_OPTION_FUNCTION_HPP_
+#define REFERENCE_OPTION_FUNCTION_HPP_
+
+#include "option_data.hpp"
+
+using namespace std;
+
+namespace OptionFunction {
+namespace ReferenceOptionFunction {
+// All functions evaluate the double kernel formulas in long double
+// (64 bit mantissa on x86), with time to expiry T - t. N(x) uses erfcl, so both
+// tails keep full relative precision.
+
+// Gaussian distribution.
+long double n(long double x);	// Pdf(x).
+long double N(long double x);	// Cdf(x).
+
+// European options, generalized Black-Scholes with cost of carry b.
+long double CallPrice(const OptionData& option, long double S);
+long double PutPrice(const OptionData& option, long double S);
+long double CallDelta(const OptionData& option, long double S);
+long double PutDelta(const OptionData& option, long double S);
+long double Gamma(const OptionData& option, long double S);	// Call and put gamma.
+
+// Perpetual American options.
+long double AmericanCallPrice(const OptionData& option, long double S);
+long double AmericanPutPrice(const OptionData& option, long double S);
+
+}	// Namespace ReferenceOptionFunction.
+}	// Namespace OptionFunction.
+
+#endif	// REFERENCE_OPTION_FUNCTION_HPP_
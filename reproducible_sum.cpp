@@ -0,0 +1,133 @@
+// reproducible_sum.cpp
+//
+// Reproducible sum implementation.
+//
+
+#include "reproducible_sum.hpp"
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+namespace OptionFunction {
+namespace ReproducibleSum {
+
+// Unevaluated sum hi + lo, |lo| <= ulp(hi) / 2.
+struct DoubleDouble {
+	double hi;
+	double lo;
+};
+
+// a + b in double-double, TwoSum of the high parts. A non finite sum is
+// passed on alone so infinities and NaN propagate as in a plain sum.
+static DoubleDouble Add(const DoubleDouble& a, const DoubleDouble& b) {
+	double s = a.hi + b.hi;
+	if (!isfinite(s)) {
+		DoubleDouble tmp = { s, 0.0 };
+		return tmp;
+	}
+	double bb = s - a.hi;
+	double e = (a.hi - (s - bb)) + (b.hi - bb) + (a.lo + b.lo);
+	DoubleDouble tmp;
+	tmp.hi = s + e;
+	tmp.lo = e - (tmp.hi - s);
+	return tmp;
+}
+
+// Block of size <= BLOCK elements, x[i * stride], in four interleaved lanes.
+static DoubleDouble BlockSum(const double* x, size_t size, size_t stride) {
+	double lane[4] = { 0.0, 0.0, 0.0, 0.0 };
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4) {
+		lane[0] += x[i * stride];
+		lane[1] += x[(i + 1) * stride];
+		lane[2] += x[(i + 2) * stride];
+		lane[3] += x[(i + 3) * stride];
+	}
+	for (; i < size; i++)
+		lane[i % 4] += x[i * stride];
+
+	DoubleDouble a = { lane[0], 0.0 }, b = { lane[1], 0.0 }, c = { lane[2], 0.0 }, d = { lane[3], 0.0 };
+	return Add(Add(a, b), Add(c, d));
+}
+
+// Pairwise tree over the block sums in place, neighbours first.
+static double Tree(DoubleDouble* partial, size_t size) {
+	if (size == 0)
+		return 0.0;
+	while (size > 1) {
+		for (size_t k = 0; k < size / 2; k++)
+			partial[k] = Add(partial[2 * k], partial[2 * k + 1]);
+		if (size % 2)
+			partial[size / 2] = partial[size - 1];
+		size = (size + 1) / 2;
+	}
+	return partial[0].hi;
+}
+
+// Block sums of blocks [first, last) of every column, element (i, c) at x[i * stride + c].
+// partial holds the blocks of column c at [c * blocks, (c + 1) * blocks).
+static void Blocks(const double* x, size_t rows, size_t columns, size_t stride, size_t first, size_t last, DoubleDouble* partial) {
+	PricingTrace::Span span("sum chunk", "reduce", (last - first) * BLOCK);
+	size_t blocks = (rows + BLOCK - 1) / BLOCK;
+	for (size_t n = first; n < last; n++) {
+		size_t begin = n * BLOCK;
+		size_t size = rows - begin < BLOCK ? rows - begin : BLOCK;
+		for (size_t c = 0; c < columns; c++)
+			partial[c * blocks + n] = BlockSum(x + begin * stride + c, size, stride);
+	}
+}
+
+// Column sums, the block order and tree are the same for every thread count.
+static vector<double> Reduce(const double* x, size_t rows, size_t columns, size_t stride, size_t threads) {
+	size_t blocks = (rows + BLOCK - 1) / BLOCK;
+	vector<DoubleDouble> partial(blocks * columns);
+	if (threads == 0)
+		threads = thread::hardware_concurrency();
+	if (threads > blocks)
+		threads = blocks;
+	if (threads <= 1)
+		Blocks(x, rows, columns, stride, 0, blocks, partial.data());
+	else {
+		vector<thread> workers;
+		for (size_t t = 1; t < threads; t++)
+			workers.push_back(thread(Blocks, x, rows, columns, stride, t * blocks / threads, (t + 1) * blocks / threads, partial.data()));
+		Blocks(x, rows, columns, stride, 0, blocks / threads, partial.data());
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+	}
+
+	vector<double> tmp(columns);
+	for (size_t c = 0; c < columns; c++)
+		tmp[c] = Tree(&partial[c * blocks], blocks);
+	return tmp;
+}
+
+double Sum(const double* x, size_t size, size_t stride) {
+	if (size <= BLOCK)	// One block, no tree.
+		return size ? BlockSum(x, size, stride).hi : 0.0;
+	return Reduce(x, size, 1, stride, 1)[0];
+}
+
+double Sum(const vector<double>& x) {
+	return Sum(x.data(), x.size());
+}
+
+double ParallelSum(const double* x, size_t size, size_t threads, size_t stride) {
+	if (size <= BLOCK)
+		return Sum(x, size, stride);
+	return Reduce(x, size, 1, stride, threads)[0];
+}
+
+double ParallelSum(const vector<double>& x, size_t threads) {
+	return ParallelSum(x.data(), x.size(), threads);
+}
+
+vector<double> ColumnSums(const double* x, size_t rows, size_t columns, size_t threads) {
+	return Reduce(x, rows, columns, columns, threads);
+}
+
+}	// Namespace ReproducibleSum.
+}	// Namespace OptionFunction.
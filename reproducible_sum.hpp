@@ -0,0 +1,43 @@
+// reproducible_sum.hpp
+//
+// Header file for the reproducible sums.
+// Bit identical book totals for any thread count.
+//
+
+#ifndef REPRODUCIBLE_SUM_HPP_
+#define REPRODUCIBLE_SUM_HPP_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Floating point addition is not associative, so a parallel sum whose order
+// follows the thread count or chunk size changes in the last bits from run to run.
+// These sums fix the order by the data alone: the input is cut into blocks of
+// BLOCK elements at fixed offsets, every block is summed in four interleaved
+// lanes, and the block sums are combined in a fixed pairwise tree in double-double
+// (error free TwoSum), rounded once at the end. Threads only decide who computes which block,
+// so Sum() and ParallelSum() give the same bits for every thread count, and the
+// result is at least as accurate as a plain loop (the tree error grows with log(blocks)).
+// Infinite or NaN terms give the IEEE result of a plain sum.
+namespace OptionFunction {
+namespace ReproducibleSum {
+const size_t BLOCK = 2048;	// Elements per leaf block, part of the result, do not change.
+
+// Sum of x[0], x[stride], ..., x[(size - 1) * stride].
+double Sum(const double* x, size_t size, size_t stride = 1);
+double Sum(const vector<double>& x);
+
+// Same bits as Sum(), blocks spread over threads (0 means one per hardware thread).
+double ParallelSum(const double* x, size_t size, size_t threads = 0, size_t stride = 1);
+double ParallelSum(const vector<double>& x, size_t threads = 0);
+
+// Column sums of a row major table, rows contracts and columns their price and greeks.
+// Column c equals Sum(x + c, rows, columns) for every thread count.
+vector<double> ColumnSums(const double* x, size_t rows, size_t columns, size_t threads = 1);
+
+}	// Namespace ReproducibleSum.
+}	// Namespace OptionFunction.
+
+#endif	// REPRODUCIBLE_SUM_HPP_
@@ -0,0 +1,271 @@
+// shard_coordinator.cpp
+//
+// SharedBook and ShardCoordinator implementation.
+//
+
+#include "shard_coordinator.hpp"
+#include <atomic>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sched.h>
+#include <spawn.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "pricing_protocol.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+// Options priced between two progress updates of a worker.
+static const size_t SHARD_BLOCK = 1024;
+
+// First argument of a worker command line: flag, segment name, shard, cpu or -1.
+static const char* SHARD_WORKER_FLAG = "--shard-worker";
+
+extern char** environ;
+
+// Layout of the segment: header, options, prices, each part page aligned.
+struct SharedBookHeader {
+	uint64_t size;
+	uint64_t shards;
+	ShardState shard[SHARD_MAX_WORKERS];
+};
+
+static size_t PageAlign(size_t bytes) {
+	size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return (bytes + page - 1) / page * page;
+}
+
+SharedBook::SharedBook() : base(0), bytes(0), size(0), owner(false) {
+}
+
+SharedBook::~SharedBook() {
+	Release();
+}
+
+bool SharedBook::Create(size_t newSize) {
+	Release();
+
+	static atomic<unsigned> counter(0);
+	ostringstream os;
+	os << "/option_book_" << getpid() << "_" << counter++;
+	name = os.str();
+
+	bytes = PageAlign(sizeof(SharedBookHeader)) + PageAlign(newSize * sizeof(PricingRequestItem)) + PageAlign(newSize * sizeof(double));
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) {
+		cout << "Cannot create shared memory " << name << endl;
+		return false;
+	}
+	if (ftruncate(fd, bytes) < 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+		cout << "Cannot size shared memory " << name << endl;
+		return false;
+	}
+	base = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		base = 0;
+		shm_unlink(name.c_str());
+		cout << "Cannot map shared memory " << name << endl;
+		return false;
+	}
+
+	size = newSize;
+	owner = true;
+	SharedBookHeader* header = static_cast<SharedBookHeader*>(base);
+	header->size = size;
+	header->shards = 0;
+	return true;
+}
+
+bool SharedBook::Open(const string& newName) {
+	Release();
+
+	name = newName;
+	int fd = shm_open(name.c_str(), O_RDWR, 0600);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0 || size_t(st.st_size) < PageAlign(sizeof(SharedBookHeader))) {
+		if (fd >= 0)
+			close(fd);
+		cout << "Cannot open shared memory " << name << endl;
+		return false;
+	}
+	bytes = size_t(st.st_size);
+	base = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		base = 0;
+		cout << "Cannot map shared memory " << name << endl;
+		return false;
+	}
+
+	size = static_cast<SharedBookHeader*>(base)->size;
+	owner = false;
+	return true;
+}
+
+void SharedBook::Release() {
+	if (base == 0)
+		return;
+	munmap(base, bytes);
+	if (owner)
+		shm_unlink(name.c_str());
+	base = 0;
+	bytes = 0;
+	size = 0;
+}
+
+PricingRequestItem* SharedBook::Items() {
+	return reinterpret_cast<PricingRequestItem*>(static_cast<char*>(base) + PageAlign(sizeof(SharedBookHeader)));
+}
+
+const PricingRequestItem* SharedBook::Items() const {
+	return reinterpret_cast<const PricingRequestItem*>(static_cast<const char*>(base) + PageAlign(sizeof(SharedBookHeader)));
+}
+
+double* SharedBook::Prices() {
+	return reinterpret_cast<double*>(reinterpret_cast<char*>(Items()) + PageAlign(size * sizeof(PricingRequestItem)));
+}
+
+const double* SharedBook::Prices() const {
+	return reinterpret_cast<const double*>(reinterpret_cast<const char*>(Items()) + PageAlign(size * sizeof(PricingRequestItem)));
+}
+
+ShardState* SharedBook::Shards() {
+	return static_cast<SharedBookHeader*>(base)->shard;
+}
+
+ShardCoordinator::ShardCoordinator(size_t workers, size_t maxRestarts)
+	: workers(workers), maxRestarts(maxRestarts), restarts(0), pinWorkers(false) {
+	if (this->workers == 0)
+		this->workers = 1;
+	if (this->workers > SHARD_MAX_WORKERS)
+		this->workers = SHARD_MAX_WORKERS;
+}
+
+ShardCoordinator::~ShardCoordinator() {
+}
+
+// posix_spawn does not run any code of the parent in the child, unlike fork,
+// after which a lock held by another parent thread (malloc, the metrics sites,
+// the trace ring) stays locked for good in the child.
+int ShardCoordinator::Spawn(SharedBook& book, size_t shard) const {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	ostringstream shardArg, cpuArg;
+	shardArg << shard;
+	cpuArg << (pinWorkers ? long(shard % (cpus > 0 ? cpus : 1)) : -1L);
+	string arg[] = { "/proc/self/exe", SHARD_WORKER_FLAG, book.Name(), shardArg.str(), cpuArg.str() };
+	char* argv[] = { &arg[0][0], &arg[1][0], &arg[2][0], &arg[3][0], &arg[4][0], 0 };
+
+	pid_t pid;
+	int error = posix_spawn(&pid, "/proc/self/exe", 0, 0, argv, environ);
+	if (error != 0) {
+		cout << "Cannot start worker for shard " << shard << ": " << strerror(error) << endl;
+		return -1;
+	}
+	return pid;
+}
+
+int ShardCoordinator::RunWorker(int argc, char* argv[]) {
+	if (argc != 5 || strcmp(argv[1], SHARD_WORKER_FLAG) != 0)
+		return -1;
+
+	SharedBook book;
+	size_t shard = strtoul(argv[3], 0, 10);
+	long cpu = strtol(argv[4], 0, 10);
+	if (!book.Open(argv[2]) || shard >= SHARD_MAX_WORKERS)
+		return 1;
+	if (cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+
+	ShardState& state = book.Shards()[shard];
+	const PricingRequestItem* items = book.Items();
+	double* prices = book.Prices();
+	for (uint64_t i = state.next; i < state.end; i = state.next) {
+		uint64_t end = i + SHARD_BLOCK < state.end ? i + SHARD_BLOCK : state.end;
+		PricingProtocol::PriceItems(items + i, prices + i, end - i);
+		state.next = end;
+	}
+	state.done = 1;
+	return 0;
+}
+
+bool ShardCoordinator::Run(SharedBook& book) {
+	PricingTrace::Span span("shard run", "shard", book.Size());
+	restarts = 0;
+	if (book.Size() == 0)
+		return true;
+
+	size_t shards = workers < book.Size() ? workers : book.Size();
+	ShardState* state = book.Shards();
+	for (size_t i = 0; i < shards; i++) {
+		state[i].begin = book.Size() * i / shards;
+		state[i].end = book.Size() * (i + 1) / shards;
+		state[i].next = state[i].begin;
+		state[i].done = 0;
+	}
+
+	vector<pid_t> pid(shards, -1);
+	size_t running = 0;
+	for (size_t i = 0; i < shards; i++) {
+		pid[i] = Spawn(book, i);
+		if (pid[i] > 0)
+			running++;
+	}
+
+	// Poll our own children only, the process may have others.
+	bool ok = true;
+	while (running > 0) {
+		bool reaped = false;
+		for (size_t i = 0; i < shards; i++) {
+			int status;
+			if (pid[i] <= 0 || waitpid(pid[i], &status, WNOHANG) != pid[i])
+				continue;
+			reaped = true;
+			pid[i] = -1;
+			running--;
+
+			if (state[i].done)
+				continue;
+			if (restarts < maxRestarts) {
+				restarts++;
+				pid[i] = Spawn(book, i);
+				if (pid[i] > 0)
+					running++;
+			} else {
+				cout << "Shard " << i << " failed at option " << state[i].next << endl;
+				ok = false;
+			}
+		}
+		if (!reaped)
+			usleep(200);
+	}
+
+	for (size_t i = 0; i < shards; i++) {
+		if (!state[i].done)
+			ok = false;
+	}
+	return ok;
+}
+
+vector<double> ShardCoordinator::Price(const vector<PricingRequestItem>& book) {
+	SharedBook shared;
+	if (!shared.Create(book.size()))
+		return vector<double>();
+	for (size_t i = 0; i < book.size(); i++)
+		shared.Items()[i] = book[i];
+	if (!Run(shared))
+		return vector<double>();
+	return vector<double>(shared.Prices(), shared.Prices() + book.size());
+}
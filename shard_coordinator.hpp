@@ -0,0 +1,123 @@
+// shard_coordinator.hpp
+//
+// Header file for Class SharedBook and Class ShardCoordinator.
+// Book evaluation split across local worker processes.
+//
+
+#ifndef SHARD_COORDINATOR_HPP_
+#define SHARD_COORDINATOR_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pricing_protocol.hpp"
+
+using namespace std;
+
+const size_t SHARD_MAX_WORKERS = 256;
+
+// Progress of one shard, written by its worker and read by the coordinator.
+struct ShardState {
+	uint64_t begin;				// First option of the shard.
+	uint64_t end;				// One past the last option.
+	atomic<uint64_t> next;		// First option not priced yet, a restarted worker resumes here.
+	atomic<uint32_t> done;		// Set when the worker finished the shard.
+};
+
+// Book in POSIX shared memory: a header, the options and their prices.
+// Worker processes map it and read options and write prices in place.
+// Create the segment with Create(size_t) and fill the options through Items().
+// Read the prices through Prices() after ShardCoordinator::Run(SharedBook&).
+// A worker process maps an existing segment by name with Open(const string&).
+class SharedBook {
+public:
+	// Constructors & destructor.
+	SharedBook();	// Empty book.
+	virtual ~SharedBook();	// Destructor, unmaps and removes a created segment.
+
+	bool Create(size_t size);				// Create a segment for size options.
+	bool Open(const string& name);			// Map the segment created by another process.
+	void Release();							// Unmap, and remove the segment if created here.
+
+	// Selectors.
+	size_t Size() const;
+	PricingRequestItem* Items();
+	const PricingRequestItem* Items() const;
+	double* Prices();
+	const double* Prices() const;
+	ShardState* Shards();
+	const string& Name() const;	// Shared memory object name.
+
+private:
+	string name;
+	void* base;
+	size_t bytes;
+	size_t size;
+	bool owner;		// Created here, removed on release.
+
+	// No copy.
+	SharedBook(const SharedBook&);
+	SharedBook& operator = (const SharedBook&);
+};
+
+// Coordinator of the worker processes.
+// Run(SharedBook&) splits the book in one contiguous shard per worker, starts the
+// workers, which price their shard with the book kernels, and waits for them.
+// A worker that dies before finishing its shard is restarted from the shard
+// progress, at most maxRestarts times per run.
+// Pin worker i to cpu i modulo the cpu count with PinWorkers(bool).
+// Workers are started with posix_spawn of /proc/self/exe, never a bare fork, so
+// the parent may have other threads holding locks (allocator, metrics, trace).
+// The program must therefore hand a worker command line to RunWorker first:
+//	int worker = ShardCoordinator::RunWorker(argc, argv);
+//	if (worker >= 0)
+//		return worker;
+class ShardCoordinator {
+public:
+	// Constructors & destructor.
+	ShardCoordinator(size_t workers, size_t maxRestarts);	// Create coordinator.
+	virtual ~ShardCoordinator();	// Destructor.
+
+	bool Run(SharedBook& book);	// Price the book, returns false if a shard could not be finished.
+	vector<double> Price(const vector<PricingRequestItem>& book);	// Copy a book in and the prices out.
+
+	static int RunWorker(int argc, char* argv[]);	// Price a shard if argv is a worker command line and return the exit code, else -1.
+
+	// Selectors.
+	size_t Workers() const;
+	size_t Restarts() const;	// Worker restarts of the last run.
+
+	// Modifiers.
+	void PinWorkers(bool pin) {	// Default inline function to set cpu pinning.
+		pinWorkers = pin;
+	}
+
+private:
+	size_t workers;
+	size_t maxRestarts;
+	size_t restarts;
+	bool pinWorkers;
+
+	int Spawn(SharedBook& book, size_t shard) const;	// Start a worker, returns its pid or -1.
+};
+
+// Implementation of the normal inline function.
+inline size_t SharedBook::Size() const {
+	return size;
+}
+
+inline const string& SharedBook::Name() const {
+	return name;
+}
+
+inline size_t ShardCoordinator::Workers() const {
+	return workers;
+}
+
+inline size_t ShardCoordinator::Restarts() const {
+	return restarts;
+}
+
+#endif	// SHARD_COORDINATOR_HPP_
@@ -0,0 +1,179 @@
+// simd_math.hpp
+//
+// Header file for the vectorizable math functions.
+// Branch free exp, log, normal cdf and its inverse for the ISA variants of the book kernels.
+//
+
+#ifndef SIMD_MATH_HPP_
+#define SIMD_MATH_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// The functions only use arithmetic, comparisons and 64 bit integer bit
+// operations, with no calls and no branches, so loops over them vectorize
+// at whatever width the enclosing function is compiled for. Conditionals are
+// bit masks or select between a computed value and a constant right before
+// the result, never ahead of arithmetic: the compiler would otherwise turn them
+// into branches it cannot if-convert without masked (AVX-512) instructions. They are forced
+// inline so a caller with a target attribute compiles them for its own ISA.
+// Accuracy for finite arguments: Sqrt within 1 ulp, Exp and Log within 2 ulp; NormalCdf within
+// 1e-15 relative of erfc(-x / sqrt(2)) / 2 for |x| <= 8, and in the far lower
+// tail limited, like erfc, by the rounding of x / sqrt(2) (2e-13 at x = -37);
+// InverseNormal within 1.2e-9 relative for min(p, 1 - p) >= 1e-10 (Acklam).
+#if defined(__GNUC__)
+#define SIMD_MATH_INLINE inline __attribute__((always_inline))
+#else
+#define SIMD_MATH_INLINE inline
+#endif
+
+namespace OptionFunction {
+namespace SimdMath {
+
+SIMD_MATH_INLINE uint64_t Bits(double x) {
+	uint64_t tmp;
+	memcpy(&tmp, &x, sizeof(tmp));
+	return tmp;
+}
+
+SIMD_MATH_INLINE double FromBits(uint64_t bits) {
+	double tmp;
+	memcpy(&tmp, &bits, sizeof(tmp));
+	return tmp;
+}
+
+// sqrt(x) = x / sqrt(x), 1 / sqrt(x) from an exponent halving guess and three
+// Newton steps, then one correction of the square root. For x >= 0. The C
+// library sqrt is a single instruction too, but with errno setting (the default)
+// the compiler guards it with a branch that stops vectorization.
+SIMD_MATH_INLINE double Sqrt(double x) {
+	double y = FromBits(0x5fe6eb50c7b537a9ULL - (Bits(x) >> 1));	// 1 / sqrt(x) within 0.4%.
+	double half = 0.5 * x;
+	y = y * (1.5 - half * y * y);
+	y = y * (1.5 - half * y * y);
+	y = y * (1.5 - half * y * y);
+	double s = x * y;
+	return s + 0.5 * y * (x - s * s);
+}
+
+// exp(x) = 2^n exp(r), n = round(x / ln 2), |r| <= ln 2 / 2, Taylor series to r^13.
+// Polynomials are evaluated with Estrin's scheme, see NormalCdf().
+// Underflows to 0 below -708.39, where the result leaves the normal range, and
+// for x = -infinity; for x <= 709. The input is not clamped: a select ahead of the arithmetic lets the
+// compiler split the function into branches again.
+SIMD_MATH_INLINE double Exp(double x) {
+	const double magic = 6755399441055744.0;	// 1.5 * 2^52, adding it rounds to an integer.
+	double t = x * 1.4426950408889634074 + magic;
+	double n = t - magic;
+	double r = (x - n * 0.693147180369123816490) - n * 1.90821492927058770002e-10;
+	double r2 = r * r;
+	double r4 = r2 * r2;
+	double r8 = r4 * r4;
+	double q0 = (1.0 + r) + (0.5 + r * (1.0 / 6.0)) * r2;
+	double q1 = (1.0 / 24.0 + r * (1.0 / 120.0)) + (1.0 / 720.0 + r * (1.0 / 5040.0)) * r2;
+	double q2 = (1.0 / 40320.0 + r * (1.0 / 362880.0)) + (1.0 / 3628800.0 + r * (1.0 / 39916800.0)) * r2;
+	double q3 = 1.0 / 479001600.0 + r * (1.0 / 6227020800.0);
+	double p = (q0 + q1 * r4) + (q2 + q3 * r4) * r8;
+	double scale = FromBits((Bits(t) - Bits(magic) + 1023) << 52);
+	return p * (x < -708.39 ? 0.0 : scale);
+}
+
+// log(x) = e ln 2 + log(m), m in [sqrt(2) / 2, sqrt(2)), log(m) = 2 atanh((m - 1) / (m + 1)).
+// Offsetting the bits by 1 - sqrt(2) / 2 carries into the exponent exactly when
+// the mantissa is at least sqrt(2), which gives e and m without a select.
+// For positive normal x.
+SIMD_MATH_INLINE double Log(double x) {
+	const double two52 = 4503599627370496.0;
+	const uint64_t sqrtHalf = 0x3fe6a09e667f3bcdULL;	// sqrt(2) / 2.
+	uint64_t bits = Bits(x) + (0x3ff0000000000000ULL - sqrtHalf);
+	double e = FromBits((bits >> 52) | 0x4330000000000000ULL) - two52 - 1023.0;	// Exponent field as double.
+	double m = FromBits((bits & 0x000fffffffffffffULL) + sqrtHalf);
+	double f = (m - 1.0) / (m + 1.0);
+	double s = f * f;
+	double s2 = s * s;
+	double s4 = s2 * s2;
+	double q0 = (1.0 / 3.0 + s * (1.0 / 5.0)) + (1.0 / 7.0 + s * (1.0 / 9.0)) * s2;
+	double q1 = (1.0 / 11.0 + s * (1.0 / 13.0)) + (1.0 / 15.0 + s * (1.0 / 17.0)) * s2;
+	double q2 = (1.0 / 19.0 + s * (1.0 / 21.0)) + (1.0 / 23.0) * s2;
+	double p = (q0 + q1 * s4) + q2 * (s4 * s4);
+	double logm = 2.0 * f + 2.0 * f * s * p;
+	return e * 0.693147180369123816490 + (e * 1.90821492927058770002e-10 + logm);
+}
+
+// N(x) = erfc(z) / 2 with z = -x / sqrt(2). For a = |z| and t = 2 / (2 + a),
+// erfc(a) = t exp(-a^2) exp(f(t)) with f a degree 27 polynomial in u = 2 t - 1
+// (a Chebyshev series, sum of absolute monomial coefficients 1.5, so the power
+// form loses nothing); a^2 is split exactly so exp(-a^2) keeps full relative
+// precision in the tail. Estrin's scheme keeps the dependency chain at five
+// multiply-adds, where Horner's or Clenshaw's would be 27 long and make the
+// vectorized loop latency bound.
+SIMD_MATH_INLINE double NormalCdf(double x) {
+	static const double c[28] = {
+		-0.671794084056692265144, 0.67264322397765673368, 0.0473433068419041500381, -0.0468956102311758605632,
+		-0.00987268936637431991036, 0.00882493855707522385864, 0.00175893355746888991123, -0.00234581250067083746965,
+		-0.00014624685982593330312, 0.000673678797075542614368, -9.37350536890334262718e-05, -0.000174302955374984006972,
+		7.14011051871817533295e-05, 3.17452117892062328012e-05, -3.01881301747834266783e-05, 1.37635835691559312622e-07,
+		8.56307515118004403121e-06, -2.94780251393807664816e-06, -1.27288017814919385263e-06, 1.24976432995064593955e-06,
+		-1.68017175875926720125e-07, -2.49326426171592174796e-07, 1.53082046002358159356e-07, 1.28258648146584164351e-09,
+		-3.90894191089804129043e-08, 1.12320700888327943785e-08, 4.04944936841881523516e-09, -1.899934432003647089e-09
+	};
+	double z = -x * 0.707106781186547524401;
+	uint64_t sign = Bits(z) & 0x8000000000000000ULL;
+	double a = FromBits(Bits(z) ^ sign);	// |z|.
+	double t = 2.0 / (2.0 + a);
+	double u = 2.0 * t - 1.0;
+
+	double u2 = u * u;
+	double u4 = u2 * u2;
+	double u8 = u4 * u4;
+	double u16 = u8 * u8;
+	double p0 = (c[0] + c[1] * u) + (c[2] + c[3] * u) * u2;
+	double p1 = (c[4] + c[5] * u) + (c[6] + c[7] * u) * u2;
+	double p2 = (c[8] + c[9] * u) + (c[10] + c[11] * u) * u2;
+	double p3 = (c[12] + c[13] * u) + (c[14] + c[15] * u) * u2;
+	double p4 = (c[16] + c[17] * u) + (c[18] + c[19] * u) * u2;
+	double p5 = (c[20] + c[21] * u) + (c[22] + c[23] * u) * u2;
+	double p6 = (c[24] + c[25] * u) + (c[26] + c[27] * u) * u2;
+	double f = ((p0 + p1 * u4) + (p2 + p3 * u4) * u8) + ((p4 + p5 * u4) + p6 * u8) * u16;
+
+	// a^2 = p + err exactly (Dekker).
+	double split = 134217729.0 * a;
+	double hi = split - (split - a);
+	double lo = a - hi;
+	double p = a * a;
+	double err = ((hi * hi - p) + 2.0 * hi * lo) + lo * lo;
+	double erfcA = t * Exp(-p) * Exp(f - err);
+	return 0.5 * (FromBits(Bits(2.0) & (0 - (sign >> 63))) + FromBits(Bits(erfcA) ^ sign));	// erfc(z) = 2 - erfc(-z) for z < 0.
+}
+
+// Inverse of N(x), Acklam's rational approximations, within 1.2e-9 relative
+// for min(p, 1 - p) >= 1e-10, which covers every 32 bit Sobol point; the error
+// grows further out (1e-5 at 1e-15). The central form in p - 1/2 and the tail form in
+// sqrt(-2 log(min(p, 1 - p))) are both computed and one is selected at the end.
+SIMD_MATH_INLINE double InverseNormal(double p) {
+	static const double a[6] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+		1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[5] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+		6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[6] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+		-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[4] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00 };
+	double q = p - 0.5;
+	double r = q * q;
+	double central = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+		/ (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+	uint64_t sign = Bits(q) & 0x8000000000000000ULL;
+	double m = 0.5 - FromBits(Bits(q) ^ sign);	// min(p, 1 - p).
+	double s = Sqrt(-2.0 * Log(m));
+	double tail = (((((c[0] * s + c[1]) * s + c[2]) * s + c[3]) * s + c[4]) * s + c[5])
+		/ ((((d[0] * s + d[1]) * s + d[2]) * s + d[3]) * s + 1.0);
+	tail = FromBits(Bits(tail) ^ sign ^ 0x8000000000000000ULL);	// Lower tail form, mirrored above 1/2.
+	return r <= 0.47575 * 0.47575 ? central : tail;
+}
+
+}	// Namespace SimdMath.
+}	// Namespace OptionFunction.
+
+#endif	// SIMD_MATH_HPP_
@@ -0,0 +1,117 @@
+// strategy.cpp
+//
+// Strategy implementation.
+//
+
+#include "strategy.hpp"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+
+using namespace std;
+
+Strategy::Strategy() {
+}
+
+Strategy::Strategy(const vector<StrategyLeg>& legs) {
+	for (size_t i = 0; i < legs.size(); i++)
+		leg.push_back(OptionFunction::StrategyFunction::CheckedLeg(legs[i]));
+	OptionFunction::StrategyFunction::Group(leg.data(), leg.size());
+}
+
+Strategy::~Strategy() {
+}
+
+void Strategy::Add(const StrategyLeg& newLeg) {
+	leg.push_back(OptionFunction::StrategyFunction::CheckedLeg(newLeg));
+	OptionFunction::StrategyFunction::Group(leg.data(), leg.size());
+}
+
+double Strategy::Price(double S) const {
+	PRICING_METRIC("Strategy::Price(double) const", leg.size());
+	return OptionFunction::StrategyFunction::FusedValue(leg.data(), leg.size(), S).price;
+}
+
+StrategyValue Strategy::Value(double S) const {
+	PRICING_METRIC("Strategy::Value(double) const", leg.size());
+	return OptionFunction::StrategyFunction::FusedValue(leg.data(), leg.size(), S);
+}
+
+namespace OptionFunction {
+namespace StrategyFunction {
+
+StrategyValue Value(const StrategyLeg* legs, size_t size, double S) {
+	return FusedValue(legs, size, S);
+}
+
+// Lexicographic on time to expiry, sig, r, b and strike.
+void Group(StrategyLeg* legs, size_t size) {
+	stable_sort(legs, legs + size, [](const StrategyLeg& x, const StrategyLeg& y) {
+		const OptionData& a = x.data;
+		const OptionData& c = y.data;
+		if (a.T - a.t != c.T - c.t)
+			return a.T - a.t < c.T - c.t;
+		if (a.sig != c.sig)
+			return a.sig < c.sig;
+		if (a.r != c.r)
+			return a.r < c.r;
+		if (a.b != c.b)
+			return a.b < c.b;
+		return a.K < c.K;
+	});
+}
+
+void Value(const Strategy* strategy, const double* S, StrategyValue* value, size_t size) {
+	PRICING_METRIC("StrategyFunction::Value(const Strategy*, const double*, StrategyValue*, size_t)", size);
+	for (size_t i = 0; i < size; i++)
+		value[i] = FusedValue(strategy[i].Legs().data(), strategy[i].Size(), S[i]);
+}
+
+vector<StrategyValue> Value(const vector<Strategy>& strategy, const vector<double>& S) {
+	if (strategy.size() != S.size()) {
+		cout << "Strategy and spot price sizes differ" << endl;
+		return vector<StrategyValue>();
+	}
+	vector<StrategyValue> tmp(strategy.size());
+	Value(strategy.data(), S.data(), tmp.data(), tmp.size());
+	return tmp;
+}
+
+// Leg with data and a changed strike or expiry.
+static StrategyLeg MakeLeg(const OptionData& data, double K, double T, char optType, double quantity) {
+	StrategyLeg tmp = { data, optType, quantity };
+	tmp.data.K = K;
+	tmp.data.T = T;
+	return tmp;
+}
+
+FixedStrategy<2> Straddle(const OptionData& data, double quantity) {
+	StrategyLeg tmp[2] = { MakeLeg(data, data.K, data.T, 'C', quantity), MakeLeg(data, data.K, data.T, 'P', quantity) };
+	return FixedStrategy<2>(tmp);
+}
+
+FixedStrategy<2> Strangle(const OptionData& data, double putK, double callK, double quantity) {
+	StrategyLeg tmp[2] = { MakeLeg(data, putK, data.T, 'P', quantity), MakeLeg(data, callK, data.T, 'C', quantity) };
+	return FixedStrategy<2>(tmp);
+}
+
+FixedStrategy<2> Vertical(const OptionData& data, double longK, double shortK, char optType, double quantity) {
+	StrategyLeg tmp[2] = { MakeLeg(data, longK, data.T, optType, quantity), MakeLeg(data, shortK, data.T, optType, -quantity) };
+	return FixedStrategy<2>(tmp);
+}
+
+FixedStrategy<3> Butterfly(const OptionData& data, double lowK, double midK, double highK, char optType, double quantity) {
+	StrategyLeg tmp[3] = { MakeLeg(data, lowK, data.T, optType, quantity), MakeLeg(data, midK, data.T, optType, -2.0 * quantity),
+		MakeLeg(data, highK, data.T, optType, quantity) };
+	return FixedStrategy<3>(tmp);
+}
+
+FixedStrategy<2> Calendar(const OptionData& data, double nearT, double farT, char optType, double quantity) {
+	StrategyLeg tmp[2] = { MakeLeg(data, data.K, nearT, optType, -quantity), MakeLeg(data, data.K, farT, optType, quantity) };
+	return FixedStrategy<2>(tmp);
+}
+
+}	// Namespace StrategyFunction.
+}	// Namespace OptionFunction.
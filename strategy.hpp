@@ -0,0 +1,276 @@
+// strategy.hpp
+//
+// Header file for Class Strategy and Class FixedStrategy.
+// Multi-leg European option strategies priced in one fused pass.
+//
+
+#ifndef STRATEGY_HPP_
+#define STRATEGY_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include "option_data.hpp"
+
+using namespace std;
+
+// One leg of a strategy.
+struct StrategyLeg {
+	OptionData data;	// Contract parameters.
+	char optType;		// 'C' or 'P'.
+	double quantity;	// Signed, negative for a short leg.
+};
+
+// Price and greeks of a strategy, quantity weighted sums over the legs.
+// Theta is the change of value per year of valuation time, see TimeRollEngine.
+struct StrategyValue {
+	double price;
+	double delta;
+	double gamma;
+	double vega;	// Per unit of volatility.
+	double theta;
+};
+
+template <size_t N> class FixedStrategy;
+class Strategy;
+
+namespace OptionFunction {
+namespace StrategyFunction {
+// Fused pass over legs in Group() order, see FixedStrategy.
+StrategyValue Value(const StrategyLeg* legs, size_t size, double S);
+
+// Stable order in which legs with the same time to expiry, sig, r and b are
+// adjacent, and within those legs with the same strike.
+void Group(StrategyLeg* legs, size_t size);
+
+// Batch evaluation of many strategies, one spot price per strategy.
+void Value(const Strategy* strategy, const double* S, StrategyValue* value, size_t size);	// Array version.
+vector<StrategyValue> Value(const vector<Strategy>& strategy, const vector<double>& S);	// Vector version.
+template <size_t N>
+void Value(const FixedStrategy<N>* strategy, const double* S, StrategyValue* value, size_t size);	// Fixed leg count version.
+
+}	// Namespace StrategyFunction.
+}	// Namespace OptionFunction.
+
+// Strategy with a number of legs known at compile time, for quoting the common
+// shapes (see the factories in StrategyFunction). Legs are kept in Group() order.
+// Every leg shares the time to expiry, square root, discount exp(-r tau), carry
+// exp((b - r) tau) and forward with the previous leg when they have the same
+// expiry terms, and d1, d2 and n(d1) as well when they also have the same strike
+// (a straddle evaluates them once), so the fused pass costs one normal cdf pair
+// per leg on top of what the legs share. Value() is inline and unrolls for N.
+// Combine strategies with operator + (FixedStrategy<N + M>) and scale them with
+// operator * (double). A leg with a wrong option type is kept as a call with
+// quantity 0, so it adds nothing.
+// Calculate the price with Price(double) and the price and greeks with Value(double).
+template <size_t N>
+class FixedStrategy {
+public:
+	// Constructors & destructor.
+	FixedStrategy(const StrategyLeg (&legs)[N]);	// Create strategy with legs.
+
+	double Price(double S) const;
+	StrategyValue Value(double S) const;
+	void Value(const double* S, StrategyValue* value, size_t size) const;	// Spot price array version.
+
+	template <size_t M>
+	FixedStrategy<N + M> operator + (const FixedStrategy<M>& other) const;
+	FixedStrategy<N> operator * (double quantity) const;	// Every leg quantity scaled.
+
+	// Selectors.
+	size_t Size() const;
+	const StrategyLeg& Leg(size_t i) const;
+
+private:
+	StrategyLeg leg[N];
+};
+
+// Strategy with a number of legs known at run time, priced like FixedStrategy.
+// Add legs with Add(const StrategyLeg&), they are kept in Group() order; a leg
+// with a wrong option type is kept as a call with quantity 0, as in FixedStrategy.
+// Calculate the price with Price(double) and the price and greeks with Value(double).
+class Strategy {
+public:
+	// Constructors & destructor.
+	Strategy();	// No legs.
+	Strategy(const vector<StrategyLeg>& legs);	// Create strategy with legs.
+	template <size_t N>
+	Strategy(const FixedStrategy<N>& fixed);	// Same legs as a fixed strategy.
+	virtual ~Strategy();	// Destructor.
+
+	void Add(const StrategyLeg& leg);
+
+	double Price(double S) const;
+	StrategyValue Value(double S) const;
+
+	// Selectors.
+	size_t Size() const;
+	const vector<StrategyLeg>& Legs() const;
+
+private:
+	vector<StrategyLeg> leg;
+};
+
+namespace OptionFunction {
+namespace StrategyFunction {
+// Common strategies on the contract data (T, t, sig, r, b, q), quantity of the long side.
+FixedStrategy<2> Straddle(const OptionData& data, double quantity = 1.0);	// Call and put at data.K.
+FixedStrategy<2> Strangle(const OptionData& data, double putK, double callK, double quantity = 1.0);
+FixedStrategy<2> Vertical(const OptionData& data, double longK, double shortK, char optType, double quantity = 1.0);
+FixedStrategy<3> Butterfly(const OptionData& data, double lowK, double midK, double highK, char optType, double quantity = 1.0);	// 1, -2, 1.
+FixedStrategy<2> Calendar(const OptionData& data, double nearT, double farT, char optType, double quantity = 1.0);	// Short near, long far.
+
+// Option type 'C', 'c', 'P' or 'p'.
+inline bool ValidLeg(const StrategyLeg& leg) {
+	return leg.optType == 'C' || leg.optType == 'c' || leg.optType == 'P' || leg.optType == 'p';
+}
+
+// The leg, or a call with quantity 0 when its option type is wrong.
+inline StrategyLeg CheckedLeg(const StrategyLeg& leg) {
+	StrategyLeg tmp = leg;
+	if (!ValidLeg(tmp)) {
+		cout << "Wrong option type" << endl;
+		tmp.optType = 'C';
+		tmp.quantity = 0.0;
+	}
+	return tmp;
+}
+
+// Same time to expiry T - t, sig, r and b.
+inline bool SameExpiry(const OptionData& a, const OptionData& b) {
+	return a.T - a.t == b.T - b.t && a.sig == b.sig && a.r == b.r && a.b == b.b;
+}
+
+// Fused pass, inline so a fixed leg count unrolls. Expired legs are worth their
+// intrinsic value with zero greeks, legs with no volatility their discounted
+// forward intrinsic value (delta and theta its derivatives, gamma and vega 0).
+inline StrategyValue FusedValue(const StrategyLeg* legs, size_t size, double S) {
+	const double invSqrt2Pi = 0.398942280401432677939946;
+	StrategyValue tmp = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	double logS = log(S);
+	double tau = 0.0, sqrtTau = 0.0, w = 0.0, discount = 0.0, carry = 0.0, forward = 0.0, drift = 0.0;
+	double d1 = 0.0, d2 = 0.0, nd1 = 0.0;
+	bool intrinsic = false;
+	for (size_t i = 0; i < size; i++) {
+		const OptionData& o = legs[i].data;
+		bool newExpiry = i == 0 || !SameExpiry(legs[i - 1].data, o);
+		if (newExpiry) {	// Expiry terms.
+			tau = o.T - o.t;
+			intrinsic = tau <= 0.0 || o.sig <= 0.0;
+			sqrtTau = sqrt(max(tau, 0.0));
+			w = o.sig * sqrtTau;
+			discount = exp(-o.r * tau);
+			carry = exp((o.b - o.r) * tau);
+			forward = S * carry;
+			drift = (o.b + 0.5 * o.sig * o.sig) * tau;
+		}
+		double s = (legs[i].optType == 'P' || legs[i].optType == 'p') ? -1.0 : 1.0;
+		double q = legs[i].quantity;
+		if (intrinsic) {
+			if (tau <= 0.0) {
+				tmp.price += q * max(s * (S - o.K), 0.0);
+			} else if (s * (forward - o.K * discount) > 0.0) {
+				double strike = o.K * discount;
+				tmp.price += q * s * (forward - strike);
+				tmp.delta += q * s * carry;
+				tmp.theta -= q * s * ((o.b - o.r) * forward + o.r * strike);
+			}
+			continue;
+		}
+		if (newExpiry || legs[i - 1].data.K != o.K) {	// Strike terms.
+			d1 = (logS - log(o.K) + drift) / w;
+			d2 = d1 - w;
+			nd1 = invSqrt2Pi * exp(-0.5 * d1 * d1);
+		}
+		double Nd1 = 0.5 * erfc(-s * d1 * M_SQRT1_2);
+		double Nd2 = 0.5 * erfc(-s * d2 * M_SQRT1_2);
+		double strike = o.K * discount;
+		tmp.price += q * s * (forward * Nd1 - strike * Nd2);
+		tmp.delta += q * s * carry * Nd1;
+		tmp.gamma += q * carry * nd1 / (S * w);
+		tmp.vega += q * forward * nd1 * sqrtTau;
+		tmp.theta += q * (-forward * nd1 * o.sig / (2.0 * sqrtTau) - s * ((o.b - o.r) * forward * Nd1 + o.r * strike * Nd2));
+	}
+	return tmp;
+}
+
+template <size_t N>
+void Value(const FixedStrategy<N>* strategy, const double* S, StrategyValue* value, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		value[i] = strategy[i].Value(S[i]);
+}
+
+}	// Namespace StrategyFunction.
+}	// Namespace OptionFunction.
+
+// Implementation of the template functions.
+template <size_t N>
+FixedStrategy<N>::FixedStrategy(const StrategyLeg (&legs)[N]) {
+	for (size_t i = 0; i < N; i++)
+		leg[i] = OptionFunction::StrategyFunction::CheckedLeg(legs[i]);
+	OptionFunction::StrategyFunction::Group(leg, N);
+}
+
+template <size_t N>
+double FixedStrategy<N>::Price(double S) const {
+	return OptionFunction::StrategyFunction::FusedValue(leg, N, S).price;
+}
+
+template <size_t N>
+StrategyValue FixedStrategy<N>::Value(double S) const {
+	return OptionFunction::StrategyFunction::FusedValue(leg, N, S);
+}
+
+template <size_t N>
+void FixedStrategy<N>::Value(const double* S, StrategyValue* value, size_t size) const {
+	for (size_t i = 0; i < size; i++)
+		value[i] = OptionFunction::StrategyFunction::FusedValue(leg, N, S[i]);
+}
+
+template <size_t N>
+template <size_t M>
+FixedStrategy<N + M> FixedStrategy<N>::operator + (const FixedStrategy<M>& other) const {
+	StrategyLeg tmp[N + M];
+	copy(leg, leg + N, tmp);
+	for (size_t i = 0; i < M; i++)
+		tmp[N + i] = other.Leg(i);
+	return FixedStrategy<N + M>(tmp);
+}
+
+template <size_t N>
+FixedStrategy<N> FixedStrategy<N>::operator * (double quantity) const {
+	StrategyLeg tmp[N];
+	copy(leg, leg + N, tmp);
+	for (size_t i = 0; i < N; i++)
+		tmp[i].quantity *= quantity;
+	return FixedStrategy<N>(tmp);
+}
+
+template <size_t N>
+size_t FixedStrategy<N>::Size() const {
+	return N;
+}
+
+template <size_t N>
+const StrategyLeg& FixedStrategy<N>::Leg(size_t i) const {
+	return leg[i];
+}
+
+template <size_t N>
+Strategy::Strategy(const FixedStrategy<N>& fixed) {
+	for (size_t i = 0; i < N; i++)
+		leg.push_back(fixed.Leg(i));
+}
+
+// Implementation of the normal inline function.
+inline size_t Strategy::Size() const {
+	return leg.size();
+}
+
+inline const vector<StrategyLeg>& Strategy::Legs() const {
+	return leg;
+}
+
+#endif	// STRATEGY_HPP_
@@ -0,0 +1,138 @@
+// taylor_reprice.cpp
+//
+// TaylorRepricer implementation.
+//
+
+#include "taylor_reprice.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "option_chain.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+
+using namespace std;
+
+TaylorTrustRegion::TaylorTrustRegion() : spotMove(0.05), volMove(0.05), timeMove(1.0 / 252.0), absError(1e-4), relError(1e-5) {
+}
+
+double TaylorRepriceStats::FallbackRate() const {
+	return queries ? double(fallbacks) / double(queries) : 0.0;
+}
+
+TaylorRepricer::TaylorRepricer(const vector<ChainOption>& book, const TaylorTrustRegion& region)
+	: book(book), expansion(book.size()), region(region) {
+	PricingTrace::Span span("taylor anchor", "taylor", book.size());
+	for (size_t i = 0; i < book.size(); i++)
+		expansion[i] = Exact(i, book[i].S, book[i].data.sig, book[i].data.t);
+	ResetStats();
+}
+
+TaylorRepricer::~TaylorRepricer() {
+}
+
+// Price and greeks, see TimeRollEngine::Reprice(). Expired contracts are worth
+// their intrinsic value, contracts without volatility their discounted forward
+// intrinsic value; neither has an expansion (w = 0).
+TaylorRepricer::Expansion TaylorRepricer::Exact(size_t i, double S, double sig, double t) const {
+	const double invSqrt2Pi = 0.398942280401432677939946;
+	const OptionData& o = book[i].data;
+	double s = (book[i].optType == 'P' || book[i].optType == 'p') ? -1.0 : 1.0;
+	Expansion e = { S, sig, t, o.T - t, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (e.tau <= 0.0 || sig <= 0.0) {
+		e.tau = max(e.tau, 0.0);
+		e.price = max(s * (S * exp((o.b - o.r) * e.tau) - o.K * exp(-o.r * e.tau)), 0.0);
+		return e;
+	}
+
+	double sqrtTau = sqrt(e.tau);
+	double carry = exp((o.b - o.r) * e.tau);
+	double strike = o.K * exp(-o.r * e.tau);
+	double forward = S * carry;
+	e.w = sig * sqrtTau;
+	double d1 = (log(S / o.K) + (o.b + 0.5 * sig * sig) * e.tau) / e.w;
+	double d2 = d1 - e.w;
+	double Nd1 = 0.5 * erfc(-s * d1 * M_SQRT1_2);
+	double Nd2 = 0.5 * erfc(-s * d2 * M_SQRT1_2);
+	double nd1 = invSqrt2Pi * exp(-0.5 * d1 * d1);
+	double dd1 = (o.b + 0.5 * sig * sig) / e.w - d1 / (2.0 * e.tau);	// d d1 / d tau.
+
+	e.price = s * (forward * Nd1 - strike * Nd2);
+	e.delta = s * carry * Nd1;
+	e.gamma = carry * nd1 / (S * e.w);
+	e.vega = forward * nd1 * sqrtTau;
+	e.theta = -forward * nd1 * sig / (2.0 * sqrtTau) - s * ((o.b - o.r) * forward * Nd1 + o.r * strike * Nd2);
+	e.vanna = -carry * nd1 * d2 / sig;
+	e.volga = e.vega * d1 * d2 / sig;
+	e.charm = -carry * (s * (o.b - o.r) * Nd1 + nd1 * dd1);	// d delta / dt = -d delta / d tau.
+	e.veta = -e.vega * ((o.b - o.r) - d1 * dd1 + 0.5 / e.tau);
+	return e;
+}
+
+bool TaylorRepricer::Expand(size_t i, double S, double sig, double t, double& price) {
+	const Expansion& e = expansion[i];
+	double dS = S - e.S;
+	double dv = sig - e.sig;
+	double dt = t - e.t;
+	// Negated so NaN moves fall back too.
+	if (!(e.w > 0.0 && fabs(dS) <= region.spotMove * e.S && fabs(dv) <= region.volMove
+		&& fabs(dt) <= region.timeMove && e.tau - dt > 0.0)) {
+		stats.outsideRegion++;
+		return false;
+	}
+
+	double second = 0.5 * e.gamma * dS * dS + 0.5 * e.volga * dv * dv + e.vanna * dS * dv + e.charm * dS * dt + e.veta * dv * dt;
+	double size = max(max(fabs(dS) / (e.S * e.w), fabs(dv) / e.sig), fabs(dt) / e.tau);
+	double error = (fabs(0.5 * e.gamma * dS * dS) + fabs(0.5 * e.volga * dv * dv) + fabs(e.vanna * dS * dv)
+		+ fabs(e.charm * dS * dt) + fabs(e.veta * dv * dt)) * size + fabs(e.theta * dt) * fabs(dt) / e.tau;
+	if (!(error <= region.absError + region.relError * fabs(e.price))) {
+		stats.errorBound++;
+		return false;
+	}
+	price = e.price + e.delta * dS + e.vega * dv + e.theta * dt + second;
+	return true;
+}
+
+double TaylorRepricer::Price(size_t i, double S, double sig, double t) {
+	PRICING_METRIC("TaylorRepricer::Price(size_t, double, double, double)", 1);
+	stats.queries++;
+	double price;
+	if (Expand(i, S, sig, t, price))
+		return price;
+	PRICING_METRIC("TaylorRepricer fallback", 1);
+	stats.fallbacks++;
+	expansion[i] = Exact(i, S, sig, t);
+	return expansion[i].price;
+}
+
+// Expansions first, then the exact evaluations of the contracts that fell back.
+void TaylorRepricer::Price(const double* S, const double* sig, const double* t, double* price) {
+	PRICING_METRIC("TaylorRepricer::Price(const double*, const double*, const double*, double*)", book.size());
+	PricingTrace::Span span("taylor reprice", "taylor", book.size());
+	stats.queries += book.size();
+	vector<size_t> fallback;
+	for (size_t i = 0; i < book.size(); i++) {
+		if (!Expand(i, S[i], sig[i], t[i], price[i]))
+			fallback.push_back(i);
+	}
+
+	PRICING_METRIC("TaylorRepricer fallback", fallback.size());
+	stats.fallbacks += fallback.size();
+	for (size_t n = 0; n < fallback.size(); n++) {
+		size_t i = fallback[n];
+		expansion[i] = Exact(i, S[i], sig[i], t[i]);
+		price[i] = expansion[i].price;
+	}
+}
+
+double TaylorRepricer::ExactPrice(size_t i, double S, double sig, double t) const {
+	return Exact(i, S, sig, t).price;
+}
+
+void TaylorRepricer::Anchor(size_t i, double S, double sig, double t) {
+	expansion[i] = Exact(i, S, sig, t);
+}
+
+void TaylorRepricer::ResetStats() {
+	stats.queries = stats.fallbacks = stats.outsideRegion = stats.errorBound = 0;
+}
@@ -0,0 +1,106 @@
+// taylor_reprice.hpp
+//
+// Header file for Class TaylorRepricer.
+// Second order expansion repricing of a European book with exact fallback.
+//
+
+#ifndef TAYLOR_REPRICE_HPP_
+#define TAYLOR_REPRICE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "option_chain.hpp"
+
+using namespace std;
+
+// Moves answered from the expansion and the error accepted.
+struct TaylorTrustRegion {
+	double spotMove;	// Largest |dS| / S.
+	double volMove;		// Largest |dsig|.
+	double timeMove;	// Largest |dt| in years.
+	double absError;	// Accepted estimated error, absError + relError * price.
+	double relError;
+
+	TaylorTrustRegion();	// 5% spot, 0.05 vol, one business day, 1e-4 + 1e-5 * price.
+};
+
+// Queries since construction or the last ResetStats().
+struct TaylorRepriceStats {
+	uint64_t queries;
+	uint64_t fallbacks;		// Exact evaluations, the sum of the two below.
+	uint64_t outsideRegion;	// Move outside the trust region.
+	uint64_t errorBound;	// Estimated error above the accepted one.
+
+	double FallbackRate() const;	// fallbacks / queries.
+};
+
+// Taylor repricer.
+// Every contract keeps the expansion of its price around the market of its last
+// exact evaluation (anchor): delta, gamma, vega, volga, vanna in spot and
+// volatility, and theta, charm and veta in valuation time t, all analytic
+// (generalized Black-Scholes with carry, same formulas as TimeRollEngine). A
+// query (S, sig, t) is answered as
+//   P0 + delta dS + vega dsig + theta dt + gamma dS^2 / 2 + volga dsig^2 / 2
+//      + vanna dS dsig + charm dS dt + veta dsig dt,
+// about twenty flops instead of a log, two exp and two erfc. The dt^2 term is
+// left out. The error of the expansion is estimated as its second order terms
+// times the size of the move (dS in standard deviations to expiry, dsig / sig,
+// dt / tau) plus theta dt^2 / tau for the left out term. A query outside the trust region or with
+// an estimate above the accepted error is priced exactly and becomes the new anchor.
+// Fallbacks are counted in Stats() and, with OPTION_PRICING_METRICS, as the
+// elements of the "TaylorRepricer fallback" entry point next to the queries of
+// the Price entry points.
+class TaylorRepricer {
+public:
+	// Constructors & destructor.
+	TaylorRepricer(const vector<ChainOption>& book, const TaylorTrustRegion& region = TaylorTrustRegion());	// Anchor at the book market.
+	virtual ~TaylorRepricer();	// Destructor.
+
+	double Price(size_t i, double S, double sig, double t);	// One contract.
+	void Price(const double* S, const double* sig, const double* t, double* price);	// Whole book, Size() values each.
+	double ExactPrice(size_t i, double S, double sig, double t) const;	// No expansion, no anchor change.
+	void Anchor(size_t i, double S, double sig, double t);	// Exact evaluation and new anchor, not counted as a fallback.
+
+	const TaylorRepriceStats& Stats() const;
+	void ResetStats();
+
+	// Selectors.
+	size_t Size() const;
+	const TaylorTrustRegion& Region() const;
+
+private:
+	// Anchor of one contract.
+	struct Expansion {
+		double S, sig, t;	// Market of the exact evaluation.
+		double tau, w;		// Time to expiry and sig sqrt(tau), 0 when degenerate.
+		double price, delta, gamma, vega, theta, vanna, volga, charm, veta;
+	};
+
+	vector<ChainOption> book;
+	vector<Expansion> expansion;
+	TaylorTrustRegion region;
+	TaylorRepriceStats stats;
+
+	Expansion Exact(size_t i, double S, double sig, double t) const;
+	bool Expand(size_t i, double S, double sig, double t, double& price);	// False when the contract needs an exact evaluation.
+
+	// No copy.
+	TaylorRepricer(const TaylorRepricer&);
+	TaylorRepricer& operator = (const TaylorRepricer&);
+};
+
+// Implementation of the normal inline function.
+inline const TaylorRepriceStats& TaylorRepricer::Stats() const {
+	return stats;
+}
+
+inline size_t TaylorRepricer::Size() const {
+	return book.size();
+}
+
+inline const TaylorTrustRegion& TaylorRepricer::Region() const {
+	return region;
+}
+
+#endif	// TAYLOR_REPRICE_HPP_
@@ -0,0 +1,104 @@
+// test_adaptive_mesh.cpp
+//
+// Adaptive curve sampling against uniform meshes
+//
+// Usage: test_adaptive_mesh [checkpoints]
+// Samples the price, delta and gamma of a European call over spot prices 50 to
+// 150 and checks that every point is one evaluation, that the curves keep their
+// ends and increasing order, that linear interpolation stays within the
+// tolerance at checkpoints (default 20001) spot prices, and that a uniform mesh
+// with 1.25 times as many evaluations is still less accurate. Then checks the
+// American price curve, the point limit and a wrong range.
+// Exits with 1 when a check fails.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "adaptive_mesh.hpp"
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+static const double START = 50.0;
+static const double END = 150.0;
+
+// Largest interpolation error of curve against f at checkpoints points.
+static double Error(const vector<CurvePoint>& curve, const function<double(double)>& f, size_t checkpoints) {
+	double tmp = 0.0;
+	for (size_t i = 0; i < checkpoints; i++) {
+		double x = START + (END - START) * double(i) / double(checkpoints - 1);
+		tmp = max(tmp, fabs(AdaptiveMesh::Interpolate(curve, x) - f(x)));
+	}
+	return tmp;
+}
+
+static vector<CurvePoint> Uniform(const function<double(double)>& f, size_t size) {
+	vector<CurvePoint> tmp(size);
+	for (size_t i = 0; i < size; i++) {
+		tmp[i].x = (i + 1 == size) ? END : START + (END - START) * double(i) / double(size - 1);
+		tmp[i].y = f(tmp[i].x);
+	}
+	return tmp;
+}
+
+static bool Ordered(const vector<CurvePoint>& curve) {
+	bool tmp = !curve.empty() && curve.front().x == START && curve.back().x == END;
+	for (size_t i = 1; i < curve.size(); i++)
+		tmp = tmp && curve[i - 1].x < curve[i].x;
+	return tmp;
+}
+
+int main(int argc, char* argv[]) {
+	size_t checkpoints = (argc > 1) ? strtoul(argv[1], 0, 10) : 20001;
+	if (checkpoints < 2)
+		checkpoints = 2;
+	EuropeanOption option(0.25, 100.0, 0.2, 0.05, 0.05, 0.0, 0.0, "C");
+	bool ok = true;
+
+	const char* value[] = { "Price", "Delta", "Gamma" };
+	function<double(double)> curve[] = {
+		[&option](double S) { return option.Price(S); },
+		[&option](double S) { return option.Delta(S); },
+		[&option](double S) { return option.Gamma(S); }
+	};
+	for (size_t v = 0; v < 3; v++) {
+		AdaptiveMeshSpec spec;
+		spec.tolerance = (v == 2) ? 1e-5 : 1e-4;
+		size_t calls = 0;
+		function<double(double)> f = curve[v];
+		vector<CurvePoint> adaptive = AdaptiveMesh::Sample([&](double S) {
+			calls++;
+			return f(S);
+		}, START, END, spec);
+		double error = Error(adaptive, f, checkpoints);
+		size_t larger = adaptive.size() + adaptive.size() / 4;
+		double uniform = Error(Uniform(f, larger), f, checkpoints);
+		cout << value[v] << ": " << adaptive.size() << " points, max error " << error << ", uniform " << larger << " points, max error " << uniform << endl;
+		ok &= Check(string(value[v]) + " points are the evaluations, in order", calls == adaptive.size() && Ordered(adaptive));
+		ok &= Check(string(value[v]) + " within the tolerance", error <= spec.tolerance);
+		ok &= Check(string(value[v]) + " uniform mesh less accurate with 1.25 times the evaluations", uniform > error);
+		vector<CurvePoint> batch = AdaptiveMesh::Curve(option, value[v], START, END, spec);
+		ok &= Check(string(value[v]) + " batch curve within the tolerance", Ordered(batch) && Error(batch, f, checkpoints) <= spec.tolerance);
+	}
+
+	AmericanOption american(100.0, 0.1, 0.1, 0.02, 0.0, 0.0, "C");
+	vector<CurvePoint> perpetual = AdaptiveMesh::Curve(american, START, END);
+	double error = Error(perpetual, [&american](double S) { return american.Price(S); }, checkpoints);
+	ok &= Check("American price curve of " + to_string(perpetual.size()) + " points within the tolerance",
+		Ordered(perpetual) && error <= AdaptiveMeshSpec().tolerance);
+
+	AdaptiveMeshSpec small;
+	small.maxPoints = 100;
+	ok &= Check("Refinement stops at maxPoints", AdaptiveMesh::Curve(option, "Price", START, END, small).size() <= small.maxPoints);
+	ok &= Check("Wrong range gives no points", AdaptiveMesh::Curve(option, "Price", END, START).empty());
+
+	return Result(ok);
+}
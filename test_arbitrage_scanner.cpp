@@ -0,0 +1,175 @@
+// test_arbitrage_scanner.cpp
+//
+// Arbitrage scanner over Black-Scholes books with planted violations
+//
+// Usage: test_arbitrage_scanner [underlyings] [threads]
+// Builds a book of underlyings (default 20) with 4 expiries and 101 strikes
+// each, priced with Black-Scholes so that it is free of arbitrage, and checks
+// that the scanner finds nothing. Then plants one violation of every kind and
+// checks that each is reported with the quotes involved, and that a book with
+// many planted violations gives the same report on 1 and on threads (default 4)
+// threads and with every supported CpuDispatch variant. Quotes with the same time
+// to expiry T - t through t are grouped together for the strike and calendar
+// checks.
+// Exits with 1 when a check fails.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "arbitrage_scanner.hpp"
+#include "cpu_dispatch.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+static const size_t STRIKES = 101;
+static const double EXPIRY[] = { 0.25, 0.5, 1.0, 2.0 };
+static const size_t EXPIRIES = sizeof(EXPIRY) / sizeof(EXPIRY[0]);
+
+// Quotes in underlying, expiry, strike order; strikes 50 to 150, no dividend yield.
+static vector<MarketQuote> Book(size_t underlyings) {
+	vector<MarketQuote> tmp;
+	for (size_t u = 0; u < underlyings; u++) {
+		for (size_t e = 0; e < EXPIRIES; e++) {
+			for (size_t k = 0; k < STRIKES; k++) {
+				MarketQuote q;
+				OptionData data = { EXPIRY[e], 50.0 + double(k), 0.2 + 0.01 * double(u % 5), 0.03, 0.03, 0.0, 0.0 };
+				q.data = data;
+				q.S = 90.0 + double(u);
+				q.call = EuropeanOptionFunction::CallPrice(data, q.S);
+				q.put = EuropeanOptionFunction::PutPrice(data, q.S);
+				q.underlying = uint32_t(u);
+				tmp.push_back(q);
+			}
+		}
+	}
+	return tmp;
+}
+
+static size_t Quote(size_t u, size_t e, size_t k) {
+	return (u * EXPIRIES + e) * STRIKES + k;
+}
+
+// Whether a violation of kind with quotes a, b, c was reported.
+static bool Found(const vector<ArbitrageViolation>& violations, ArbitrageKind kind, size_t a, size_t b = ARBITRAGE_NO_QUOTE, size_t c = ARBITRAGE_NO_QUOTE) {
+	for (size_t i = 0; i < violations.size(); i++) {
+		const ArbitrageViolation& v = violations[i];
+		if (v.kind == kind && v.quote[0] == a && v.quote[1] == b && v.quote[2] == c && v.amount > 0.0)
+			return true;
+	}
+	return false;
+}
+
+static bool Before(const ArbitrageViolation& x, const ArbitrageViolation& y) {
+	if (x.kind != y.kind)
+		return x.kind < y.kind;
+	return lexicographical_compare(x.quote, x.quote + 3, y.quote, y.quote + 3);
+}
+
+static bool Same(const ArbitrageViolation& x, const ArbitrageViolation& y) {
+	return x.kind == y.kind && equal(x.quote, x.quote + 3, y.quote) && x.amount == y.amount;
+}
+
+// Same quotes, amounts within CpuDispatch::TOLERANCE of the variants.
+static bool Close(const ArbitrageViolation& x, const ArbitrageViolation& y) {
+	return x.kind == y.kind && equal(x.quote, x.quote + 3, y.quote) && fabs(x.amount - y.amount) <= CpuDispatch::TOLERANCE;
+}
+
+// Moves the valuation date of a quote by t, same time to expiry and prices.
+static void Shift(MarketQuote& q, double t) {
+	q.data.T += t;
+	q.data.t += t;
+}
+
+int main(int argc, char* argv[]) {
+	size_t underlyings = (argc > 1) ? strtoul(argv[1], 0, 10) : 20;
+	size_t threads = (argc > 2) ? strtoul(argv[2], 0, 10) : 4;
+	if (underlyings < 1)
+		underlyings = 1;
+	bool ok = true;
+
+	ArbitrageScanner scanner(ArbitrageTolerance(), threads);
+	vector<MarketQuote> clean = Book(underlyings);
+	vector<ArbitrageViolation> violations = scanner.Scan(clean);
+	ArbitrageScanner::Print(violations);
+	ok &= Check("Black-Scholes book of " + to_string(clean.size()) + " quotes has no violation", violations.empty());
+
+	// One planted violation of every kind.
+	vector<MarketQuote> book = clean;
+	book[Quote(0, 1, 50)].put += 0.01;
+	ok &= Check("Parity", Found(scanner.Scan(book), PUT_CALL_PARITY, Quote(0, 1, 50)));
+
+	book = clean;
+	book[Quote(0, 1, 51)].call = book[Quote(0, 1, 50)].call + 0.01;
+	ok &= Check("Call rising with strike", Found(scanner.Scan(book), CALL_STRIKE, Quote(0, 1, 50), Quote(0, 1, 51)));
+
+	book = clean;
+	book[Quote(0, 1, 49)].put = book[Quote(0, 1, 50)].put + 0.01;
+	ok &= Check("Put falling with strike", Found(scanner.Scan(book), PUT_STRIKE, Quote(0, 1, 49), Quote(0, 1, 50)));
+
+	book = clean;
+	book[Quote(0, 1, 50)].call += 0.1;
+	ok &= Check("Call butterfly", Found(scanner.Scan(book), CALL_CONVEXITY, Quote(0, 1, 49), Quote(0, 1, 50), Quote(0, 1, 51)));
+
+	book = clean;
+	book[Quote(0, 1, 50)].put += 0.1;
+	ok &= Check("Put butterfly", Found(scanner.Scan(book), PUT_CONVEXITY, Quote(0, 1, 49), Quote(0, 1, 50), Quote(0, 1, 51)));
+
+	book = clean;
+	book[Quote(0, 2, 50)].call = book[Quote(0, 1, 50)].call - 0.01;
+	ok &= Check("Calendar", Found(scanner.Scan(book), CALENDAR, Quote(0, 1, 50), Quote(0, 2, 50)));
+
+	// Shuffled book with many violations, on 1 and on threads threads.
+	book = clean;
+	for (size_t i = 0; i < book.size(); i += 37)
+		book[i].call *= 1.0 + 0.02 * double(i % 3);
+	for (size_t i = 0; i < book.size(); i++)
+		swap(book[i], book[(i * 7919) % book.size()]);
+	vector<ArbitrageViolation> one = ArbitrageScanner(ArbitrageTolerance(), 1).Scan(book);
+	vector<ArbitrageViolation> several = scanner.Scan(book);
+	sort(one.begin(), one.end(), Before);
+	sort(several.begin(), several.end(), Before);
+	cout << one.size() << " violations in the shuffled book" << endl;
+	ok &= Check("Same report on 1 and " + to_string(threads) + " threads",
+		!one.empty() && one.size() == several.size() && equal(one.begin(), one.end(), several.begin(), Same));
+
+
+	// Every CpuDispatch variant reports what ISA_BASELINE reports.
+	CpuIsa active = CpuDispatch::Active();
+	CpuDispatch::Select(ISA_BASELINE);
+	vector<ArbitrageViolation> baseline = scanner.Scan(book);
+	sort(baseline.begin(), baseline.end(), Before);
+	for (int isa = ISA_SSE2; isa < ISA_COUNT; isa++) {
+		if (!CpuDispatch::Supported(CpuIsa(isa)))
+			continue;
+		CpuDispatch::Select(CpuIsa(isa));
+		vector<ArbitrageViolation> variant = scanner.Scan(book);
+		sort(variant.begin(), variant.end(), Before);
+		ok &= Check(string("Same report as the baseline, ") + CpuDispatch::Name(CpuIsa(isa)),
+			variant.size() == baseline.size() && equal(variant.begin(), variant.end(), baseline.begin(), Close));
+	}
+	CpuDispatch::Select(active);
+
+	// Every other strike of the T = 0.5 chain valued half a year earlier: the same
+	// time to expiry, one group with the other strikes, none with the T = 1 chain.
+	book = clean;
+	for (size_t k = 0; k < STRIKES; k += 2)
+		Shift(book[Quote(0, 1, k)], 0.5);
+	ok &= Check("Quotes grouped by time to expiry", scanner.Scan(book).empty());
+	book[Quote(0, 1, 51)].call = book[Quote(0, 1, 50)].call + 0.01;
+	ok &= Check("Call rising with strike across valuation dates", Found(scanner.Scan(book), CALL_STRIKE, Quote(0, 1, 50), Quote(0, 1, 51)));
+	book = clean;
+	Shift(book[Quote(0, 1, 50)], 0.5);	// T = 1 as the next expiry, a shorter time to expiry.
+	book[Quote(0, 2, 50)].call = book[Quote(0, 1, 50)].call - 0.01;
+	ok &= Check("Calendar in time to expiry order", Found(scanner.Scan(book), CALENDAR, Quote(0, 1, 50), Quote(0, 2, 50)));
+
+	return Result(ok);
+}
@@ -0,0 +1,188 @@
+// test_async_pricing.cpp
+//
+// Asynchronous pricing jobs
+//
+// Usage: test_async_pricing [size] [threads]
+// Prices a European call over size spot prices (default 100000) on an executor
+// with threads workers (default 4) and compares with the synchronous prices;
+// checks the chunk and progress callbacks, cancellation of queued and of
+// running chunks, and that an exception thrown by a kernel or a callback is
+// rethrown by Get() instead of ending the program or leaving Get() waiting,
+// with the executor still usable afterwards. Then fails each allocation of
+// Run() in turn, Submit() included, and checks that Get() rethrows the bad_alloc
+// instead of waiting for chunks that were never submitted.
+// Exits with 1 when a check fails.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "async_pricing.hpp"
+#include "european_option.hpp"
+#include "option_function.hpp"
+#include "pricing_executor.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+// Allocation failAt of this thread, counted from the last reset of allocations, throws bad_alloc.
+static thread_local long allocations = 0;
+static thread_local long failAt = 0;
+
+void* operator new(size_t size) {
+	if (failAt > 0 && ++allocations == failAt)
+		throw bad_alloc();
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+// Outcome of Get(): "value", "cancelled" or the message of another exception.
+static string Outcome(const PricingJob& job) {
+	try {
+		job.Get();
+		return "value";
+	} catch (const PricingCancelled&) {
+		return "cancelled";
+	} catch (const exception& e) {
+		return e.what();
+	}
+}
+
+int main(int argc, char* argv[]) {
+	size_t size = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000;
+	size_t threads = (argc > 2) ? strtoul(argv[2], 0, 10) : 4;
+	if (size < 2)
+		size = 2;
+
+	PricingExecutor executor(threads);
+	PricingExecutor single(1);
+	EuropeanOption option(1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0, "C");
+	vector<double> S = MeshArray(50.0, 150.0, 100.0 / double(size - 1));
+	bool ok = true;
+
+	// Result and callbacks.
+	AsyncPricingOptions options;
+	options.executor = &executor;
+	options.chunkSize = 1000;
+	atomic<size_t> received(0);
+	double last = 0.0;
+	bool increasing = true;
+	options.onChunk = [&](size_t, const vector<double>& values) { received += values.size(); };
+	options.onProgress = [&](double done) {
+		increasing = increasing && done > last;
+		last = done;
+	};
+	PricingJob job = AsyncPricing::Price(option, S, options);
+	vector<double> async = job.Get();
+	ok &= Check("Same prices as EuropeanOption::Price", async == option.Price(S));
+	ok &= Check("Chunks cover every element", received == S.size());
+	ok &= Check("Progress increases to 1", increasing && last == 1.0 && job.Progress() == 1.0 && job.IsDone());
+
+	// Cancel from the first chunk, the queued chunks are skipped.
+	AsyncPricingOptions cancelling;
+	cancelling.executor = &single;
+	cancelling.chunkSize = 100;
+	PricingJob first;
+	size_t chunks = 0;
+	cancelling.onChunk = [&](size_t, const vector<double>&) {
+		chunks++;
+		first.Cancel();
+	};
+	atomic<bool> release(false);
+	single.Submit([&]() {	// Holds the worker until the handle is set.
+		while (!release)
+			this_thread::sleep_for(chrono::milliseconds(1));
+	});
+	first = AsyncPricing::Price(option, S, cancelling);
+	release = true;
+	ok &= Check("Cancelled job throws PricingCancelled", Outcome(first) == "cancelled");
+	ok &= Check("Queued chunks skipped", chunks == 1 && first.IsCancelled() && first.Progress() < 1.0);
+
+	// Cancel a running chunk, the kernel stops at its next check.
+	atomic<bool> started(false);
+	AsyncPricingOptions running;
+	running.executor = &executor;
+	PricingJob spinning = AsyncPricing::Run(1, [&](size_t, size_t, double*, const atomic<bool>& cancelled) {
+		started = true;
+		while (!cancelled)
+			this_thread::sleep_for(chrono::milliseconds(1));
+	}, running);
+	while (!started)
+		this_thread::sleep_for(chrono::milliseconds(1));
+	spinning.Cancel();
+	ok &= Check("Running chunk stops on Cancel()", Outcome(spinning) == "cancelled");
+
+	// Exceptions of the kernel and of the callbacks.
+	AsyncPricingOptions failing;
+	failing.executor = &single;
+	failing.chunkSize = 100;
+	PricingJob kernel = AsyncPricing::Evaluate(S, [](double x) -> double {
+		if (x > 100.0)
+			throw runtime_error("kernel failed");
+		return x;
+	}, failing);
+	ok &= Check("Kernel exception rethrown by Get()", Outcome(kernel) == "kernel failed");
+	ok &= Check("Failed job stops the other chunks", kernel.Progress() < 1.0);
+
+	failing.executor = &executor;
+	failing.onProgress = [](double done) {
+		if (done >= 0.5)
+			throw runtime_error("callback failed");
+	};
+	ok &= Check("Callback exception rethrown by Get()", Outcome(AsyncPricing::Price(option, S, failing)) == "callback failed");
+	failing.onProgress = function<void(double)>();
+	failing.onChunk = [](size_t, const vector<double>&) { throw logic_error("every chunk failed"); };
+	ok &= Check("Exception of every chunk rethrown once", Outcome(AsyncPricing::Price(option, S, failing)) == "every chunk failed");
+
+	// Allocations of Run() failing, in Submit() the later chunks are never submitted.
+	AsyncPricingOptions small;
+	small.executor = &executor;
+	small.chunkSize = 1;
+	AsyncPricing::ChunkKernel index = [](size_t begin, size_t end, double* out, const atomic<bool>&) {
+		for (size_t i = begin; i < end; i++)
+			out[i - begin] = double(i);
+	};
+	allocations = 0;
+	failAt = 1L << 40;
+	vector<double> indices = AsyncPricing::Run(64, index, small).Get();
+	long count = allocations;
+	failAt = 0;
+	size_t rethrown = 0, thrown = 0;
+	bool returned = indices.size() == 64 && indices[63] == 63.0;
+	for (long n = 1; n <= count && returned; n++) {
+		PricingJob job;
+		allocations = 0;
+		failAt = n;
+		try {
+			job = AsyncPricing::Run(64, index, small);
+		} catch (const bad_alloc&) {
+			thrown++;	// Before any chunk was submitted.
+		}
+		failAt = 0;
+		returned = job.Future().wait_for(chrono::seconds(10)) == future_status::ready;
+		string outcome = returned ? Outcome(job) : "";
+		rethrown += outcome == bad_alloc().what() ? 1 : 0;
+		returned = returned && (outcome == bad_alloc().what() || outcome == "value");
+	}
+	cout << rethrown << " failed jobs and " << thrown << " failed Run() calls of " << count << " allocations" << endl;
+	ok &= Check("Failed Submit() rethrown by Get()", returned && rethrown > 0);
+
+	ok &= Check("Executors still run jobs", AsyncPricing::Price(option, S, options).Get() == async
+		&& AsyncPricing::Price(option, S, cancelling).Get() == async);
+
+	return Result(ok);
+}
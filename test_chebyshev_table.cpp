@@ -0,0 +1,124 @@
+// test_chebyshev_table.cpp
+//
+// Chebyshev table accuracy and Save/Load round trip
+//
+// Usage: test_chebyshev_table [points]
+// Builds the default table and compares call and put prices at points (default
+// 100000) random options inside the domain with EuropeanOptionFunction. The
+// error per unit of discounted strike must stay within twice MaxError(), which
+// is measured on a grid and not a bound. Then saves the table, loads it back
+// and checks for the same prices bit for bit, that truncated and corrupted
+// files are rejected without changing the table, and that Build() reports a
+// spec whose maxColumns cannot reach targetError.
+// Exits with 1 when a check fails.
+//
+
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "chebyshev_table.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+// Reads a whole file.
+static string ReadFile(const string& fileName) {
+	ifstream in(fileName.c_str(), ios::binary);
+	ostringstream os;
+	os << in.rdbuf();
+	return os.str();
+}
+
+static void WriteFile(const string& fileName, const string& bytes) {
+	ofstream out(fileName.c_str(), ios::binary);
+	out.write(bytes.data(), bytes.size());
+}
+
+int main(int argc, char* argv[]) {
+	size_t points = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000;
+	bool ok = true;
+
+	ChebyshevTableSpec spec;
+	ChebyshevTable table;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ok &= Check("Default spec meets its target error", table.Build(spec) && table.MaxError() <= spec.targetError);
+	cout << table.Tiles() << " tiles in " << Seconds(start) << " s, measured error " << table.MaxError() << endl;
+
+	// Random options with (x, w) inside the domain.
+	mt19937_64 rng(42);
+	uniform_real_distribution<double> uniform(0.0, 1.0);
+	vector<OptionData> option(points);
+	vector<double> S(points);
+	for (size_t i = 0; i < points; i++) {
+		OptionData data = { 0.05 + 1.95 * uniform(rng), 100.0, 0.0, 0.05 * uniform(rng), 0.04 * uniform(rng) - 0.02, 0.0, 0.0 };
+		double w = spec.wMin + (spec.wMax - spec.wMin) * uniform(rng);
+		double x = spec.xMin + (spec.xMax - spec.xMin) * uniform(rng);
+		data.sig = w / sqrt(data.T);
+		option[i] = data;
+		S[i] = data.K * exp(x - data.b * data.T);
+	}
+
+	double callError = 0.0, putError = 0.0;
+	for (size_t i = 0; i < points; i++) {
+		double scale = option[i].K * exp(-option[i].r * option[i].T);
+		callError = fmax(callError, fabs(table.CallPrice(option[i], S[i]) - EuropeanOptionFunction::CallPrice(option[i], S[i])) / scale);
+		putError = fmax(putError, fabs(table.PutPrice(option[i], S[i]) - EuropeanOptionFunction::PutPrice(option[i], S[i])) / scale);
+	}
+	ok &= Difference("Call error per discounted strike", callError, 2.0 * table.MaxError());
+	ok &= Difference("Put error per discounted strike", putError, 2.0 * table.MaxError() + 1e-13);
+
+	vector<double> price(points);
+	table.CallPrice(option.data(), S.data(), price.data(), points);
+	bool same = true;
+	for (size_t i = 0; i < points; i++)
+		same = same && price[i] == table.CallPrice(option[i], S[i]);
+	ok &= Check("Book version gives the single option prices", same);
+
+	// Save/Load round trip.
+	ostringstream name;
+	name << "/tmp/test_chebyshev_table_" << getpid();
+	string fileName = name.str();
+	ChebyshevTable loaded;
+	ok &= Check("Save and Load", table.Save(fileName) && loaded.Load(fileName));
+	same = loaded.Tiles() == table.Tiles() && loaded.MaxError() == table.MaxError()
+		&& loaded.MaxDeltaError() == table.MaxDeltaError() && loaded.Spec().degree == spec.degree;
+	for (size_t i = 0; i < points; i++) {
+		same = same && loaded.CallPrice(option[i], S[i]) == table.CallPrice(option[i], S[i])
+			&& loaded.CallDelta(option[i], S[i]) == table.CallDelta(option[i], S[i])
+			&& loaded.Gamma(option[i], S[i]) == table.Gamma(option[i], S[i]);
+	}
+	ok &= Check("Loaded table gives the same bits", same);
+
+	string bytes = ReadFile(fileName);
+	WriteFile(fileName, bytes.substr(0, bytes.size() / 2));
+	bool rejected = !loaded.Load(fileName);
+	string corrupted = bytes;
+	corrupted[0] = 'X';
+	WriteFile(fileName, corrupted);
+	rejected = rejected && !loaded.Load(fileName) && !loaded.Load(fileName + ".missing");
+	ok &= Check("Truncated, corrupted and missing files rejected", rejected
+		&& loaded.Tiles() == table.Tiles() && loaded.CallPrice(option[0], S[0]) == table.CallPrice(option[0], S[0]));
+	remove(fileName.c_str());
+
+	// Target out of reach of maxColumns.
+	ChebyshevTableSpec coarse;
+	coarse.rows = 8;
+	coarse.maxColumns = coarse.minColumns;
+	coarse.targetError = 1e-14;
+	ChebyshevTable small;
+	ok &= Check("Unreachable target reported", !small.Build(coarse) && !small.Empty() && small.MaxError() > coarse.targetError);
+
+	return Result(ok);
+}
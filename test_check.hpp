@@ -0,0 +1,47 @@
+// test_check.hpp
+//
+// Header file for the checks shared by the tests.
+// A check prints its name, marked FAILED when it does not hold, and returns
+// whether it holds; Result() prints the verdict of all checks and returns the
+// exit code of the test.
+//
+
+#ifndef TEST_CHECK_HPP_
+#define TEST_CHECK_HPP_
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace OptionFunction {
+namespace TestCheck {
+
+inline bool Check(const string& name, bool ok) {
+	cout << name << (ok ? "" : "  FAILED") << endl;
+	return ok;
+}
+
+// Largest difference found against its tolerance.
+inline bool Difference(const string& name, double worst, double tolerance) {
+	bool ok = worst <= tolerance;
+	cout << name << ": max difference " << worst << (ok ? "" : "  FAILED") << endl;
+	return ok;
+}
+
+// Wall time since start.
+inline double Seconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// "OK" and 0 when every check held, "FAILED" and 1 otherwise.
+inline int Result(bool ok) {
+	cout << (ok ? "OK" : "FAILED") << endl;
+	return ok ? 0 : 1;
+}
+
+}	// Namespace TestCheck.
+}	// Namespace OptionFunction.
+
+#endif	// TEST_CHECK_HPP_
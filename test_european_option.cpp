@@ -81,6 +81,15 @@ int main(void) {
 	cout << "P = " << Batch4.Price(100.0) << endl;
 	cout << string(75, '-') << endl;
 
+	// Batch1 valued at t = 0.10 with expiry T = 0.35, same time to expiry as Batch1.
+	OptData = { 0.35, 65.0, 0.30, 0.08, 0.08, 0.10, 0.0 };
+	EuropeanOption Batch1Later(OptData, "C");
+	cout << "Batch1 at t = 0.10, T = 0.35" << endl;
+	cout << "C = " << Batch1Later.Price(60.0) << endl;
+	Batch1Later.toggle();
+	cout << "P = " << Batch1Later.Price(60.0) << endl;
+	cout << string(75, '-') << endl;
+
 	// Put-call parity.
 	cout << "*** Put-call parity ***\n\n";
 	cout << "Batch1" << endl;
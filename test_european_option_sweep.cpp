@@ -0,0 +1,93 @@
+// test_european_option_sweep.cpp
+//
+// Concurrent parameter sweeps of one shared European option
+//
+// Usage: test_european_option_sweep [threads] [rounds]
+// Threads sweep every OptionData field of the same const EuropeanOption at the
+// same time, small sweeps on the calling thread and large ones that run on
+// several threads themselves, and compare with sweeps computed beforehand.
+// Build with -fsanitize=thread to check the sweeps for data races.
+// Exits with 1 when a price or the option differs.
+//
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "european_option.hpp"
+#include "option_data.hpp"
+#include "option_function.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+struct Sweep {
+	string name;
+	vector<double> param;
+	vector<double> expected;
+};
+
+static bool SameData(const OptionData& a, const OptionData& b) {
+	return a.T == b.T && a.K == b.K && a.sig == b.sig && a.r == b.r && a.b == b.b && a.t == b.t && a.q == b.q;
+}
+
+int main(int argc, char* argv[]) {
+	size_t threads = (argc > 1) ? strtoul(argv[1], 0, 10) : 8;
+	size_t rounds = (argc > 2) ? strtoul(argv[2], 0, 10) : 20;
+
+	const EuropeanOption option(1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0, "C");
+	const OptionData original = option.Get();
+	const double S = 105.0;
+
+	// Every field, small and large (parallel) sweeps. Expected prices come from
+	// scalar pricing of a modified copy.
+	const string names[] = { "T", "K", "sig", "r", "b", "t", "q" };
+	const double start[] = { 0.1, 50.0, 0.05, 0.0, -0.05, 0.0, 0.0 };
+	const double step[] = { 0.5, 20.0, 0.1, 0.02, 0.02, 0.1, 0.01 };
+	vector<Sweep> sweeps;
+	for (size_t n = 0; n < 7; n++) {
+		for (size_t size = 16; size <= 20000; size *= 1250) {
+			Sweep tmp;
+			tmp.name = names[n];
+			for (size_t i = 0; i < size; i++) {
+				double x = start[n] + step[n] * double(i % 5) + 1e-5 * double(i);
+				tmp.param.push_back(x);
+				OptionData data = original;
+				SetParam(data, names[n], x);
+				tmp.expected.push_back(EuropeanOption(data, "C").Price(S));
+			}
+			sweeps.push_back(tmp);
+		}
+	}
+
+	atomic<size_t> mismatches(0);
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([&, t]() {
+			for (size_t round = 0; round < rounds; round++) {
+				const Sweep& sweep = sweeps[(t + round) % sweeps.size()];
+				vector<double> price = option.Price(sweep.param, sweep.name, S);
+				if (price.size() != sweep.expected.size()) {
+					mismatches++;
+					continue;
+				}
+				for (size_t i = 0; i < price.size(); i++) {
+					if (price[i] != sweep.expected[i] && !(price[i] != price[i] && sweep.expected[i] != sweep.expected[i]))
+						mismatches++;
+				}
+				if (!SameData(option.Get(), original))
+					mismatches++;
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	bool wrongName = option.Price(sweeps[0].param, "x", S).empty();
+	cout << threads << " threads, " << rounds << " sweeps each over " << sweeps.size() << " sweeps of all fields" << endl;
+	cout << "Mismatches: " << mismatches << endl;
+	cout << "Option unchanged: " << (SameData(option.Get(), original) ? "yes" : "no") << endl;
+	return (mismatches == 0 && wrongName && SameData(option.Get(), original)) ? 0 : 1;
+}
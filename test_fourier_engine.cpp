@@ -0,0 +1,96 @@
+// test_fourier_engine.cpp
+//
+// FFT strike chains against closed form and strike by strike prices
+//
+// Usage: test_fourier_engine [expiries] [threads]
+// Prices a lognormal chain against EuropeanOptionFunction, a Heston chain
+// against the Lewis integral, checks that repricing an expiry with new strikes
+// and spot prices hits the cache and that threads do not change the chain
+// prices, and prints the time of a chain with and without the cache.
+// Exits with 1 when a price differs by more than 1e-5.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "european_option_function.hpp"
+#include "fourier_engine.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+int main(int argc, char* argv[]) {
+	size_t expiries = (argc > 1) ? strtoul(argv[1], 0, 10) : 12;
+	size_t threads = (argc > 2) ? strtoul(argv[2], 0, 10) : 0;
+
+	OptionData data = { 1.0, 100.0, 0.2, 0.05, 0.02, 0.0, 0.0 };
+	double S = 100.0;
+	vector<double> K;
+	for (double k = 50.0; k <= 200.0; k += 2.5)
+		K.push_back(k);
+	bool ok = true;
+
+	// Lognormal model, closed form.
+	FourierEngine lognormal(FourierFunction::BlackScholes(data.sig));
+	vector<double> call = lognormal.Price(data, K, 'C', S);
+	vector<double> put = lognormal.Price(data, K, 'P', S);
+	double worst = 0.0;
+	for (size_t i = 0; i < K.size(); i++) {
+		OptionData strike = data;
+		strike.K = K[i];
+		worst = max(worst, fabs(call[i] - EuropeanOptionFunction::CallPrice(strike, S)));
+		worst = max(worst, fabs(put[i] - EuropeanOptionFunction::PutPrice(strike, S)));
+	}
+	ok &= Difference("Black-Scholes chain", worst, 1e-5);
+
+	// Heston with skew, strike by strike integral.
+	HestonParams heston = { 0.04, 1.5, 0.04, 0.5, -0.7 };
+	FourierEngine engine(heston);
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	call = engine.Price(data, K, 'C', S);
+	double missTime = Seconds(t0);
+	worst = 0.0;
+	t0 = chrono::steady_clock::now();
+	for (size_t i = 0; i < K.size(); i++)
+		worst = max(worst, fabs(call[i] - engine.IntegralPrice(data, K[i], 'C', S)));
+	double integralTime = Seconds(t0);
+	ok &= Difference("Heston chain", worst, 1e-5);
+
+	// Same expiry, other strikes and spot: no new grid.
+	uint64_t misses = engine.CacheMisses();
+	vector<double> shifted(K);
+	for (size_t i = 0; i < shifted.size(); i++)
+		shifted[i] += 1.25;
+	t0 = chrono::steady_clock::now();
+	vector<double> again = engine.Price(data, shifted, 'P', 101.0);
+	double hitTime = Seconds(t0);
+	worst = 0.0;
+	for (size_t i = 0; i < K.size(); i += 8)
+		worst = max(worst, fabs(again[i] - engine.IntegralPrice(data, shifted[i], 'P', 101.0)));
+	ok &= Difference("Heston cached chain", worst, 1e-5);
+	ok &= Check("No cache miss on a strike change", engine.CacheMisses() == misses);
+
+	// Expiries in parallel.
+	vector<FourierExpiry> chain;
+	for (size_t e = 1; e <= expiries; e++) {
+		FourierExpiry tmp = { data, (e & 1) ? 'C' : 'P', S, K };
+		tmp.data.T = 0.125 * double(e);
+		chain.push_back(tmp);
+	}
+	engine.Clear();
+	t0 = chrono::steady_clock::now();
+	vector<vector<double> > parallel = engine.Price(chain, threads);
+	double chainTime = Seconds(t0);
+	engine.Clear();
+	vector<vector<double> > serial = engine.Price(chain, 1);
+	ok &= Check("Thread count does not change the chain prices", parallel == serial);
+
+	cout << K.size() << " strikes: FFT " << missTime * 1e6 << " us, cached " << hitTime * 1e6 << " us, strike by strike "
+		<< integralTime * 1e6 << " us; " << expiries << " expiries " << chainTime * 1e6 << " us" << endl;
+	return TestCheck::Result(ok);
+}
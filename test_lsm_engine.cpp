@@ -0,0 +1,79 @@
+// test_lsm_engine.cpp
+//
+// Least squares Monte Carlo against published and closed form prices
+//
+// Usage: test_lsm_engine [paths] [dates] [threads]
+// Prices the American put of Longstaff and Schwartz (2001), table 1 (S 36,
+// K 40, sig 0.2, r 0.06, T 1, finite difference value 4.478), checks that the
+// in sample price and the out of sample lower bound bracket it within the
+// discretization and sampling error, that an American call without dividends
+// is worth the European call, and that the thread count does not change the
+// price. Then prices the put with paths x dates (default 250000 x 252, pass
+// 1000000 252 for the full size run) and reports the time and state memory.
+// Exits with 1 when a check fails.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "european_option_function.hpp"
+#include "lsm_engine.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+int main(int argc, char* argv[]) {
+	size_t paths = (argc > 1) ? strtoul(argv[1], 0, 10) : 250000;
+	size_t dates = (argc > 2) ? strtoul(argv[2], 0, 10) : 252;
+	size_t threads = (argc > 3) ? strtoul(argv[3], 0, 10) : 0;
+
+	OptionData put = { 1.0, 40.0, 0.2, 0.06, 0.06, 0.0, 0.0 };
+	double S = 36.0;
+	LsmSpec spec;
+	spec.threads = threads;
+	bool ok = true;
+
+	LsmResult result = LsmEngine(put, 'P', spec).Price(S);
+	cout << "American put: in sample " << result.price << " +- " << result.stdError << ", lower bound "
+		<< result.lowerBound << " +- " << result.lowerStdError << endl;
+	ok &= Check("In sample price within 0.03 of 4.478", fabs(result.price - 4.478) <= 0.03);
+	ok &= Check("Lower bound below 4.478 + 3 standard errors", result.lowerBound <= 4.478 + 3.0 * result.lowerStdError);
+	ok &= Check("Lower bound within 0.05 of 4.478", fabs(result.lowerBound - 4.478) <= 0.05);
+	ok &= Check("Above the European put", result.lowerBound > EuropeanOptionFunction::PutPrice(put, S));
+
+	LsmSpec monomial = spec;
+	monomial.basis = LSM_MONOMIAL;
+	monomial.degree = 2;
+	LsmResult other = LsmEngine(put, 'P', monomial).Price(S);
+	ok &= Check("Monomial basis within 0.03 of 4.478", fabs(other.price - 4.478) <= 0.03);
+
+	OptionData call = { 1.0, 100.0, 0.25, 0.05, 0.05, 0.0, 0.0 };
+	LsmResult american = LsmEngine(call, 'C', spec).Price(100.0);
+	double european = EuropeanOptionFunction::CallPrice(call, 100.0);
+	ok &= Check("Call without dividends within 4 standard errors of " + to_string(european),
+		fabs(american.price - european) <= 4.0 * american.stdError && fabs(american.lowerBound - european) <= 4.0 * american.lowerStdError);
+
+	LsmSpec one = spec, several = spec;
+	one.threads = 1;
+	several.threads = 3;
+	LsmResult a = LsmEngine(put, 'P', one).Price(S), b = LsmEngine(put, 'P', several).Price(S);
+	ok &= Check("1 and 3 threads give the same bits", a.price == b.price && a.lowerBound == b.lowerBound);
+
+	// Large run.
+	LsmSpec large = spec;
+	large.paths = paths;
+	large.dates = dates;
+	large.lowerPaths = paths / 4;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	LsmResult big = LsmEngine(put, 'P', large).Price(S);
+	double seconds = Seconds(start);
+	cout << paths << " paths x " << dates << " dates: " << big.price << " +- " << big.stdError << ", lower bound " << big.lowerBound
+		<< " +- " << big.lowerStdError << " in " << seconds << " s, state " << 2.0 * 8.0 * double(paths) / 1048576.0 << " MB" << endl;
+
+	return TestCheck::Result(ok);
+}
@@ -0,0 +1,115 @@
+// test_option_chain.cpp
+//
+// Chain engine grouping and prices
+//
+// Usage: test_option_chain [underlyings]
+// Builds a book of underlyings (default 50) with three expiries each, a smile
+// of strikes per expiry, calls and puts, plus a contract with the same T - t
+// through t, zero volatility and expired ones, and checks the grouping stats and that
+// every supported CpuDispatch variant gives the EuropeanOptionFunction book
+// prices within CpuDispatch::TOLERANCE * max(price, K), in book order.
+// Exits with 1 when a check fails.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "cpu_dispatch.hpp"
+#include "european_option_function.hpp"
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+// Worst error of price against the book kernels, relative to max(price, K).
+static double Worst(const vector<ChainOption>& book, const vector<double>& price) {
+	double worst = 0.0;
+	for (size_t i = 0; i < book.size(); i++) {
+		double expected;
+		if (book[i].optType == 'P')
+			EuropeanOptionFunction::PutPrice(&book[i].data, &book[i].S, &expected, 1);
+		else
+			EuropeanOptionFunction::CallPrice(&book[i].data, &book[i].S, &expected, 1);
+		double error = fabs(price[i] - expected) / max(fabs(expected), book[i].data.K);
+		if (!(error <= worst))
+			worst = error;	// NaN included.
+	}
+	return worst;
+}
+
+int main(int argc, char* argv[]) {
+	size_t underlyings = (argc > 1) ? strtoul(argv[1], 0, 10) : 50;
+	bool ok = true;
+
+	// underlyings x 3 expiries x 2 types x 21 strikes, 126 options per underlying in 3 chains.
+	const double T[] = { 0.1, 0.5, 2.0 };
+	vector<ChainOption> book;
+	for (size_t u = 0; u < underlyings; u++) {
+		double S = 50.0 + double(u);
+		for (size_t e = 0; e < 3; e++) {
+			for (size_t k = 0; k < 21; k++) {
+				for (size_t type = 0; type < 2; type++) {
+					OptionData data = { T[e], S * (0.5 + 0.05 * double(k)), 0.15 + 0.01 * double(k % 7), 0.03, 0.01, 0.0, 0.0 };
+					ChainOption o = { data, S, uint32_t(u), type ? 'P' : 'C' };
+					book.push_back(o);
+				}
+			}
+		}
+	}
+
+	// Same time to expiry as the T = 0.5 chain of underlying 0 through t, joins
+	// it; zero volatility and expired contracts, each a chain of its own.
+	OptionData shifted = { 1.5, 95.0, 0.2, 0.03, 0.01, 1.0, 0.0 };	// T - t = 0.5.
+	ChainOption o = { shifted, 50.0, 0, 'C' };
+	book.push_back(o);
+	OptionData flat = { 1.0, 80.0, 0.0, 0.03, 0.01, 0.0, 0.0 };
+	ChainOption zeroVol = { flat, 100.0, uint32_t(underlyings), 'C' };
+	book.push_back(zeroVol);
+	OptionData expired = { 1.0, 120.0, 0.2, 0.03, 0.01, 1.0, 0.0 };
+	ChainOption atExpiry = { expired, 100.0, uint32_t(underlyings + 1), 'P' };
+	book.push_back(atExpiry);
+
+	OptionChainEngine engine(book);
+	ChainGroupingStats stats = engine.Stats();
+	engine.Print();
+	ok &= Check("Grouped by underlying and time to expiry", stats.options == book.size() && stats.chains == 3 * underlyings + 2
+		&& stats.largest == 43 && stats.singletons == 2);
+	ok &= Check("Mean size and terms saved", stats.meanSize == double(book.size()) / stats.chains
+		&& stats.termsSaved == 4 * (book.size() - stats.chains));
+
+	CpuIsa active = CpuDispatch::Active();
+	for (int isa = 0; isa < ISA_COUNT; isa++) {
+		if (!CpuDispatch::Supported(CpuIsa(isa)))
+			continue;
+		CpuDispatch::Select(CpuIsa(isa));
+		vector<double> price = engine.Price();
+		ok &= Difference(string("Prices against EuropeanOptionFunction, ") + CpuDispatch::Name(CpuIsa(isa)),
+			Worst(book, price), CpuDispatch::TOLERANCE);
+
+		vector<OptionData> data(book.size());
+		vector<double> spot(book.size()), call(book.size());
+		for (size_t i = 0; i < book.size(); i++) {
+			data[i] = book[i].data;
+			spot[i] = book[i].S;
+		}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t r = 0; r < 20; r++)
+			engine.Price(price.data());
+		double chainSeconds = Seconds(start);
+		start = chrono::steady_clock::now();
+		for (size_t r = 0; r < 20; r++)
+			EuropeanOptionFunction::CallPrice(data.data(), spot.data(), call.data(), call.size());
+		double bookSeconds = Seconds(start);
+		cout << CpuDispatch::Name(CpuIsa(isa)) << ": chain " << 1e9 * chainSeconds / (20.0 * book.size())
+			<< " ns/option, book CallPrice " << 1e9 * bookSeconds / (20.0 * book.size()) << " ns/option" << endl;
+	}
+	CpuDispatch::Select(active);
+
+	return Result(ok);
+}
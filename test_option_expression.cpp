@@ -0,0 +1,103 @@
+// test_option_expression.cpp
+//
+// Lazy option expressions against the vector functions
+//
+// Usage: test_option_expression [mesh points] [repeats]
+// Evaluates the same chains (mesh, price, parity, greeks, user transform) with
+// the EuropeanOptionFunction vector versions and with Lazy expressions, checks
+// that they agree and prints the time per point of both.
+// Exits with 1 when a value differs by more than 1e-12 of max(value, K).
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "european_option.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "option_expression.hpp"
+#include "option_function.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+// Scaled payoff of a user transform.
+struct Scaled {
+	double factor;
+	double operator () (double x) const {
+		return factor * x * x;
+	}
+};
+
+// Largest difference relative to max(|eager|, K), infinite for different sizes.
+static double Worst(const vector<double>& eager, const vector<double>& lazy, double K) {
+	if (eager.size() != lazy.size())
+		return HUGE_VAL;
+	double worst = 0.0;
+	for (size_t i = 0; i < eager.size(); i++)
+		worst = max(worst, fabs(eager[i] - lazy[i]) / max(fabs(eager[i]), K));
+	return worst;
+}
+
+static bool Check(const string& name, const vector<double>& eager, const vector<double>& lazy, double K) {
+	return Difference(name + ", " + to_string(eager.size()) + " points, relative", Worst(eager, lazy, K), 1e-12);
+}
+
+int main(int argc, char* argv[]) {
+	size_t points = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000;
+	size_t repeats = (argc > 2) ? strtoul(argv[2], 0, 10) : 20;
+	if (points < 2)
+		points = 2;
+
+	OptionData data = { 0.5, 100.0, 0.3, 0.05, 0.02, 0.0, 0.0 };
+	EuropeanOption put(data, "P");
+	double start = 50.0, end = 150.0, h = (end - start) / double(points - 1);
+	Scaled scaled = { 0.5 };
+
+	bool ok = true;
+	ok &= Check("MeshArray", MeshArray(start, end, h), Lazy::ToVector(Lazy::Mesh(start, end, h)), 1.0);
+	ok &= Check("CallPrice", EuropeanOptionFunction::CallPrice(data, start, end, h),
+		Lazy::ToVector(Lazy::CallPrice(data, Lazy::Mesh(start, end, h))), data.K);
+	ok &= Check("CallToPut", EuropeanOptionFunction::CallToPut(data, start, end, h),
+		Lazy::ToVector(Lazy::CallToPut(data, Lazy::Mesh(start, end, h))), data.K);
+	ok &= Check("PutToCall", EuropeanOptionFunction::PutToCall(data, start, end, h),
+		Lazy::ToVector(Lazy::PutToCall(data, Lazy::Mesh(start, end, h))), data.K);
+	ok &= Check("Price", put.Price(start, end, h), Lazy::ToVector(Lazy::Price(put, Lazy::Mesh(start, end, h))), data.K);
+	ok &= Check("Delta", put.Delta(start, end, h), Lazy::ToVector(Lazy::Delta(put, Lazy::Mesh(start, end, h))), 1.0);
+	ok &= Check("Gamma", put.Gamma(start, end, h), Lazy::ToVector(Lazy::Gamma(put, Lazy::Mesh(start, end, h))), 1.0);
+
+	// Straddle minus a transform of the spot, over an existing spot vector.
+	vector<double> S = MeshArray(start, end, h);
+	vector<double> eager, lazy;
+	vector<double> call = EuropeanOptionFunction::CallPrice(data, S);
+	vector<double> parity = EuropeanOptionFunction::CallToPut(data, S);
+	for (size_t i = 0; i < S.size(); i++)
+		eager.push_back(call[i] + parity[i] - scaled(S[i]) / data.K);
+	Lazy::Store(Lazy::CallPrice(data, Lazy::Span(S)) + Lazy::CallToPut(data, Lazy::Span(S))
+		- Lazy::Map(Lazy::Span(S), scaled) / data.K, lazy);
+	ok &= Check("Chain", eager, lazy, data.K);
+
+	// Time of the parity chain summed over the mesh.
+	double eagerSum = 0.0, lazySum = 0.0;
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeats; r++) {
+		vector<double> tmp = EuropeanOptionFunction::CallToPut(data, MeshArray(start, end, h));
+		for (size_t i = 0; i < tmp.size(); i++)
+			eagerSum += tmp[i];
+	}
+	double eagerTime = Seconds(t0);
+	t0 = chrono::steady_clock::now();
+	for (size_t r = 0; r < repeats; r++)
+		lazySum += Lazy::Sum(Lazy::CallToPut(data, Lazy::Mesh(start, end, h)));
+	double lazyTime = Seconds(t0);
+	double scale = 1e9 / double(repeats * points);
+	cout << "CallToPut(MeshArray) summed: vectors " << eagerTime * scale << " ns/point, lazy "
+		<< lazyTime * scale << " ns/point (" << eagerSum - lazySum << " difference)" << endl;
+
+	return TestCheck::Result(ok);
+}
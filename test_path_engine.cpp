@@ -0,0 +1,88 @@
+// test_path_engine.cpp
+//
+// Shared path Monte Carlo against closed form prices and separate simulations
+//
+// Usage: test_path_engine [paths] [threads]
+// Prices European, Asian, barrier and lookback payoffs on one set of paths,
+// checks the European prices against Black-Scholes, in + out barriers against
+// the European price, a path function against the built in payoff, and that
+// 1, 3 and threads threads and a repeated run give the same bits, then times
+// the shared paths against one simulation per payoff.
+// Exits with 1 when a check fails.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "path_engine.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+int main(int argc, char* argv[]) {
+	size_t paths = (argc > 1) ? strtoul(argv[1], 0, 10) : 100000;
+	size_t threads = (argc > 2) ? strtoul(argv[2], 0, 10) : 4;
+
+	OptionData data = { 1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0 };
+	double S = 100.0;
+	size_t steps = 52;
+	const PathPayoff payoffs[] = {
+		{ PATH_EUROPEAN, 'C', 100.0, 0.0 }, { PATH_EUROPEAN, 'P', 100.0, 0.0 },
+		{ PATH_ASIAN, 'C', 100.0, 0.0 }, { PATH_ASIAN, 'P', 100.0, 0.0 },
+		{ PATH_UP_AND_OUT, 'C', 100.0, 130.0 }, { PATH_UP_AND_IN, 'C', 100.0, 130.0 },
+		{ PATH_DOWN_AND_OUT, 'P', 100.0, 80.0 }, { PATH_DOWN_AND_IN, 'P', 100.0, 80.0 },
+		{ PATH_LOOKBACK_FIXED, 'C', 100.0, 0.0 }, { PATH_LOOKBACK_FLOATING, 'P', 0.0, 0.0 }
+	};
+	const char* names[] = { "European call", "European put", "Asian call", "Asian put", "Up and out call", "Up and in call",
+		"Down and out put", "Down and in put", "Fixed lookback call", "Floating lookback put" };
+	size_t count = sizeof(payoffs) / sizeof(payoffs[0]);
+
+	PathEngine engine(data, S, steps);
+	for (size_t i = 0; i < count; i++)
+		engine.Add(payoffs[i]);
+	double K = data.K;
+	engine.Add([K](const double* path, size_t size) { return max(path[size - 1] - K, 0.0); });
+
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	vector<PathResult> shared = engine.Price(paths, 7, threads);
+	double sharedTime = Seconds(t0);
+	for (size_t i = 0; i < count; i++)
+		cout << names[i] << ": " << shared[i].price << " +- " << shared[i].stdError << endl;
+
+	bool ok = true;
+	double call = EuropeanOptionFunction::CallPrice(data, S), put = EuropeanOptionFunction::PutPrice(data, S);
+	ok &= Check("European call within 4 standard errors of " + to_string(call), fabs(shared[0].price - call) <= 4.0 * shared[0].stdError);
+	ok &= Check("European put within 4 standard errors of " + to_string(put), fabs(shared[1].price - put) <= 4.0 * shared[1].stdError);
+	ok &= Check("Up and out + up and in = European call", fabs(shared[4].price + shared[5].price - shared[0].price) <= 1e-10 * call);
+	ok &= Check("Down and out + down and in = European put", fabs(shared[6].price + shared[7].price - shared[1].price) <= 1e-10 * put);
+	ok &= Check("Path function = European call", fabs(shared[count].price - shared[0].price) <= 1e-12 * call);
+	vector<PathResult> serial = engine.Price(paths, 7, 1);
+	vector<PathResult> other = engine.Price(paths, 7, 3);
+	vector<PathResult> repeat = engine.Price(paths, 7, threads);
+	bool same = true;
+	for (size_t i = 0; i < serial.size(); i++) {
+		same = same && serial[i].price == shared[i].price && serial[i].stdError == shared[i].stdError
+			&& other[i].price == shared[i].price && repeat[i].price == shared[i].price;
+	}
+	ok &= Check("1, 3 and " + to_string(threads) + " threads and a repeated run give the same bits", same);
+
+	// One simulation per payoff.
+	t0 = chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++) {
+		PathEngine single(data, S, steps);
+		single.Add(payoffs[i]);
+		single.Price(paths, 7, threads);
+	}
+	double separateTime = Seconds(t0);
+	cout << count << " payoffs, " << paths << " paths of " << steps << " steps, " << engine.BlockPaths() << " paths per block: shared "
+		<< sharedTime * 1e3 << " ms, separate " << separateTime * 1e3 << " ms" << endl;
+
+	return TestCheck::Result(ok);
+}
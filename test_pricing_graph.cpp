@@ -0,0 +1,241 @@
+// test_pricing_graph.cpp
+//
+// Incremental recomputation of a pricing graph against full recomputation
+//
+// Usage: test_pricing_graph [underlyings] [contracts] [threads]
+// Builds a graph of underlyings (default 16) independent subgraphs, each with
+// spot, vol and rate inputs, contracts (default 64) European and American
+// calls and puts, their aggregate and two hedges. Checks the first Recompute()
+// against the closed form prices, that Set() marks exactly the dependents of an
+// input and Recompute() brings only those up to date with the same values as a
+// full recomputation of a new graph, and that a Recompute() spread over an
+// executor with threads workers (default 4) gives the same bits as on one thread.
+// Then fails each allocation of a parallel Recompute() in turn and checks that
+// the bad_alloc reaches the calling thread, the nodes stay dirty and the next
+// Recompute() gives the values of a full recomputation.
+// Exits with 1 when a check fails.
+//
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "american_option_function.hpp"
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "pricing_executor.hpp"
+#include "pricing_graph.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+// Allocation failAt, counted from the last reset of allocations, throws bad_alloc.
+static atomic<long> allocations(0);
+static atomic<long> failAt(0);
+
+void* operator new(size_t size) {
+	if (failAt > 0 && ++allocations == failAt)
+		throw bad_alloc();
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+// Input nodes of one underlying.
+struct Underlying {
+	size_t spot;
+	size_t vol;
+	size_t rate;
+};
+
+// Adds one subgraph per underlying with the given input values; nodes of
+// graphs built with the same sizes have the same ids.
+static vector<Underlying> Build(PricingGraph& graph, size_t underlyings, size_t contracts, const vector<double>& input) {
+	vector<Underlying> tmp(underlyings);
+	for (size_t u = 0; u < underlyings; u++) {
+		tmp[u].spot = graph.AddInput(input[3 * u]);
+		tmp[u].vol = graph.AddInput(input[3 * u + 1]);
+		tmp[u].rate = graph.AddInput(input[3 * u + 2]);
+		vector<size_t> member;
+		vector<double> weight;
+		for (size_t c = 0; c < contracts; c++) {
+			GraphContract contract;
+			OptionData data = { 0.25 + 0.25 * double(c % 4), 80.0 + 2.0 * double(c % 21), 0.2, 0.03, 0.02, 0.0, 0.0 };
+			contract.data = data;
+			contract.optType = (c % 2) ? 'P' : 'C';
+			contract.american = c % 3 == 0;
+			contract.spot = tmp[u].spot;
+			contract.vol = tmp[u].vol;
+			contract.rate = (c % 5 == 0) ? NO_NODE : tmp[u].rate;
+			contract.carry = NO_NODE;
+			member.push_back(graph.AddContract(contract));
+			weight.push_back((c % 2) ? -1.0 : 2.0);
+		}
+		size_t aggregate = graph.AddAggregate(member, weight);
+		graph.AddHedge(aggregate);
+		graph.AddHedge(aggregate, member[0]);
+	}
+	return tmp;
+}
+
+static vector<double> Inputs(size_t underlyings) {
+	vector<double> tmp;
+	for (size_t u = 0; u < underlyings; u++) {
+		tmp.push_back(90.0 + double(u));
+		tmp.push_back(0.15 + 0.01 * double(u % 10));
+		tmp.push_back(0.01 + 0.002 * double(u % 5));
+	}
+	return tmp;
+}
+
+// Whether every node of a and b has the same value and delta.
+static bool SameNodes(const PricingGraph& a, const PricingGraph& b) {
+	if (a.Size() != b.Size())
+		return false;
+	for (size_t i = 0; i < a.Size(); i++) {
+		if (a.Value(i) != b.Value(i) || a.Delta(i) != b.Delta(i) || a.IsDirty(i) || b.IsDirty(i))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	size_t underlyings = (argc > 1) ? strtoul(argv[1], 0, 10) : 16;
+	size_t contracts = (argc > 2) ? strtoul(argv[2], 0, 10) : 64;
+	size_t threads = (argc > 3) ? strtoul(argv[3], 0, 10) : 4;
+	if (underlyings < 2)
+		underlyings = 2;
+	if (contracts < 1)
+		contracts = 1;
+	size_t perUnderlying = 3 + contracts + 3;
+	bool ok = true;
+
+	vector<double> input = Inputs(underlyings);
+	PricingGraph graph;
+	vector<Underlying> node = Build(graph, underlyings, contracts, input);
+	ok &= Check("One subgraph per underlying", graph.Subgraphs() == underlyings);
+	graph.Recompute();
+	const PricingGraphStats& stats = graph.LastRecompute();
+	ok &= Check("First Recompute() prices every contract in 4 kernel calls",
+		stats.contracts == underlyings * contracts && stats.aggregates == 3 * underlyings && stats.kernelCalls == 4 && graph.Dirty() == 0);
+
+	// Closed form prices of the first underlying.
+	double worst = 0.0;
+	for (size_t c = 0; c < contracts; c++) {
+		OptionData data = { 0.25 + 0.25 * double(c % 4), 80.0 + 2.0 * double(c % 21), input[1], (c % 5 == 0) ? 0.03 : input[2], 0.02, 0.0, 0.0 };
+		bool put = c % 2 == 1;
+		double price = (c % 3 == 0)
+			? (put ? AmericanOptionFunction::PutPrice(data, input[0]) : AmericanOptionFunction::CallPrice(data, input[0]))
+			: (put ? EuropeanOptionFunction::PutPrice(data, input[0]) : EuropeanOptionFunction::CallPrice(data, input[0]));
+		worst = max(worst, fabs(graph.Value(3 + c) - price) / max(price, 1.0));
+	}
+	ok &= Difference("Contracts against the closed form, relative", worst, 1e-10);
+	size_t aggregate = 3 + contracts;
+	ok &= Check("Hedges make the aggregate delta neutral",
+		fabs(graph.Delta(aggregate) + graph.Value(aggregate + 1)) <= 1e-12 * max(fabs(graph.Delta(aggregate)), 1.0)
+		&& fabs(graph.Delta(aggregate) + graph.Value(aggregate + 2) * graph.Delta(3)) <= 1e-9 * max(fabs(graph.Delta(aggregate)), 1.0));
+
+	// One input changed: only its dependents are recomputed.
+	size_t u = underlyings / 2;
+	input[3 * u] *= 1.01;
+	graph.Set(node[u].spot, input[3 * u]);
+	ok &= Check("Set() marks the contracts, aggregate and hedges of the spot", graph.Dirty() == contracts + 3
+		&& graph.IsDirty(node[u].spot + 3) && !graph.IsDirty(node[u].vol) && !graph.IsDirty(node[u - 1].spot + 3));
+	graph.Recompute();
+	ok &= Check("Recompute() reprices the dirty nodes only", stats.contracts == contracts && stats.aggregates == 3);
+	graph.Set(node[u].spot, input[3 * u]);
+	ok &= Check("Unchanged value marks nothing", graph.Dirty() == 0);
+	input[3 * u + 2] += 0.01;
+	graph.Set(node[u].rate, input[3 * u + 2]);
+	size_t linked = 0;
+	for (size_t c = 0; c < contracts; c++)
+		linked += (c % 5 == 0) ? 0 : 1;
+	ok &= Check("Contracts with their own rate stay clean", graph.Dirty() == linked + 3 && !graph.IsDirty(node[u].spot + 3));
+	graph.Recompute();
+	{
+		PricingGraph full;
+		Build(full, underlyings, contracts, input);
+		full.Recompute();
+		ok &= Check("Same values as a full recomputation", SameNodes(graph, full));
+	}
+
+	// Many inputs changed, some twice.
+	for (size_t n = 0; n < 5 * underlyings; n++) {
+		size_t i = (n * 7) % input.size();
+		input[i] *= (i % 3 == 0) ? 0.995 : 1.02;
+		graph.Set(i / 3 * perUnderlying + i % 3, input[i]);
+	}
+	graph.Recompute();
+	{
+		PricingGraph full;
+		Build(full, underlyings, contracts, input);
+		full.Recompute();
+		ok &= Check("Same values as a full recomputation after many changes", SameNodes(graph, full));
+	}
+
+	// Parallel subgraphs.
+	PricingExecutor executor(threads);
+	PricingGraph serial, parallel;
+	vector<Underlying> a = Build(serial, underlyings, contracts, input);
+	vector<Underlying> b = Build(parallel, underlyings, contracts, input);
+	serial.Recompute();
+	parallel.Recompute(&executor);
+	ok &= Check("Executor spreads the subgraphs over " + to_string(executor.Size()) + " tasks",
+		parallel.LastRecompute().tasks == min(executor.Size(), underlyings) && parallel.LastRecompute().contracts == underlyings * contracts);
+	for (size_t v = 0; v < underlyings; v += 3) {
+		serial.Set(a[v].vol, input[3 * v + 1] + 0.05);
+		parallel.Set(b[v].vol, input[3 * v + 1] + 0.05);
+	}
+	serial.Recompute();
+	parallel.Recompute(&executor);
+	ok &= Check("Same bits on one thread and on the executor", SameNodes(serial, parallel));
+
+	// A failed allocation anywhere in a parallel Recompute(): in this thread, in
+	// Submit() or in a task.
+	allocations = 0;
+	failAt = 1L << 40;
+	for (size_t v = 0; v < underlyings; v++)
+		parallel.Set(b[v].vol, parallel.Value(b[v].vol) + 0.01);
+	parallel.Recompute(&executor);
+	long count = allocations;
+	failAt = 0;
+	size_t thrown = 0;
+	bool recovered = true;
+	for (long n = 1; n <= count && recovered; n += max(1L, count / 100)) {
+		for (size_t v = 0; v < underlyings; v++)
+			parallel.Set(b[v].vol, parallel.Value(b[v].vol) + 0.01);
+		size_t dirtyBefore = parallel.Dirty();
+		allocations = 0;
+		failAt = n;
+		try {
+			parallel.Recompute(&executor);
+		} catch (const bad_alloc&) {
+			failAt = 0;
+			thrown++;
+			recovered = parallel.Dirty() == dirtyBefore;
+			parallel.Recompute(&executor);
+		}
+		failAt = 0;
+		vector<double> now(input);
+		for (size_t v = 0; v < underlyings; v++)
+			now[3 * v + 1] = parallel.Value(b[v].vol);
+		PricingGraph full;
+		Build(full, underlyings, contracts, now);
+		full.Recompute();
+		recovered = recovered && SameNodes(parallel, full);
+	}
+	cout << thrown << " failed Recompute() calls of " << count << " allocations" << endl;
+	ok &= Check("Exceptions of the tasks rethrown on the calling thread, nodes left dirty", recovered && thrown > 0);
+
+	return Result(ok);
+}
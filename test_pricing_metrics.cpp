@@ -0,0 +1,151 @@
+// test_pricing_metrics.cpp
+//
+// Pricing metrics counters, histograms and dumps
+//
+// Usage: test_pricing_metrics [threads]
+// Build this test and pricing_metrics.cpp with -DOPTION_PRICING_METRICS.
+// Checks call and element counts, that every latency lands in the bucket whose
+// bounds hold it, percentiles, Reset(), the Prometheus histogram (cumulative
+// buckets, +Inf, sum and count) and JSON dumps with an escaped entry name, and
+// that the counters of threads (default 4) that exited are still in the totals.
+// Exits with 1 when a check fails.
+//
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pricing_metrics.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction::TestCheck;
+
+static void Priced(size_t elements) {
+	PRICING_METRIC("test::Priced(size_t)", elements);
+}
+
+static void Quoted() {
+	PRICING_METRIC("test::\"Quoted\"\\", 1);
+}
+
+// Snapshot of an entry point, calls 0 when it is not listed.
+static PricingMetricSnapshot Find(const string& name) {
+	vector<PricingMetricSnapshot> metrics = PricingMetrics::Collect();
+	for (size_t i = 0; i < metrics.size(); i++) {
+		if (metrics[i].name == name)
+			return metrics[i];
+	}
+	PricingMetricSnapshot none;
+	none.calls = 0;
+	none.elements = 0;
+	none.nanos = 0;
+	return none;
+}
+
+// Value of the Prometheus sample that starts with prefix, -1 when missing.
+static double Sample(const string& dump, const string& prefix) {
+	istringstream in(dump);
+	string line;
+	while (getline(in, line)) {
+		if (line.compare(0, prefix.size(), prefix) == 0)
+			return strtod(line.c_str() + prefix.size(), 0);
+	}
+	return -1.0;
+}
+
+int main(int argc, char* argv[]) {
+	size_t threads = (argc > 1) ? strtoul(argv[1], 0, 10) : 4;
+	bool ok = true;
+
+	ok &= Check("Compiled with OPTION_PRICING_METRICS", PricingMetrics::Enabled());
+	if (!PricingMetrics::Enabled())
+		return Result(false);
+
+	// Counts and elements.
+	for (size_t i = 0; i < 5; i++)
+		Priced(10);
+	PricingMetricSnapshot priced = Find("test::Priced(size_t)");
+	ok &= Check("Calls and elements counted", priced.calls == 5 && priced.elements == 50);
+
+	// Buckets: every value within the bounds of its bucket, the last one saturates.
+	bool bounds = true;
+	for (uint64_t nanos = 0; nanos < (uint64_t(1) << 40); nanos = nanos * 3 / 2 + 1) {
+		size_t i = PricingMetrics::BucketIndex(nanos);
+		bounds = bounds && PricingMetricSnapshot::BucketLow(i) <= nanos && nanos < PricingMetricSnapshot::BucketHigh(i)
+			&& (i == 0 || PricingMetricSnapshot::BucketHigh(i - 1) == PricingMetricSnapshot::BucketLow(i));
+	}
+	bounds = bounds && PricingMetrics::BucketIndex(~uint64_t(0)) == PricingMetricSnapshot::BUCKETS - 1;
+	ok &= Check("Latencies within their bucket bounds", bounds);
+
+	PricingMetrics::Site site("test::Buckets");
+	for (size_t i = 0; i < 90; i++)
+		PricingMetrics::Record(site.Id(), 1, 5);
+	for (size_t i = 0; i < 10; i++)
+		PricingMetrics::Record(site.Id(), 2, 1000);
+	PricingMetricSnapshot buckets = Find("test::Buckets");
+	size_t slow = PricingMetrics::BucketIndex(1000);
+	ok &= Check("Histogram buckets", buckets.calls == 100 && buckets.elements == 110 && buckets.nanos == 90 * 5 + 10 * 1000
+		&& buckets.bucket[5] == 90 && buckets.bucket[slow] == 10);
+	ok &= Check("Percentiles", buckets.Percentile(0.5) == 6.0 && buckets.Percentile(0.9) == 6.0
+		&& buckets.Percentile(0.99) == double(PricingMetricSnapshot::BucketHigh(slow)));
+
+	// Dumps.
+	Quoted();
+	ostringstream prometheus, json;
+	PricingMetrics::DumpPrometheus(prometheus);
+	PricingMetrics::DumpJson(json);
+	string label = "{entry=\"test::Buckets\"";
+	double cumulative = -1.0;
+	bool monotonic = true;
+	istringstream lines(prometheus.str());
+	string line;
+	while (getline(lines, line)) {
+		string prefix = "option_pricing_latency_seconds_bucket" + label;
+		if (line.compare(0, prefix.size(), prefix) != 0)
+			continue;
+		double value = strtod(line.c_str() + line.rfind(' '), 0);
+		monotonic = monotonic && value >= cumulative;
+		cumulative = value;
+	}
+	ok &= Check("Prometheus counters", Sample(prometheus.str(), "option_pricing_calls_total" + label + "} ") == 100.0
+		&& Sample(prometheus.str(), "option_pricing_elements_total" + label + "} ") == 110.0);
+	ok &= Check("Prometheus histogram", monotonic && cumulative == 100.0
+		&& Sample(prometheus.str(), "option_pricing_latency_seconds_bucket" + label + ",le=\"+Inf\"} ") == 100.0
+		&& Sample(prometheus.str(), "option_pricing_latency_seconds_count" + label + "} ") == 100.0
+		&& Sample(prometheus.str(), "option_pricing_latency_seconds_sum" + label + "} ") == 10450e-9);
+	ok &= Check("Escaped entry names", prometheus.str().find("entry=\"test::\\\"Quoted\\\"\\\\\"") != string::npos
+		&& json.str().find("\"entry\": \"test::\\\"Quoted\\\"\\\\\"") != string::npos);
+	ok &= Check("JSON dump", json.str().find("{\"entry\": \"test::Priced(size_t)\", \"calls\": 5, \"elements\": 50,") != string::npos
+		&& json.str().find("\"entry\": \"test::Buckets\", \"calls\": 100, \"elements\": 110, \"total_ns\": 10450, \"mean_ns\": 104.5, \"p50_ns\": 6,") != string::npos);
+
+	// Reset.
+	PricingMetrics::Reset();
+	ok &= Check("Reset() drops every entry point", PricingMetrics::Collect().empty());
+	Priced(4);
+	priced = Find("test::Priced(size_t)");
+	ok &= Check("Counts after Reset()", priced.calls == 1 && priced.elements == 4 && Find("test::Buckets").calls == 0);
+
+	// Threads that exit fold their counters into the totals.
+	PricingMetrics::Reset();
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([]() {
+			for (size_t i = 0; i < 100; i++)
+				Priced(3);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	priced = Find("test::Priced(size_t)");
+	ok &= Check("Exited threads kept in the totals", priced.calls == 100 * threads && priced.elements == 300 * threads);
+	Priced(1);
+	PricingMetrics::Reset();
+	Priced(2);
+	priced = Find("test::Priced(size_t)");
+	ok &= Check("Reset() after threads exited", priced.calls == 1 && priced.elements == 2);
+
+	return Result(ok);
+}
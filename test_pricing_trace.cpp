@@ -0,0 +1,233 @@
+// test_pricing_trace.cpp
+//
+// Pricing trace recording and Chrome trace export
+//
+// Usage: test_pricing_trace [threads] [spans]
+// Threads (default 4) each record spans (default 100) into rings of 16 slots,
+// then the export is parsed as JSON and checked: every named thread has its
+// thread_name event, each ring kept its newest 16 spans in order with their
+// items, Dropped() counts the overwritten ones, a disabled span records
+// nothing, names are escaped, and Clear() drops everything, the buffers of
+// exited threads included.
+// Exits with 1 when a check fails.
+//
+
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pricing_trace.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction::TestCheck;
+
+// Parsed JSON value, enough of JSON for the trace export.
+struct JsonValue {
+	enum Type { NUL, NUMBER, STRING, ARRAY, OBJECT } type;
+	double number;
+	string text;
+	vector<JsonValue> items;
+	map<string, JsonValue> members;
+
+	JsonValue() : type(NUL), number(0.0) {
+	}
+
+	const JsonValue& operator [] (const string& key) const {
+		static const JsonValue none;
+		map<string, JsonValue>::const_iterator it = members.find(key);
+		return it == members.end() ? none : it->second;
+	}
+};
+
+// Recursive descent parser, false on a syntax error.
+class JsonParser {
+public:
+	JsonParser(const string& text) : text(text), pos(0) {
+	}
+
+	bool Parse(JsonValue& value) {
+		return Value(value) && (Skip(), pos == text.size());
+	}
+
+private:
+	const string& text;
+	size_t pos;
+
+	void Skip() {
+		while (pos < text.size() && isspace(static_cast<unsigned char>(text[pos])))
+			pos++;
+	}
+
+	bool Accept(char c) {
+		Skip();
+		if (pos < text.size() && text[pos] == c) {
+			pos++;
+			return true;
+		}
+		return false;
+	}
+
+	bool String(string& out) {
+		if (!Accept('"'))
+			return false;
+		out.clear();
+		while (pos < text.size() && text[pos] != '"') {
+			if (text[pos] == '\\' && ++pos == text.size())
+				return false;
+			out += text[pos++];
+		}
+		return Accept('"');
+	}
+
+	bool Value(JsonValue& value) {
+		Skip();
+		if (pos >= text.size())
+			return false;
+		if (text[pos] == '"') {
+			value.type = JsonValue::STRING;
+			return String(value.text);
+		}
+		if (Accept('[')) {
+			value.type = JsonValue::ARRAY;
+			if (Accept(']'))
+				return true;
+			do {
+				value.items.push_back(JsonValue());
+				if (!Value(value.items.back()))
+					return false;
+			} while (Accept(','));
+			return Accept(']');
+		}
+		if (Accept('{')) {
+			value.type = JsonValue::OBJECT;
+			if (Accept('}'))
+				return true;
+			do {
+				string key;
+				if (!String(key) || !Accept(':') || !Value(value.members[key]))
+					return false;
+			} while (Accept(','));
+			return Accept('}');
+		}
+		char* end = 0;
+		value.type = JsonValue::NUMBER;
+		value.number = strtod(text.c_str() + pos, &end);
+		if (end == text.c_str() + pos)
+			return false;
+		pos = end - text.c_str();
+		return true;
+	}
+};
+
+// Exports the trace and parses it, false when the export is not valid JSON.
+static bool Export(JsonValue& trace) {
+	ostringstream out;
+	PricingTrace::WriteChromeTrace(out);
+	trace = JsonValue();
+	return JsonParser(out.str()).Parse(trace) && trace["traceEvents"].type == JsonValue::ARRAY;
+}
+
+// Events of the export with phase ph.
+static vector<JsonValue> Events(const JsonValue& trace, const string& ph) {
+	vector<JsonValue> tmp;
+	const vector<JsonValue>& events = trace["traceEvents"].items;
+	for (size_t i = 0; i < events.size(); i++) {
+		if (events[i]["ph"].text == ph)
+			tmp.push_back(events[i]);
+	}
+	return tmp;
+}
+
+static const size_t RING = 16;
+
+int main(int argc, char* argv[]) {
+	size_t threads = (argc > 1) ? strtoul(argv[1], 0, 10) : 4;
+	size_t spans = (argc > 2) ? strtoul(argv[2], 0, 10) : 100;
+	if (spans < RING)
+		spans = RING;
+	bool ok = true;
+
+	{
+		PricingTrace::Span off("off", "test");	// Tracing is off, not recorded.
+	}
+	PricingTrace::Enable(true, RING);
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([t, spans]() {
+			ostringstream name;
+			name << "worker \"" << t << "\"";
+			PricingTrace::SetThreadName(name.str());
+			for (size_t i = 0; i < spans; i++) {
+				PricingTrace::Span span("stage", "test", i + 1);
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	JsonValue trace;
+	ok &= Check("Export parses as JSON", Export(trace));
+	vector<JsonValue> names = Events(trace, "M");
+	vector<JsonValue> complete = Events(trace, "X");
+
+	// Thread names, escaped quotes included, one per worker and distinct tids.
+	map<double, string> threadName;
+	for (size_t i = 0; i < names.size(); i++)
+		threadName[names[i]["tid"].number] = names[i]["args"]["name"].text;
+	bool named = threadName.size() == threads;
+	for (size_t t = 0; t < threads; t++) {
+		ostringstream name;
+		name << "worker \"" << t << "\"";
+		bool found = false;
+		for (map<double, string>::const_iterator it = threadName.begin(); it != threadName.end(); ++it)
+			found = found || it->second == name.str();
+		named = named && found;
+	}
+	ok &= Check("Thread names of every worker", named);
+
+	// Each ring keeps its newest spans, items spans - RING + 1 to spans, in order.
+	map<double, vector<JsonValue> > byThread;
+	for (size_t i = 0; i < complete.size(); i++)
+		byThread[complete[i]["tid"].number].push_back(complete[i]);
+	bool newest = complete.size() == threads * RING && byThread.size() == threads;
+	for (map<double, vector<JsonValue> >::const_iterator it = byThread.begin(); it != byThread.end(); ++it) {
+		newest = newest && threadName.count(it->first) == 1 && it->second.size() == RING;
+		for (size_t i = 0; newest && i < it->second.size(); i++) {
+			const JsonValue& event = it->second[i];
+			newest = event["name"].text == "stage" && event["cat"].text == "test"
+				&& event["args"]["items"].number == double(spans - RING + 1 + i)
+				&& event["ts"].number >= 0.0 && event["dur"].number >= 0.0
+				&& (i == 0 || event["ts"].number >= it->second[i - 1]["ts"].number);
+		}
+	}
+	ok &= Check("Rings overwritten oldest first", newest);
+	ok &= Check("Dropped() counts the overwritten spans", PricingTrace::Dropped() == threads * (spans - RING));
+
+	// Recorded on this thread, then Clear() frees the exited threads' buffers.
+	PricingTrace::SetThreadName("main");
+	{
+		PricingTrace::Span span("main span", "test", 7);
+	}
+	PricingTrace::Clear();
+	ok &= Check("Clear() drops every span and the exited threads", Export(trace) && Events(trace, "X").empty()
+		&& Events(trace, "M").size() == 1 && Events(trace, "M")[0]["args"]["name"].text == "main"
+		&& PricingTrace::Dropped() == 0);
+
+	{
+		PricingTrace::Span span("after clear", "test", 3);
+	}
+	PricingTrace::Enable(false);
+	{
+		PricingTrace::Span span("disabled", "test", 5);
+	}
+	complete.clear();
+	ok &= Check("Spans after Clear() recorded, disabled spans not", Export(trace) && (complete = Events(trace, "X")).size() == 1
+		&& complete[0]["name"].text == "after clear" && complete[0]["args"]["items"].number == 3.0);
+
+	return Result(ok);
+}
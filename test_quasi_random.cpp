@@ -0,0 +1,107 @@
+// test_quasi_random.cpp
+//
+// Sobol sequence and Brownian bridge
+//
+// Usage: test_quasi_random [log2 points]
+// Draws 2^m points (default and least m = 12) of SobolSequence::MAX_DIMENSIONS
+// dimensions, plain and scrambled, and checks that every one dimensional
+// projection puts one point in each interval of width 2^-m, that adjacent
+// dimensions are uncorrelated (high dimensions need 2^12 points or more), and
+// that Skip() gives the points Next() walks to. Then builds paths of
+// MAX_DIMENSIONS steps through a BrownianBridge and checks the variance of the
+// end point, the midpoint and the increments against the step size.
+// Exits with 1 when a check fails.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "quasi_random.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+int main(int argc, char* argv[]) {
+	size_t m = (argc > 1) ? strtoul(argv[1], 0, 10) : 12;
+	m = min<size_t>(max<size_t>(m, 12), 20);
+	size_t points = size_t(1) << m;
+	const size_t D = SobolSequence::MAX_DIMENSIONS;
+	bool ok = true;
+
+	SobolSequence tooMany(D + 1);
+	ok &= Check("Dimensions above MAX_DIMENSIONS rejected", tooMany.Dimensions() == D && SobolSequence(0).Dimensions() == D);
+
+	for (uint64_t seed = 0; seed < 2; seed++) {
+		SobolSequence sobol(D, seed);
+		vector<double> u(points * D);
+		sobol.Next(u.data(), points);
+
+		// One point per interval, every dimension.
+		bool stratified = sobol.Index() == points;
+		vector<size_t> count(points);
+		for (size_t d = 0; stratified && d < D; d++) {
+			count.assign(points, 0);
+			for (size_t i = 0; i < points; i++) {
+				double x = u[i * D + d];
+				stratified = stratified && x > 0.0 && x < 1.0;
+				count[size_t(x * double(points))]++;
+			}
+			for (size_t j = 0; j < points; j++)
+				stratified = stratified && count[j] == 1;
+		}
+		string name = seed ? ", scrambled" : ", plain";
+		ok &= Check("One dimensional projections stratified" + name, stratified);
+
+		// Covariance of adjacent dimensions.
+		double worst = 0.0;
+		for (size_t d = 0; d + 1 < D; d++) {
+			double sum = 0.0;
+			for (size_t i = 0; i < points; i++)
+				sum += (u[i * D + d] - 0.5) * (u[i * D + d + 1] - 0.5);
+			worst = fmax(worst, fabs(sum / double(points)) * 12.0);
+		}
+		ok &= Difference("Correlation of adjacent dimensions" + name, worst, 0.125);
+
+		// Skip() against Next().
+		bool same = true;
+		vector<double> point(D);
+		const size_t index[] = { 1, 7, points / 2 + 3, points - 1 };
+		for (size_t k = 0; k < 4; k++) {
+			sobol.Skip(index[k]);
+			sobol.Next(point.data());
+			for (size_t d = 0; d < D; d++)
+				same = same && point[d] == u[index[k] * D + d];
+		}
+		ok &= Check("Skip() gives the points of Next()" + name, same && sobol.Index() == points);
+	}
+
+	// Bridge paths on every dimension: Var W(T) = T and Var dW = T / steps.
+	const double T = 2.0;
+	SobolSequence sobol(D, 11);
+	BrownianBridge bridge(D, T);
+	vector<double> u(D), z(D), W(D), dW(D);
+	double end = 0.0, increment = 0.0, mid = 0.0;
+	for (size_t i = 0; i < points; i++) {
+		sobol.Next(u.data());
+		QuasiRandom::InverseNormal(u.data(), z.data(), D);
+		bridge.Path(z.data(), W.data());
+		bridge.Increments(z.data(), dW.data());
+		end += W[D - 1] * W[D - 1];
+		mid += W[D / 2 - 1] * W[D / 2 - 1];
+		for (size_t k = 0; k < D; k++)
+			increment += dW[k] * dW[k];
+	}
+	end /= double(points);
+	mid /= double(points);
+	increment /= double(points) * double(D);
+	cout << "Var W(T) " << end << ", Var W(T / 2) " << mid << ", Var dW " << increment << " * steps / T" << endl;
+	ok &= Difference("Variance of the end point", fabs(end / T - 1.0), 0.01);
+	ok &= Difference("Variance of the midpoint", fabs(2.0 * mid / T - 1.0), 0.01);
+	ok &= Difference("Variance of the increments", fabs(increment * double(D) / T - 1.0), 0.01);
+
+	return Result(ok);
+}
@@ -0,0 +1,103 @@
+// test_quote_cache.cpp
+//
+// Quote cache hits, tolerances, eviction and concurrent use
+//
+// Usage: test_quote_cache [threads] [quotes]
+// Checks that exact and bucketed quotes hit with the price of the first quote
+// in the bucket, that European and American quotes and calls and puts do not
+// share keys, that values too large for a bucket index (a huge strike or spot
+// price with a small step) still get keys of their own, and that the LRU
+// evicts down to the capacity. Then threads (default 4) price the same quotes
+// (default 2000 per thread) through one cache and compare with direct prices.
+// Exits with 1 when a check fails.
+//
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "american_option.hpp"
+#include "european_option.hpp"
+#include "quote_cache.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+int main(int argc, char* argv[]) {
+	size_t threads = (argc > 1) ? strtoul(argv[1], 0, 10) : 4;
+	size_t quotes = (argc > 2) ? strtoul(argv[2], 0, 10) : 2000;
+	bool ok = true;
+
+	EuropeanOption call(1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0, "C");
+	EuropeanOption put(1.0, 100.0, 0.25, 0.05, 0.03, 0.0, 0.0, "P");
+	AmericanOption american(100.0, 0.25, 0.05, 0.03, 0.0, 0.0, "C");
+
+	// Exact matching.
+	QuoteCache exact(100);
+	double first = exact.Price(call, 100.0);
+	double again = exact.Price(call, 100.0);
+	ok &= Check("Exact hit returns the computed price", first == call.Price(100.0) && again == first && exact.Stats().hits == 1);
+	ok &= Check("Nearby spot misses without tolerance", exact.Price(call, 100.0 + 1e-12) == call.Price(100.0 + 1e-12) && exact.Stats().misses == 2);
+	ok &= Check("Calls, puts and American options have their own keys",
+		exact.Price(put, 100.0) == put.Price(100.0) && exact.Price(american, 100.0) == american.Price(100.0));
+
+	// Bucketed spot and parameters.
+	QuoteTolerance tolerance;
+	tolerance.spotAbsolute = 0.01;
+	tolerance.paramStep = 1e-6;
+	QuoteCache bucketed(100, 4, tolerance);
+	double price = bucketed.Price(call, 100.001);
+	ok &= Check("Same bucket hits with the first price", bucketed.Price(call, 100.009) == price && bucketed.Stats().hits == 1);
+	ok &= Check("Hit error within delta times the bucket width", fabs(price - call.Price(100.009)) <= call.Delta(100.0) * 0.01);
+	ok &= Check("Next bucket misses", bucketed.Price(call, 100.011) == call.Price(100.011));
+
+	// Values outside the bucket index range.
+	EuropeanOption huge(1.0, 1e300, 0.25, 0.05, 0.03, 0.0, 0.0, "P");
+	EuropeanOption huger(1.0, 2e300, 0.25, 0.05, 0.03, 0.0, 0.0, "P");
+	double hugePrice = bucketed.Price(huge, 100.0);
+	ok &= Check("Strikes beyond 2^62 steps have their own keys",
+		hugePrice == huge.Price(100.0) && bucketed.Price(huger, 100.0) == huger.Price(100.0) && bucketed.Price(huge, 100.0) == hugePrice);
+	double farSpot = bucketed.Price(call, 1e30);
+	ok &= Check("Spot prices beyond 2^62 buckets have their own keys",
+		farSpot == call.Price(1e30) && bucketed.Price(call, 2e30) == call.Price(2e30) && bucketed.Price(call, 1e30) == farSpot);
+
+	// Eviction.
+	QuoteCache small(4, 1);
+	for (size_t i = 0; i < 10; i++)
+		small.Price(call, 90.0 + double(i));
+	QuoteCacheStats stats = small.Stats();
+	ok &= Check("LRU evicts down to the capacity", stats.size == 4 && stats.evictions == 6);
+	small.Price(call, 99.0);
+	ok &= Check("Most recent quote kept", small.Stats().hits == 1);
+	small.Clear();
+	ok &= Check("Clear() drops every quote", small.Stats().size == 0);
+
+	// Concurrent use.
+	vector<double> S(quotes), expected(quotes);
+	for (size_t i = 0; i < quotes; i++) {
+		S[i] = 50.0 + 100.0 * double(i % 500) / 500.0;
+		expected[i] = call.Price(S[i]);
+	}
+	QuoteCache shared(quotes, 8);
+	atomic<size_t> wrong(0);
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([&, t]() {
+			for (size_t n = 0; n < quotes; n++) {
+				size_t i = (n + t * 97) % quotes;
+				if (shared.Price(call, S[i]) != expected[i])
+					wrong++;
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	stats = shared.Stats();
+	ok &= Check("Concurrent prices equal direct prices", wrong == 0 && stats.hits + stats.misses == threads * quotes && stats.size == 500);
+
+	return Result(ok);
+}
@@ -0,0 +1,121 @@
+// test_reproducible_sum.cpp
+//
+// Reproducible book totals
+//
+// Usage: test_reproducible_sum [size] [max threads]
+// Sums an ill conditioned book of prices and greeks with 1 to max threads and
+// checks that every total has the same bits; compares the time with a plain
+// parallel sum. Exits with 1 on a mismatch.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "reproducible_sum.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+static uint64_t Bits(double x) {
+	uint64_t tmp;
+	memcpy(&tmp, &x, sizeof(tmp));
+	return tmp;
+}
+
+// Plain parallel sum, the order follows the thread count.
+static double NaiveParallelSum(const vector<double>& x, size_t threads) {
+	vector<double> partial(threads, 0.0);
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.push_back(thread([&x, &partial, t, threads]() {
+			double sum = 0.0;
+			for (size_t i = t * x.size() / threads; i < (t + 1) * x.size() / threads; i++)
+				sum += x[i];
+			partial[t] = sum;
+		}));
+	}
+	double sum = 0.0;
+	for (size_t t = 0; t < threads; t++) {
+		workers[t].join();
+		sum += partial[t];
+	}
+	return sum;
+}
+
+template <typename F>
+static double BestMillis(F f) {
+	double best = 1e300;
+	for (int r = 0; r < 5; r++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		f();
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+int main(int argc, char* argv[]) {
+	size_t size = (argc > 1) ? strtoul(argv[1], 0, 10) : 1000000;
+	size_t maxThreads = (argc > 2) ? strtoul(argv[2], 0, 10) : 16;
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	// Rows of price, delta, gamma, vega: long and short positions of very
+	// different size, so the totals cancel and a plain sum depends on the order.
+	const size_t columns = 4;
+	vector<double> book(size * columns);
+	uint64_t seed = 2024;
+	for (size_t i = 0; i < size; i++) {
+		for (size_t c = 0; c < columns; c++) {
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			double u = double(seed >> 11) / 9007199254740992.0;
+			double sign = (seed >> 7) & 1 ? 1.0 : -1.0;
+			book[i * columns + c] = sign * pow(10.0, 8.0 * u - 2.0) * (c + 1);
+		}
+	}
+	vector<double> price(size);
+	for (size_t i = 0; i < size; i++)
+		price[i] = book[i * columns];
+
+	bool ok = true;
+	double reference = ReproducibleSum::Sum(price);
+	vector<double> columnReference = ReproducibleSum::ColumnSums(book.data(), size, columns, 1);
+	cout << size << " options, price total " << setprecision(17) << reference << endl;
+	cout << "threads  naive sum                 reproducible sum          columns" << endl;
+	for (size_t threads = 1; threads <= maxThreads; threads++) {
+		double naive = NaiveParallelSum(price, threads);
+		double sum = ReproducibleSum::ParallelSum(price, threads);
+		vector<double> column = ReproducibleSum::ColumnSums(book.data(), size, columns, threads);
+		bool same = Bits(sum) == Bits(reference);
+		for (size_t c = 0; c < columns; c++) {
+			same = same && Bits(column[c]) == Bits(columnReference[c]);
+			same = same && Bits(column[c]) == Bits(ReproducibleSum::Sum(book.data() + c, size, columns));
+		}
+		ok = ok && same;
+		cout << setw(7) << threads << "  " << setw(24) << naive << "  " << setw(24) << sum
+			<< "  " << (same ? "identical" : "DIFFERENT") << endl;
+	}
+
+	// Chunking does not matter either: the sum of a prefix computed alone equals
+	// the same prefix summed as part of more threads.
+	size_t prefix = size / 3;
+	double alone = ReproducibleSum::Sum(price.data(), prefix);
+	for (size_t threads = 1; threads <= maxThreads; threads++)
+		ok = ok && Bits(alone) == Bits(ReproducibleSum::ParallelSum(price.data(), prefix, threads));
+
+	// Cost relative to the plain parallel sum.
+	size_t threads = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+	volatile double sink = 0.0;
+	double naiveTime = BestMillis([&]() { sink = NaiveParallelSum(price, threads); });
+	double sumTime = BestMillis([&]() { sink = ReproducibleSum::ParallelSum(price, threads); });
+	cout << fixed << setprecision(3) << threads << " threads: naive " << naiveTime << " ms, reproducible "
+		<< sumTime << " ms (" << setprecision(2) << sumTime / naiveTime << "x)" << endl;
+
+	cout << (ok ? "All totals bit identical" : "Totals differ between thread counts") << endl;
+	return ok ? 0 : 1;
+}
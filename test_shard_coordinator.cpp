@@ -0,0 +1,137 @@
+// test_shard_coordinator.cpp
+//
+// Sharded book evaluation with worker processes
+//
+// Usage: test_shard_coordinator [size] [workers]
+// Prices a book of size options (default 1000000) with workers processes
+// (default 4) and compares with PricingProtocol::PriceItems in this process.
+// Then kills the workers with SIGKILL before the first shard is finished and
+// checks that they are restarted from the shard progress with the same prices,
+// and that a run without restarts left reports the unfinished shard.
+// Exits with 1 when a check fails.
+//
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "option_data.hpp"
+#include "pricing_protocol.hpp"
+#include "shard_coordinator.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction::TestCheck;
+
+// Pids of the running children of this process, from /proc.
+static vector<pid_t> Children() {
+	vector<pid_t> tmp;
+	DIR* dir = opendir("/proc");
+	if (!dir)
+		return tmp;
+	for (dirent* entry = readdir(dir); entry; entry = readdir(dir)) {
+		pid_t pid = atoi(entry->d_name);
+		if (pid <= 0)
+			continue;
+		ifstream file(("/proc/" + string(entry->d_name) + "/stat").c_str());
+		string line;
+		if (!getline(file, line) || line.rfind(')') == string::npos)
+			continue;
+		istringstream fields(line.substr(line.rfind(')') + 1));	// State and parent pid after the name.
+		char state = 0;
+		pid_t parent = 0;
+		fields >> state >> parent;
+		if (parent == getpid() && state != 'Z')
+			tmp.push_back(pid);
+	}
+	closedir(dir);
+	return tmp;
+}
+
+// Runs of the kill checks before giving up.
+static const size_t ATTEMPTS = 20;
+
+// Runs the book, killing the workers once while the first shard is unfinished.
+static void RunAndKill(ShardCoordinator& coordinator, SharedBook& book, bool& ok) {
+	atomic<bool> finished(false), killed(false);
+	thread killer([&]() {
+		ShardState* state = book.Shards();
+		while (!finished && !killed) {
+			if (!state[0].done) {
+				vector<pid_t> pid = Children();
+				for (size_t i = 0; i < pid.size(); i++)
+					killed = (kill(pid[i], SIGKILL) == 0) || killed;
+			}
+			this_thread::yield();
+		}
+	});
+	ok = coordinator.Run(book);
+	finished = true;
+	killer.join();
+}
+
+int main(int argc, char* argv[]) {
+	int worker = ShardCoordinator::RunWorker(argc, argv);
+	if (worker >= 0)
+		return worker;
+
+	size_t size = (argc > 1) ? strtoul(argv[1], 0, 10) : 1000000;
+	size_t workers = (argc > 2) ? strtoul(argv[2], 0, 10) : 4;
+	bool ok = true;
+
+	vector<PricingRequestItem> items(size);
+	for (size_t i = 0; i < size; i++) {
+		OptionData data = { 0.25 + 0.5 * double(i % 7) / 7.0, 80.0 + double(i % 41), 0.15 + 0.01 * double(i % 11), 0.03, 0.01, 0.0, 0.0 };
+		items[i] = PricingProtocol::MakeItem(data, (i % 3) ? PRICING_EUROPEAN : PRICING_AMERICAN, (i % 2) ? 'C' : 'P', 100.0);
+	}
+	vector<double> expected(size);
+	PricingProtocol::PriceItems(items.data(), expected.data(), size);
+
+	ShardCoordinator coordinator(workers, SHARD_MAX_WORKERS);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<double> prices = coordinator.Price(items);
+	cout << size << " options on " << coordinator.Workers() << " workers in " << Seconds(start) << " s" << endl;
+	ok &= Check("Same prices as PriceItems", prices == expected && coordinator.Restarts() == 0);
+
+	// Killed workers, restarted. A small shard may finish before the kill
+	// lands, so the run is repeated until a worker dies mid shard.
+	SharedBook book;
+	if (!book.Create(size))
+		return Result(false);
+	for (size_t i = 0; i < size; i++)
+		book.Items()[i] = items[i];
+	bool restarted = false, same = true, finished = false;
+	for (size_t attempt = 0; attempt < ATTEMPTS && !restarted; attempt++) {
+		fill(book.Prices(), book.Prices() + size, 0.0);
+		RunAndKill(coordinator, book, finished);
+		restarted = coordinator.Restarts() >= 1;
+		same = same && finished && vector<double>(book.Prices(), book.Prices() + size) == expected;
+	}
+	ok &= Check("Killed worker restarted", restarted);
+	ok &= Check("Same prices after the restarts", same);
+
+	// Killed workers, no restarts left.
+	ShardCoordinator strict(workers, 0);
+	bool failed = false, consistent = true;
+	for (size_t attempt = 0; attempt < ATTEMPTS && !failed; attempt++) {
+		RunAndKill(strict, book, finished);
+		bool done = true;
+		for (size_t i = 0; i < strict.Workers() && i < size; i++)
+			done = done && book.Shards()[i].done;
+		failed = !finished;
+		consistent = consistent && finished == done && strict.Restarts() == 0;
+	}
+	ok &= Check("Unfinished shard reported without restarts", failed && consistent);
+
+	return Result(ok);
+}
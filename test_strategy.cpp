@@ -0,0 +1,181 @@
+// test_strategy.cpp
+//
+// Fused strategy value and greeks
+//
+// Usage: test_strategy [strategies]
+// Builds random strategies (default 200) of up to 8 legs that share expiries and
+// strikes, and compares the fused price, delta and gamma with the quantity
+// weighted EuropeanOptionFunction values of the legs, vega and theta with central
+// finite differences in sig and t. Checks that expired legs are worth their
+// intrinsic value and zero volatility legs their discounted forward intrinsic
+// value, the factories, operator + and operator *, the Strategy copy of a fixed
+// strategy, the batch versions, and that a leg with a wrong option type is kept
+// as a call with quantity 0 by both FixedStrategy and Strategy.
+// Exits with 1 when a check fails.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "european_option_function.hpp"
+#include "option_data.hpp"
+#include "strategy.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+static bool IsPut(const StrategyLeg& leg) {
+	return leg.optType == 'P' || leg.optType == 'p';
+}
+
+static double LegPrice(const StrategyLeg& leg, double S) {
+	return IsPut(leg) ? EuropeanOptionFunction::PutPrice(leg.data, S) : EuropeanOptionFunction::CallPrice(leg.data, S);
+}
+
+// Quantity weighted sum of the leg values, vega and theta by central differences.
+static StrategyValue Expected(const vector<StrategyLeg>& legs, double S) {
+	const double h = 1e-5;
+	StrategyValue tmp = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (size_t i = 0; i < legs.size(); i++) {
+		const StrategyLeg& leg = legs[i];
+		double q = leg.quantity;
+		StrategyLeg up = leg, down = leg;
+		up.data.sig += h;
+		down.data.sig -= h;
+		tmp.vega += q * (LegPrice(up, S) - LegPrice(down, S)) / (2.0 * h);
+		up = leg;
+		down = leg;
+		up.data.t += h;
+		down.data.t -= h;
+		tmp.theta += q * (LegPrice(up, S) - LegPrice(down, S)) / (2.0 * h);
+		tmp.price += q * LegPrice(leg, S);
+		tmp.delta += q * (IsPut(leg) ? EuropeanOptionFunction::PutDelta(leg.data, S) : EuropeanOptionFunction::CallDelta(leg.data, S));
+		tmp.gamma += q * EuropeanOptionFunction::CallGamma(leg.data, S);
+	}
+	return tmp;
+}
+
+// Largest difference of price and greeks.
+static double Distance(const StrategyValue& a, const StrategyValue& b) {
+	return max(max(max(fabs(a.price - b.price), fabs(a.delta - b.delta)), max(fabs(a.gamma - b.gamma), fabs(a.vega - b.vega))),
+		fabs(a.theta - b.theta));
+}
+
+static StrategyValue Sum(const StrategyValue& a, const StrategyValue& b) {
+	StrategyValue tmp = { a.price + b.price, a.delta + b.delta, a.gamma + b.gamma, a.vega + b.vega, a.theta + b.theta };
+	return tmp;
+}
+
+int main(int argc, char* argv[]) {
+	size_t strategies = (argc > 1) ? strtoul(argv[1], 0, 10) : 200;
+	bool ok = true;
+
+	// Legs drawn from 3 expiries (one through t) and 4 strikes, so legs share
+	// expiry terms and d1, in random order, long and short, calls and puts.
+	const OptionData expiry[] = { { 0.25, 0.0, 0.3, 0.05, 0.02, 0.0, 0.0 }, { 1.0, 0.0, 0.2, 0.05, 0.05, 0.0, 0.0 },
+		{ 2.5, 0.0, 0.25, 0.03, 0.0, 0.5, 0.0 } };
+	const double strike[] = { 80.0, 95.0, 100.0, 120.0 };
+	const char type[] = { 'C', 'P', 'c', 'p' };
+	mt19937_64 rng(7);
+	vector<Strategy> book;
+	vector<double> spot;
+	double fusedError = 0.0, greekError = 0.0;
+	bool price = true;
+	for (size_t s = 0; s < strategies; s++) {
+		vector<StrategyLeg> legs(1 + rng() % 8);
+		for (size_t i = 0; i < legs.size(); i++) {
+			legs[i].data = expiry[rng() % 3];
+			legs[i].data.K = strike[rng() % 4];
+			legs[i].optType = type[rng() % 4];
+			legs[i].quantity = double(int(rng() % 7) - 3);
+		}
+		double S = 70.0 + double(rng() % 60);
+		Strategy strategy(legs);
+		StrategyValue value = strategy.Value(S);
+		StrategyValue expected = Expected(legs, S);
+		fusedError = max(fusedError, max(fabs(value.price - expected.price), fabs(value.delta - expected.delta)) / 100.0
+			+ fabs(value.gamma - expected.gamma));
+		greekError = max(greekError, max(fabs(value.vega - expected.vega), fabs(value.theta - expected.theta)) / 100.0);
+		price = price && strategy.Price(S) == value.price;
+		book.push_back(strategy);
+		spot.push_back(S);
+	}
+	ok &= Difference("Fused price, delta and gamma against the legs", fusedError, 1e-12);
+	ok &= Difference("Fused vega and theta against central differences", greekError, 1e-8);
+	ok &= Check("Price() is the price of Value()", price);
+
+	// Batch versions.
+	vector<StrategyValue> batch = StrategyFunction::Value(book, spot);
+	bool same = batch.size() == book.size();
+	for (size_t i = 0; same && i < batch.size(); i++)
+		same = Distance(batch[i], book[i].Value(spot[i])) == 0.0;
+	ok &= Check("Batch values", same && StrategyFunction::Value(book, vector<double>(1, 100.0)).empty());
+
+	// Expired and zero volatility legs.
+	OptionData expired = { 1.0, 100.0, 0.2, 0.05, 0.02, 1.25, 0.0 };
+	StrategyLeg expiredLegs[] = { { expired, 'C', 2.0 }, { expired, 'P', 1.0 }, { expired, 'p', -1.0 } };
+	expiredLegs[1].data.K = 120.0;
+	StrategyValue atExpiry = FixedStrategy<3>(expiredLegs).Value(110.0);
+	ok &= Check("Expired legs worth their intrinsic value", atExpiry.price == 2.0 * 10.0 + 10.0 && atExpiry.delta == 0.0
+		&& atExpiry.gamma == 0.0 && atExpiry.vega == 0.0 && atExpiry.theta == 0.0);
+
+	OptionData flat = { 1.0, 100.0, 0.0, 0.05, 0.02, 0.0, 0.0 };
+	StrategyLeg flatLegs[] = { { flat, 'C', 3.0 }, { flat, 'P', 5.0 } };
+	StrategyValue zeroVol = FixedStrategy<2>(flatLegs).Value(110.0);
+	double carry = exp(-0.03), forward = 110.0 * carry, discounted = 100.0 * exp(-0.05);
+	ok &= Check("Zero volatility legs worth their discounted forward intrinsic value",
+		fabs(zeroVol.price - 3.0 * (forward - discounted)) < 1e-12 && fabs(zeroVol.delta - 3.0 * carry) < 1e-15
+		&& fabs(zeroVol.theta + 3.0 * (-0.03 * forward + 0.05 * discounted)) < 1e-12 && zeroVol.gamma == 0.0 && zeroVol.vega == 0.0);
+
+	// Factories, operator + and operator *.
+	OptionData data = { 1.0, 100.0, 0.25, 0.04, 0.01, 0.0, 0.0 };
+	const double S = 103.0;
+	double call = EuropeanOptionFunction::CallPrice(data, S), put = EuropeanOptionFunction::PutPrice(data, S);
+	FixedStrategy<2> straddle = StrategyFunction::Straddle(data);
+	FixedStrategy<3> butterfly = StrategyFunction::Butterfly(data, 90.0, 100.0, 110.0, 'C');
+	FixedStrategy<2> calendar = StrategyFunction::Calendar(data, 0.5, 1.5, 'P', 2.0);
+	ok &= Check("Straddle", fabs(straddle.Price(S) - (call + put)) < 1e-12);
+	ok &= Check("Butterfly and calendar quantities", butterfly.Leg(0).quantity == 1.0 && butterfly.Leg(1).quantity == -2.0
+		&& butterfly.Leg(2).quantity == 1.0 && butterfly.Leg(1).data.K == 100.0
+		&& calendar.Leg(0).data.T == 0.5 && calendar.Leg(0).quantity == -2.0 && calendar.Leg(1).quantity == 2.0);
+	FixedStrategy<2> vertical = StrategyFunction::Vertical(data, 95.0, 105.0, 'C');
+	FixedStrategy<2> strangle = StrategyFunction::Strangle(data, 90.0, 110.0, -1.0);
+	FixedStrategy<4> combined = vertical + strangle;
+	FixedStrategy<7> condor = combined + butterfly;
+	ok &= Difference("operator + against the sum of the parts", Distance(combined.Value(S), Sum(vertical.Value(S), strangle.Value(S)))
+		+ Distance(condor.Value(S), Sum(Sum(vertical.Value(S), strangle.Value(S)), butterfly.Value(S))), 1e-12);
+	StrategyValue half = (condor * 0.5).Value(S), whole = condor.Value(S);
+	ok &= Check("operator * scales every leg", Distance(Sum(half, half), whole) == 0.0 && (condor * 0.5).Leg(0).quantity == 0.5 * condor.Leg(0).quantity);
+	Strategy copied(condor);
+	vector<StrategyValue> fixedValues(3);
+	double spots[] = { 90.0, 100.0, 110.0 };
+	condor.Value(spots, fixedValues.data(), 3);
+	ok &= Check("Strategy copy of a fixed strategy", copied.Size() == 7 && Distance(copied.Value(110.0), fixedValues[2]) == 0.0
+		&& Distance(StrategyFunction::Value(&condor.Leg(0), 7, 90.0), fixedValues[0]) == 0.0);
+
+	// A wrong option type is kept as a call with quantity 0 by every constructor.
+	StrategyLeg mixed[] = { { data, 'C', 1.0 }, { data, 'X', 5.0 }, { data, 'P', -1.0 } };
+	mixed[1].data.K = 90.0;
+	StrategyLeg valid[] = { mixed[0], mixed[2] };
+	FixedStrategy<3> fixed(mixed);
+	Strategy dynamic(vector<StrategyLeg>(mixed, mixed + 3));
+	Strategy added;
+	for (size_t i = 0; i < 3; i++)
+		added.Add(mixed[i]);
+	StrategyValue reference = FixedStrategy<2>(valid).Value(S);
+	bool kept = fixed.Size() == 3 && dynamic.Size() == 3 && added.Size() == 3;
+	for (size_t i = 0; kept && i < 3; i++) {
+		kept = fixed.Leg(i).optType == dynamic.Legs()[i].optType && fixed.Leg(i).quantity == dynamic.Legs()[i].quantity
+			&& fixed.Leg(i).quantity == added.Legs()[i].quantity && (fixed.Leg(i).data.K != 90.0
+			|| (fixed.Leg(i).optType == 'C' && fixed.Leg(i).quantity == 0.0));
+	}
+	ok &= Check("Wrong option type kept as a call with quantity 0", kept && Distance(fixed.Value(S), reference) < 1e-15
+		&& Distance(dynamic.Value(S), fixed.Value(S)) == 0.0 && Distance(added.Value(S), fixed.Value(S)) == 0.0);
+
+	return Result(ok);
+}
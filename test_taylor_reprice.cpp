@@ -0,0 +1,157 @@
+// test_taylor_reprice.cpp
+//
+// Taylor repricing against exact prices, and its fallback counts
+//
+// Usage: test_taylor_reprice [contracts] [steps]
+// Builds a book of contracts (default 1000) European calls and puts and walks
+// the market steps times (default 200) in small random moves, checking every
+// answer from the expansion against the exact price within twice the accepted
+// error (the estimate leaves out the third order terms, which dominate for
+// short dated far out of the money contracts). Then checks that moves outside the trust region and moves with an
+// error estimate above the accepted one fall back to the exact price, are
+// counted as such and re-anchor the contract, that contracts without
+// volatility or past expiry always fall back, and that the one contract and
+// whole book versions count the same.
+// Exits with 1 when a check fails.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "taylor_reprice.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+using namespace OptionFunction::TestCheck;
+
+static vector<ChainOption> Book(size_t size) {
+	vector<ChainOption> tmp(size);
+	for (size_t i = 0; i < size; i++) {
+		OptionData data = { 0.1 + 0.9 * double(i % 10) / 9.0, 70.0 + double(i % 61), 0.15 + 0.2 * double(i % 7) / 6.0, 0.03, 0.01, 0.0, 0.0 };
+		tmp[i].data = data;
+		tmp[i].S = 100.0;
+		tmp[i].underlying = 0;
+		tmp[i].optType = (i % 2) ? 'P' : 'C';
+	}
+	return tmp;
+}
+
+// Uniform in [-1, 1].
+static double Move(uint64_t& state) {
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return double(state >> 11) / 4503599627370496.0 - 1.0;
+}
+
+// Whether the counters add up: every fallback outside the region or above the error bound.
+static bool Consistent(const TaylorRepriceStats& stats) {
+	return stats.fallbacks == stats.outsideRegion + stats.errorBound && stats.fallbacks <= stats.queries;
+}
+
+int main(int argc, char* argv[]) {
+	size_t size = (argc > 1) ? strtoul(argv[1], 0, 10) : 1000;
+	size_t steps = (argc > 2) ? strtoul(argv[2], 0, 10) : 200;
+	if (size < 3)
+		size = 3;
+	vector<ChainOption> book = Book(size);
+	TaylorTrustRegion region;
+	bool ok = true;
+
+	// Random walk of small moves, expansion answers checked against exact prices.
+	TaylorRepricer repricer(book, region);
+	vector<double> S(size), sig(size), t(size), price(size);
+	for (size_t i = 0; i < size; i++) {
+		S[i] = book[i].S;
+		sig[i] = book[i].data.sig;
+		t[i] = book[i].data.t;
+	}
+	double hour = min(1.0 / (252.0 * 24.0), 0.05 / double(steps));	// At most half the shortest expiry over the walk.
+	uint64_t state = 1;
+	size_t answered = 0;
+	double worst = 0.0;
+	for (size_t step = 0; step < steps; step++) {
+		double spot = 1.0 + 0.002 * Move(state), vol = 0.001 * Move(state);
+		for (size_t i = 0; i < size; i++) {
+			S[i] *= spot;
+			sig[i] = max(sig[i] + vol, 0.05);
+			t[i] += hour;
+		}
+		uint64_t fallbacks = repricer.Stats().fallbacks;
+		repricer.Price(S.data(), sig.data(), t.data(), price.data());
+		answered += size - (repricer.Stats().fallbacks - fallbacks);
+		for (size_t i = 0; i < size; i++) {
+			double exact = repricer.ExactPrice(i, S[i], sig[i], t[i]);
+			worst = max(worst, fabs(price[i] - exact) / (region.absError + region.relError * exact));
+		}
+	}
+	TaylorRepriceStats stats = repricer.Stats();
+	cout << stats.queries << " queries, " << stats.fallbacks << " fallbacks (" << stats.outsideRegion << " outside the region, "
+		<< stats.errorBound << " above the error bound)" << endl;
+	ok &= Check("Queries counted", stats.queries == size * steps && Consistent(stats));
+	ok &= Check("Most small moves answered from the expansion", answered > size * steps / 2);
+	ok &= Difference("Expansion error over the accepted error", worst, 2.0);	// The estimate leaves out third order terms.
+
+	// Outside the trust region: exact prices, counted, new anchors.
+	repricer.ResetStats();
+	ok &= Check("ResetStats() clears the counters", repricer.Stats().queries == 0 && repricer.Stats().fallbacks == 0);
+	for (size_t i = 0; i < size; i++)
+		S[i] *= 1.0 + 2.0 * region.spotMove;
+	repricer.Price(S.data(), sig.data(), t.data(), price.data());
+	bool exact = true;
+	for (size_t i = 0; i < size; i++)
+		exact = exact && price[i] == repricer.ExactPrice(i, S[i], sig[i], t[i]);
+	stats = repricer.Stats();
+	ok &= Check("Spot jump falls back for every contract", stats.fallbacks == size && stats.outsideRegion == size && exact);
+	repricer.Price(S.data(), sig.data(), t.data(), price.data());
+	ok &= Check("Fallback re-anchors", repricer.Stats().fallbacks == size && repricer.Stats().queries == 2 * size);
+	double nan = numeric_limits<double>::quiet_NaN();
+	repricer.Price(0, nan, sig[0], t[0]);
+	repricer.Price(1, S[1], sig[1] + 2.0 * region.volMove, t[1]);
+	repricer.Price(2, S[2], sig[2], t[2] + 2.0 * region.timeMove);
+	ok &= Check("NaN, vol and time moves outside the region fall back", repricer.Stats().outsideRegion == size + 3 && Consistent(repricer.Stats()));
+
+	// Error bound: a tight accepted error turns the same moves into fallbacks.
+	TaylorTrustRegion tight = region;
+	tight.absError = 1e-12;
+	tight.relError = 0.0;
+	TaylorRepricer strict(book, tight), loose(book, region);
+	vector<double> moved(size);
+	for (size_t i = 0; i < size; i++)
+		moved[i] = book[i].S * 1.01;
+	for (size_t i = 0; i < size; i++) {
+		strict.Price(i, moved[i], book[i].data.sig, book[i].data.t);
+		loose.Price(i, moved[i], book[i].data.sig, book[i].data.t);
+	}
+	ok &= Check("Estimate above a tight accepted error falls back", strict.Stats().errorBound > loose.Stats().errorBound
+		&& strict.Stats().outsideRegion == 0 && Consistent(strict.Stats()));
+
+	// The whole book version counts as the one contract version.
+	TaylorRepricer whole(book, tight);
+	vector<double> vol(size), time(size);
+	for (size_t i = 0; i < size; i++) {
+		vol[i] = book[i].data.sig;
+		time[i] = book[i].data.t;
+	}
+	whole.Price(moved.data(), vol.data(), time.data(), price.data());
+	ok &= Check("Book and contract versions count the same", whole.Stats().fallbacks == strict.Stats().fallbacks
+		&& whole.Stats().errorBound == strict.Stats().errorBound && whole.Stats().queries == strict.Stats().queries);
+
+	// No expansion without volatility or past expiry.
+	vector<ChainOption> degenerate(2, book[0]);
+	degenerate[0].data.sig = 0.0;
+	degenerate[1].data.t = degenerate[1].data.T + 0.1;
+	TaylorRepricer flat(degenerate, region);
+	double forward = degenerate[0].S * exp((degenerate[0].data.b - degenerate[0].data.r) * degenerate[0].data.T)
+		- degenerate[0].data.K * exp(-degenerate[0].data.r * degenerate[0].data.T);
+	double zero = flat.Price(0, degenerate[0].S, 0.0, 0.0);
+	double expired = flat.Price(1, degenerate[1].S, degenerate[1].data.sig, degenerate[1].data.t);
+	ok &= Check("Zero volatility and expired contracts always fall back", flat.Stats().fallbacks == 2 && flat.Stats().outsideRegion == 2
+		&& fabs(zero - max(forward, 0.0)) <= 1e-12 * degenerate[0].S && expired == max(degenerate[1].S - degenerate[1].data.K, 0.0));
+
+	return Result(ok);
+}
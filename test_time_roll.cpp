@@ -0,0 +1,151 @@
+// test_time_roll.cpp
+//
+// Time roll repricing, theta, P&L explain and calendar
+//
+// Usage: test_time_roll [underlyings]
+// Rolls a book of underlyings (default 20) chains forward with every supported
+// CpuDispatch variant and compares prices and deltas with EuropeanOptionFunction
+// on the rolled contracts, theta with a central finite difference in t, checks
+// that the explain of a one day roll with a spot move leaves a small residual
+// and adds up to the price change, that expired and zero volatility options get
+// their intrinsic values, and that the calendar counts business days across a
+// weekend and a holiday.
+// Exits with 1 when a check fails.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cpu_dispatch.hpp"
+#include "european_option_function.hpp"
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "test_check.hpp"
+#include "time_roll.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+using namespace OptionFunction::TestCheck;
+
+static double Price(const ChainOption& o) {
+	return o.optType == 'P' ? EuropeanOptionFunction::PutPrice(o.data, o.S) : EuropeanOptionFunction::CallPrice(o.data, o.S);
+}
+
+static double Delta(const ChainOption& o) {
+	return o.optType == 'P' ? EuropeanOptionFunction::PutDelta(o.data, o.S) : EuropeanOptionFunction::CallDelta(o.data, o.S);
+}
+
+int main(int argc, char* argv[]) {
+	size_t underlyings = (argc > 1) ? strtoul(argv[1], 0, 10) : 20;
+	bool ok = true;
+
+	vector<ChainOption> book;
+	for (size_t u = 0; u < underlyings; u++) {
+		double S = 80.0 + 2.0 * double(u);
+		for (size_t k = 0; k < 15; k++) {
+			OptionData data = { 0.2 + 0.1 * double(k % 5), S * (0.7 + 0.04 * double(k)), 0.1 + 0.02 * double(k % 6),
+				0.04, 0.01 * double(u % 3), 0.0, 0.0 };
+			ChainOption call = { data, S, uint32_t(u), 'C' };
+			ChainOption put = { data, S, uint32_t(u), 'P' };
+			book.push_back(call);
+			book.push_back(put);
+		}
+	}
+
+	// Roll(dt > 0) against the formulas on the rolled contracts, every variant.
+	const double dt = 0.05;
+	CpuIsa active = CpuDispatch::Active();
+	for (int isa = 0; isa < ISA_COUNT; isa++) {
+		if (!CpuDispatch::Supported(CpuIsa(isa)))
+			continue;
+		CpuDispatch::Select(CpuIsa(isa));
+		TimeRollEngine engine(book);
+		engine.Roll(dt);
+		engine.Roll(dt);
+		vector<ChainOption> rolled = engine.Book();
+		double priceError = 0.0, deltaError = 0.0;
+		for (size_t i = 0; i < rolled.size(); i++) {
+			priceError = max(priceError, fabs(engine.Price()[i] - Price(rolled[i])) / rolled[i].data.K);
+			deltaError = max(deltaError, fabs(engine.Delta()[i] - Delta(rolled[i])));
+		}
+		string name = CpuDispatch::Name(CpuIsa(isa));
+		ok &= Check("Rolled contracts advanced, " + name, fabs(engine.Elapsed() - 2.0 * dt) < 1e-15 && rolled[0].data.t == engine.Elapsed());
+		ok &= Difference("Rolled prices, " + name, priceError, 1e-12);
+		ok &= Difference("Rolled deltas, " + name, deltaError, 1e-12);
+	}
+	CpuDispatch::Select(active);
+
+	// Theta is the value change per year of valuation time.
+	TimeRollEngine engine(book);
+	engine.Roll(dt);
+	vector<ChainOption> rolled = engine.Book();
+	const double h = 1e-4;
+	double thetaError = 0.0;
+	for (size_t i = 0; i < rolled.size(); i++) {
+		ChainOption up = rolled[i], down = rolled[i];
+		up.data.t += h;
+		down.data.t -= h;
+		double difference = (Price(up) - Price(down)) / (2.0 * h);
+		thetaError = max(thetaError, fabs(engine.Theta()[i] - difference) / rolled[i].data.K);
+	}
+	ok &= Difference("Theta against a central difference in t", thetaError, 1e-8);
+
+	// One business day with 0.5% spot moves.
+	vector<double> moved(book.size());
+	for (size_t i = 0; i < book.size(); i++)
+		moved[i] = book[i].S * ((i / 30) % 2 ? 1.005 : 0.995);
+	vector<double> before = engine.Price();
+	ok &= Check("Spot size mismatch rejected", !engine.Roll(1.0 / 252.0, vector<double>(3, 100.0)));
+	ok &= Check("Roll with spot moves", engine.Roll(1.0 / 252.0, moved));
+	double total = 0.0, residual = 0.0, adds = 0.0;
+	for (size_t i = 0; i < book.size(); i++) {
+		const TimeRollExplain& e = engine.Explain()[i];
+		adds = max(adds, fabs(e.total - (engine.Price()[i] - before[i])) + fabs(e.delta + e.gamma + e.theta + e.residual - e.total));
+		total += fabs(e.total);
+		residual += fabs(e.residual);
+	}
+	cout << "Explain residual " << residual << " of a total move " << total << endl;
+	ok &= Difference("Explain adds up to the price change", adds, 1e-12);
+	ok &= Check("Explain residual below 2% of the move", residual < 0.02 * total);
+	TimeRollExplain sum = engine.ExplainTotal();
+	double direct = 0.0;
+	for (size_t i = 0; i < book.size(); i++)
+		direct += engine.Explain()[i].total;
+	ok &= Difference("ExplainTotal() against the book sum", fabs(sum.total - direct) + fabs(sum.delta + sum.gamma + sum.theta + sum.residual - sum.total), 1e-10);
+
+	// Expired and zero volatility options.
+	OptionData flat = { 1.0, 100.0, 0.0, 0.05, 0.02, 0.0, 0.0 };
+	OptionData shortDated = { 0.1, 100.0, 0.3, 0.05, 0.02, 0.0, 0.0 };
+	ChainOption special[] = { { flat, 110.0, 0, 'C' }, { flat, 110.0, 0, 'P' }, { shortDated, 90.0, 0, 'P' }, { shortDated, 90.0, 0, 'C' } };
+	TimeRollEngine edge(vector<ChainOption>(special, special + 4));
+	double forward = 110.0 * exp(-0.03), strike = 100.0 * exp(-0.05);
+	ok &= Check("Zero volatility worth the discounted forward intrinsic value", fabs(edge.Price()[0] - (forward - strike)) < 1e-12
+		&& edge.Price()[1] == 0.0 && edge.Gamma()[0] == 0.0 && fabs(edge.Delta()[0] - exp(-0.03)) < 1e-15);
+	edge.Roll(0.2);
+	ok &= Check("Expired options worth their intrinsic value", edge.Price()[2] == 10.0 && edge.Price()[3] == 0.0
+		&& edge.Delta()[2] == 0.0 && edge.Gamma()[2] == 0.0 && edge.Theta()[2] == 0.0);
+
+	// Calendar, day 0 a Monday.
+	TimeRollCalendar business;
+	TimeRollCalendar calendar(false);
+	ok &= Check("Weekend", !business.IsBusinessDay(5) && !business.IsBusinessDay(6) && business.IsBusinessDay(7)
+		&& business.BusinessDays(4, 7) == 1 && business.BusinessDays(7, 4) == -1 && business.BusinessDays(0, 14) == 10
+		&& business.BusinessDays(-3, 0) == 1);
+	ok &= Check("Year fractions", business.YearFraction(4, 7) == 1.0 / 252.0 && calendar.YearFraction(4, 7) == 3.0 / 365.0);
+	business.AddHoliday(7);
+	business.AddHoliday(7);
+	business.AddHoliday(13);	// A Sunday, no effect.
+	ok &= Check("Holiday", !business.IsBusinessDay(7) && business.BusinessDays(4, 7) == 0 && business.BusinessDays(4, 8) == 1
+		&& business.BusinessDays(0, 14) == 9 && business.BusinessDays(8, 4) == -1);
+
+	// A weekend roll over the holiday moves the book by one business day.
+	TimeRollEngine weekend(book), oneDay(book);
+	weekend.Roll(business, 4, 8);
+	oneDay.Roll(1.0 / 252.0);
+	ok &= Check("Calendar roll", weekend.Elapsed() == 1.0 / 252.0 && weekend.Price() == oneDay.Price());
+
+	return Result(ok);
+}
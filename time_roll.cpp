@@ -0,0 +1,358 @@
+// time_roll.cpp
+//
+// TimeRollCalendar and TimeRollEngine implementation.
+//
+
+#include "time_roll.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "cpu_dispatch.hpp"
+#include "option_chain.hpp"
+#include "option_data.hpp"
+#include "pricing_metrics.hpp"
+#include "pricing_trace.hpp"
+#include "reproducible_sum.hpp"
+#include "simd_math.hpp"
+
+using namespace std;
+using namespace OptionFunction;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIME_ROLL_X86 1
+#define TIME_ROLL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+static bool IsWeekday(long day) {
+	return ((day % 7) + 7) % 7 < 5;
+}
+
+// Weekdays in (from, to], from <= to.
+static long Weekdays(long from, long to) {
+	long days = to - from;
+	long tmp = days / 7 * 5;
+	for (long d = from + days / 7 * 7 + 1; d <= to; d++) {
+		if (IsWeekday(d))
+			tmp++;
+	}
+	return tmp;
+}
+
+TimeRollCalendar::TimeRollCalendar(bool businessDays) : businessDays(businessDays) {
+}
+
+TimeRollCalendar::~TimeRollCalendar() {
+}
+
+void TimeRollCalendar::AddHoliday(long day) {
+	vector<long>::iterator it = lower_bound(holidays.begin(), holidays.end(), day);
+	if (it == holidays.end() || *it != day)
+		holidays.insert(it, day);
+}
+
+bool TimeRollCalendar::IsBusinessDay(long day) const {
+	return IsWeekday(day) && !binary_search(holidays.begin(), holidays.end(), day);
+}
+
+long TimeRollCalendar::BusinessDays(long from, long to) const {
+	if (to < from)
+		return -BusinessDays(to, from);
+	long tmp = Weekdays(from, to);
+	vector<long>::const_iterator it = upper_bound(holidays.begin(), holidays.end(), from);
+	for (; it != holidays.end() && *it <= to; it++) {
+		if (IsWeekday(*it))
+			tmp--;
+	}
+	return tmp;
+}
+
+double TimeRollCalendar::YearFraction(long from, long to) const {
+	if (businessDays)
+		return BusinessDays(from, to) / 252.0;
+	return (to - from) / 365.0;
+}
+
+TimeRollEngine::TimeRollEngine(const vector<ChainOption>& book) : book(book), elapsed(0.0) {
+	size_t size = book.size();
+	K.resize(size);
+	logK.resize(size);
+	halfVar.resize(size);
+	sig.resize(size);
+	sign.resize(size);
+	r.resize(size);
+	b.resize(size);
+	tau.resize(size);
+	sqrtTau.resize(size);
+	discount.resize(size);
+	carry.resize(size);
+	S.resize(size);
+	price.resize(size);
+	delta.resize(size);
+	gamma.resize(size);
+	theta.resize(size);
+	explain.resize(size);
+
+	for (size_t i = 0; i < size; i++) {
+		const ChainOption& o = book[i];
+		K[i] = o.data.K;
+		logK[i] = log(o.data.K);
+		halfVar[i] = 0.5 * o.data.sig * o.data.sig;
+		sig[i] = o.data.sig;
+		sign[i] = (o.optType == 'P' || o.optType == 'p') ? -1.0 : 1.0;
+		r[i] = o.data.r;
+		b[i] = o.data.b;
+		tau[i] = o.data.T - o.data.t;
+		S[i] = o.S;
+	}
+	Reprice(0.0, S.data());
+	for (size_t i = 0; i < size; i++) {
+		TimeRollExplain zero = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+		explain[i] = zero;
+	}
+}
+
+TimeRollEngine::~TimeRollEngine() {
+}
+
+void TimeRollEngine::Roll(double dt) {
+	Reprice(dt, S.data());
+}
+
+bool TimeRollEngine::Roll(double dt, const vector<double>& S) {
+	if (S.size() != book.size()) {
+		cout << "Book and spot price sizes differ" << endl;
+		return false;
+	}
+	Reprice(dt, S.data());
+	return true;
+}
+
+void TimeRollEngine::Roll(const TimeRollCalendar& calendar, long from, long to) {
+	Reprice(calendar.YearFraction(from, to), S.data());
+}
+
+// Reproducible over the book order, see ReproducibleSum.
+TimeRollExplain TimeRollEngine::ExplainTotal() const {
+	static_assert(sizeof(TimeRollExplain) == 5 * sizeof(double), "TimeRollExplain must be five packed doubles");
+	vector<double> sum = OptionFunction::ReproducibleSum::ColumnSums(reinterpret_cast<const double*>(explain.data()), explain.size(), 5);
+	TimeRollExplain tmp = { sum[0], sum[1], sum[2], sum[3], sum[4] };
+	return tmp;
+}
+
+vector<ChainOption> TimeRollEngine::Book() const {
+	vector<ChainOption> tmp = book;
+	for (size_t i = 0; i < tmp.size(); i++) {
+		tmp[i].data.t += elapsed;
+		tmp[i].S = S[i];
+	}
+	return tmp;
+}
+
+// Arrays of a TimeRollEngine, so the file static kernels below can reach them.
+struct TimeRollArrays {
+	const double* K;
+	const double* logK;
+	const double* halfVar;
+	const double* sig;
+	const double* sign;
+	const double* r;
+	const double* b;
+	double* tau;
+	double* sqrtTau;
+	double* discount;
+	double* carry;
+	double* S;
+	double* price;
+	double* delta;
+	double* gamma;
+	double* theta;
+	TimeRollExplain* explain;
+};
+
+static const double INV_SQRT_2PI = 0.398942280401432677939946;
+
+// With s the sign, s = 1 for calls and -1 for puts (Haug):
+// price = s (S C N(s d1) - K D N(s d2)), delta = s C N(s d1), gamma = C n(d1) / (S sig sqrt(tau)),
+// theta = -S C n(d1) sig / (2 sqrt(tau)) - s ((b - r) S C N(s d1) + r K D N(s d2)),
+// with carry factor C = exp((b - r) tau) and discount D = exp(-r tau).
+// One option with the C library erfc, the baseline variant and the fallback of
+// the vector loop for expired options and options without volatility.
+static void RepriceOne(const TimeRollArrays& a, size_t i, double dt, double newS) {
+	double oldPrice = a.price[i];
+	double dS = newS - a.S[i];
+	TimeRollExplain e;
+	e.delta = a.delta[i] * dS;
+	e.gamma = 0.5 * a.gamma[i] * dS * dS;
+	e.theta = a.theta[i] * dt;
+
+	// Time dependent terms.
+	a.tau[i] -= dt;
+	a.S[i] = newS;
+	double s = a.sign[i];
+	double r = a.r[i], b = a.b[i];
+	if (a.tau[i] <= 0.0 || a.sig[i] <= 0.0) {
+		// Discounted forward intrinsic value, the plain intrinsic value at expiry.
+		a.tau[i] = max(a.tau[i], 0.0);
+		a.sqrtTau[i] = sqrt(a.tau[i]);
+		a.discount[i] = exp(-r * a.tau[i]);
+		a.carry[i] = exp((b - r) * a.tau[i]);
+		double forward = a.S[i] * a.carry[i];
+		double strike = a.K[i] * a.discount[i];
+		bool live = a.tau[i] > 0.0 && s * (forward - strike) > 0.0;	// In the money before expiry.
+		a.price[i] = max(s * (forward - strike), 0.0);
+		a.delta[i] = live ? s * a.carry[i] : 0.0;
+		a.gamma[i] = 0.0;
+		a.theta[i] = live ? -s * ((b - r) * forward + r * strike) : 0.0;
+	} else {
+		a.sqrtTau[i] = sqrt(a.tau[i]);
+		a.discount[i] = exp(-r * a.tau[i]);
+		a.carry[i] = exp((b - r) * a.tau[i]);
+
+		double w = a.sig[i] * a.sqrtTau[i];
+		double d1 = (log(a.S[i]) - a.logK[i] + (b + a.halfVar[i]) * a.tau[i]) / w;
+		double d2 = d1 - w;
+		double Nd1 = 0.5 * erfc(-s * d1 * M_SQRT1_2);
+		double Nd2 = 0.5 * erfc(-s * d2 * M_SQRT1_2);
+		double nd1 = INV_SQRT_2PI * exp(-0.5 * d1 * d1);
+		double forward = a.S[i] * a.carry[i];
+		double strike = a.K[i] * a.discount[i];
+
+		a.price[i] = s * (forward * Nd1 - strike * Nd2);
+		a.delta[i] = s * a.carry[i] * Nd1;
+		a.gamma[i] = a.carry[i] * nd1 / (a.S[i] * w);
+		a.theta[i] = -forward * nd1 * a.sig[i] / (2.0 * a.sqrtTau[i]) - s * ((b - r) * forward * Nd1 + r * strike * Nd2);
+	}
+
+	e.total = a.price[i] - oldPrice;
+	e.residual = e.total - e.delta - e.gamma - e.theta;
+	a.explain[i] = e;
+}
+
+static void RepriceBaseline(const TimeRollArrays& a, double dt, const double* newS, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		RepriceOne(a, i, dt, newS[i]);
+}
+
+// Options per block of the vector loop, copied into local arrays with a fixed
+// trip count so the loop vectorizes at -O2; a short last block is padded.
+static const size_t ROLL_BLOCK = 64;
+
+// Same formulas over SimdMath, forced inline into one wrapper per CpuDispatch
+// variant. The explain needs the greeks before the roll, so it is taken while
+// the block is stored.
+SIMD_MATH_INLINE void RepriceBody(const TimeRollArrays& a, double dt, const double* newS, size_t size) {
+	double tau[ROLL_BLOCK], S[ROLL_BLOCK], sig[ROLL_BLOCK], logK[ROLL_BLOCK], halfVar[ROLL_BLOCK];
+	double K[ROLL_BLOCK], sign[ROLL_BLOCK], r[ROLL_BLOCK], b[ROLL_BLOCK];
+	double sqrtTau[ROLL_BLOCK], discount[ROLL_BLOCK], carry[ROLL_BLOCK];
+	double price[ROLL_BLOCK], delta[ROLL_BLOCK], gamma[ROLL_BLOCK], theta[ROLL_BLOCK];
+	bool degenerate[ROLL_BLOCK];
+	for (size_t start = 0; start < size; start += ROLL_BLOCK) {
+		size_t n = min(ROLL_BLOCK, size - start);
+		for (size_t i = 0; i < ROLL_BLOCK; i++) {
+			size_t j = start + i;
+			bool used = i < n;
+			tau[i] = used ? a.tau[j] - dt : 1.0;
+			S[i] = used ? newS[j] : 1.0;
+			sig[i] = used ? a.sig[j] : 0.2;
+			logK[i] = used ? a.logK[j] : 0.0;
+			halfVar[i] = used ? a.halfVar[j] : 0.02;
+			K[i] = used ? a.K[j] : 1.0;
+			sign[i] = used ? a.sign[j] : 1.0;
+			r[i] = used ? a.r[j] : 0.0;
+			b[i] = used ? a.b[j] : 0.0;
+			degenerate[i] = !(tau[i] > 0.0 && sig[i] > 0.0);
+			if (degenerate[i]) {	// Harmless values, RepriceOne prices it.
+				tau[i] = 1.0;
+				sig[i] = 0.2;
+			}
+		}
+		for (size_t i = 0; i < ROLL_BLOCK; i++) {
+			double s = sign[i];
+			sqrtTau[i] = SimdMath::Sqrt(tau[i]);
+			discount[i] = SimdMath::Exp(-r[i] * tau[i]);
+			carry[i] = SimdMath::Exp((b[i] - r[i]) * tau[i]);
+
+			double w = sig[i] * sqrtTau[i];
+			double d1 = (SimdMath::Log(S[i]) - logK[i] + (b[i] + halfVar[i]) * tau[i]) / w;
+			double d2 = d1 - w;
+			double Nd1 = SimdMath::NormalCdf(s * d1);
+			double Nd2 = SimdMath::NormalCdf(s * d2);
+			double nd1 = INV_SQRT_2PI * SimdMath::Exp(-0.5 * d1 * d1);
+			double forward = S[i] * carry[i];
+			double strike = K[i] * discount[i];
+
+			price[i] = s * (forward * Nd1 - strike * Nd2);
+			delta[i] = s * carry[i] * Nd1;
+			gamma[i] = carry[i] * nd1 / (S[i] * w);
+			theta[i] = -forward * nd1 * sig[i] / (2.0 * sqrtTau[i]) - s * ((b[i] - r[i]) * forward * Nd1 + r[i] * strike * Nd2);
+		}
+		for (size_t i = 0; i < n; i++) {
+			size_t j = start + i;
+			if (degenerate[i]) {
+				RepriceOne(a, j, dt, newS[j]);
+				continue;
+			}
+			double dS = newS[j] - a.S[j];
+			TimeRollExplain e;
+			e.delta = a.delta[j] * dS;
+			e.gamma = 0.5 * a.gamma[j] * dS * dS;
+			e.theta = a.theta[j] * dt;
+			e.total = price[i] - a.price[j];
+			e.residual = e.total - e.delta - e.gamma - e.theta;
+			a.explain[j] = e;
+
+			a.tau[j] = tau[i];
+			a.S[j] = S[i];
+			a.sqrtTau[j] = sqrtTau[i];
+			a.discount[j] = discount[i];
+			a.carry[j] = carry[i];
+			a.price[j] = price[i];
+			a.delta[j] = delta[i];
+			a.gamma[j] = gamma[i];
+			a.theta[j] = theta[i];
+		}
+	}
+}
+
+static void RepriceSse2(const TimeRollArrays& a, double dt, const double* newS, size_t size) {
+	RepriceBody(a, dt, newS, size);
+}
+
+#ifdef TIME_ROLL_X86
+TIME_ROLL_TARGET("avx2,fma")
+static void RepriceAvx2(const TimeRollArrays& a, double dt, const double* newS, size_t size) {
+	RepriceBody(a, dt, newS, size);
+}
+
+TIME_ROLL_TARGET("avx512f,avx512dq,avx2,fma,prefer-vector-width=512")
+static void RepriceAvx512(const TimeRollArrays& a, double dt, const double* newS, size_t size) {
+	RepriceBody(a, dt, newS, size);
+}
+#endif
+
+// newS may be S itself, every entry is read before it is written.
+void TimeRollEngine::Reprice(double dt, const double* newS) {
+	PRICING_METRIC("TimeRollEngine::Roll", book.size());
+	PricingTrace::Span span("roll", "time roll", book.size());
+	elapsed += dt;
+	TimeRollArrays a = { K.data(), logK.data(), halfVar.data(), sig.data(), sign.data(), r.data(), b.data(),
+		tau.data(), sqrtTau.data(), discount.data(), carry.data(), S.data(),
+		price.data(), delta.data(), gamma.data(), theta.data(), explain.data() };
+	switch (CpuDispatch::Active()) {
+	case ISA_BASELINE:
+		RepriceBaseline(a, dt, newS, book.size());
+		break;
+#ifdef TIME_ROLL_X86
+	case ISA_AVX512:
+		RepriceAvx512(a, dt, newS, book.size());
+		break;
+	case ISA_AVX2:
+		RepriceAvx2(a, dt, newS, book.size());
+		break;
+#endif
+	default:
+		RepriceSse2(a, dt, newS, book.size());
+		break;
+	}
+}
@@ -0,0 +1,142 @@
+// time_roll.hpp
+//
+// Header file for Class TimeRollCalendar and Class TimeRollEngine.
+// Book repricing as the valuation date advances.
+//
+
+#ifndef TIME_ROLL_HPP_
+#define TIME_ROLL_HPP_
+
+#include <cstddef>
+#include <vector>
+#include "option_chain.hpp"
+#include "option_data.hpp"
+
+using namespace std;
+
+// Day count calendar for time rolls.
+// Days are serial numbers with day 0 a Monday; days 5 and 6 of every week are
+// the weekend. With business day counting a year is 252 business days and only
+// business days between two dates count; otherwise a year is 365 calendar days.
+// Add holidays with AddHoliday(long), they only matter for business day counting.
+class TimeRollCalendar {
+public:
+	// Constructors & destructor.
+	TimeRollCalendar(bool businessDays = true);	// 252 business or 365 calendar days a year.
+	virtual ~TimeRollCalendar();	// Destructor.
+
+	void AddHoliday(long day);
+	bool IsBusinessDay(long day) const;
+	long BusinessDays(long from, long to) const;	// Business days in (from, to].
+	double YearFraction(long from, long to) const;	// Time from the close of day from to the close of day to.
+
+	// Selectors.
+	bool BusinessDayCount() const;
+
+private:
+	bool businessDays;
+	vector<long> holidays;	// Sorted, no duplicates.
+};
+
+// P&L explain of one option over one roll, from the greeks before the roll.
+struct TimeRollExplain {
+	double total;		// Price change.
+	double delta;		// delta * dS.
+	double gamma;		// 0.5 * gamma * dS^2.
+	double theta;		// theta * dt.
+	double residual;	// total - delta - gamma - theta.
+};
+
+// Time roll engine.
+// The book is priced once at construction with time to expiry T - t. The engine
+// keeps the static terms (strike, log strike, half variance rate, sign) and the
+// time dependent terms (time to expiry, sqrt, discount exp(-r tau) and carry
+// factor exp((b - r) tau)) of every option in contiguous arrays. Roll(double dt)
+// advances the valuation time of the whole book by dt years, refreshes only the
+// time dependent terms and reprices price, delta, gamma and theta in one pass,
+// over SimdMath in the variant CpuDispatch selected (the erfc loop for
+// ISA_BASELINE); Roll(double dt, const vector<double>& S) also moves the spot prices.
+// Each roll records a P&L explain per option, see Explain(). Options that reach
+// expiry are worth their intrinsic value with zero greeks; options without
+// volatility are worth the discounted forward intrinsic value
+// max(s (S exp((b - r) tau) - K exp(-r tau)), 0), with gamma 0.
+// Theta is the change of value per year of valuation time (Haug, generalized
+// Black-Scholes with carry).
+// Access the results with Price(), Delta(), Gamma(), Theta() in book order,
+// the updated contracts with Book() and the elapsed time with Elapsed().
+class TimeRollEngine {
+public:
+	// Constructors & destructor.
+	TimeRollEngine(const vector<ChainOption>& book);	// Price the book at its current dates.
+	virtual ~TimeRollEngine();	// Destructor.
+
+	void Roll(double dt);	// Advance valuation time by dt years, spots unchanged.
+	bool Roll(double dt, const vector<double>& S);	// Advance and move spots, false on a size mismatch.
+	void Roll(const TimeRollCalendar& calendar, long from, long to);	// Overnight or weekend roll.
+
+	// Selectors.
+	size_t Size() const;
+	double Elapsed() const;	// Valuation time rolled since construction.
+	const vector<double>& Price() const;
+	const vector<double>& Delta() const;
+	const vector<double>& Gamma() const;
+	const vector<double>& Theta() const;
+	const vector<TimeRollExplain>& Explain() const;	// Of the last roll.
+	TimeRollExplain ExplainTotal() const;	// Book sum of the last roll.
+	vector<ChainOption> Book() const;	// Contracts with t advanced and the current spots.
+
+private:
+	vector<ChainOption> book;
+	double elapsed;
+
+	// Static terms.
+	vector<double> K, logK, halfVar, sig, sign, r, b;
+
+	// Time dependent terms.
+	vector<double> tau, sqrtTau, discount, carry;
+
+	// Market and results.
+	vector<double> S, price, delta, gamma, theta;
+	vector<TimeRollExplain> explain;
+
+	void Reprice(double dt, const double* newS);	// Refresh the time terms and greeks.
+
+	// No copy.
+	TimeRollEngine(const TimeRollEngine&);
+	TimeRollEngine& operator = (const TimeRollEngine&);
+};
+
+// Implementation of the normal inline function.
+inline bool TimeRollCalendar::BusinessDayCount() const {
+	return businessDays;
+}
+
+inline size_t TimeRollEngine::Size() const {
+	return book.size();
+}
+
+inline double TimeRollEngine::Elapsed() const {
+	return elapsed;
+}
+
+inline const vector<double>& TimeRollEngine::Price() const {
+	return price;
+}
+
+inline const vector<double>& TimeRollEngine::Delta() const {
+	return delta;
+}
+
+inline const vector<double>& TimeRollEngine::Gamma() const {
+	return gamma;
+}
+
+inline const vector<double>& TimeRollEngine::Theta() const {
+	return theta;
+}
+
+inline const vector<TimeRollExplain>& TimeRollEngine::Explain() const {
+	return explain;
+}
+
+#endif	// TIME_ROLL_HPP_